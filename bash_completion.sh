@@ -1,36 +1,47 @@
 # Completions for the programs
-lda_commands="transform train"
+lda_commands="transform train serve"
 lda_train=$(echo "--help" "--quiet" "--workers" "--topics" "--iterations"  \
     "--random_state" "--snapshot_every" "--continue" "--e_step_iterations" \
     "--e_step_tolerance" "--compute_likelihood" "--initialize_seeded"      \
-    "--initialize_random")
+    "--initialize_random" "--shards" "--blocks_per_shard" "--shard_storage" \
+    "--warm_start" "--warm_start_storage" "--skip_converged" "--numa"     \
+    "--deterministic" "--precision" "--hash_buckets" "--checkpoint")
 lda_transform=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
-    "--e_step_tolerance")
+    "--e_step_tolerance" "--precision")
+lda_serve=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
+    "--e_step_tolerance" "--max_batch" "--max_latency" "--precision")
 
-slda_commands="transform train"
+slda_commands="transform train serve"
 slda_train=$(echo "--help" "--quiet" "--workers" "--topics" "--iterations"  \
     "--random_state" "--snapshot_every" "--continue" "--e_step_iterations"  \
     "--e_step_tolerance" "--compute_likelihood" "--fixed_point_iteration"   \
     "--m_step_iterations" "--m_step_tolerance" "--regularization_penalty"   \
-    "--initialize_seeded" "--initialize_random")
+    "--initialize_seeded" "--initialize_random" "--deterministic"          \
+    "--precision" "--hash_buckets" "--checkpoint")
 slda_transform=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
-    "--e_step_tolerance")
+    "--e_step_tolerance" "--precision")
+slda_serve=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
+    "--e_step_tolerance" "--max_batch" "--max_latency" "--precision")
 
-fslda_commands="transform train online_train"
+fslda_commands="transform train online_train serve"
 fslda_train=$(echo "--help" "--quiet" "--workers" "--topics" "--iterations"   \
     "--random_state" "--snapshot_every" "--continue" "--e_step_iterations"    \
     "--e_step_tolerance" "--compute_likelihood"                               \
     "--m_step_iterations" "--m_step_tolerance" "--continue_from_unsupervised" \
     "--supervised_weight" "--regularization_penalty" "--initialize_seeded"    \
-    "--initialize_random")
+    "--initialize_random" "--deterministic" "--precision" "--hash_buckets" \
+    "--checkpoint")
 fslda_online_train=$(echo "--help" "--quiet" "--workers" "--topics"   \
     "--iterations" "--random_state" "--snapshot_every" "--continue"   \
     "--e_step_iterations" "--e_step_tolerance" "--compute_likelihood" \
     "--batch_size" "--momentum" "--learning_rate" "--beta_weight"     \
     "--continue_from_unsupervised" "--supervised_weight"              \
-    "--regularization_penalty" "--initialize_seeded" "--initialize_random")
+    "--regularization_penalty" "--initialize_seeded" "--initialize_random" \
+    "--hogwild" "--deterministic" "--precision" "--hash_buckets" "--checkpoint")
 fslda_transform=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
-    "--e_step_tolerance")
+    "--e_step_tolerance" "--precision")
+fslda_serve=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
+    "--e_step_tolerance" "--max_batch" "--max_latency" "--precision")
 
 _ldaplusplus()
 {
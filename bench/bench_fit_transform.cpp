@@ -0,0 +1,207 @@
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <Eigen/Core>
+
+#include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+
+#include "synthetic_corpus.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+typedef std::chrono::duration<double, std::ratio<1> > seconds;
+
+
+/**
+ * An expectation and maximization step pairing as can be configured through
+ * the LDABuilder.
+ */
+struct Combination
+{
+    std::string name;
+    std::function<void(LDABuilder<double> &, size_t)> configure;
+    // The multinomial models need eta to be a distribution
+    bool uniform_eta;
+};
+
+
+std::vector<Combination> combinations() {
+    return {
+        {"classic/classic", [](LDABuilder<double> &b, size_t C) {
+            b.set_classic_e_step().set_classic_m_step();
+        }, false},
+        {"supervised/supervised", [](LDABuilder<double> &b, size_t C) {
+            b.set_supervised_e_step().set_supervised_m_step();
+        }, false},
+        {"fast_supervised/fast_supervised", [](LDABuilder<double> &b, size_t C) {
+            b.set_fast_supervised_e_step().set_fast_supervised_m_step();
+        }, false},
+        {"fast_supervised/fast_supervised_online", [](LDABuilder<double> &b, size_t C) {
+            b.set_fast_supervised_e_step().set_fast_supervised_online_m_step(C);
+        }, false},
+        {"semi_supervised/semi_supervised", [](LDABuilder<double> &b, size_t C) {
+            b.set_semi_supervised_e_step().set_semi_supervised_m_step();
+        }, false},
+        {"multinomial_supervised/multinomial_supervised", [](LDABuilder<double> &b, size_t C) {
+            b.set_multinomial_supervised_e_step().set_multinomial_supervised_m_step();
+        }, true},
+        {"correspondence_supervised/correspondence_supervised", [](LDABuilder<double> &b, size_t C) {
+            b.set_correspondence_supervised_e_step().set_correspondence_supervised_m_step();
+        }, true}
+    };
+}
+
+
+/**
+ * Train and transform with a single configuration and print a line of
+ * results. It is meant to be run in a child process so that the peak RSS
+ * refers to this configuration alone.
+ */
+void run(
+    const SyntheticCorpus &corpus,
+    const Combination &combination,
+    size_t topics,
+    size_t classes,
+    size_t epochs,
+    size_t workers
+) {
+    LDABuilder<double> builder;
+    builder.set_iterations(epochs).set_workers(workers);
+    combination.configure(builder, classes);
+    builder.initialize_topics_seeded(corpus.X, topics);
+    if (combination.uniform_eta) {
+        builder.initialize_eta_uniform(classes);
+    } else {
+        builder.initialize_eta_zeros(classes);
+    }
+    LDA<double> lda = builder;
+
+    std::chrono::high_resolution_clock clock;
+    std::vector<double> epoch_times;
+    auto epoch_start = clock.now();
+    lda.get_event_dispatcher()->add_listener(
+        [&](std::shared_ptr<events::Event> event) {
+            if (event->type() == events::EpochProgressEvent<double>::type_tag()) {
+                auto now = clock.now();
+                epoch_times.push_back(
+                    std::chrono::duration_cast<seconds>(now - epoch_start).count()
+                );
+                epoch_start = now;
+            }
+        }
+    );
+
+    auto start = clock.now();
+    epoch_start = start;
+    lda.fit(corpus.X, corpus.y);
+    double fit_time = std::chrono::duration_cast<seconds>(clock.now() - start).count();
+
+    // Inference uses the classic expectation step on the trained model like
+    // the console applications do
+    auto model = lda.model_parameters<parameters::SupervisedModelParameters<double> >();
+    LDA<double> inference = LDABuilder<double>().
+        set_workers(workers).
+        set_classic_e_step(10, 1e-2, 0.0).
+        initialize_topics_from_model(model).
+        initialize_eta_from_model(model);
+
+    start = clock.now();
+    MatrixXd gammas = inference.transform(corpus.X);
+    double transform_time = std::chrono::duration_cast<seconds>(clock.now() - start).count();
+
+    double mean_epoch = 0;
+    for (auto t : epoch_times) {
+        mean_epoch += t;
+    }
+    mean_epoch /= std::max<size_t>(1, epoch_times.size());
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    double D = corpus.X.cols();
+    double N = corpus.tokens;
+    std::cout << std::left << std::setw(54) << combination.name
+              << std::right << std::setw(4) << workers
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << (D * epochs / fit_time)
+              << std::setw(14) << (N * epochs / fit_time)
+              << std::setw(12) << (D / transform_time)
+              << std::setw(14) << (N / transform_time)
+              << std::setprecision(4)
+              << std::setw(11) << mean_epoch
+              << std::setw(11) << usage.ru_maxrss / 1024.0
+              << std::endl;
+}
+
+
+/**
+ * Usage: bench_fit_transform [documents [words [topics [classes [length [epochs [max_workers]]]]]]]
+ *
+ * Sample a corpus from a synthetic supervised LDA model and report for every
+ * expectation/maximization step combination and for 1, 2, 4, ... workers the
+ * training and inference throughput, the mean time per epoch and the peak
+ * resident memory.
+ */
+int main(int argc, char **argv) {
+    size_t documents   = (argc > 1) ? std::atoi(argv[1]) : 1000;
+    size_t words       = (argc > 2) ? std::atoi(argv[2]) : 1000;
+    size_t topics      = (argc > 3) ? std::atoi(argv[3]) : 20;
+    size_t classes     = (argc > 4) ? std::atoi(argv[4]) : 5;
+    double length      = (argc > 5) ? std::atof(argv[5]) : 100;
+    size_t epochs      = (argc > 6) ? std::atoi(argv[6]) : 2;
+    size_t max_workers = (argc > 7) ? std::atoi(argv[7]) : std::thread::hardware_concurrency();
+
+    SyntheticCorpus corpus = SyntheticCorpusGenerator().
+        set_topics(topics).
+        set_words(words).
+        set_classes(classes).
+        set_document_length(length, DocumentLength::LogNormal).
+        sample(documents);
+
+    std::cout << documents << " documents, " << words << " words, "
+              << topics << " topics, " << classes << " classes, "
+              << corpus.tokens << " tokens, " << epochs << " epochs" << std::endl;
+    std::cout << std::left << std::setw(54) << "e_step/m_step"
+              << std::right << std::setw(4) << "thr"
+              << std::setw(12) << "fit doc/s"
+              << std::setw(14) << "fit tok/s"
+              << std::setw(12) << "tr doc/s"
+              << std::setw(14) << "tr tok/s"
+              << std::setw(11) << "epoch (s)"
+              << std::setw(11) << "RSS (MB)"
+              << std::endl;
+
+    for (auto & combination : combinations()) {
+        for (size_t workers=1; workers<=std::max<size_t>(1, max_workers); workers*=2) {
+            // Fork so that the peak RSS and the heap state are not shared
+            // between configurations
+            pid_t pid = fork();
+            if (pid == 0) {
+                run(corpus, combination, topics, classes, epochs, workers);
+                std::exit(0);
+            }
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cout << std::left << std::setw(54) << combination.name
+                          << std::right << std::setw(4) << workers
+                          << "  failed" << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
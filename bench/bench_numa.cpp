@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include <Eigen/Core>
+
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/parallel/NumaTopology.hpp"
+
+#include "synthetic_corpus.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+typedef std::chrono::duration<double, std::ratio<1> > seconds;
+
+
+/**
+ * Fit a classic LDA and return the training throughput in documents per
+ * second.
+ */
+double fit(const SyntheticCorpus &corpus, size_t topics, size_t epochs, size_t workers, bool numa) {
+    LDA<double> lda = LDABuilder<double>().
+        set_iterations(epochs).
+        set_workers(workers).
+        set_numa(numa).
+        set_classic_e_step().
+        set_classic_m_step().
+        initialize_topics_seeded(corpus.X, topics).
+        initialize_eta_zeros(1);
+
+    std::chrono::high_resolution_clock clock;
+    auto start = clock.now();
+    lda.fit(corpus.X);
+    double fit_time = std::chrono::duration_cast<seconds>(clock.now() - start).count();
+
+    return corpus.X.cols() * epochs / fit_time;
+}
+
+
+/**
+ * Usage: bench_numa [documents [words [topics [length [epochs [max_workers]]]]]]
+ *
+ * Compare the training throughput of the classic LDA with a single copy of
+ * the model to the one with the workers pinned to the NUMA nodes and a copy
+ * of the model per node. The vocabulary should be large enough for beta
+ * not to fit in the caches for the difference to show.
+ */
+int main(int argc, char **argv) {
+    size_t documents   = (argc > 1) ? std::atoi(argv[1]) : 2000;
+    size_t words       = (argc > 2) ? std::atoi(argv[2]) : 100000;
+    size_t topics      = (argc > 3) ? std::atoi(argv[3]) : 100;
+    double length      = (argc > 4) ? std::atof(argv[4]) : 200;
+    size_t epochs      = (argc > 5) ? std::atoi(argv[5]) : 2;
+    size_t max_workers = (argc > 6) ? std::atoi(argv[6]) : std::thread::hardware_concurrency();
+
+    SyntheticCorpus corpus = SyntheticCorpusGenerator().
+        set_topics(topics).
+        set_words(words).
+        set_document_length(length, DocumentLength::LogNormal).
+        sample(documents);
+
+    std::cout << documents << " documents, " << words << " words, "
+              << topics << " topics, " << corpus.tokens << " tokens, "
+              << epochs << " epochs, "
+              << parallel::NumaTopology().nodes() << " NUMA nodes" << std::endl;
+    std::cout << std::right << std::setw(4) << "thr"
+              << std::setw(16) << "single doc/s"
+              << std::setw(16) << "numa doc/s"
+              << std::setw(10) << "speedup"
+              << std::endl;
+
+    for (size_t workers=1; workers<=std::max<size_t>(1, max_workers); workers*=2) {
+        double single = fit(corpus, topics, epochs, workers, false);
+        double numa = fit(corpus, topics, epochs, workers, true);
+        std::cout << std::setw(4) << workers
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(16) << single
+                  << std::setw(16) << numa
+                  << std::setprecision(2)
+                  << std::setw(10) << numa / single
+                  << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+#ifndef _LDAPLUSPLUS_BENCH_SYNTHETIC_CORPUS_HPP_
+#define _LDAPLUSPLUS_BENCH_SYNTHETIC_CORPUS_HPP_
+
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+
+
+/**
+ * The distribution used to sample the length (in tokens) of each synthetic
+ * document.
+ */
+enum class DocumentLength
+{
+    Constant,
+    Poisson,
+    LogNormal
+};
+
+
+/**
+ * A corpus sampled from a known LDA model together with the parameters that
+ * generated it.
+ */
+struct SyntheticCorpus
+{
+    /** The word counts one document per column (V x D) */
+    Eigen::MatrixXi X;
+    /** The class of each document */
+    Eigen::VectorXi y;
+    /** The true topic mixtures one document per column (K x D) */
+    Eigen::MatrixXd theta;
+    /** The true topic over words distributions (K x V) */
+    Eigen::MatrixXd beta;
+    /** The total number of tokens in the corpus */
+    size_t tokens;
+};
+
+
+/**
+ * Sample corpora from the generative process of supervised LDA so that the
+ * full training and inference pipeline can be benchmarked on data with a
+ * realistic structure.
+ *
+ * 1. The background frequency of each word follows a Zipf law with exponent
+ *    zipf_exponent.
+ * 2. Each topic is sampled from a Dirichlet whose base measure is the Zipfian
+ *    background distribution (with concentration topic_concentration) so
+ *    that topics share the frequent words but differ in the tail.
+ * 3. Each document samples a length from the configured distribution, a topic
+ *    mixture from a symmetric Dirichlet(alpha) and then one topic and one
+ *    word per token.
+ * 4. The class of a document is the class whose topics (topic k belongs to
+ *    class k % classes) have the largest total weight in its mixture.
+ *
+ * Example:
+ *
+ *     SyntheticCorpus c = SyntheticCorpusGenerator().
+ *                             set_topics(50).
+ *                             set_words(5000).
+ *                             sample(10000);
+ */
+class SyntheticCorpusGenerator
+{
+    public:
+        SyntheticCorpusGenerator()
+            : topics_(20),
+              words_(1000),
+              classes_(5),
+              mean_length_(100),
+              length_(DocumentLength::Poisson),
+              alpha_(0.1),
+              zipf_exponent_(1.07),
+              topic_concentration_(100),
+              random_state_(0)
+        {}
+
+        SyntheticCorpusGenerator & set_topics(size_t topics) { topics_ = topics; return *this; }
+        SyntheticCorpusGenerator & set_words(size_t words) { words_ = words; return *this; }
+        SyntheticCorpusGenerator & set_classes(size_t classes) { classes_ = classes; return *this; }
+        SyntheticCorpusGenerator & set_alpha(double alpha) { alpha_ = alpha; return *this; }
+        SyntheticCorpusGenerator & set_zipf_exponent(double s) { zipf_exponent_ = s; return *this; }
+        SyntheticCorpusGenerator & set_random_state(int random_state) { random_state_ = random_state; return *this; }
+
+        /**
+         * @param mean_length The mean number of tokens per document
+         * @param length      The distribution of the document lengths
+         */
+        SyntheticCorpusGenerator & set_document_length(
+            double mean_length,
+            DocumentLength length = DocumentLength::Poisson
+        ) {
+            mean_length_ = mean_length;
+            length_ = length;
+            return *this;
+        }
+
+        /**
+         * Sample a corpus of the given number of documents.
+         */
+        SyntheticCorpus sample(size_t documents) const {
+            std::mt19937 prng(random_state_);
+            SyntheticCorpus corpus;
+
+            // Zipfian background distribution over the vocabulary
+            std::vector<double> background(words_);
+            for (size_t w=0; w<words_; w++) {
+                background[w] = 1.0 / std::pow(w + 1.0, zipf_exponent_);
+            }
+            double background_sum = 0;
+            for (auto b : background) {
+                background_sum += b;
+            }
+
+            // Sample the topics
+            corpus.beta = Eigen::MatrixXd(topics_, words_);
+            for (size_t k=0; k<topics_; k++) {
+                for (size_t w=0; w<words_; w++) {
+                    std::gamma_distribution<double> g(
+                        std::max(topic_concentration_ * background[w] / background_sum, 1e-3),
+                        1.0
+                    );
+                    corpus.beta(k, w) = g(prng) + 1e-12;
+                }
+                corpus.beta.row(k) /= corpus.beta.row(k).sum();
+            }
+            std::vector<std::discrete_distribution<int> > topic_words;
+            for (size_t k=0; k<topics_; k++) {
+                std::vector<double> row(words_);
+                for (size_t w=0; w<words_; w++) {
+                    row[w] = corpus.beta(k, w);
+                }
+                topic_words.emplace_back(row.begin(), row.end());
+            }
+
+            // Sample the documents
+            corpus.X = Eigen::MatrixXi::Zero(words_, documents);
+            corpus.y = Eigen::VectorXi(documents);
+            corpus.theta = Eigen::MatrixXd(topics_, documents);
+            corpus.tokens = 0;
+            std::gamma_distribution<double> theta_gamma(alpha_, 1.0);
+            for (size_t d=0; d<documents; d++) {
+                for (size_t k=0; k<topics_; k++) {
+                    corpus.theta(k, d) = theta_gamma(prng) + 1e-12;
+                }
+                corpus.theta.col(d) /= corpus.theta.col(d).sum();
+
+                std::discrete_distribution<int> topic(
+                    corpus.theta.col(d).data(),
+                    corpus.theta.col(d).data() + topics_
+                );
+                size_t length = sample_length(prng);
+                for (size_t n=0; n<length; n++) {
+                    corpus.X(topic_words[topic(prng)](prng), d)++;
+                }
+                corpus.tokens += length;
+
+                Eigen::VectorXd class_weight = Eigen::VectorXd::Zero(classes_);
+                for (size_t k=0; k<topics_; k++) {
+                    class_weight[k % classes_] += corpus.theta(k, d);
+                }
+                class_weight.maxCoeff(&corpus.y[d]);
+            }
+
+            return corpus;
+        }
+
+    private:
+        size_t sample_length(std::mt19937 &prng) const {
+            switch (length_) {
+                case DocumentLength::Constant:
+                    return static_cast<size_t>(mean_length_);
+                case DocumentLength::Poisson: {
+                    std::poisson_distribution<size_t> length(mean_length_);
+                    return std::max<size_t>(1, length(prng));
+                }
+                case DocumentLength::LogNormal: {
+                    // sigma = 1 and mu chosen so that the mean is mean_length_
+                    std::lognormal_distribution<double> length(std::log(mean_length_) - 0.5, 1.0);
+                    return std::max<size_t>(1, static_cast<size_t>(length(prng)));
+                }
+            }
+            return 1;
+        }
+
+        size_t topics_;
+        size_t words_;
+        size_t classes_;
+        double mean_length_;
+        DocumentLength length_;
+        double alpha_;
+        double zipf_exponent_;
+        double topic_concentration_;
+        int random_state_;
+};
+
+
+#endif  // _LDAPLUSPLUS_BENCH_SYNTHETIC_CORPUS_HPP_
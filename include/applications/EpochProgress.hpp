@@ -2,6 +2,7 @@
 #define _APPLICATIONS_EPOCHPROGRESS_HPP_
 
 #include <iostream>
+#include <vector>
 
 #include "ldaplusplus/events/Events.hpp"
 
@@ -11,18 +12,24 @@ using namespace ldaplusplus;
   * This class is used to keep track of the progress of a complete Expectation
   * - Maximization step.
   */
+template <typename Scalar = double>
 class EpochProgress : public events::EventListenerInterface
 {
     public:
         EpochProgress();
 
         void on_event(std::shared_ptr<events::Event> event);
+        std::vector<size_t> event_types() const;
 
     private:
        int em_iterations_;
        int likelihood_;
        int cnt_likelihoods_;
        int is_first_time_;
+       // The expectation step iterations and warm starts of this epoch
+       size_t e_step_iterations_;
+       size_t documents_;
+       size_t warm_started_;
 };
 
 #endif  // _APPLICATIONS_EPOCHPROGRESS_HPP_
@@ -2,6 +2,7 @@
 #define _APPLICATIONS_EXPECTATIONPROGRESS_HPP_
 
 #include <iostream>
+#include <vector>
 
 #include "ldaplusplus/events/Events.hpp"
 
@@ -17,6 +18,7 @@ class ExpectationProgress : public events::EventListenerInterface
         ExpectationProgress(int print_every = 100);
 
         void on_event(std::shared_ptr<events::Event> event);
+        std::vector<size_t> event_types() const;
 
     private:
         // The number of completed doc_e_step iterations so far.
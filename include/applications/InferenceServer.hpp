@@ -0,0 +1,138 @@
+#ifndef _APPLICATIONS_INFERENCESERVER_HPP_
+#define _APPLICATIONS_INFERENCESERVER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "ldaplusplus/LDA.hpp"
+
+using namespace ldaplusplus;
+
+/**
+ * Keep an LDA model resident and answer inference requests over a Unix
+ * domain socket.
+ *
+ * The requests of all the connections are batched together into a single
+ * LDA::transform() call. A batch is processed as soon as it has max_batch
+ * documents or its oldest request has waited for max_latency.
+ *
+ * Every connection can send any number of requests one after the other
+ * and receives a response for each one in order. All the integers are in
+ * the byte order of the host.
+ *
+ *     request:  uint8 type (0 for gammas, 1 for a prediction)
+ *               uint32 N
+ *               N times (uint32 word index, uint32 count)
+ *     response: int32 status (the predicted class, 0 for gammas or -1 for
+ *               an invalid request)
+ *               uint32 K
+ *               K times float64 (the gamma of the document)
+ *
+ * A request whose N exceeds the size of the vocabulary gets an invalid
+ * response and its connection is closed since the rest of its stream
+ * cannot be parsed. The word indices must be smaller than the size of the
+ * vocabulary and the counts of a word must add up to at most INT_MAX.
+ *
+ * The responses are in double precision whatever the precision of the LDA.
+ */
+template <typename Scalar = double>
+class InferenceServer
+{
+    public:
+        /**
+         * @param lda         The LDA to run the expectation steps with
+         * @param words       The size of the vocabulary
+         * @param supervised  Whether the model can make predictions
+         * @param max_batch   The maximum number of documents per transform
+         * @param max_latency The maximum time a request waits for its batch
+         *                    to fill
+         */
+        InferenceServer(
+            LDA<Scalar> &lda,
+            size_t words,
+            bool supervised,
+            size_t max_batch,
+            std::chrono::microseconds max_latency
+        );
+        ~InferenceServer();
+
+        /**
+         * Listen on the socket and serve requests until stop() is called.
+         */
+        void serve(const std::string &socket_path);
+
+        /**
+         * Stop serving and close all the connections.
+         */
+        void stop();
+
+    private:
+        struct Response
+        {
+            int32_t status;
+            Eigen::VectorXd gamma;
+        };
+
+        struct Request
+        {
+            Eigen::VectorXi words;
+            bool predict;
+            std::chrono::steady_clock::time_point arrival;
+            std::promise<Response> response;
+        };
+
+        /**
+         * Read requests from a connection until it is closed.
+         */
+        void handle_connection(int connection);
+
+        /**
+         * Send a response.
+         *
+         * @return False if the connection failed
+         */
+        bool respond(int connection, const Response &response);
+
+        /**
+         * Collect the requests in batches and transform them.
+         */
+        void batcher();
+
+        /**
+         * Run a single transform for a batch of requests.
+         */
+        void process(std::vector<std::shared_ptr<Request> > &batch);
+
+        LDA<Scalar> &lda_;
+        size_t words_;
+        bool supervised_;
+        size_t max_batch_;
+        std::chrono::microseconds max_latency_;
+
+        // the outputs of the transforms for up to max_batch_ documents
+        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> gammas_;
+        Eigen::VectorXi predictions_;
+
+        bool running_;
+        int listener_;
+        std::mutex mutex_;
+        std::condition_variable pending_cv_;
+        std::deque<std::shared_ptr<Request> > pending_;
+        // the open connections, each served by a detached thread
+        std::set<int> connections_;
+        std::condition_variable connections_cv_;
+        std::thread batcher_;
+};
+
+#endif  // _APPLICATIONS_INFERENCESERVER_HPP_
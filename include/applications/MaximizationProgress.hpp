@@ -2,6 +2,7 @@
 #define _APPLICATIONS_MAXIMIZATIONPROGRESS_HPP_
 
 #include <iostream>
+#include <vector>
 
 #include "ldaplusplus/events/Events.hpp"
 
@@ -11,12 +12,14 @@ using namespace ldaplusplus;
   * This class is used to keep track of the progress during the Maximization
   * step.
   */
+template <typename Scalar = double>
 class MaximizationProgress : public events::EventListenerInterface
 {
     public:
         MaximizationProgress();
 
         void on_event(std::shared_ptr<events::Event> event);
+        std::vector<size_t> event_types() const;
 
     private:
         // The number of completed doc_m_step iterations
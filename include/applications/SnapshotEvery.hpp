@@ -1,28 +1,148 @@
 #ifndef _APPLICATIONS_SNAPSHOTEVERY_HPP_
 #define _APPLICATIONS_SNAPSHOTEVERY_HPP_
 
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "ldaplusplus/FeatureHasher.hpp"
 #include "ldaplusplus/Parameters.hpp"
 
 #include "ldaplusplus/events/Events.hpp"
 
 using namespace ldaplusplus;
 
+/**
+ * Dispatched by SnapshotEvery (on the training thread) when a snapshot has
+ * been written or has failed.
+ */
+class SnapshotEvent : public events::Event
+{
+    public:
+        SnapshotEvent(
+            std::string path,
+            double seconds,
+            size_t dropped,
+            std::string error = ""
+        ) : Event(type_tag()),
+            path_(path),
+            seconds_(seconds),
+            dropped_(dropped),
+            error_(error)
+        {}
+
+        static size_t type_tag() {
+            static const size_t type = events::event_type("SnapshotEvent");
+            return type;
+        }
+
+        const std::string & path() const { return path_; }
+        // The time it took to write the snapshot
+        double seconds() const { return seconds_; }
+        // The snapshots dropped so far because the writer fell behind
+        size_t dropped() const { return dropped_; }
+        // Why the snapshot could not be written (empty on success)
+        const std::string & error() const { return error_; }
+
+    private:
+        std::string path_;
+        double seconds_;
+        size_t dropped_;
+        std::string error_;
+};
+
+/**
+ * Save the model every few epochs without stopping the training.
+ *
+ * The parameters are copied on the training thread and written on a
+ * dedicated thread to a temporary file that is then renamed, so a snapshot
+ * file is always complete. The thread is started with the first snapshot. If the writer falls behind only the latest
+ * pending snapshot is kept. The snapshot pending on destruction is written
+ * before the destructor returns.
+ *
+ * The written (or failed) snapshots are reported with a SnapshotEvent on
+ * the training thread at the next epoch and by flush(), which should be
+ * called once the training is over.
+ */
+template <typename Scalar = double>
 class SnapshotEvery : public events::EventListenerInterface
 {
     public:
-        SnapshotEvery(std::string path, int save_every=10);
+        /**
+         * @param path       The prefix of the snapshot files
+         * @param save_every Snapshot every that many epochs
+         * @param dispatcher A dispatcher to report the SnapshotEvent to
+         *                   (on the training thread)
+         * @param hasher     The hasher of the word ids to save with every
+         *                   snapshot (if any)
+         */
+        SnapshotEvery(
+            std::string path,
+            int save_every=10,
+            std::shared_ptr<events::EventDispatcherInterface> dispatcher=nullptr,
+            std::shared_ptr<const corpus::FeatureHasher> hasher=nullptr
+        );
+        ~SnapshotEvery();
 
         void on_event(std::shared_ptr<events::Event> event);
+        std::vector<size_t> event_types() const;
 
-        void snapshot(
-            std::shared_ptr<parameters::Parameters> parameters
+        /**
+         * Wait for the pending snapshot to be written and report the
+         * snapshots written so far.
+         */
+        void flush();
+
+        /**
+         * Write the parameters of an epoch to disk on the calling thread.
+         *
+         * @return The path of the snapshot
+         * @throws std::runtime_error if the snapshot could not be written
+         */
+        std::string snapshot(
+            std::shared_ptr<parameters::Parameters> parameters,
+            int epoch
         );
     private:
+        /**
+         * Write the pending snapshots until destruction.
+         */
+        void writer();
+
+        /**
+         * Dispatch a SnapshotEvent for every snapshot written since the
+         * last call.
+         */
+        void report();
+
+        struct WrittenSnapshot
+        {
+            std::string path;
+            double seconds;
+            size_t dropped;
+            std::string error;
+        };
+
         std::string path_;
         int save_every_;
         int seen_so_far_;
+        // not owned so that the dispatcher and its listener can be freed
+        std::weak_ptr<events::EventDispatcherInterface> dispatcher_;
+        std::shared_ptr<const corpus::FeatureHasher> hasher_;
+
+        std::mutex mutex_;
+        std::condition_variable pending_cv_;
+        std::shared_ptr<parameters::Parameters> pending_;
+        int pending_epoch_;
+        size_t dropped_;
+        // whether the writer is busy with a snapshot
+        bool writing_;
+        std::vector<WrittenSnapshot> written_;
+        bool stop_;
+        std::thread writer_;
 };
 
 #endif // _APPLICATIONS_SNAPSHOTEVERY_HPP_
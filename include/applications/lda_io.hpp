@@ -2,9 +2,13 @@
 #define _APPLICATIONS_LDA_IO_HPP_
 
 #include <memory>
+#include <string>
 
 #include <Eigen/Core>
 
+#include "ldaplusplus/Document.hpp"
+#include "ldaplusplus/FeatureHasher.hpp"
+#include "ldaplusplus/LDA.hpp"
 #include "ldaplusplus/Parameters.hpp"
 
 using namespace ldaplusplus;
@@ -38,28 +42,200 @@ void parse_input_data(
     Eigen::MatrixXi &X
 );
 
+/**
+  * Parse the input data from a file hashing the word ids of the documents
+  * a block at a time (see hash_input_data()) so that the word counts with
+  * a row per word id are never in memory all together.
+  *
+  * @param data_path  The file to read the input data from
+  * @param hasher     The hasher or nullptr to keep the word ids
+  * @param X          The (hashed) word counts
+  * @param y          The class labels of the input data
+  * @param block_size The number of documents to read at a time
+  */
+void parse_input_data(
+    std::string data_path,
+    std::shared_ptr<const corpus::FeatureHasher> hasher,
+    Eigen::MatrixXi &X,
+    Eigen::MatrixXi &y,
+    size_t block_size = 16384
+);
+
+/**
+  * Parse the input data from a file hashing the word ids of the documents
+  * a block at a time, like the previous overload but without labels.
+  *
+  * @param data_path  The file to read the input data from
+  * @param hasher     The hasher or nullptr to keep the word ids
+  * @param X          The (hashed) word counts
+  * @param block_size The number of documents to read at a time
+  */
+void parse_input_data(
+    std::string data_path,
+    std::shared_ptr<const corpus::FeatureHasher> hasher,
+    Eigen::MatrixXi &X,
+    size_t block_size = 16384
+);
+
+/**
+  * @param model_path The path of a model
+  * @return Whether the model should be saved as a single indexed model file
+  *         (see model_file::save()) namely if the path ends with .ldam
+  */
+bool is_model_file_path(const std::string &model_path);
+
 /**
   * Save a set of model parameters in a file defined by the model_path input
-  * argument, according to the NumpyFormat.
+  * argument, according to the NumpyFormat or as a model file if the path
+  * ends with .ldam .
   *
   * @param model_path The file to save the set of the input parameters
-  * @param parameters The set of input parameters to be saved
+  * @param parameters The set of input parameters to be saved (their scalar
+  *                   type must be Scalar)
+  * @param hasher     The hasher of the word ids of the training data (if
+  *                   any) to be saved along with the model
   */
+template <typename Scalar = double>
 void save_lda(
     std::string model_path,
-    std::shared_ptr<parameters::Parameters> parameters
+    std::shared_ptr<parameters::Parameters> parameters,
+    std::shared_ptr<const corpus::FeatureHasher> hasher = nullptr
 );
 
 /**
-  * Read a set of model parameters saved in NumpyInput from a file
+  * Read a set of model parameters saved in NumpyInput or as a model file
+  * (the format is detected from the contents of the file). Models saved
+  * with a different precision are converted to Scalar.
   *
   * @param model_path The file to read a set of model parameters from
   * @return The model parameters
   */
-std::shared_ptr<parameters::SupervisedModelParameters<double> > load_lda(
+template <typename Scalar = double>
+std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > load_lda(
+    std::string model_path
+);
+
+/**
+  * Read a set of model parameters to transform documents with. A model file
+  * saved with Scalar and a column major beta is mapped and its beta is read
+  * in place (see model_file::map_parameters()), so that the processes that
+  * serve the same model share a single copy of it in the page cache. Any
+  * other model is read with load_lda().
+  *
+  * @param model_path The file to read the model parameters from
+  * @return MappedModelParameters or SupervisedModelParameters
+  */
+template <typename Scalar = double>
+std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > load_lda_for_inference(
+    std::string model_path
+);
+
+/**
+  * @param model Model parameters read by load_lda_for_inference()
+  * @return The number of words of the model
+  */
+template <typename Scalar = double>
+size_t model_words(
+    std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > model
+);
+
+/**
+  * Read the hasher saved along with a model by save_lda().
+  *
+  * @param model_path The file to read the hasher from
+  * @return The hasher or nullptr if the model was trained on plain word ids
+  */
+std::shared_ptr<corpus::FeatureHasher> load_feature_hasher(
     std::string model_path
 );
 
+/**
+  * Hash the word ids of the input data in place if there is a hasher.
+  *
+  * @param hasher The hasher or nullptr
+  * @param X      The word counts
+  */
+void hash_input_data(
+    std::shared_ptr<const corpus::FeatureHasher> hasher,
+    Eigen::MatrixXi &X
+);
+
+/**
+  * Transform the documents of an input data file (the word counts read by
+  * parse_input_data()) and write their topic mixtures to an npy file. The
+  * documents are read, hashed and transformed a block at a time so neither
+  * the input nor the output needs to fit in memory.
+  *
+  * @param data_path   The file to read the word counts from
+  * @param hasher      The hasher of the word ids of the model or nullptr
+  * @param lda         The LDA to transform the documents with
+  * @param output_path The npy file to write the topic mixtures to
+  * @param block_size  The number of documents to read at a time
+  */
+template <typename Scalar>
+void transform_input_data(
+    std::string data_path,
+    std::shared_ptr<const corpus::FeatureHasher> hasher,
+    LDA<Scalar> &lda,
+    std::string output_path,
+    size_t block_size = 16384
+);
+
+/**
+  * Write a checkpoint of a training (see LDA::save_checkpoint()) along with
+  * the number of epochs trained so far. The checkpoint is written to a
+  * temporary file and renamed so that a preempted process leaves the
+  * previous checkpoint intact.
+  *
+  * @param checkpoint_path The file to write the checkpoint to
+  * @param lda             The LDA being trained
+  * @param corpus          The corpus it is trained on
+  * @param epochs          The number of epochs trained so far
+  */
+template <typename Scalar>
+void save_checkpoint(
+    std::string checkpoint_path,
+    LDA<Scalar> &lda,
+    std::shared_ptr<const corpus::Corpus> corpus,
+    size_t epochs
+);
+
+/**
+  * Resume a training from a checkpoint written by save_checkpoint() if it
+  * exists.
+  *
+  * @param checkpoint_path The file to read the checkpoint from
+  * @param lda             The LDA to restore (created with the same
+  *                        configuration as the one that wrote it)
+  * @param corpus          The corpus to restore the shuffling state of
+  * @return The number of epochs already trained (0 if there is no
+  *         checkpoint)
+  */
+template <typename Scalar>
+size_t load_checkpoint(
+    std::string checkpoint_path,
+    LDA<Scalar> &lda,
+    std::shared_ptr<corpus::Corpus> corpus
+);
+
+/**
+  * Train for a number of epochs writing a checkpoint after every one of
+  * them and resume from the checkpoint if it exists, so that a preempted
+  * training loses at most an epoch.
+  *
+  * @param checkpoint_path The file to keep the checkpoint in
+  * @param lda             The LDA to train
+  * @param corpus          The corpus to train on
+  * @param iterations      The total number of epochs
+  */
+template <typename Scalar>
+void fit_with_checkpoints(
+    std::string checkpoint_path,
+    LDA<Scalar> &lda,
+    std::shared_ptr<corpus::Corpus> corpus,
+    size_t iterations
+);
+
 
 }  // namespace io
 
@@ -2,7 +2,10 @@
 #define _LDAPLUSPLUS_DOCUMENT_HPP_
 
 
+#include <cstdint>
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <random>
 #include <vector>
 
@@ -35,6 +38,21 @@ class Document
          */
         virtual const Eigen::VectorXi & get_words() const = 0;
 
+        /**
+         * @return A number that identifies the document in its corpus across
+         *         shuffles (for instance its column in a matrix) or -1 if
+         *         there is no such number
+         */
+        virtual int get_id() const { return -1; }
+
+        /**
+         * @return A hash of the ids and the counts of the words of the
+         *         document, so that the caches keyed by get_id() can tell
+         *         whether they hold the same document (the ids repeat
+         *         across corpora)
+         */
+        uint64_t fingerprint() const;
+
         /**
          * @return The corpus this documents belongs to after casting it to
          *         another pointer type for saving a few keystrokes.
@@ -78,6 +96,39 @@ class Corpus
          */
         virtual void shuffle() = 0;
 
+        /**
+         * Count the distinct and the total words of the ith document without
+         * creating it (for instance to estimate the cost of its expectation
+         * step). The default implementation goes through at().
+         */
+        virtual void count_words(
+            size_t index,
+            size_t &distinct_words,
+            size_t &total_words
+        ) const;
+
+        /**
+         * The number of words of the vocabulary of the documents (the rows
+         * of their word counts) without creating one of them. The default
+         * implementation goes through at() and returns 0 for an empty
+         * corpus.
+         */
+        virtual size_t words() const;
+
+        /**
+         * Write the state of the shuffling so that a training can be
+         * resumed with the same sequence of shuffles (see
+         * LDA::save_checkpoint()).
+         *
+         * The default implementation writes nothing.
+         */
+        virtual void save_state(std::ostream &os) const {}
+
+        /**
+         * Restore the state written by save_state().
+         */
+        virtual void load_state(std::istream &is) {}
+
         virtual ~Corpus(){};
 };
 
@@ -105,14 +156,20 @@ class EigenDocument : public Document
 {
     public:
         EigenDocument(Eigen::VectorXi X) : EigenDocument(X, nullptr) {}
-        EigenDocument(Eigen::VectorXi X, std::shared_ptr<const Corpus> corpus);
+        EigenDocument(
+            Eigen::VectorXi X,
+            std::shared_ptr<const Corpus> corpus,
+            int id = -1
+        );
 
         const std::shared_ptr<const Corpus> get_corpus() const override;
         const Eigen::VectorXi & get_words() const override;
+        int get_id() const override;
 
     private:
         Eigen::VectorXi X_;
         std::shared_ptr<const Corpus> corpus_;
+        int id_;
 };
 
 
@@ -131,6 +188,7 @@ class ClassificationDecorator : public ClassificationDocument
 
         const std::shared_ptr<const Corpus> get_corpus() const override;
         const Eigen::VectorXi & get_words() const override;
+        int get_id() const override;
         int get_class() const override;
 
     private:
@@ -159,6 +217,16 @@ class CorpusIndexes
          */
         void shuffle();
 
+        /**
+         * Write the current order of the indexes and the state of the PRNG.
+         */
+        void save_state(std::ostream &os) const;
+
+        /**
+         * Restore the state written by save_state().
+         */
+        void load_state(std::istream &is);
+
     private:
         /**
          * A vector of indices that implements the function mapping the ith in
@@ -182,6 +250,14 @@ class EigenCorpus : public Corpus
         size_t size() const override;
         virtual const std::shared_ptr<Document> at(size_t index) const override;
         void shuffle() override;
+        void count_words(
+            size_t index,
+            size_t &distinct_words,
+            size_t &total_words
+        ) const override;
+        size_t words() const override;
+        void save_state(std::ostream &os) const override;
+        void load_state(std::istream &is) override;
 
     protected:
         /** To implement shuffle */
@@ -212,6 +288,14 @@ class EigenClassificationCorpus : public ClassificationCorpus
         size_t size() const override;
         virtual const std::shared_ptr<Document> at(size_t index) const override;
         void shuffle() override;
+        void count_words(
+            size_t index,
+            size_t &distinct_words,
+            size_t &total_words
+        ) const override;
+        size_t words() const override;
+        void save_state(std::ostream &os) const override;
+        void load_state(std::istream &is) override;
         float get_prior(int y) const override;
 
     private:
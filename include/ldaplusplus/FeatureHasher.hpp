@@ -0,0 +1,63 @@
+#ifndef _LDAPLUSPLUS_FEATURE_HASHER_HPP_
+#define _LDAPLUSPLUS_FEATURE_HASHER_HPP_
+
+
+#include <cstdint>
+
+#include <Eigen/Core>
+
+namespace ldaplusplus {
+namespace corpus {
+
+
+/**
+ * FeatureHasher maps the word ids of an unbounded vocabulary to a fixed
+ * number of buckets so that the size of the model (beta and the
+ * sufficient statistics of the maximization steps are K x buckets) does not
+ * grow with the vocabulary.
+ *
+ * The words that fall in the same bucket are treated as a single word by
+ * the model. The mapping depends only on the number of buckets and the
+ * seed, thus the same hasher (see model_file::save()) must be used when
+ * transforming documents with the model.
+ *
+ * Example:
+ *
+ *     FeatureHasher hasher(1 << 16);
+ *     lda.fit(hasher.transform(X));  // X can have any number of rows
+ */
+class FeatureHasher
+{
+    public:
+        /**
+         * @param buckets The number of words of the hashed vocabulary
+         * @param seed    Selects one of the possible mappings
+         */
+        FeatureHasher(size_t buckets, uint64_t seed = 0);
+
+        size_t buckets() const { return buckets_; }
+        uint64_t seed() const { return seed_; }
+
+        /**
+         * @return The bucket of a word id
+         */
+        size_t bucket(size_t word) const;
+
+        /**
+         * Sum the counts of the words that fall in the same bucket.
+         *
+         * @param X The word counts with a row per word id
+         * @return  The word counts with a row per bucket
+         */
+        Eigen::MatrixXi transform(const Eigen::MatrixXi &X) const;
+
+    private:
+        size_t buckets_;
+        uint64_t seed_;
+};
+
+
+}  // namespace corpus
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_FEATURE_HASHER_HPP_
@@ -2,10 +2,15 @@
 #define _LDAPLUSPLUS_LDA_HPP_
 
 
+#include <atomic>
 #include <condition_variable>
+#include <functional>
+#include <future>
+#include <istream>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <ostream>
 #include <vector>
 #include <thread>
 #include <tuple>
@@ -14,8 +19,11 @@
 
 #include "ldaplusplus/events/Events.hpp"
 #include "ldaplusplus/em/EStepInterface.hpp"
+#include "ldaplusplus/em/GammaCache.hpp"
 #include "ldaplusplus/em/MStepInterface.hpp"
+#include "ldaplusplus/em/SelectiveUpdate.hpp"
 #include "ldaplusplus/Parameters.hpp"
+#include "ldaplusplus/parallel/NumaTopology.hpp"
 
 namespace ldaplusplus {
 
@@ -30,6 +38,50 @@ namespace ldaplusplus {
  * 3. It aggregates all the events and redispatches them on the same thread
  *    through a single event dispatcher.
  * 4. It provides a very simple interface (borrowed from scikit-learn)
+ *
+ * By default the epochs are synchronous; the worker threads wait for the
+ * batch maximization step of an epoch before they start the expectation
+ * step of the next one. With a staleness bound s > 0 the maximization step
+ * of the supervised models is split; \f$\beta\f$ is still maximized
+ * before the next epoch but the optimization of \f$\eta\f$ runs in the
+ * background while the expectation steps of the following epochs use the
+ * \f$\eta\f$ of a previous epoch. The new \f$\eta\f$ is swapped in
+ * atomically (in a copy of the model parameters) when the optimization
+ * completes and at most s optimizations can be pending at any time. This
+ * requires a maximization step that supports MStepInterface::detach(),
+ * otherwise (for instance for unsupervised models, where there is nothing
+ * to overlap) the epochs remain synchronous.
+ *
+ * The order in which the workers complete the expectation steps depends on
+ * thread timing, thus so does the order of the doc_m_step() calls and the
+ * model an online maximization step produces. In deterministic mode the
+ * documents are processed in windows of a fixed size; the expectation steps
+ * of a window all use the model as it was at the start of the window and
+ * doc_m_step() is called in document order once the window is complete.
+ * The trained model is then bit-identical for any number of workers. The
+ * deterministic mode cannot be combined with a staleness bound or with a
+ * maximization step whose doc_m_step() runs concurrently (see
+ * LDABuilder::set_deterministic()).
+ *
+ * The documents are dispatched to the workers longest first (see
+ * LDA::queue_documents()) to avoid idle workers at the end of the epochs.
+ * When the maximization step is online only the few long documents are
+ * moved and they are spread over the epoch, so that the minibatches stay
+ * random samples of the shuffled corpus.
+ *
+ * In NUMA mode the workers are pinned round robin to the NUMA nodes and
+ * every node gets its own copy of the model parameters, allocated on the
+ * node, that the expectation steps read from. The copies are kept across
+ * epochs and transforms and a worker copies the model again only after a
+ * maximization step has changed it. The online maximization steps that
+ * change the model in place during an epoch are read from the shared model
+ * instead, while the snapshots published by a hogwild maximization step
+ * are copied as they arrive. On a single node machine it only pins the
+ * workers.
+ *
+ * Given an em::SelectiveUpdate, the documents that have converged skip the
+ * expectation step for a few epochs during training and their cached
+ * variational parameters are passed to the maximization step instead.
  */
 template <typename Scalar = double>
 class LDA
@@ -38,6 +90,15 @@ class LDA
     typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
 
     public:
+        /**
+         * A callback that receives the \f$\gamma\f$ of the consecutive
+         * documents starting from the document first (see the streaming
+         * LDA::transform()).
+         */
+        typedef std::function<
+            void(size_t first, const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &gammas)
+        > TransformSink;
+
         /**
          * Create an LDA with the given model parameters, expectation and
          * maximization steps default iterations and worker threads.
@@ -53,13 +114,33 @@ class LDA
          *                         LDA::fit
          * @param workers          The number of worker threads to create for
          *                         computing the expectation step
+         * @param staleness        The maximum number of epochs whose
+         *                         optimization of eta may still be running
+         *                         while the next expectation step uses an
+         *                         older eta (0 means synchronous epochs)
+         * @param deterministic_window The number of documents per window in
+         *                             deterministic mode (0 disables it)
+         * @param selective_update Decides which documents skip the
+         *                         expectation step of an epoch (nullptr
+         *                         means that no document is skipped)
+         * @param numa             Pin the workers to NUMA nodes and give
+         *                         every node a copy of the model
+         * @param gamma_cache      Warm starts the expectation steps of the
+         *                         training documents (nullptr means that
+         *                         every document starts from the uniform
+         *                         initialization)
          */
         LDA(
             std::shared_ptr<parameters::Parameters> model_parameters,
             std::shared_ptr<em::EStepInterface<Scalar> > e_step,
             std::shared_ptr<em::MStepInterface<Scalar> > m_step,
             size_t iterations = 20,
-            size_t workers = 1
+            size_t workers = 1,
+            size_t staleness = 0,
+            size_t deterministic_window = 0,
+            std::shared_ptr<em::SelectiveUpdate<Scalar> > selective_update = nullptr,
+            bool numa = false,
+            std::shared_ptr<em::GammaCache<Scalar> > gamma_cache = nullptr
         );
 
         /**
@@ -67,6 +148,12 @@ class LDA
          */
         LDA(LDA &&lda);
 
+        /**
+         * Stop the transform worker pool after it has finished the submitted
+         * transforms.
+         */
+        ~LDA();
+
         /**
          * Compute a supervised topic model for word counts X and classes y.
          *
@@ -98,7 +185,8 @@ class LDA
          * Perform a single EM iteration.
          *
          * An EigenClassificationCorpus will be created from the passed
-         * parameters.
+         * parameters. X may have fewer rows than the model has words, in
+         * which case the missing words are counted as zeros.
          *
          * @param X The word counts in column-major order
          * @param y The classes as integers
@@ -108,6 +196,10 @@ class LDA
         /**
          * Perform a single EM iteration.
          *
+         * If the documents have more words than the model, the maximization
+         * step is asked to grow the model before the epoch starts (see
+         * MStepInterface::grow_vocabulary()).
+         *
          * @param corpus The implementation of Corpus that contains the
          *               observed variables.
          */
@@ -123,6 +215,55 @@ class LDA
          */
         MatrixX transform(const Eigen::MatrixXi &X);
 
+        /**
+         * Run the expectation step and pass the topic mixtures to a sink a
+         * block of consecutive documents at a time instead of returning them
+         * all, so that the memory needed does not grow with the number of
+         * documents.
+         *
+         * A single pool of workers transforms the documents in order and a
+         * block is passed to the sink as soon as all of its documents and
+         * the ones before it are done. Apart from the block only the
+         * \f$\gamma\f$ of the documents completed out of order are kept in
+         * memory and the workers wait instead of transforming more than a
+         * few hundred documents per worker past the first one that is not
+         * done (for instance a long document), so that the memory
+         * needed stays bounded however the lengths of the documents are
+         * distributed.
+         *
+         * @param corpus     The documents to transform
+         * @param sink       Receives the index of the first document of the
+         *                   block and the \f$\gamma\f$ of its documents
+         * @param block_size The number of documents per block
+         */
+        void transform(
+            std::shared_ptr<corpus::Corpus> corpus,
+            const TransformSink &sink,
+            size_t block_size = 1024
+        );
+
+        /**
+         * Queue the documents defined by the word counts X to be transformed
+         * asynchronously and return immediately.
+         *
+         * The documents are transformed by a pool of worker threads
+         * (started by the first submission) that persists across calls and
+         * is shared by all the submissions, which can be made concurrently
+         * from any number of threads. The workers take a few documents from
+         * each pending submission in turn, so a small submission completes
+         * soon even when it arrives behind large ones.
+         *
+         * The workers share the expectation step and the model with the
+         * training so they pause while partial_fit() (or fit()) and
+         * load_checkpoint() run. The events of the expectation steps stay
+         * queued until the thread that created the LDA processes them.
+         *
+         * @param  X The word counts in column-major order (copied)
+         * @return A future for the \f$\gamma\f$ of every document (or the
+         *         exception thrown by the expectation step)
+         */
+        std::future<MatrixX> submit_transform(const Eigen::MatrixXi &X);
+
         /**
          * Treat the SupervisedModelParameters::eta as a linear model and
          * compute the distances from the planes of the documents in the topic
@@ -164,6 +305,47 @@ class LDA
          */
         std::tuple<MatrixX, Eigen::VectorXi> transform_predict(const Eigen::MatrixXi &X);
 
+        /**
+         * The following overloads write their results in matrices provided
+         * by the caller instead of allocating them. The class scores and
+         * predictions are computed from the \f$\gamma\f$ of every document
+         * as soon as it is available so no K x D or C x D intermediate is
+         * allocated either. Every call still creates the worker threads and
+         * a corpus for X, and the expectation step allocates the variational
+         * parameters of every document.
+         *
+         * The outputs should have the right size (K x D for the
+         * \f$\gamma\f$, C x D for the class scores and D for the
+         * predictions) and may be blocks of larger matrices; otherwise
+         * std::invalid_argument is thrown. Like the rest of the transforms
+         * they should not be called concurrently on the same LDA (see
+         * submit_transform()).
+         */
+
+        /**
+         * LDA::transform into gammas.
+         */
+        void transform(const Eigen::MatrixXi &X, Eigen::Ref<MatrixX> gammas);
+
+        /**
+         * LDA::decision_function into scores.
+         */
+        void decision_function(const Eigen::MatrixXi &X, Eigen::Ref<MatrixX> scores);
+
+        /**
+         * LDA::predict into predictions.
+         */
+        void predict(const Eigen::MatrixXi &X, Eigen::Ref<Eigen::VectorXi> predictions);
+
+        /**
+         * LDA::transform_predict into gammas and predictions.
+         */
+        void transform_predict(
+            const Eigen::MatrixXi &X,
+            Eigen::Ref<MatrixX> gammas,
+            Eigen::Ref<Eigen::VectorXi> predictions
+        );
+
         /**
          * Get the event dispatcher for this LDA instance.
          */
@@ -173,16 +355,68 @@ class LDA
 
         /**
          * Get a constant reference to the model's parameters.
+         *
+         * Waits for any maximization steps running in the background.
          */
         const std::shared_ptr<parameters::Parameters> model_parameters() {
+            wait_for_m_steps();
             return model_parameters_;
         }
 
         template <typename P>
         const std::shared_ptr<P> model_parameters() {
+            wait_for_m_steps();
             return std::static_pointer_cast<P>(model_parameters_);
         }
 
+        /**
+         * Block until all the maximization steps running in the background
+         * (see the staleness parameter) have been applied to the model
+         * parameters.
+         */
+        void wait_for_m_steps();
+
+        /**
+         * Write a checkpoint from which the training can be resumed as if
+         * it had not been interrupted.
+         *
+         * Besides the model parameters the checkpoint contains the state
+         * that the expectation and maximization steps keep across epochs
+         * (see EStepInterface::save_state() and
+         * MStepInterface::save_state()) and optionally the shuffling state
+         * of the corpus. The caches that only speed up the training (the
+         * gamma cache and the selective update) are not saved.
+         *
+         * It should be called between epochs; it waits for any
+         * maximization steps running in the background.
+         *
+         * @param os     The stream to write the checkpoint to (opened in
+         *               binary mode)
+         * @param corpus The corpus being trained on or nullptr to not save
+         *               its state
+         */
+        void save_checkpoint(
+            std::ostream &os,
+            std::shared_ptr<const corpus::Corpus> corpus = nullptr
+        );
+
+        /**
+         * Restore a checkpoint written by save_checkpoint() into an LDA
+         * that was created with the same configuration.
+         *
+         * If the checkpoint is invalid an exception is thrown and the
+         * model, the expectation and maximization steps and the corpus are
+         * left as they were.
+         *
+         * @param is     The stream to read the checkpoint from
+         * @param corpus The corpus to restore the shuffling state of or
+         *               nullptr to ignore it
+         */
+        void load_checkpoint(
+            std::istream &is,
+            std::shared_ptr<corpus::Corpus> corpus = nullptr
+        );
+
     protected:
         /**
          * Generate a Corpus from a pair of X, y matrices
@@ -197,10 +431,73 @@ class LDA
          */
         std::shared_ptr<corpus::Corpus> get_corpus(const Eigen::MatrixXi &X);
 
+        /**
+         * How queue_documents() orders the documents.
+         */
+        enum class QueueOrder
+        {
+            // all the documents by cost, the most expensive first
+            Cost,
+            // the few long documents first, the rest in order
+            LongFirst,
+            // the few long documents spread evenly among the rest, which
+            // keep their order
+            LongSpread,
+            // all the documents in order
+            InOrder
+        };
+
+        /**
+         * Queue the documents [start, end) of the corpus for the workers.
+         * The workers claim them in chunks (see LDA::chunk_size()).
+         *
+         * The documents with the most expensive expectation steps (judged
+         * by their number of distinct words and their length) are queued
+         * early so that no worker is left processing a long document at
+         * the end of the epoch while the others idle.
+         *
+         * @param order Whether to order all the documents by cost or to
+         *              only move the few that could delay the epoch and
+         *              keep the (shuffled) order of the rest (the online
+         *              maximization steps need the long documents spread
+         *              over the minibatches)
+         */
+        void queue_documents(
+            std::shared_ptr<corpus::Corpus> corpus,
+            size_t start,
+            size_t end,
+            QueueOrder order
+        );
+
         /**
          * Create a worker thread pool.
+         *
+         * @param doc_m_step Also call the maximization step's doc_m_step()
+         *                   from the workers (see
+         *                   MStepInterface::concurrent_doc_m_step())
+         * @param training   The documents are part of a training epoch so
+         *                   the converged ones may be skipped
+         */
+        void create_worker_pool(bool doc_m_step = false, bool training = false);
+
+        /**
+         * Compute how many of the queued documents a worker should claim at
+         * once.
+         *
+         * The chunks are sized from the measured time per document so that
+         * claiming them costs little compared to processing them, and they
+         * shrink as the queue empties so that the work stays balanced.
          */
-        void create_worker_pool();
+        size_t chunk_size();
+
+        /**
+         * Return the copy of the model of a NUMA node (see the NUMA mode)
+         * and copy the model again if it has changed since.
+         *
+         * Called by the workers pinned to the node, so that the pages of the
+         * copy are allocated on that node.
+         */
+        std::shared_ptr<parameters::Parameters> node_model(size_t node);
 
         /**
          * Destroy the worker thread pool
@@ -220,13 +517,39 @@ class LDA
         /**
          * Extract the variational parameters and the document index from the
          * worker queue.
+         *
+         * The workers return their results in batches and all the available
+         * ones are taken from the queue at once.
          */
         std::tuple<std::shared_ptr<parameters::Parameters>, size_t> extract_vp_from_queue();
 
         /**
          * A doc_e_step worker thread.
+         *
+         * @param doc_m_step Call doc_m_step() right after each doc_e_step()
+         * @param training   Skip the converged documents
+         * @param worker     The index of the worker in the pool
+         */
+        void doc_e_step_worker(bool doc_m_step, bool training, size_t worker);
+
+        /**
+         * Run the expectation steps and doc_m_step() of an epoch in windows
+         * of deterministic_window_ documents (see the deterministic mode).
          */
-        void doc_e_step_worker();
+        void deterministic_doc_steps(std::shared_ptr<corpus::Corpus> corpus);
+
+        /**
+         * Run the batch maximization step either synchronously or with the
+         * optimization of eta in the background depending on the staleness
+         * bound.
+         */
+        void batch_m_step();
+
+        /**
+         * @return The number of words of the model or 0 if the model has no
+         *         dense beta
+         */
+        size_t model_words();
 
         /**
          * Implement the decision function using already transformed data.
@@ -244,14 +567,95 @@ class LDA
          */
         Eigen::VectorXi predict(const MatrixX &scores);
 
+        /**
+         * Compute the class scores of the already transformed documents
+         * gammas into scores without copying gammas.
+         */
+        void compute_decision_function(
+            const Eigen::Ref<const MatrixX> &gammas,
+            Eigen::Ref<MatrixX> scores
+        );
+
+        /**
+         * Compute the argmax of every column of the scores into predictions.
+         */
+        void compute_predictions(
+            const Eigen::Ref<const MatrixX> &scores,
+            Eigen::Ref<Eigen::VectorXi> predictions
+        );
+
+        /**
+         * Transform the documents X with the worker pool and pass the
+         * \f$\gamma\f$ of every document with its index to a function on
+         * the calling thread as soon as it is computed.
+         */
+        void transform_documents(
+            const Eigen::MatrixXi &X,
+            const std::function<void(size_t, const VectorX &)> &document_gamma
+        );
+
 
     private:
+        /**
+         * A submitted transform that is not complete yet.
+         */
+        struct TransformRequest
+        {
+            // the documents of the request and the corpus that wraps them
+            Eigen::MatrixXi X;
+            std::shared_ptr<corpus::Corpus> corpus;
+            MatrixX gammas;
+            // the next document to hand out to the workers
+            size_t next;
+            // the documents whose gammas are not computed yet
+            size_t remaining;
+            bool failed;
+            std::promise<MatrixX> result;
+        };
+
+        /**
+         * Pauses the submitted transforms for as long as it lives.
+         */
+        struct TransformsPause
+        {
+            explicit TransformsPause(LDA<Scalar> &lda) : lda(lda) {
+                lda.pause_transforms();
+            }
+            ~TransformsPause() {
+                lda.resume_transforms();
+            }
+
+            LDA<Scalar> &lda;
+        };
+
         /**
          * Pass the event dispatcher down to the implementations so that they
          * can communicate with the outside world.
          */
         void set_up_event_dispatcher();
 
+        /**
+         * Let the maximization step replace the model parameters (see
+         * em::MStepInterface::set_model_publisher()).
+         */
+        void set_up_model_publisher();
+
+        /**
+         * The loop of the threads of the transform worker pool.
+         */
+        void transform_worker();
+
+        /**
+         * Stop handing out the documents of the submitted transforms and
+         * wait for the workers to finish the ones they have.
+         */
+        void pause_transforms();
+
+        /**
+         * Let the transform workers continue after pause_transforms().
+         */
+        void resume_transforms();
+
         // The model parameters
         std::shared_ptr<parameters::Parameters> model_parameters_;
 
@@ -261,18 +665,72 @@ class LDA
 
         // Member variables that affect the behaviour of fit
         size_t iterations_;
+        size_t staleness_;
+        size_t deterministic_window_;
+        std::shared_ptr<em::SelectiveUpdate<Scalar> > selective_update_;
+        // the corpus of the documents cached by selective_update_
+        std::weak_ptr<corpus::Corpus> selective_corpus_;
+        std::shared_ptr<em::GammaCache<Scalar> > gamma_cache_;
+        bool numa_;
+        parallel::NumaTopology numa_topology_;
+        // a copy of the model parameters per NUMA node for the workers,
+        // made from the model source at version (see node_model())
+        struct NumaReplica {
+            std::mutex mutex;
+            std::shared_ptr<parameters::Parameters> source;
+            size_t version;
+            std::shared_ptr<parameters::Parameters> model;
+        };
+        std::vector<std::unique_ptr<NumaReplica> > replicas_;
+        // whether the workers of the current pool read the replicas
+        bool use_replicas_;
+        // counts the changes of the model parameters in place (the
+        // replaced models are recognized by their address)
+        std::atomic<size_t> model_version_;
 
         // The thread related member variables
         std::vector<std::thread> workers_;
-        std::mutex queue_in_mutex_;
-        std::list<std::tuple<std::shared_ptr<corpus::Corpus>, size_t> > queue_in_;
+        // the workers claim chunks of jobs_ by advancing next_job_
+        std::shared_ptr<corpus::Corpus> jobs_corpus_;
+        std::vector<size_t> jobs_;
+        std::atomic<size_t> next_job_;
+        // the workers wait before the jobs from jobs_limit_ on (so that the
+        // results a streaming transform reorders stay few)
+        std::atomic<size_t> jobs_limit_;
+        std::mutex jobs_limit_mutex_;
+        std::condition_variable jobs_limit_cv_;
+        // the moving average of the time spent per document
+        std::atomic<long long> document_nanoseconds_;
         std::mutex queue_out_mutex_;
         std::condition_variable queue_out_cv_;
         std::list<std::tuple<std::shared_ptr<parameters::Parameters>, size_t> > queue_out_;
+        // the results taken from queue_out_ but not yet extracted
+        std::list<std::tuple<std::shared_ptr<parameters::Parameters>, size_t> > results_;
+
+        // The persistent pool for submit_transform() and the requests that
+        // have documents not yet handed out to a worker in round robin order
+        std::vector<std::thread> transform_workers_;
+        std::mutex transform_mutex_;
+        std::condition_variable transform_cv_;
+        std::list<std::shared_ptr<TransformRequest> > transform_requests_;
+        bool stop_transform_workers_;
+        // the training pauses the workers and waits for the documents they
+        // are transforming
+        bool transforms_paused_;
+        size_t active_transforms_;
 
         // An event dispatcher that we will use to communicate with the
         // external components
         std::shared_ptr<events::EventDispatcherInterface> event_dispatcher_;
+
+        // Serializes the changes of the model parameters between the main
+        // thread and the optimizations of eta running in the background
+        std::mutex model_mutex_;
+
+        // The maximization steps running in the background in the order
+        // they were started. It is declared last so that it is destroyed
+        // (and thus waited for) first.
+        std::list<std::shared_future<void> > pending_m_steps_;
 };
 
 
@@ -1,8 +1,10 @@
 #ifndef _LDAPLUSPLUS_LDABUILDER_HPP_
 #define _LDAPLUSPLUS_LDABUILDER_HPP_
 
+#include <functional>
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -11,8 +13,11 @@
 #include "ldaplusplus/Document.hpp"
 #include "ldaplusplus/em/FastSupervisedEStep.hpp"
 #include "ldaplusplus/em/EStepInterface.hpp"
+#include "ldaplusplus/em/GammaCache.hpp"
 #include "ldaplusplus/em/MStepInterface.hpp"
+#include "ldaplusplus/em/SelectiveUpdate.hpp"
 #include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/parallel/Transport.hpp"
 
 namespace ldaplusplus {
 
@@ -83,6 +88,98 @@ class LDABuilder : public LDABuilderInterface<Scalar>
         /** Choose a number of parallel workers for the expectation step */
         LDABuilder & set_workers(size_t workers);
 
+        /**
+         * Let the optimization of eta of up to staleness epochs run in the
+         * background while the next epochs use an older eta (see LDA). 0
+         * means synchronous epochs.
+         */
+        LDABuilder & set_staleness(size_t staleness) {
+            staleness_ = staleness;
+            return *this;
+        }
+
+        /**
+         * Make training produce bit-identical models regardless of the
+         * number of workers by running the expectation step in windows of
+         * documents (see LDA). 0 disables the deterministic mode.
+         *
+         * It cannot be combined with a staleness bound or a maximization
+         * step that runs concurrently in the workers (hogwild), since both
+         * make the model depend on thread timing; creating the LDA throws
+         * in that case.
+         */
+        LDABuilder & set_deterministic(size_t window = 256) {
+            deterministic_window_ = window;
+            return *this;
+        }
+
+        /**
+         * Start the expectation step of every document from its
+         * \f$\gamma\f$ of the previous epoch (see em::GammaCache). Only
+         * the UnsupervisedEStep and the FastSupervisedEStep support warm
+         * starting and only the documents passed to LDA::fit() and
+         * LDA::partial_fit() use the cache.
+         *
+         * @param documents The number of documents in the corpus
+         * @param path      A file to keep the cache in or empty to keep it
+         *                  in memory
+         */
+        LDABuilder & set_gamma_cache(size_t documents, std::string path = "") {
+            gamma_cache_documents_ = documents;
+            gamma_cache_path_ = path;
+            return *this;
+        }
+
+        /**
+         * Pin the workers to the NUMA nodes of the machine and give every
+         * node its own copy of the model parameters (see LDA).
+         */
+        LDABuilder & set_numa(bool numa = true) {
+            numa_ = numa;
+            return *this;
+        }
+
+        /**
+         * Skip the expectation step of the documents that have converged
+         * during training (see em::SelectiveUpdate).
+         *
+         * @param tolerance       The relative change of \f$\gamma\f$ below
+         *                        which a document is skipped
+         * @param skip_epochs     The number of epochs to skip a converged
+         *                        document for (0 disables skipping)
+         * @param full_pass_every Every that many epochs no document is
+         *                        skipped
+         */
+        LDABuilder & set_selective_update(
+            Scalar tolerance = 1e-2,
+            size_t skip_epochs = 2,
+            size_t full_pass_every = 5
+        ) {
+            selective_tolerance_ = tolerance;
+            selective_skip_epochs_ = skip_epochs;
+            selective_full_pass_every_ = full_pass_every;
+            return *this;
+        }
+
+        /**
+         * Train together with the other processes connected through the
+         * transport (data parallel training).
+         *
+         * Every process should fit the model on its own shard of the corpus
+         * having initialized the model parameters identically (for instance
+         * with the same random state on the same data). The maximization
+         * step combines the sufficient statistics of all the processes every
+         * epoch (or minibatch for the online maximization step) so that all
+         * the processes end up with the same model, which is the model a
+         * single process would compute on the whole corpus up to the order
+         * of floating point summations.
+         */
+        LDABuilder & set_transport(std::shared_ptr<parallel::Transport> transport) {
+            transport_ = transport;
+            m_step_->set_transport(transport_);
+            return *this;
+        }
+
         /**
          * Create an UnsupervisedEStep.
          *
@@ -115,13 +212,20 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             Scalar compute_likelihood = 1.0,
             int random_state = 0
         ) {
-            e_requires_eta_ = false;
-            return set_e(get_classic_e_step(
+            set_e(get_classic_e_step(
                 e_step_iterations,
                 e_step_tolerance,
                 compute_likelihood,
                 random_state
             ));
+            e_step_for_topics_ = classic_e_step_for_topics(
+                e_step_iterations,
+                e_step_tolerance,
+                compute_likelihood,
+                random_state
+            );
+            e_requires_eta_ = false;
+            return *this;
         }
 
         /**
@@ -209,6 +313,13 @@ class LDABuilder : public LDABuilderInterface<Scalar>
                 compute_likelihood,
                 random_state
             ));
+            e_step_for_topics_ = fast_supervised_e_step_for_topics(
+                e_step_iterations,
+                e_step_tolerance,
+                C,
+                compute_likelihood,
+                random_state
+            );
             e_requires_eta_ = true;
             return *this;
         }
@@ -343,6 +454,66 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             return *this;
         }
 
+        /**
+         * Create a QuantizedEStep.
+         *
+         * It can only be used for inference with a model set with
+         * initialize_from_quantized_model().
+         *
+         * @param e_step_iterations The max number of times to alternate
+         *                          between maximizing for \f$\gamma\f$ and
+         *                          for \f$\phi\f$.
+         * @param e_step_tolerance  The minimum relative change in the
+         *                          variational parameter \f$\gamma\f$.
+         */
+        std::shared_ptr<em::EStepInterface<Scalar> > get_quantized_e_step(
+            size_t e_step_iterations = 10,
+            Scalar e_step_tolerance = 1e-2
+        );
+        /**
+         * See the corresponding get_*_e_step() method.
+         */
+        LDABuilder & set_quantized_e_step(
+            size_t e_step_iterations = 10,
+            Scalar e_step_tolerance = 1e-2
+        ) {
+            set_e(get_quantized_e_step(
+                e_step_iterations,
+                e_step_tolerance
+            ));
+            return *this;
+        }
+
+        /**
+         * Create a SparseEStep.
+         *
+         * It can only be used for inference with a model set with
+         * initialize_from_sparse_model().
+         *
+         * @param e_step_iterations The max number of times to alternate
+         *                          between maximizing for \f$\gamma\f$ and
+         *                          for \f$\phi\f$.
+         * @param e_step_tolerance  The minimum relative change in the
+         *                          variational parameter \f$\gamma\f$.
+         */
+        std::shared_ptr<em::EStepInterface<Scalar> > get_sparse_e_step(
+            size_t e_step_iterations = 10,
+            Scalar e_step_tolerance = 1e-2
+        );
+        /**
+         * See the corresponding get_*_e_step() method.
+         */
+        LDABuilder & set_sparse_e_step(
+            size_t e_step_iterations = 10,
+            Scalar e_step_tolerance = 1e-2
+        ) {
+            set_e(get_sparse_e_step(
+                e_step_iterations,
+                e_step_tolerance
+            ));
+            return *this;
+        }
+
         /**
          * Set an expectation step.
          *
@@ -356,6 +527,7 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             e_requires_eta_ = false; // clear require eta because we do not know
                                      // this e_step
             e_step_ = e_step;
+            e_step_for_topics_ = nullptr;
             return *this;
         }
 
@@ -459,6 +631,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
          *                               update of \f$\eta\f$
          * @param beta_weight            The weight for the online update
          *                               of \f$\beta\f$
+         * @param hogwild                Apply the updates concurrently from the
+         *                               expectation step workers
          */
         std::shared_ptr<em::MStepInterface<Scalar> > get_fast_supervised_online_m_step(
             size_t num_classes,
@@ -466,7 +640,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             size_t minibatch_size = 128,
             Scalar eta_momentum = 0.9,
             Scalar eta_learning_rate = 0.01,
-            Scalar beta_weight = 0.9
+            Scalar beta_weight = 0.9,
+            bool hogwild = false
         );
         LDABuilder & set_fast_supervised_online_m_step(
             size_t num_classes,
@@ -474,7 +649,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             size_t minibatch_size = 128,
             Scalar eta_momentum = 0.9,
             Scalar eta_learning_rate = 0.01,
-            Scalar beta_weight = 0.9
+            Scalar beta_weight = 0.9,
+            bool hogwild = false
         ) {
             set_m(get_fast_supervised_online_m_step(
                 num_classes,
@@ -482,7 +658,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
                 minibatch_size,
                 eta_momentum,
                 eta_learning_rate,
-                beta_weight
+                beta_weight,
+                hogwild
             ));
             m_requires_eta_ = true;
             return *this;
@@ -506,6 +683,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
          *                               update of \f$\eta\f$
          * @param beta_weight            The weight for the online update
          *                                   of \f$\beta\f$
+         * @param hogwild                Apply the updates concurrently from the
+         *                               expectation step workers
          */
         std::shared_ptr<em::MStepInterface<Scalar> > get_fast_supervised_online_m_step(
             std::vector<Scalar> class_weights,
@@ -513,7 +692,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             size_t minibatch_size = 128,
             Scalar eta_momentum = 0.9,
             Scalar eta_learning_rate = 0.01,
-            Scalar beta_weight = 0.9
+            Scalar beta_weight = 0.9,
+            bool hogwild = false
         );
         LDABuilder & set_fast_supervised_online_m_step(
             std::vector<Scalar> class_weights,
@@ -521,7 +701,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             size_t minibatch_size = 128,
             Scalar eta_momentum = 0.9,
             Scalar eta_learning_rate = 0.01,
-            Scalar beta_weight = 0.9
+            Scalar beta_weight = 0.9,
+            bool hogwild = false
         ) {
             set_m(get_fast_supervised_online_m_step(
                 class_weights,
@@ -529,7 +710,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
                 minibatch_size,
                 eta_momentum,
                 eta_learning_rate,
-                beta_weight
+                beta_weight,
+                hogwild
             ));
             m_requires_eta_ = true;
             return *this;
@@ -553,6 +735,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
          *                               update of \f$\eta\f$
          * @param beta_weight            The weight for the online update
          *                                   of \f$\beta\f$
+         * @param hogwild                Apply the updates concurrently from the
+         *                               expectation step workers
          */
         std::shared_ptr<em::MStepInterface<Scalar> > get_fast_supervised_online_m_step(
             Eigen::Matrix<Scalar, Eigen::Dynamic, 1> class_weights,
@@ -560,7 +744,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             size_t minibatch_size = 128,
             Scalar eta_momentum = 0.9,
             Scalar eta_learning_rate = 0.01,
-            Scalar beta_weight = 0.9
+            Scalar beta_weight = 0.9,
+            bool hogwild = false
         );
         LDABuilder & set_fast_supervised_online_m_step(
             Eigen::Matrix<Scalar, Eigen::Dynamic, 1> class_weights,
@@ -568,7 +753,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             size_t minibatch_size = 128,
             Scalar eta_momentum = 0.9,
             Scalar eta_learning_rate = 0.01,
-            Scalar beta_weight = 0.9
+            Scalar beta_weight = 0.9,
+            bool hogwild = false
         ) {
             set_m(get_fast_supervised_online_m_step(
                 class_weights,
@@ -576,7 +762,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
                 minibatch_size,
                 eta_momentum,
                 eta_learning_rate,
-                beta_weight
+                beta_weight,
+                hogwild
             ));
             m_requires_eta_ = true;
             return *this;
@@ -670,6 +857,9 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             m_requires_eta_ = false; // clear require eta because we do not know
                                      // this m_step
             m_step_ = m_step;
+            if (transport_) {
+                m_step_->set_transport(transport_);
+            }
             return *this;
         }
 
@@ -778,14 +968,79 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             return *this;
         }
 
+        /**
+         * Use a quantized model (see quantization::quantize()) instead of
+         * the builder's model parameters.
+         *
+         * The created LDA can only be used for inference and requires
+         * set_quantized_e_step().
+         */
+        LDABuilder & initialize_from_quantized_model(
+            std::shared_ptr<parameters::QuantizedModelParameters<Scalar> > model
+        ) {
+            inference_model_parameters_ = model;
+
+            return *this;
+        }
+
+        /**
+         * Use a sparse model (see sparsification::sparsify()) instead of
+         * the builder's model parameters.
+         *
+         * The created LDA can only be used for inference and requires
+         * set_sparse_e_step().
+         */
+        LDABuilder & initialize_from_sparse_model(
+            std::shared_ptr<parameters::SparseModelParameters<Scalar> > model
+        ) {
+            inference_model_parameters_ = model;
+
+            return *this;
+        }
+
+        /**
+         * Use a model whose beta is read in place from a memory mapped model
+         * file (see model_file::map_parameters()) instead of the builder's
+         * model parameters.
+         *
+         * The created LDA can only be used for inference and requires
+         * set_classic_e_step().
+         */
+        LDABuilder & initialize_from_mapped_model(
+            std::shared_ptr<parameters::MappedModelParameters<Scalar> > model
+        ) {
+            inference_model_parameters_ = model;
+
+            return *this;
+        }
+
         /**
          * Build a brand new LDA instance from the configuration of the
          * builder.
          *
          * Before returning it also checks a few things that would result in an
          * unusable LDA instance and throws a runtime_error. 
+         *
+         * If the expectation step was chosen with set_classic_e_step() or
+         * set_fast_supervised_e_step() and the number of topics is 16, 32 or
+         * 64 the expectation step is replaced with the one specialized for
+         * that number of topics.
          */
         virtual operator LDA<Scalar>() const override {
+            check_inference_model();
+
+            if (inference_model_parameters_) {
+                return LDA<Scalar>(
+                    inference_model_parameters_,
+                    (e_step_for_topics_) ?
+                        e_step_for_topics_(inference_model_parameters_->alpha.rows()) :
+                        e_step_,
+                    m_step_,
+                    iterations_,
+                    workers_
+                );
+            }
+
             if (model_parameters_->beta.rows() == 0) {
                 throw std::runtime_error("You need to call initialize_topics before "
                                          "creating an LDA from the builder.");
@@ -800,26 +1055,104 @@ class LDABuilder : public LDABuilderInterface<Scalar>
                                          "Call initialize_eta_*()");
             }
 
+            if (
+                deterministic_window_ > 0 &&
+                (staleness_ > 0 || m_step_->concurrent_doc_m_step())
+            ) {
+                throw std::runtime_error("The deterministic mode cannot be used "
+                                         "with a staleness bound or a hogwild "
+                                         "maximization step");
+            }
+
+            auto e_step = (e_step_for_topics_) ?
+                e_step_for_topics_(model_parameters_->beta.rows()) :
+                e_step_;
             return LDA<Scalar>(
                 model_parameters_,
-                e_step_,
+                e_step,
                 m_step_,
                 iterations_,
-                workers_
+                workers_,
+                staleness_,
+                deterministic_window_,
+                (selective_skip_epochs_ > 0) ?
+                    std::make_shared<em::SelectiveUpdate<Scalar> >(
+                        selective_tolerance_,
+                        selective_skip_epochs_,
+                        selective_full_pass_every_
+                    ) : nullptr,
+                numa_,
+                (gamma_cache_documents_ > 0) ?
+                    std::make_shared<em::GammaCache<Scalar> >(
+                        model_parameters_->beta.rows(),
+                        gamma_cache_documents_,
+                        gamma_cache_path_
+                    ) : nullptr
             );
         };
 
     private:
+        typedef std::function<
+            std::shared_ptr<em::EStepInterface<Scalar> >(size_t)
+        > EStepForTopics;
+
+        /**
+         * Create a function that returns an UnsupervisedEStep specialized for
+         * the number of topics passed to it (if such a specialization
+         * exists).
+         */
+        static EStepForTopics classic_e_step_for_topics(
+            size_t e_step_iterations,
+            Scalar e_step_tolerance,
+            Scalar compute_likelihood,
+            int random_state
+        );
+
+        /**
+         * Create a function that returns a FastSupervisedEStep specialized
+         * for the number of topics passed to it (if such a specialization
+         * exists).
+         */
+        static EStepForTopics fast_supervised_e_step_for_topics(
+            size_t e_step_iterations,
+            Scalar e_step_tolerance,
+            Scalar C,
+            Scalar compute_likelihood,
+            int random_state
+        );
+
+        /**
+         * Throw a runtime_error if the inference only models (quantized,
+         * sparse or mapped) are not paired with their expectation steps.
+         */
+        void check_inference_model() const;
+
         // generic lda parameters
         size_t iterations_;
         size_t workers_;
+        size_t staleness_;
+        size_t deterministic_window_;
+        size_t gamma_cache_documents_;
+        std::string gamma_cache_path_;
+        Scalar selective_tolerance_;
+        size_t selective_skip_epochs_;
+        size_t selective_full_pass_every_;
+        bool numa_;
 
         // implementations
         std::shared_ptr<em::EStepInterface<Scalar> > e_step_;
         std::shared_ptr<em::MStepInterface<Scalar> > m_step_;
+        // creates e_step_ specialized for a given number of topics (can be
+        // empty)
+        EStepForTopics e_step_for_topics_;
 
         // the model parameters
         std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > model_parameters_;
+        // a model that replaces model_parameters_ for inference only
+        std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > inference_model_parameters_;
+
+        // connects the processes of data parallel training (can be empty)
+        std::shared_ptr<parallel::Transport> transport_;
 
         // A flag to keep track of having set EM steps that require the eta
         // model parameters.
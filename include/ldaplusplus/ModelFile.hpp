@@ -0,0 +1,225 @@
+#ifndef _LDAPLUSPLUS_MODEL_FILE_HPP_
+#define _LDAPLUSPLUS_MODEL_FILE_HPP_
+
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <Eigen/Core>
+
+#include "ldaplusplus/FeatureHasher.hpp"
+#include "ldaplusplus/Parameters.hpp"
+
+namespace ldaplusplus {
+namespace model_file {
+
+
+/**
+ * The model file is a single file container for the model parameters that
+ * can be memory mapped and whose arrays can be viewed in place (see
+ * MappedModel) without parsing or copying it. An LDA that only transforms
+ * documents can read beta from the mapping (see map_parameters()) while an
+ * LDA that is trained owns its parameters, so building one from a model
+ * file (MappedModel::parameters()) copies the arrays once.
+ *
+ * It starts with a 64 byte Header followed by a table of contents with a
+ * Section entry per array. The arrays (alpha, beta and optionally eta) start
+ * at 64 byte aligned offsets. Beta is stored either in column major order
+ * (like all our matrices) or in row major order (a topic after the other).
+ * Every section optionally has an FNV-1a checksum of its bytes. Models
+ * trained on hashed word ids have one more section with the number of
+ * buckets and the seed of the corpus::FeatureHasher (two uint64).
+ *
+ * Like the numpy files we write, the numbers are in the byte order of the
+ * machine that wrote the file.
+ */
+
+static const char MAGIC[8] = {'L', 'D', 'A', '+', '+', 'M', 'D', 'L'};
+static const uint32_t VERSION = 1;
+static const size_t ALIGNMENT = 64;
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    // The size in bytes of the scalar type of the arrays (4 or 8)
+    uint32_t scalar_size;
+    uint64_t topics;
+    uint64_t words;
+    // 0 for unsupervised models that have no eta
+    uint64_t classes;
+    uint32_t sections;
+    uint32_t reserved;
+    char padding[16];
+};
+
+enum SectionId
+{
+    Alpha = 1,
+    Beta,
+    Eta,
+    FeatureHashing
+};
+
+enum SectionFlags
+{
+    RowMajor = 1,
+    HasChecksum = 2
+};
+
+struct Section
+{
+    uint32_t id;
+    uint32_t flags;
+    uint64_t offset;
+    uint64_t bytes;
+    uint64_t checksum;
+};
+
+
+/**
+ * Compute the 64 bit FNV-1a hash of a buffer.
+ */
+uint64_t checksum(const char *data, size_t bytes);
+
+
+/**
+ * Save the model parameters in a model file.
+ *
+ * @param path           The file to write
+ * @param parameters     ModelParameters or SupervisedModelParameters (eta
+ *                       is saved if it is not empty)
+ * @param row_major_beta Store beta a topic after the other
+ * @param checksums      Compute a checksum for every section
+ * @param hasher         The hasher of the word ids of the training
+ *                       documents if any
+ */
+template <typename Scalar>
+void save(
+    const std::string &path,
+    std::shared_ptr<parameters::Parameters> parameters,
+    bool row_major_beta = false,
+    bool checksums = true,
+    std::shared_ptr<const corpus::FeatureHasher> hasher = nullptr
+);
+
+
+/**
+ * MappedModel maps a model file in memory and provides views of its arrays.
+ * The views remain valid as long as the MappedModel exists.
+ *
+ * The file is mapped read only and shared, thus any number of processes
+ * that map the same model share a single copy of it in the page cache and
+ * opening it only reads the header.
+ */
+template <typename Scalar>
+class MappedModel
+{
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    public:
+        typedef Eigen::Map<const VectorX, Eigen::Aligned> ConstVectorMap;
+        typedef Eigen::Map<const MatrixX, Eigen::Aligned> ConstMatrixMap;
+        // beta may be stored in either order
+        typedef Eigen::Map<
+            const MatrixX,
+            0,
+            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>
+        > ConstStridedMatrixMap;
+
+        /**
+         * @param path             The model file
+         * @param verify_checksums Read all the sections and compare them
+         *                         with their checksums (this touches every
+         *                         page of the file)
+         */
+        MappedModel(const std::string &path, bool verify_checksums = false);
+        ~MappedModel();
+
+        MappedModel(const MappedModel &) = delete;
+        MappedModel & operator=(const MappedModel &) = delete;
+
+        size_t topics() const { return header_->topics; }
+        size_t words() const { return header_->words; }
+        size_t classes() const { return header_->classes; }
+
+        /**
+         * @return Whether beta is stored a topic after the other
+         */
+        bool row_major_beta() const;
+
+        ConstVectorMap alpha() const;
+        ConstStridedMatrixMap beta() const;
+        /**
+         * @return The K x C eta (empty for unsupervised models)
+         */
+        ConstMatrixMap eta() const;
+
+        /**
+         * Copy the arrays to SupervisedModelParameters to be used by an LDA.
+         *
+         * This is the only copy of the arrays; the views above read the
+         * mapping directly.
+         */
+        std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > parameters() const;
+
+        /**
+         * @return The hasher that the documents should go through before
+         *         being transformed with this model or nullptr if the model
+         *         was trained on plain word ids
+         */
+        std::shared_ptr<corpus::FeatureHasher> feature_hasher() const;
+
+    private:
+        /**
+         * @return The section with that id or nullptr
+         */
+        const Section * section(SectionId id) const;
+
+        /**
+         * @return A pointer to the data of the section with that id
+         */
+        const Scalar * data(SectionId id) const;
+
+        const char *mapping_;
+        size_t size_;
+        const Header *header_;
+        const Section *sections_;
+};
+
+
+/**
+ * Map a model file and view its beta in place to transform documents
+ * without a private copy of the model (see MappedModelParameters).
+ *
+ * @param path The model file saved with Scalar and a column major beta
+ * @return The parameters that keep the file mapped while they exist
+ * @throws std::runtime_error     if the file is not a valid model file of
+ *                                this precision
+ * @throws std::invalid_argument  if beta is stored in row major order
+ */
+template <typename Scalar>
+std::shared_ptr<parameters::MappedModelParameters<Scalar> > map_parameters(
+    const std::string &path
+);
+
+
+/**
+ * @return Whether the file starts with the magic of the model files
+ */
+bool is_model_file(const std::string &path);
+
+
+/**
+ * @return The size in bytes of the scalar type the model file was saved with
+ *         so that it can be mapped with the matching MappedModel
+ */
+size_t scalar_size(const std::string &path);
+
+
+}  // namespace model_file
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_MODEL_FILE_HPP_
@@ -2,9 +2,12 @@
 #define _LDAPLUSPLUS_NUMPY_FORMAT_HPP_
 
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
 #include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -69,10 +72,143 @@ namespace numpy_format {
             for (size_t j=0; j<sizeof(Scalar)/2; j++) {
                 std::swap(d.c[j], d.c[sizeof(Scalar)-j-1]);
             }
+            data[i] = d.v;
         }
     }
 
 
+    /**
+     * Write the magic, the version and the header of a version 1 npy file.
+     *
+     * @param os            The stream to write to
+     * @param dtype         The numpy dtype including the endianess
+     * @param fortran_order Wether the data that follow are column major
+     * @param shape         The shape of the array
+     * @param min_size      Pad the header with spaces so that together with
+     *                      the magic it occupies at least that many bytes
+     *                      (used to rewrite the header in place later)
+     */
+    inline void write_header(
+        std::ostream &os,
+        const std::string &dtype,
+        bool fortran_order,
+        const std::vector<size_t> &shape,
+        size_t min_size = 0
+    ) {
+        const uint8_t MAGIC_AND_VERSION[] = {
+            0x93, 0x4e, 0x55, 0x4d, 0x50, 0x59, 0x01, 0x00
+        };
+
+        // We need to create the header for the data which is a python literal
+        // string
+        std::ostringstream header;
+        header << "{'descr': '" << dtype << "',"
+               << " 'fortran_order': " << (fortran_order ? "True" : "False") << ","
+               << " 'shape': (";
+        for (auto d : shape) {
+            header << d << ", ";
+        }
+        header << ")}";
+
+        // Now we need to pad it with spaces until the total size of the magic +
+        // version + header_len + header is divisible by 16
+        while ((static_cast<size_t>(header.tellp()) + 11) % 16 ||
+               static_cast<size_t>(header.tellp()) + 11 < min_size) {
+            header << " ";
+        }
+        header << "\n";
+
+        // Now we need to write the magic and version
+        os.write(reinterpret_cast<const char *>(MAGIC_AND_VERSION), 8);
+
+        // Write the header length in little endian no matter what
+        uint16_t header_len = header.tellp();
+        if (!is_big_endian()) {
+            os.write(reinterpret_cast<const char *>(&header_len), 2);
+        } else {
+            os.write(reinterpret_cast<const char *>(&header_len) + 1, 1);
+            os.write(reinterpret_cast<const char *>(&header_len), 1);
+        }
+
+        // Write the header
+        os << header.str();
+    }
+
+
+    /**
+     * Read the magic, the version and the header of a version 1 npy file.
+     *
+     * @param is            The stream to read from
+     * @param dtype         The numpy dtype including the endianess
+     * @param fortran_order Wether the data that follow are column major
+     * @param shape         The shape of the array
+     */
+    inline void read_header(
+        std::istream &is,
+        std::string &dtype,
+        bool &fortran_order,
+        std::vector<size_t> &shape
+    ) {
+        shape.clear();
+
+        // read the magic and the version and assert that it is compatible
+        char MAGIC_AND_VERSION[8];
+        is.read(MAGIC_AND_VERSION, 8);
+        if (MAGIC_AND_VERSION[6] > 1) {
+            throw std::runtime_error(
+                "Only version 1 of the numpy format is supported"
+            );
+        }
+
+        // if the file is empty (aka we read nothing) just throw a
+        // runtime error
+        if (is.gcount() == 0) {
+            throw std::runtime_error(
+                "The file is empty and cannot be read"
+            );
+        }
+
+        // read the header len
+        uint16_t header_len;
+        is.read(reinterpret_cast<char *>(&header_len), 2);
+        if (is_big_endian()) {
+            swap_endianess(&header_len, 1);
+        }
+
+        // read the header
+        std::vector<char> buffer(header_len+1);
+        is.read(&buffer[0], header_len);
+        buffer[header_len] = 0;
+        std::string header(&buffer[0]);
+
+        // we can parse the header efficiently using the fact that the
+        // specification requires the dictionary to be passed by
+        // pprint.pformat()
+
+        // parse dtype info
+        dtype = header.substr(11, 3);
+
+        // parse contiguity type
+        fortran_order = header[34] == 'T';
+
+        // parse shape
+        std::string shape_literal = header.substr(
+            header.find_last_of('(')+1,
+            header.find_last_of(')')
+        );
+        try {
+            while (true) {
+                size_t processed;
+                shape.push_back(std::stoi(shape_literal, &processed));
+
+                // +2 to account for the comma and the space
+                shape_literal = shape_literal.substr(processed + 2);
+            }
+        } catch (const std::invalid_argument&) {
+            // that's ok it means we finished parsing the tuple
+        }
+    }
+
     /**
      * NumpyOutput provides an easy way to serialize a contiguous array using
      * the numpy format.
@@ -150,42 +286,12 @@ namespace numpy_format {
              * Scalar.
              */
             friend std::ostream & operator<<(std::ostream &os, const NumpyOutput &data) {
-                const uint8_t MAGIC_AND_VERSION[] = {
-                    0x93, 0x4e, 0x55, 0x4d, 0x50, 0x59, 0x01, 0x00
-                };
-
-                // We need to create the header for the data which is a python literal
-                // string
-                std::ostringstream header;
-                header << "{'descr': '" << data.dtype() << "',"
-                       << " 'fortran_order': " << (data.fortran_contiguous() ? "True" : "False") << ","
-                       << " 'shape': (";
-                for (auto d : data.shape()) {
-                    header << d << ", ";
-                }
-                header << ")}";
-
-                // Now we need to pad it with spaces until the total size of the magic +
-                // version + header_len + header is divisible by 16
-                while ((static_cast<size_t>(header.tellp()) + 11) % 16) {
-                    header << " ";
-                }
-                header << "\n";
-
-                // Now we need to write the magic and version
-                os.write(reinterpret_cast<const char *>(MAGIC_AND_VERSION), 8);
-
-                // Write the header length in little endian no matter what
-                uint16_t header_len = header.tellp();
-                if (!is_big_endian()) {
-                    os.write(reinterpret_cast<const char *>(&header_len), 2);
-                } else {
-                    os.write(reinterpret_cast<const char *>(&header_len) + 1, 1);
-                    os.write(reinterpret_cast<const char *>(&header_len), 1);
-                }
-
-                // Write the header
-                os << header.str();
+                write_header(
+                    os,
+                    data.dtype(),
+                    data.fortran_contiguous(),
+                    data.shape()
+                );
 
                 // Finally write the data
                 size_t N = 1;
@@ -272,44 +378,9 @@ namespace numpy_format {
             friend std::istream & operator>>(std::istream &is, NumpyInput &data) {
                 // reset the NumpyInput instance
                 data.data_.clear();
-                data.shape_.clear();
-
-                // read the magic and the version and assert that it is compatible
-                char MAGIC_AND_VERSION[8];
-                is.read(MAGIC_AND_VERSION, 8);
-                if (MAGIC_AND_VERSION[6] > 1) {
-                    throw std::runtime_error(
-                        "Only version 1 of the numpy format is supported"
-                    );
-                }
-
-                // if the file is empty (aka we read nothing) just throw a
-                // runtime error
-                if (is.gcount() == 0) {
-                    throw std::runtime_error(
-                        "The file is empty and cannot be read"
-                    );
-                }
 
-                // read the header len
-                uint16_t header_len;
-                is.read(reinterpret_cast<char *>(&header_len), 2);
-                if (is_big_endian()) {
-                    swap_endianess(&header_len, 1);
-                }
-
-                // read the header
-                std::vector<char> buffer(header_len+1);
-                is.read(&buffer[0], header_len);
-                buffer[header_len] = 0;
-                std::string header(&buffer[0]);
-
-                // we can parse the header efficiently using the fact that the
-                // specification requires the dictionary to be passed by
-                // pprint.pformat()
-
-                // parse dtype info
-                std::string dtype = header.substr(11, 3);
+                std::string dtype;
+                read_header(is, dtype, data.fortran_, data.shape_);
                 bool endianness = dtype[0] == '>';
                 if (dtype.substr(1) != dtype_for_scalar<Scalar>()) {
                     throw std::runtime_error(
@@ -320,26 +391,6 @@ namespace numpy_format {
                     );
                 }
 
-                // parse contiguity type
-                data.fortran_ = header[34] == 'T';
-
-                // parse shape
-                std::string shape = header.substr(
-                    header.find_last_of('(')+1,
-                    header.find_last_of(')')
-                );
-                try {
-                    while (true) {
-                        size_t processed;
-                        data.shape_.push_back(std::stoi(shape, &processed));
-
-                        // +2 to account for the comma and the space
-                        shape = shape.substr(processed + 2);
-                    }
-                } catch (const std::invalid_argument&) {
-                    // that's ok it means we finished parsing the tuple
-                }
-
                 // compute the total size of the data
                 int N = 1;
                 for (auto c : data.shape_) {
@@ -364,6 +415,239 @@ namespace numpy_format {
     };
 
 
+    /**
+     * NumpyReader reads a two dimensional npy array from a stream a block of
+     * columns at a time so that the whole matrix never needs to be in
+     * memory. Column major arrays are read sequentially while the columns
+     * of a row major array are gathered from every row.
+     *
+     * Example:
+     *
+     *     std::ifstream in("X.npy", std::ios::binary);
+     *     numpy_format::NumpyReader<int> reader(in);
+     *     while (reader.remaining() > 0) {
+     *         MatrixXi block = reader.read(1000);
+     *     }
+     */
+    template <typename Scalar>
+    class NumpyReader
+    {
+        typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+
+        public:
+            /**
+             * Read the header of the array that starts at the current
+             * position of the stream.
+             *
+             * @param is The stream to read from (it should be seekable if
+             *           the array is row major)
+             */
+            NumpyReader(std::istream &is)
+                : is_(is),
+                  cols_read_(0)
+            {
+                std::string dtype;
+                std::vector<size_t> shape;
+                read_header(is_, dtype, fortran_, shape);
+                if (dtype.substr(1) != dtype_for_scalar<Scalar>()) {
+                    throw std::runtime_error(
+                        std::string() +
+                        "The type of the array is not the " +
+                        "one requested: " + dtype.substr(1) +
+                        " != " + dtype_for_scalar<Scalar>()
+                    );
+                }
+                swap_ = (dtype[0] == '>') != is_big_endian();
+
+                // the same shape as the matrices of NumpyInput
+                rows_ = (shape.empty()) ? 1 : shape[0];
+                cols_ = 1;
+                for (size_t i=1; i<shape.size(); i++) {
+                    cols_ *= shape[i];
+                }
+                data_start_ = is_.tellg();
+            }
+
+            NumpyReader(const NumpyReader &) = delete;
+            NumpyReader & operator=(const NumpyReader &) = delete;
+
+            size_t rows() const { return rows_; }
+            size_t cols() const { return cols_; }
+
+            /**
+             * @return The number of columns that have not been read yet
+             */
+            size_t remaining() const { return cols_ - cols_read_; }
+
+            /**
+             * Read the next columns of the array. After the last column the
+             * stream is positioned right after the array.
+             *
+             * @param cols The number of columns to read (fewer are returned
+             *             at the end of the array)
+             */
+            MatrixX read(size_t cols) {
+                cols = std::min(cols, remaining());
+                MatrixX block(rows_, cols);
+
+                if (fortran_) {
+                    is_.read(
+                        reinterpret_cast<char *>(block.data()),
+                        block.size()*sizeof(Scalar)
+                    );
+                } else {
+                    std::vector<Scalar> row(cols);
+                    for (size_t r=0; r<rows_; r++) {
+                        is_.seekg(offset(r, cols_read_));
+                        is_.read(
+                            reinterpret_cast<char *>(row.data()),
+                            cols*sizeof(Scalar)
+                        );
+                        block.row(r) = Eigen::Map<const Eigen::Matrix<Scalar, 1, Eigen::Dynamic> >(
+                            row.data(),
+                            cols
+                        );
+                    }
+                }
+                if (!is_) {
+                    throw std::runtime_error("The npy array is truncated");
+                }
+                if (swap_) {
+                    swap_endianess(block.data(), block.size());
+                }
+
+                cols_read_ += cols;
+                if (!fortran_ && remaining() == 0) {
+                    is_.seekg(offset(rows_, 0));
+                }
+
+                return block;
+            }
+
+        private:
+            /**
+             * @return The position of the element (r, c) of a row major array
+             */
+            std::streampos offset(size_t r, size_t c) const {
+                return data_start_ + static_cast<std::streamoff>(
+                    (r*cols_ + c)*sizeof(Scalar)
+                );
+            }
+
+            std::istream &is_;
+            std::streampos data_start_;
+            size_t rows_;
+            size_t cols_;
+            size_t cols_read_;
+            bool fortran_;
+            bool swap_;
+    };
+
+    /**
+     * NumpyWriter writes a column major matrix to an npy file a block of
+     * columns at a time so that the whole matrix never needs to be in
+     * memory. The number of columns is only known when the writer is closed
+     * so the header is written with room to spare and rewritten in place.
+     *
+     * Example:
+     *
+     *     numpy_format::NumpyWriter<float> writer("gammas.npy", 10);
+     *     writer.write(MatrixXf::Random(10, 100));
+     *     writer.write(MatrixXf::Random(10, 50));
+     *     writer.close();  // gammas.npy now contains a 10x150 array
+     */
+    template <typename Scalar>
+    class NumpyWriter
+    {
+        // enough for any shape (rows, cols) of 64 bit numbers
+        static const size_t HEADER_SIZE = 128;
+
+        public:
+            /**
+             * @param path The file to write
+             * @param rows The number of rows of every block
+             */
+            NumpyWriter(const std::string &path, size_t rows)
+                : out_(path, std::ios::out | std::ios::binary | std::ios::trunc),
+                  rows_(rows),
+                  cols_(0)
+            {
+                if (!out_) {
+                    throw std::runtime_error("Could not create " + path);
+                }
+                write_header(out_, dtype(), true, {rows_, cols_}, HEADER_SIZE);
+            }
+
+            NumpyWriter(const NumpyWriter &) = delete;
+            NumpyWriter & operator=(const NumpyWriter &) = delete;
+
+            /**
+             * Close the file if it has not been closed already.
+             */
+            ~NumpyWriter() {
+                try {
+                    close();
+                } catch (...) {
+                    // Destructors should not throw; call close() to get the
+                    // errors
+                }
+            }
+
+            /**
+             * Append the columns of a block to the array.
+             *
+             * @param block A matrix with as many rows as given in the
+             *              constructor
+             */
+            template <typename Derived>
+            void write(const Eigen::MatrixBase<Derived> &block) {
+                if (static_cast<size_t>(block.rows()) != rows_) {
+                    throw std::invalid_argument("All the blocks should have "
+                                                "the same number of rows");
+                }
+
+                // evaluate it in column major order if it is not already
+                const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &data = block;
+                out_.write(
+                    reinterpret_cast<const char *>(data.data()),
+                    data.size()*sizeof(Scalar)
+                );
+                cols_ += data.cols();
+            }
+
+            /**
+             * Write the final shape in the header and close the file.
+             */
+            void close() {
+                if (!out_.is_open()) {
+                    return;
+                }
+
+                out_.seekp(0);
+                write_header(out_, dtype(), true, {rows_, cols_}, HEADER_SIZE);
+                out_.close();
+                if (!out_) {
+                    throw std::runtime_error("Could not write the npy file");
+                }
+            }
+
+            /**
+             * @return The number of columns written so far
+             */
+            size_t cols() const { return cols_; }
+
+        private:
+            std::string dtype() const {
+                return std::string(is_big_endian() ? ">" : "<") +
+                       dtype_for_scalar<Scalar>();
+            }
+
+            std::ofstream out_;
+            size_t rows_;
+            size_t cols_;
+    };
+
+
     /**
      * Saves data into a stream  
      */
@@ -2,19 +2,32 @@
 #define _LDAPLUSPLUS_PARAMETERS_HPP_
 
 
+#include <cstdint>
+#include <memory>
 #include <utility>
 
 #include <Eigen/Core>
+#include <Eigen/SparseCore>
 
 namespace ldaplusplus {
 namespace parameters {
 
 
 /**
- * All the parameter related objects will be extending this empty struct.
+ * All the parameter related objects will be extending this struct.
  */
 struct Parameters
 {
+    virtual ~Parameters() {}
+
+    /**
+     * Create a deep copy of these parameters keeping the dynamic type (used
+     * for instance to maximize a copy of the model in the background while
+     * the original is being read).
+     */
+    virtual std::shared_ptr<Parameters> clone() const {
+        return std::make_shared<Parameters>(*this);
+    }
 };
 
 
@@ -36,6 +49,10 @@ struct ModelParameters : public Parameters
 
     Eigen::Matrix<Scalar, Eigen::Dynamic, 1> alpha;
     Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> beta;
+
+    std::shared_ptr<Parameters> clone() const override {
+        return std::make_shared<ModelParameters>(*this);
+    }
 };
 
 
@@ -51,11 +68,122 @@ struct SupervisedModelParameters : public ModelParameters<Scalar>
         Eigen::Matrix<Scalar, Eigen::Dynamic, 1> a,
         Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> b,
         Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> e
-    ) : ModelParameters<Scalar>(a, b),
+    ) : ModelParameters<Scalar>(std::move(a), std::move(b)),
         eta(std::move(e))
     {}
 
     Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> eta;
+
+    std::shared_ptr<Parameters> clone() const override {
+        return std::make_shared<SupervisedModelParameters>(*this);
+    }
+};
+
+
+/**
+ * QuantizedModelParameters keep the topics over words distributions in a
+ * compressed form that is only meant to be used for inference (see
+ * QuantizedEStep and quantization::quantize()).
+ *
+ * The inherited beta is left empty. With Float16 every topic (row) \f$k\f$
+ * is stored as \f$\beta_{kw} \approx s_k q_{kw}\f$ where \f$s_k\f$ is
+ * the per topic scale in beta_scale and \f$q_{kw}\f$ a half precision
+ * float. With Int8 \f$q_{kw}\f$ is an unsigned 8 bit code and
+ * \f$\beta_{kw} \approx l_{k q_{kw}}\f$ where the K x 256 beta_levels
+ * are spaced logarithmically between the smallest and the largest
+ * probability of each topic (\f$l_{k0} = 0\f$), so that the small
+ * probabilities keep the same relative precision as the large ones.
+ * alpha and eta are kept intact so that the decision function works as
+ * with the full precision model.
+ */
+template <typename Scalar = double>
+struct QuantizedModelParameters : public SupervisedModelParameters<Scalar>
+{
+    enum Encoding
+    {
+        Float16 = 1,
+        Int8
+    };
+
+    QuantizedModelParameters() {}
+
+    Encoding encoding;
+    Eigen::Matrix<Eigen::half, Eigen::Dynamic, Eigen::Dynamic> beta_half;
+    Eigen::Matrix<std::uint8_t, Eigen::Dynamic, Eigen::Dynamic> beta_int8;
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> beta_scale;
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> beta_levels;
+
+    std::shared_ptr<Parameters> clone() const override {
+        return std::make_shared<QuantizedModelParameters>(*this);
+    }
+};
+
+
+/**
+ * SparseModelParameters keep for every word only the topics that generate it
+ * with non negligible probability and are only meant to be used for inference
+ * (see SparseEStep and sparsification::sparsify()).
+ *
+ * The inherited beta is left empty and beta_sparse is a K x V column major
+ * sparse matrix, namely for every word a list of (topic, probability) pairs.
+ * alpha and eta are kept intact.
+ */
+template <typename Scalar = double>
+struct SparseModelParameters : public SupervisedModelParameters<Scalar>
+{
+    SparseModelParameters() {}
+
+    Eigen::SparseMatrix<Scalar, Eigen::ColMajor> beta_sparse;
+
+    std::shared_ptr<Parameters> clone() const override {
+        return std::make_shared<SparseModelParameters>(*this);
+    }
+};
+
+
+/**
+ * MappedModelParameters read the topics over words distributions in place
+ * from a memory mapped model file (see model_file::map_parameters()) and
+ * are only meant to be used for inference with the classic expectation
+ * step (see UnsupervisedEStep).
+ *
+ * The inherited beta is left empty and beta_map views the K x V column
+ * major beta of the mapping, which is kept alive by mapping for as long as
+ * the parameters (or a clone of them) exist. alpha and eta are small and
+ * they are copied.
+ */
+template <typename Scalar = double>
+struct MappedModelParameters : public SupervisedModelParameters<Scalar>
+{
+    typedef Eigen::Map<
+        const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>
+    > ConstMatrixMap;
+
+    MappedModelParameters(
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> a,
+        const Scalar *beta,
+        int topics,
+        int words,
+        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> e,
+        std::shared_ptr<const void> m
+    ) : SupervisedModelParameters<Scalar>(
+            std::move(a),
+            Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>(),
+            std::move(e)
+        ),
+        beta_map(beta, topics, words),
+        mapping(std::move(m))
+    {}
+
+    ConstMatrixMap beta_map;
+    std::shared_ptr<const void> mapping;
+
+    /**
+     * The clone shares the read only mapping.
+     */
+    std::shared_ptr<Parameters> clone() const override {
+        return std::make_shared<MappedModelParameters>(*this);
+    }
 };
 
 
@@ -76,6 +204,10 @@ struct VariationalParameters : public Parameters
 
     Eigen::Matrix<Scalar, Eigen::Dynamic, 1> gamma;
     Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> phi;
+
+    std::shared_ptr<Parameters> clone() const override {
+        return std::make_shared<VariationalParameters>(*this);
+    }
 };
 
 
@@ -96,6 +228,10 @@ struct SupervisedCorrespondenceVariationalParameters : public VariationalParamet
     {}
 
     Eigen::Matrix<Scalar, Eigen::Dynamic, 1> tau;
+
+    std::shared_ptr<Parameters> clone() const override {
+        return std::make_shared<SupervisedCorrespondenceVariationalParameters>(*this);
+    }
 };
 
 }  // namespace parameters
@@ -0,0 +1,128 @@
+#ifndef _LDAPLUSPLUS_CHECKPOINT_HPP_
+#define _LDAPLUSPLUS_CHECKPOINT_HPP_
+
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <Eigen/Core>
+
+namespace ldaplusplus {
+namespace checkpoint {
+
+
+/**
+ * The checkpoints are a flat binary format in the byte order of the machine
+ * that wrote them, like the numpy files we write. They are meant to resume
+ * a training on the same kind of machine and not for long term storage.
+ *
+ * Every value is written as its raw bytes, matrices as their rows and
+ * columns (int64), the size of their scalar (uint32) and their column major
+ * data and strings as their length (uint64) followed by their bytes.
+ */
+
+
+/**
+ * Write the raw bytes of a trivially copyable value.
+ */
+template <typename T>
+void write(std::ostream &os, const T &value) {
+    os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+
+/**
+ * Read a value written with write().
+ */
+template <typename T>
+T read(std::istream &is) {
+    T value;
+    is.read(reinterpret_cast<char *>(&value), sizeof(T));
+    if (!is) {
+        throw std::runtime_error("The checkpoint is truncated");
+    }
+
+    return value;
+}
+
+
+inline void write_string(std::ostream &os, const std::string &s) {
+    write<uint64_t>(os, s.size());
+    os.write(s.data(), s.size());
+}
+
+
+inline std::string read_string(std::istream &is) {
+    std::string s(read<uint64_t>(is), '\0');
+    is.read(&s[0], s.size());
+    if (!is) {
+        throw std::runtime_error("The checkpoint is truncated");
+    }
+
+    return s;
+}
+
+
+template <typename Derived>
+void write_matrix(std::ostream &os, const Eigen::PlainObjectBase<Derived> &x) {
+    typedef typename Derived::Scalar Scalar;
+
+    write<int64_t>(os, x.rows());
+    write<int64_t>(os, x.cols());
+    write<uint32_t>(os, sizeof(Scalar));
+    os.write(reinterpret_cast<const char *>(x.data()), x.size()*sizeof(Scalar));
+}
+
+
+/**
+ * Read a matrix written with write_matrix() resizing x as needed.
+ */
+template <typename Derived>
+void read_matrix(std::istream &is, Eigen::PlainObjectBase<Derived> &x) {
+    typedef typename Derived::Scalar Scalar;
+
+    int64_t rows = read<int64_t>(is);
+    int64_t cols = read<int64_t>(is);
+    if (read<uint32_t>(is) != sizeof(Scalar)) {
+        throw std::runtime_error("The checkpoint was written with a "
+                                 "different precision");
+    }
+    x.resize(rows, cols);
+    is.read(reinterpret_cast<char *>(x.data()), x.size()*sizeof(Scalar));
+    if (!is) {
+        throw std::runtime_error("The checkpoint is truncated");
+    }
+}
+
+
+/**
+ * Write the state of a standard random number engine (in its textual
+ * representation since that is the only portable one).
+ */
+template <typename PRNG>
+void write_prng(std::ostream &os, const PRNG &prng) {
+    std::ostringstream state;
+    state << prng;
+    write_string(os, state.str());
+}
+
+
+template <typename PRNG>
+void read_prng(std::istream &is, PRNG &prng) {
+    std::istringstream state(read_string(is));
+    state >> prng;
+    if (!state) {
+        throw std::runtime_error("The checkpoint contains an invalid "
+                                 "random number generator state");
+    }
+}
+
+
+}  // namespace checkpoint
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_CHECKPOINT_HPP_
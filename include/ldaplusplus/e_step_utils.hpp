@@ -1,7 +1,10 @@
 #ifndef _LDAPLUSPLUS_ESTEPUTILS_HPP_
 #define _LDAPLUSPLUS_ESTEPUTILS_HPP_
 
+#include <cstdint>
+
 #include <Eigen/Core>
+#include <Eigen/SparseCore>
 
 namespace ldaplusplus {
 namespace e_step_utils {
@@ -22,7 +25,7 @@ namespace e_step_utils {
     Scalar compute_unsupervised_likelihood(
         const VectorXi & X,
         const VectorX<Scalar> &alpha,
-        const MatrixX<Scalar> &beta,
+        const Ref<const MatrixX<Scalar> > &beta,
         const MatrixX<Scalar> &phi,
         const VectorX<Scalar> &gamma
     );
@@ -141,8 +144,12 @@ namespace e_step_utils {
      *     gamma_i ^ {t+1} =  alpha_i + \sum_n \phi_{n,i}^{t+1}
      *
      * Equation (7) in Latent Dirichlet Allocation, Blei 2003 
+     *
+     * When Topics is not Eigen::Dynamic the computation is performed with
+     * fixed size vectors of that many topics (it is instantiated for 16, 32
+     * and 64 topics) and it must match the rows of phi.
      */
-    template <typename Scalar>
+    template <typename Scalar, int Topics = Eigen::Dynamic>
     void compute_gamma(
         const VectorXi & X,
         const VectorX<Scalar> & alpha,
@@ -162,10 +169,12 @@ namespace e_step_utils {
      *     end
      * 
      * Equation (6) in Latent Dirichlet Allocation, Blei 2003
+     *
+     * See compute_gamma() for the meaning of Topics.
      */
-    template <typename Scalar>
+    template <typename Scalar, int Topics = Eigen::Dynamic>
     void compute_unsupervised_phi(
-        const MatrixX<Scalar> & beta,
+        const Ref<const MatrixX<Scalar> > & beta,
         const VectorX<Scalar> & gamma,
         Ref<MatrixX<Scalar> > phi
     );
@@ -174,8 +183,9 @@ namespace e_step_utils {
      * Update Multinomial parameter phi, according to the following approximation
      *
      *
+     * See compute_gamma() for the meaning of Topics.
      */
-    template <typename Scalar>
+    template <typename Scalar, int Topics = Eigen::Dynamic>
     void compute_supervised_approximate_phi(
         const VectorX<Scalar> & X_ratio,
         int num_words,
@@ -217,6 +227,80 @@ namespace e_step_utils {
         const MatrixX<Scalar> & phi,
         Ref<VectorX<Scalar> > tau
     );
+
+    /**
+     * Extract the words that appear in a document.
+     *
+     * @param X      The word counts of a document
+     * @param words  The vocabulary indices of the words with non zero
+     *               counts in increasing order (output)
+     * @param counts The counts of these words (output)
+     */
+    void nonzero_words(const VectorXi & X, VectorXi & words, VectorXi & counts);
+
+    /**
+     * Compute phi as in compute_unsupervised_phi() but only for the words
+     * that appear in a document and using a quantized beta (see
+     * QuantizedModelParameters) that is dequantized on the fly.
+     *
+     *     phi_{n,i} \propto s_i q_{i, w_n} exp(\psi(\gamma_i))
+     *
+     * @param beta       The half precision topics (K x V)
+     * @param beta_scale The per topic scale s
+     * @param words      The vocabulary indices w_n of the document's words
+     * @param gamma      The variational Dirichlet parameter
+     * @param phi        The output K x words.rows() matrix
+     */
+    template <typename Scalar>
+    void compute_quantized_phi(
+        const Eigen::Matrix<Eigen::half, Eigen::Dynamic, Eigen::Dynamic> & beta,
+        const VectorX<Scalar> & beta_scale,
+        const VectorXi & words,
+        const VectorX<Scalar> & gamma,
+        Ref<MatrixX<Scalar> > phi
+    );
+
+    /**
+     * Compute phi as above for an 8 bit beta whose codes are looked up in
+     * the per topic levels.
+     *
+     *     phi_{n,i} \propto l_{i, q_{i, w_n}} exp(\psi(\gamma_i))
+     *
+     * @param beta        The 8 bit codes of the topics (K x V)
+     * @param beta_levels The K x 256 probability of each code per topic
+     */
+    template <typename Scalar>
+    void compute_quantized_phi(
+        const Eigen::Matrix<std::uint8_t, Eigen::Dynamic, Eigen::Dynamic> & beta,
+        const MatrixX<Scalar> & beta_levels,
+        const VectorXi & words,
+        const VectorX<Scalar> & gamma,
+        Ref<MatrixX<Scalar> > phi
+    );
+
+    /**
+     * Perform one update of phi and gamma as compute_unsupervised_phi() and
+     * compute_gamma() do, but iterating only over the topics that are kept
+     * for each word in a sparse beta (see SparseModelParameters). phi is
+     * never materialized.
+     *
+     *     phi_{n,i} \propto beta_{i, w_n} exp(\psi(\gamma_i))  for i in topics(w_n)
+     *     gamma_i = alpha_i + \sum_n X_n phi_{n,i}
+     *
+     * @param beta   The sparse topics (K x V column major)
+     * @param words  The vocabulary indices w_n of the document's words
+     * @param counts The number of times X_n that each word appears
+     * @param alpha  The Dirichlet prior
+     * @param gamma  The variational Dirichlet parameter (input and output)
+     */
+    template <typename Scalar>
+    void compute_sparse_phi_gamma(
+        const Eigen::SparseMatrix<Scalar, Eigen::ColMajor> & beta,
+        const VectorXi & words,
+        const VectorXi & counts,
+        const VectorX<Scalar> & alpha,
+        Ref<VectorX<Scalar> > gamma
+    );
 } // namespace e_step_utils
 
 } // namespace ldaplusplus
@@ -37,6 +37,16 @@ class AbstractEStep : public EStepInterface<Scalar>
          */
         virtual void e_step() override {}
 
+        /**
+         * Save the state of the PRNG.
+         */
+        virtual void save_state(std::ostream &os) const override;
+
+        /**
+         * Restore the state of the PRNG.
+         */
+        virtual void load_state(std::istream &is) override;
+
     protected:
         /**
          * Check for convergence based on the mean relative change of the
@@ -1,9 +1,13 @@
 #ifndef _LDAPLUSPLUS_EM_ESTEPINTERFACE_HPP_
 #define _LDAPLUSPLUS_EM_ESTEPINTERFACE_HPP_
 
+#include <istream>
+#include <ostream>
+
 #include <Eigen/Core>
 
 #include "ldaplusplus/Document.hpp"
+#include "ldaplusplus/em/GammaCache.hpp"
 #include "ldaplusplus/events/Events.hpp"
 #include "ldaplusplus/Parameters.hpp"
 
@@ -43,6 +47,29 @@ class EStepInterface : public events::EventDispatcherComposition
             const std::shared_ptr<parameters::Parameters> parameters
         )=0;
 
+        /**
+         * Maximize the ELBO starting from the \f$\gamma\f$ of the document
+         * kept in a cache from the previous epoch and store the new one in
+         * it. Only training passes a cache so that the documents of other
+         * corpora neither use nor overwrite it.
+         *
+         * The default implementation ignores the cache, see
+         * UnsupervisedEStep and FastSupervisedEStep for warm starting.
+         *
+         * @param doc         A single document
+         * @param parameters  The model parameters
+         * @param gamma_cache The cache of the training documents' gammas
+         * @return            The variational parameters for the current
+         *                    model, after e-step is completed
+         */
+        virtual std::shared_ptr<parameters::Parameters> cached_doc_e_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> parameters,
+            GammaCache<Scalar> &gamma_cache
+        ) {
+            return doc_e_step(doc, parameters);
+        }
+
         /**
          * Perform actions that should be performed once for each epoch for the
          * whole corpus. One use of this method is so that the e steps can know
@@ -50,6 +77,24 @@ class EStepInterface : public events::EventDispatcherComposition
          */
         virtual void e_step()=0;
 
+        /**
+         * Write the state that this expectation step keeps across epochs
+         * (for instance the epoch count) so that a training can be resumed
+         * from a checkpoint (see LDA::save_checkpoint()).
+         *
+         * The default implementation writes nothing.
+         *
+         * @param os The stream to write the state to
+         */
+        virtual void save_state(std::ostream &os) const {}
+
+        /**
+         * Restore the state written by save_state().
+         *
+         * @param is The stream to read the state from
+         */
+        virtual void load_state(std::istream &is) {}
+
         virtual ~EStepInterface(){};
 };
 
@@ -1,6 +1,10 @@
 #ifndef _LDAPLUSPLUS_EM_FASTONLINESUPERVISEDMSTEP_HPP_
 #define _LDAPLUSPLUS_EM_FASTONLINESUPERVISEDMSTEP_HPP_
 
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "ldaplusplus/em/MStepInterface.hpp"
 
 namespace ldaplusplus {
@@ -21,6 +25,28 @@ namespace em {
  * In the maximization with respect to \f$\eta\f$ the first order taylor
  * approximation to the expectation of the log normalizer is used as in the
  * FastSupervisedMStep.
+ *
+ * When training with a transport (see MStepInterface::set_transport()) a
+ * minibatch is made of minibatch_size documents from every process, thus all
+ * the processes must be given the same number of documents.
+ *
+ * In hogwild mode doc_m_step() is called concurrently by the expectation step
+ * workers (see concurrent_doc_m_step()). Every worker aggregates a minibatch
+ * of its own and applies the update to a private copy of the model, locking
+ * only the topics that it writes and \f$\eta\f$ (Hogwild!, Niu et al. 2011).
+ * The topics of the copy are stored row major, each padded to its own cache
+ * lines, so that workers updating different topics do not falsely share
+ * them. After every update a snapshot of the copy is published (see
+ * MStepInterface::set_model_publisher()) so the expectation steps never
+ * read parameters that are being written. The MaximizationProgressEvent of
+ * the updates are dispatched by m_step() at the end of each epoch, which
+ * also applies the partially filled minibatches and checks that the model
+ * is consistent, that is finite with the topics being distributions over
+ * words. The hogwild mode cannot be combined with a transport.
+ *
+ * The vocabulary can grow while training on a stream (see
+ * grow_vocabulary()). When training with a transport all the processes must
+ * grow it in the same epoch.
  */
 template <typename Scalar>
 class FastOnlineSupervisedMStep : public MStepInterface<Scalar>
@@ -45,6 +71,8 @@ class FastOnlineSupervisedMStep : public MStepInterface<Scalar>
          *                               update of \f$\eta\f$
          * @param beta_weight            The weight for the online update
          *                                   of \f$\beta\f$
+         * @param hogwild                Apply the updates concurrently from
+         *                               the expectation step workers
          */
         FastOnlineSupervisedMStep(
             VectorX class_weights,
@@ -52,7 +80,8 @@ class FastOnlineSupervisedMStep : public MStepInterface<Scalar>
             size_t minibatch_size = 128,
             Scalar eta_momentum = 0.9,
             Scalar eta_learning_rate = 0.01,
-            Scalar beta_weight = 0.9
+            Scalar beta_weight = 0.9,
+            bool hogwild = false
         );
         /**
          * Create an FastOnlineSupervisedMStep that uses uniform weights for the
@@ -69,6 +98,8 @@ class FastOnlineSupervisedMStep : public MStepInterface<Scalar>
          *                               update of \f$\eta\f$
          * @param beta_weight            The weight for the online update
          *                                   of \f$\beta\f$
+         * @param hogwild                Apply the updates concurrently from
+         *                               the expectation step workers
          */
         FastOnlineSupervisedMStep(
             size_t num_classes,
@@ -76,7 +107,8 @@ class FastOnlineSupervisedMStep : public MStepInterface<Scalar>
             size_t minibatch_size = 128,
             Scalar eta_momentum = 0.9,
             Scalar eta_learning_rate = 0.01,
-            Scalar beta_weight = 0.9
+            Scalar beta_weight = 0.9,
+            bool hogwild = false
         );
 
         /**
@@ -103,7 +135,116 @@ class FastOnlineSupervisedMStep : public MStepInterface<Scalar>
             std::shared_ptr<parameters::Parameters> m_parameters
         ) override;
 
+        /**
+         * @return True if in hogwild mode
+         */
+        virtual bool concurrent_doc_m_step() const override {
+            return hogwild_;
+        }
+
+        /**
+         * @return True since every minibatch changes the model
+         */
+        virtual bool online_doc_m_step() const override {
+            return true;
+        }
+
+        /**
+         * Append a column for each new word to beta initialized with the
+         * uniform prior 1/words (the topics are renormalized with a single
+         * scale of the old words since they all sum to one). The
+         * sufficient statistics grow in chunks of at least their current
+         * size, so that a stream with a slowly growing vocabulary only
+         * reallocates them a logarithmic number of times.
+         */
+        virtual void grow_vocabulary(
+            size_t words,
+            std::shared_ptr<parameters::Parameters> parameters
+        ) override;
+
+        /**
+         * Save the partially filled minibatch (or the partially filled
+         * minibatches of the hogwild workers), the velocity of \f$\eta\f$
+         * and the count of the documents seen in the minibatch.
+         *
+         * It must not be called while doc_m_step() may be running.
+         */
+        virtual void save_state(std::ostream &os) const override;
+
+        /**
+         * Restore the state written by save_state().
+         */
+        virtual void load_state(std::istream &is) override;
+
     private:
+        typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixX;
+
+        /**
+         * The sufficient statistics of the minibatch of a worker in hogwild
+         * mode.
+         */
+        struct Minibatch
+        {
+            MatrixX b;
+            MatrixX expected_z_bar;
+            Eigen::VectorXi y;
+            size_t docs;
+        };
+
+        /**
+         * A mutex padded to a cache line so that the locks of neighbouring
+         * topics are not falsely shared.
+         */
+        struct PaddedMutex
+        {
+            std::mutex mutex;
+            char padding[64 - sizeof(std::mutex) % 64];
+        };
+
+        /**
+         * Update the model with the first `docs` documents of a minibatch.
+         */
+        void update(
+            const Eigen::Ref<const MatrixX> &b,
+            const MatrixX &expected_z_bar,
+            const Eigen::VectorXi &y,
+            size_t docs,
+            std::shared_ptr<parameters::Parameters> parameters
+        );
+
+        /**
+         * Update the private copy of the model with the first `docs`
+         * documents of a minibatch in hogwild mode locking every topic
+         * while it is being written.
+         */
+        void hogwild_update(
+            const MatrixX &b,
+            const MatrixX &expected_z_bar,
+            const Eigen::VectorXi &y,
+            size_t docs
+        );
+
+        /**
+         * Copy the private model of hogwild mode to parameters.
+         */
+        void copy_hogwild_model(
+            std::shared_ptr<parameters::Parameters> parameters
+        );
+
+        /**
+         * Aggregate the document in the minibatch of the calling worker and
+         * update the model if it is full.
+         */
+        void hogwild_doc_m_step(
+            const Eigen::VectorXi &X,
+            int y,
+            const MatrixX &phi,
+            const VectorX &gamma,
+            const VectorX &alpha,
+            std::shared_ptr<parameters::Parameters> m_parameters
+        );
+
+
         // Number of classes
         VectorX class_weights_;
         size_t num_classes_;
@@ -116,7 +257,8 @@ class FastOnlineSupervisedMStep : public MStepInterface<Scalar>
         Scalar regularization_penalty_;
 
         // The suff stats and data needed to optimize the ELBO w.r.t. model
-        // parameters
+        // parameters (b_ may have more columns than beta, see
+        // grow_vocabulary(), and only the first beta.cols() are used)
         MatrixX b_;
         Scalar beta_weight_;
         MatrixX expected_z_bar_;
@@ -128,6 +270,26 @@ class FastOnlineSupervisedMStep : public MStepInterface<Scalar>
 
         // The number of document's seen so far
         size_t docs_seen_so_far_;
+
+        // The hogwild mode state. The minibatches that no worker is filling
+        // at the moment, the private copy of the model (beta_rows_ and b_rows_
+        // have a padded row per topic and only the first beta.cols() columns
+        // are used) and a lock per topic plus one for eta.
+        bool hogwild_;
+        std::mutex minibatches_mutex_;
+        std::vector<std::shared_ptr<Minibatch> > minibatches_;
+        bool hogwild_model_ready_;
+        size_t hogwild_words_;
+        RowMatrixX beta_rows_;
+        RowMatrixX b_rows_;
+        MatrixX hogwild_eta_;
+        std::unique_ptr<PaddedMutex[]> topic_locks_;
+        std::mutex eta_lock_;
+        // publishing a snapshot is serialized so that it is never replaced
+        // by an older one
+        std::mutex publish_lock_;
+        // the log likelihoods of the hogwild updates of this epoch
+        std::vector<Scalar> hogwild_log_py_;
 };
 
 }  // namespace em
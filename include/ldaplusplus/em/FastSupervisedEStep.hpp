@@ -14,8 +14,10 @@ namespace em {
  * Similarly to all expectation steps (e.g. SupervisedEStep, UnsupervisedEStep)
  * we compute the values of variational parameters \f$\gamma\f$ and \f$\phi\f$
  * such that the likelihood of generating each document is maximized.
+ *
+ * See UnsupervisedEStep for the meaning of Topics.
  */
-template<typename Scalar>
+template<typename Scalar, int Topics = Eigen::Dynamic>
 class FastSupervisedEStep : public AbstractEStep<Scalar>
 {
     typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
@@ -102,6 +104,16 @@ class FastSupervisedEStep : public AbstractEStep<Scalar>
             const std::shared_ptr<parameters::Parameters> parameters
         ) override;
 
+        /**
+         * Run doc_e_step() starting from the cached \f$\gamma\f$ of the
+         * document (if any) and cache the computed one.
+         */
+        std::shared_ptr<parameters::Parameters> cached_doc_e_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> parameters,
+            GammaCache<Scalar> &gamma_cache
+        ) override;
+
         /**
          * Count how many epochs have already passed, in order to suitably
          * adjust the value of \f$\mathcal{C}\f$ hyperparameter, when
@@ -109,7 +121,26 @@ class FastSupervisedEStep : public AbstractEStep<Scalar>
          */
         void e_step() override;
 
+        /**
+         * Save the epoch count along with the PRNG.
+         */
+        void save_state(std::ostream &os) const override;
+
+        /**
+         * Restore the epoch count and the PRNG.
+         */
+        void load_state(std::istream &is) override;
+
     private:
+        /**
+         * The expectation step with an optional gamma cache.
+         */
+        std::shared_ptr<parameters::Parameters> doc_e_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> parameters,
+            GammaCache<Scalar> *gamma_cache
+        );
+
         /**
          * Define the weighting parameter for the supervised part of
          * expectation step according to the selected CWeightType method.
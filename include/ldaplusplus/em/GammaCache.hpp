@@ -0,0 +1,93 @@
+#ifndef _LDAPLUSPLUS_EM_GAMMACACHE_HPP_
+#define _LDAPLUSPLUS_EM_GAMMACACHE_HPP_
+
+
+#include <string>
+
+#include <Eigen/Core>
+
+#include "ldaplusplus/Document.hpp"
+#include "ldaplusplus/parallel/SharedArray.hpp"
+
+namespace ldaplusplus {
+namespace em {
+
+
+/**
+ * GammaCache keeps the variational parameter \f$\gamma\f$ of every document
+ * from the previous epoch so that the expectation step can start from it
+ * instead of the uniform initialization (warm start). In later epochs the
+ * posterior of most documents barely moves thus the expectation step
+ * converges in a few iterations.
+ *
+ * The documents are identified by corpus::Document::get_id() and the
+ * \f$\gamma\f$ are stored as floats regardless of Scalar. The cache is
+ * either in memory or in a memory mapped file (for corpora whose cache does
+ * not fit in memory).
+ *
+ * The expectation steps of different documents may use the cache
+ * concurrently.
+ */
+template <typename Scalar>
+class GammaCache
+{
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    public:
+        /**
+         * @param topics    The number of topics
+         * @param documents The number of documents, documents with larger
+         *                  ids are not cached
+         * @param path      A file to store the cache in or empty to keep it
+         *                  in memory
+         */
+        GammaCache(size_t topics, size_t documents, const std::string &path = "");
+
+        /**
+         * Read the cached gamma of a document.
+         *
+         * A gamma is only returned if it was stored for a document with the
+         * same id, the same number of words and the same
+         * corpus::Document::fingerprint() (the ids repeat across corpora).
+         *
+         * @param doc   The document
+         * @param gamma The gamma of the document (output)
+         * @return      Whether a gamma was found
+         */
+        bool get(const corpus::Document &doc, VectorX &gamma);
+
+        /**
+         * Store the gamma of a document.
+         *
+         * @param doc   The document
+         * @param gamma The gamma computed by the expectation step
+         */
+        void put(const corpus::Document &doc, const VectorX &gamma);
+
+        size_t topics() const { return topics_; }
+        size_t documents() const { return documents_; }
+
+    private:
+        /**
+         * @return The slot of the document or nullptr if it is not cached
+         */
+        float * slot(const corpus::Document &doc);
+
+        // The floats before the gamma of every document, its number of
+        // words and its fingerprint
+        static const size_t HEADER = 3;
+
+        size_t topics_;
+        size_t documents_;
+
+        // For every document its number of words and its fingerprint
+        // followed by its gamma (a zero gamma marks an empty slot since
+        // gamma > alpha > 0)
+        parallel::SharedArray<float> gammas_;
+};
+
+
+}  // namespace em
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_EM_GAMMACACHE_HPP_
@@ -1,11 +1,18 @@
 #ifndef _LDAPLUSPLUS_EM_MSTEPINTERFACE_HPP_
 #define _LDAPLUSPLUS_EM_MSTEPINTERFACE_HPP_
 
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+
 #include <Eigen/Core>
 
 #include "ldaplusplus/Document.hpp"
 #include "ldaplusplus/events/Events.hpp"
 #include "ldaplusplus/Parameters.hpp"
+#include "ldaplusplus/parallel/Transport.hpp"
 
 namespace ldaplusplus {
 namespace em {
@@ -60,7 +67,150 @@ class MStepInterface : public events::EventDispatcherComposition
             std::shared_ptr<parameters::Parameters> m_parameters
         )=0;
 
+        /**
+         * Whether doc_m_step() can be called concurrently from many threads.
+         *
+         * If true LDA calls doc_m_step() from the expectation step workers
+         * right after each document's expectation step instead of
+         * serializing the calls on the main thread.
+         *
+         * @return True if doc_m_step() is thread safe
+         */
+        virtual bool concurrent_doc_m_step() const {
+            return false;
+        }
+
+        /**
+         * Whether doc_m_step() changes the model parameters (online
+         * maximization steps), namely whether a copy of the model taken at
+         * the start of an epoch becomes stale during the epoch.
+         *
+         * @return True if doc_m_step() changes the model parameters
+         */
+        virtual bool online_doc_m_step() const {
+            return false;
+        }
+
+        /**
+         * Split m_step() in two; maximize w.r.t. \f$\beta\f$ now and move the
+         * sufficient statistics of the supervised part to a new maximization
+         * step whose m_step() only maximizes w.r.t. \f$\eta\f$.
+         *
+         * This allows the (comparatively slow) optimization of \f$\eta\f$
+         * to run in a background thread on SupervisedModelParameters that
+         * hold only \f$\eta\f$, while this object keeps aggregating the
+         * statistics of the next epoch. Anything that must be done in step
+         * with the other processes (see set_transport()) is done here.
+         *
+         * @param parameters Model parameters (changed by this method unless
+         *                   it returns nullptr)
+         * @return A maximization step that maximizes w.r.t. \f$\eta\f$ or
+         *         nullptr if the implementation does not support it
+         */
+        virtual std::shared_ptr<MStepInterface<Scalar> > detach(
+            std::shared_ptr<parameters::Parameters> parameters
+        ) {
+            return nullptr;
+        }
+
+        /**
+         * Grow the model so that it can describe documents with more words
+         * than the ones it was created with (the new word ids are the last
+         * ones). It is called between epochs when no expectation step is
+         * running.
+         *
+         * The default implementation throws since most maximization steps
+         * assume a fixed vocabulary.
+         *
+         * @param words      The new number of words
+         * @param parameters Model parameters (changed after call)
+         */
+        virtual void grow_vocabulary(
+            size_t words,
+            std::shared_ptr<parameters::Parameters> parameters
+        ) {
+            throw std::runtime_error("The documents have more words than the "
+                                     "model and this maximization step cannot "
+                                     "grow the vocabulary");
+        }
+
+        /**
+         * Write the state that this maximization step keeps across epochs
+         * (for instance the partially filled minibatch and the momentum of
+         * an online maximization step) so that a training can be resumed
+         * from a checkpoint (see LDA::save_checkpoint()).
+         *
+         * The default implementation writes nothing.
+         *
+         * @param os The stream to write the state to
+         */
+        virtual void save_state(std::ostream &os) const {}
+
+        /**
+         * Restore the state written by save_state().
+         *
+         * @param is The stream to read the state from
+         */
+        virtual void load_state(std::istream &is) {}
+
+        /**
+         * Set a transport to other processes that train on different shards
+         * of the corpus. The maximization steps combine their sufficient
+         * statistics with the other processes' through it before
+         * maximizing, so that all the processes compute the same model.
+         *
+         * @param transport The transport or nullptr for single process
+         *                  training
+         */
+        void set_transport(std::shared_ptr<parallel::Transport> transport) {
+            transport_ = transport;
+        }
+
+        /**
+         * @return The transport or nullptr if this is single process
+         *         training
+         */
+        std::shared_ptr<parallel::Transport> get_transport() {
+            return transport_;
+        }
+
+        /**
+         * Set the function that replaces the model parameters that the
+         * expectation steps read.
+         *
+         * In concurrent mode (see concurrent_doc_m_step()) doc_m_step() must
+         * not change the model parameters it is given, since the other
+         * workers are reading them, so it publishes an updated copy through
+         * this function instead.
+         *
+         * @param publisher Called with the new model parameters
+         */
+        void set_model_publisher(
+            std::function<void(std::shared_ptr<parameters::Parameters>)> publisher
+        ) {
+            publisher_ = publisher;
+        }
+
         virtual ~MStepInterface(){};
+
+    protected:
+        /**
+         * @return True if a model publisher has been set
+         */
+        bool can_publish_model() const {
+            return static_cast<bool>(publisher_);
+        }
+
+        /**
+         * Publish new model parameters (see set_model_publisher()).
+         */
+        void publish_model(std::shared_ptr<parameters::Parameters> parameters) {
+            publisher_(parameters);
+        }
+
+    private:
+        std::shared_ptr<parallel::Transport> transport_;
+        std::function<void(std::shared_ptr<parameters::Parameters>)> publisher_;
 };
 
 }  // namespace em
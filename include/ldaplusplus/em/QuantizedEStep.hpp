@@ -0,0 +1,63 @@
+#ifndef _LDAPLUSPLUS_EM_QUANTIZEDESTEP_HPP_
+#define _LDAPLUSPLUS_EM_QUANTIZEDESTEP_HPP_
+
+#include "ldaplusplus/em/AbstractEStep.hpp"
+
+namespace ldaplusplus {
+namespace em {
+
+
+/**
+ * QuantizedEStep implements the classic LDA expectation step (see
+ * UnsupervisedEStep) for models stored in QuantizedModelParameters.
+ *
+ * It is meant only for inference (LDA::transform and friends). The topics
+ * are dequantized on the fly only for the words that appear in each
+ * document and the returned VariationalParameters contain only
+ * \f$\gamma\f$ (\f$\phi\f$ is left empty) thus it cannot be combined with
+ * any maximization step.
+ */
+template <typename Scalar>
+class QuantizedEStep : public AbstractEStep<Scalar>
+{
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    public:
+        /**
+         * @param e_step_iterations The max number of times to alternate
+         *                          between maximizing for \f$\gamma\f$ and
+         *                          for \f$\phi\f$.
+         * @param e_step_tolerance  The minimum relative change in the
+         *                          variational parameter \f$\gamma\f$.
+         */
+        QuantizedEStep(
+            size_t e_step_iterations = 10,
+            Scalar e_step_tolerance = 1e-2
+        );
+
+        /**
+         * Maximize the ELBO w.r.t. to \f$\phi\f$ and \f$\gamma\f$ exactly
+         * as UnsupervisedEStep::doc_e_step() does.
+         *
+         * @param doc        A single document
+         * @param parameters An instance of QuantizedModelParameters
+         * @return           VariationalParameters with only \f$\gamma\f$
+         */
+        virtual std::shared_ptr<parameters::Parameters> doc_e_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> parameters
+        ) override;
+
+    private:
+        // The maximum number of iterations in E-step.
+        size_t e_step_iterations_;
+        // The convergence tolerance for the maximazation of the ELBO w.r.t.
+        // phi and gamma in E-step
+        Scalar e_step_tolerance_;
+};
+
+}  // namespace em
+}  // namespace ldaplusplus
+
+#endif // _LDAPLUSPLUS_EM_QUANTIZEDESTEP_HPP_
@@ -0,0 +1,132 @@
+#ifndef _LDAPLUSPLUS_EM_SELECTIVEUPDATE_HPP_
+#define _LDAPLUSPLUS_EM_SELECTIVEUPDATE_HPP_
+
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <Eigen/Core>
+
+#include "ldaplusplus/Document.hpp"
+#include "ldaplusplus/Parameters.hpp"
+
+namespace ldaplusplus {
+namespace em {
+
+
+/**
+ * SelectiveUpdate decides which documents can skip the expectation step of
+ * an epoch because their variational parameters have converged.
+ *
+ * After a document's expectation step its \f$\gamma\f$ is compared with
+ * the one of the previous epoch. If the absolute change relative to the
+ * sum of \f$\gamma\f$ (the document's length plus the sum of
+ * \f$\alpha\f$) is less than the tolerance the document is skipped for the next skip_epochs epochs and
+ * its cached variational parameters are passed to the maximization step
+ * instead. Every full_pass_every epochs no document is skipped so that the
+ * documents whose posterior starts moving again are caught.
+ *
+ * The documents are identified by corpus::Document::get_id() and the
+ * cached parameters are only used for a document with the same
+ * corpus::Document::fingerprint() and number of words. Only
+ * \f$\gamma\f$ and the columns of \f$\phi\f$ for the words in the document
+ * are cached (as floats) since the maximization steps multiply \f$\phi\f$
+ * with the word counts. Only plain parameters::VariationalParameters with
+ * a full \f$\phi\f$ are cached.
+ *
+ * Different documents may be updated concurrently.
+ */
+template <typename Scalar>
+class SelectiveUpdate
+{
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    public:
+        /**
+         * @param tolerance       The relative change of \f$\gamma\f$ below
+         *                        which a document is skipped
+         * @param skip_epochs     The number of epochs to skip a converged
+         *                        document for
+         * @param full_pass_every Every that many epochs no document is
+         *                        skipped (0 means never)
+         */
+        SelectiveUpdate(
+            Scalar tolerance = 1e-2,
+            size_t skip_epochs = 2,
+            size_t full_pass_every = 5
+        );
+
+        /**
+         * @param doc The document about to be processed
+         * @return    The cached variational parameters if the document
+         *            should skip the expectation step of this epoch or
+         *            nullptr otherwise
+         */
+        std::shared_ptr<parameters::Parameters> get(const corpus::Document &doc);
+
+        /**
+         * Remember the variational parameters computed for a document and
+         * decide whether it converged.
+         *
+         * @param doc          The document
+         * @param v_parameters The variational parameters computed by the
+         *                     expectation step
+         */
+        void put(
+            const corpus::Document &doc,
+            const std::shared_ptr<parameters::Parameters> v_parameters
+        );
+
+        /**
+         * Move on to the next epoch.
+         */
+        void next_epoch() { epoch_++; }
+
+        /**
+         * Forget every document (for instance because the next epoch is
+         * over another corpus). It must not be called while get() or put()
+         * may be running.
+         */
+        void clear();
+
+    private:
+        struct Entry
+        {
+            int num_words;
+            uint64_t fingerprint;
+            Eigen::VectorXf gamma;
+            // The columns of phi of the words in the document
+            Eigen::MatrixXf phi;
+            // The document is skipped up to (including) this epoch
+            size_t skip_until;
+        };
+
+        /**
+         * @return Whether no document is skipped in this epoch
+         */
+        bool full_pass() const;
+
+        /**
+         * @return The entry of the document (created if needed)
+         */
+        Entry & entry(int id);
+
+        Scalar tolerance_;
+        size_t skip_epochs_;
+        size_t full_pass_every_;
+        size_t epoch_;
+
+        // The unordered_map does not invalidate references on insertion so
+        // the mutex only needs to protect the lookup
+        std::mutex entries_mutex_;
+        std::unordered_map<int, Entry> entries_;
+};
+
+
+}  // namespace em
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_EM_SELECTIVEUPDATE_HPP_
@@ -52,6 +52,16 @@ class SemiSupervisedEStep : public EStepInterface<Scalar>
          */
         void e_step() override;
 
+        /**
+         * Save the state of both the sub e steps.
+         */
+        void save_state(std::ostream &os) const override;
+
+        /**
+         * Restore the state of both the sub e steps.
+         */
+        void load_state(std::istream &is) override;
+
     private:
         std::shared_ptr<EStepInterface<Scalar> > supervised_step_;
         std::shared_ptr<EStepInterface<Scalar> > unsupervised_step_;
@@ -0,0 +1,67 @@
+#ifndef _LDAPLUSPLUS_EM_SPARSEESTEP_HPP_
+#define _LDAPLUSPLUS_EM_SPARSEESTEP_HPP_
+
+#include "ldaplusplus/em/AbstractEStep.hpp"
+
+namespace ldaplusplus {
+namespace em {
+
+
+/**
+ * SparseEStep implements the classic LDA expectation step (see
+ * UnsupervisedEStep) for models stored in SparseModelParameters.
+ *
+ * For every word of a document only the topics kept in the sparse model are
+ * visited, so the cost of an iteration is proportional to the number of
+ * unique words in the document times the average number of topics per word
+ * instead of times the number of topics.
+ *
+ * It is meant only for inference (LDA::transform and friends) and the
+ * returned VariationalParameters contain only \f$\gamma\f$ (\f$\phi\f$
+ * is never materialized) thus it cannot be combined with any maximization
+ * step.
+ */
+template <typename Scalar>
+class SparseEStep : public AbstractEStep<Scalar>
+{
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    public:
+        /**
+         * @param e_step_iterations The max number of times to alternate
+         *                          between maximizing for \f$\gamma\f$ and
+         *                          for \f$\phi\f$.
+         * @param e_step_tolerance  The minimum relative change in the
+         *                          variational parameter \f$\gamma\f$.
+         */
+        SparseEStep(
+            size_t e_step_iterations = 10,
+            Scalar e_step_tolerance = 1e-2
+        );
+
+        /**
+         * Maximize the ELBO w.r.t. to \f$\phi\f$ and \f$\gamma\f$ exactly
+         * as UnsupervisedEStep::doc_e_step() does.
+         *
+         * @param doc        A single document
+         * @param parameters An instance of SparseModelParameters
+         * @return           VariationalParameters with only \f$\gamma\f$
+         */
+        virtual std::shared_ptr<parameters::Parameters> doc_e_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> parameters
+        ) override;
+
+    private:
+        // The maximum number of iterations in E-step.
+        size_t e_step_iterations_;
+        // The convergence tolerance for the maximazation of the ELBO w.r.t.
+        // phi and gamma in E-step
+        Scalar e_step_tolerance_;
+};
+
+}  // namespace em
+}  // namespace ldaplusplus
+
+#endif // _LDAPLUSPLUS_EM_SPARSEESTEP_HPP_
@@ -57,7 +57,8 @@ class SupervisedMStep : public UnsupervisedMStep<Scalar>
         ) : m_step_iterations_(m_step_iterations),
             m_step_tolerance_(m_step_tolerance),
             regularization_penalty_(regularization_penalty),
-            docs_(0)
+            docs_(0),
+            eta_only_(false)
         {}
 
         /**
@@ -89,7 +90,22 @@ class SupervisedMStep : public UnsupervisedMStep<Scalar>
             std::shared_ptr<parameters::Parameters> m_parameters
         ) override;
 
+        virtual std::shared_ptr<MStepInterface<Scalar> > detach(
+            std::shared_ptr<parameters::Parameters> parameters
+        ) override;
+
     private:
+        /**
+         * Keep the statistics of the documents seen so far and combine them
+         * with the ones of the other processes.
+         */
+        void gather_statistics();
+
+        /**
+         * Maximize \f$\mathcal{L}_{\eta}\f$ using gradient descent.
+         */
+        void maximize_eta(std::shared_ptr<parameters::Parameters> parameters);
+
         // The maximum number of iterations in M-step
         size_t m_step_iterations_;
         // The convergence tolerance for the maximazation of the ELBO w.r.t.
@@ -104,6 +120,9 @@ class SupervisedMStep : public UnsupervisedMStep<Scalar>
         MatrixX expected_z_bar_;
         std::vector<MatrixX> variance_z_bar_;
         Eigen::VectorXi y_;
+
+        // Set for the maximization steps created by detach()
+        bool eta_only_;
 };
 
 }  // namespace em
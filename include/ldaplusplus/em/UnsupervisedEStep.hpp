@@ -18,11 +18,19 @@ namespace em {
  *
  * See UnsupervisedEStep::doc_e_step for the mathematics.
  *
+ * When Topics is not Eigen::Dynamic the e step uses the kernels that are
+ * specialized for exactly that many topics (16, 32 and 64 are instantiated)
+ * and the model must have that many topics. LDABuilder picks the
+ * specialization automatically.
+ *
+ * The topics are read either from ModelParameters or in place from a
+ * memory mapped model file (MappedModelParameters).
+ *
  * [1] Blei, David M., Andrew Y. Ng, and Michael I. Jordan. "Latent dirichlet
  *     allocation." Journal of machine Learning research 3.Jan (2003):
  *     993-1022.
  */
-template <typename Scalar>
+template <typename Scalar, int Topics = Eigen::Dynamic>
 class UnsupervisedEStep : public AbstractEStep<Scalar>
 {
     typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
@@ -73,7 +81,26 @@ class UnsupervisedEStep : public AbstractEStep<Scalar>
             const std::shared_ptr<parameters::Parameters> parameters
         ) override;
 
+        /**
+         * Run doc_e_step() starting from the cached \f$\gamma\f$ of the
+         * document (if any) and cache the computed one.
+         */
+        virtual std::shared_ptr<parameters::Parameters> cached_doc_e_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> parameters,
+            GammaCache<Scalar> &gamma_cache
+        ) override;
+
     private:
+        /**
+         * The expectation step with an optional gamma cache.
+         */
+        std::shared_ptr<parameters::Parameters> doc_e_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> parameters,
+            GammaCache<Scalar> *gamma_cache
+        );
+
         // The maximum number of iterations in E-step.
         size_t e_step_iterations_;
         // The convergence tolerance for the maximazation of the ELBO w.r.t.
@@ -75,7 +75,10 @@ class UnsupervisedMStep : public MStepInterface<Scalar>
         ) override;
 
     private:
-        MatrixX b_;
+        // The sufficient statistics are accumulated in double precision
+        // regardless of Scalar since a float accumulator loses the
+        // contributions of the later documents of large corpora
+        Eigen::MatrixXd b_;
 };
 
 }  // namespace em
@@ -2,16 +2,42 @@
 #define _LDAPLUSPLUS_EVENTS_EVENTS_HPP_
 
 
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_set>
+#include <vector>
 
 namespace ldaplusplus {
 namespace events {
 
 
+/**
+ * Get the type tag of the events with the given id.
+ *
+ * The tags are small consecutive integers assigned the first time an id is
+ * seen, so the dispatchers can keep a listener list per event type and
+ * route an event with a single index lookup. The event classes look up
+ * their tag once and keep it (see ProgressEvents.hpp).
+ *
+ * @param id A string that identifies the event
+ * @return The type tag of the event
+ */
+size_t event_type(const std::string &id);
+
+
+/**
+ * Does not lock, the listeners may call it for every event.
+ *
+ * @param type The type tag of an event
+ * @return The string that identifies the events with this tag
+ */
+const std::string & event_id(size_t type);
+
+
 /**
  * A base event object that will be dispatched and received.
  */
@@ -23,14 +49,24 @@ class Event
          */
         Event(std::string id);
 
+        /**
+         * @param type The type tag of the event (see event_type())
+         */
+        Event(size_t type);
+
         /**
          * @return A string that identifies the event (passed in the
          *         constructor)
          */
         const std::string & id() const;
 
+        /**
+         * @return The type tag of the event
+         */
+        size_t type() const { return type_; }
+
     private:
-        std::string id_;
+        size_t type_;
 };
 
 
@@ -45,6 +81,15 @@ class EventListenerInterface
          */
         virtual void on_event(std::shared_ptr<Event> event) = 0;
 
+        /**
+         * The dispatchers only pass to the listener the events of the
+         * types returned by this method.
+         *
+         * @return The type tags of the events this listener handles or an
+         *         empty vector for all the events
+         */
+        virtual std::vector<size_t> event_types() const { return {}; }
+
         virtual ~EventListenerInterface(){};
 };
 
@@ -55,12 +100,17 @@ class EventListenerInterface
 class FunctionEventListener : public EventListenerInterface
 {
     public:
-        FunctionEventListener(std::function<void(std::shared_ptr<Event>)> listener);
+        FunctionEventListener(
+            std::function<void(std::shared_ptr<Event>)> listener,
+            std::vector<size_t> event_types = {}
+        );
 
         void on_event(std::shared_ptr<Event> event) override;
+        std::vector<size_t> event_types() const override;
 
     private:
         std::function<void(std::shared_ptr<Event>)> listener_;
+        std::vector<size_t> event_types_;
 };
 
 
@@ -111,12 +161,16 @@ class EventDispatcherInterface
          * The created object is returned so that the listener can be removed
          * later.
          *
-         * @param listener A function implementing the EventListener interface.
+         * @param listener    A function implementing the EventListener
+         *                    interface.
+         * @param event_types The type tags of the events to pass to the
+         *                    function (all the events if empty)
          */
         std::shared_ptr<EventListenerInterface> add_listener(
-            std::function<void(std::shared_ptr<Event>)> listener
+            std::function<void(std::shared_ptr<Event>)> listener,
+            std::vector<size_t> event_types = {}
         ) {
-            auto l = std::make_shared<FunctionEventListener>(listener);
+            auto l = std::make_shared<FunctionEventListener>(listener, event_types);
 
             add_listener(l);
 
@@ -159,6 +213,42 @@ class EventDispatcherInterface
 };
 
 
+/**
+ * The listeners of a dispatcher grouped by the event types they handle.
+ */
+class EventListeners
+{
+    public:
+        /**
+         * Add the listener to the lists of the event types it handles.
+         */
+        void add(std::shared_ptr<EventListenerInterface> listener);
+
+        /**
+         * Remove the listener from all the lists.
+         */
+        void remove(std::shared_ptr<EventListenerInterface> listener);
+
+        /**
+         * Call the on_event() of the listeners that handle this event in
+         * the order they were added.
+         */
+        void notify(std::shared_ptr<Event> event) const;
+
+        /**
+         * Whether any listener handles the events of this type.
+         */
+        bool handles(size_t type) const;
+
+    private:
+        // the listeners of all the events
+        std::list<std::shared_ptr<EventListenerInterface> > all_;
+        // the listeners of every event type (specific and all the events
+        // ones in the order they were added) indexed by the type tag
+        std::vector<std::list<std::shared_ptr<EventListenerInterface> > > by_type_;
+};
+
+
 /**
  * EventDispatcher is a simple implementation of an EventDispatcherInterface. It can be
  * copied, passed by value, reference whatever. It is **not** thread safe.
@@ -171,7 +261,7 @@ class EventDispatcher : public EventDispatcherInterface
         void dispatch(std::shared_ptr<Event> event) override;
 
     private:
-        std::list<std::shared_ptr<EventListenerInterface> > listeners_;
+        EventListeners listeners_;
 };
 
 
@@ -206,8 +296,14 @@ class EventDispatcherComposition
 class ThreadSafeEventDispatcher : public EventDispatcherInterface
 {
     public:
+        ThreadSafeEventDispatcher();
+
         virtual void add_listener(std::shared_ptr<EventListenerInterface> listener) override;
         virtual void remove_listener(std::shared_ptr<EventListenerInterface> listener) override;
+        /**
+         * Queue the event until the next process_events() (or drop it if no
+         * listener handles it).
+         */
         virtual void dispatch(std::shared_ptr<Event> event) override;
 
         /**
@@ -217,11 +313,13 @@ class ThreadSafeEventDispatcher : public EventDispatcherInterface
          * The listeners will be called on the thread that this method is
          * called.
          */
-        void process_events();
+        virtual void process_events();
 
     private:
+        // the listeners are copied on write so that process_events() only
+        // needs to take a reference to them
         std::mutex listeners_mutex_;
-        std::list<std::shared_ptr<EventListenerInterface> > listeners_;
+        std::shared_ptr<const EventListeners> listeners_;
 
         std::mutex deleted_listeners_mutex_;
         std::unordered_set<std::shared_ptr<EventListenerInterface> > deleted_listeners_;
@@ -245,6 +343,12 @@ class SameThreadEventDispatcher : public ThreadSafeEventDispatcher
 
         virtual void dispatch(std::shared_ptr<Event> event) override;
 
+        /**
+         * Process the queued events if called from the thread in which the
+         * dispatcher was created, otherwise leave them queued for it.
+         */
+        virtual void process_events() override;
+
     private:
         std::thread::id thread_id_;
 };
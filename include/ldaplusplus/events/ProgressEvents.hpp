@@ -17,15 +17,38 @@ template <typename Scalar>
 class ExpectationProgressEvent : public Event
 {
     public:
-        ExpectationProgressEvent(Scalar likelihood) :
-            Event("ExpectationProgressEvent"),
-            likelihood_(likelihood)
+        ExpectationProgressEvent(
+            Scalar likelihood,
+            size_t iterations = 0,
+            bool warm_started = false
+        ) :
+            Event(type_tag()),
+            likelihood_(likelihood),
+            iterations_(iterations),
+            warm_started_(warm_started)
         {}
 
+        /**
+         * @return The type tag of the ExpectationProgressEvent for any
+         *         Scalar
+         */
+        static size_t type_tag() {
+            static const size_t type = event_type("ExpectationProgressEvent");
+            return type;
+        }
+
         Scalar likelihood() const { return likelihood_; }
 
+        // The iterations the expectation step needed to converge (0 if the
+        // expectation step does not report them) and whether it started
+        // from a cached gamma (see em::GammaCache)
+        size_t iterations() const { return iterations_; }
+        bool warm_started() const { return warm_started_; }
+
     private:
         Scalar likelihood_;
+        size_t iterations_;
+        bool warm_started_;
 };
 
 
@@ -34,10 +57,15 @@ class MaximizationProgressEvent : public Event
 {
     public:
         MaximizationProgressEvent(Scalar likelihood) :
-            Event("MaximizationProgressEvent"),
+            Event(type_tag()),
             likelihood_(likelihood)
         {}
 
+        static size_t type_tag() {
+            static const size_t type = event_type("MaximizationProgressEvent");
+            return type;
+        }
+
         Scalar likelihood() const { return likelihood_; }
 
     private:
@@ -50,10 +78,15 @@ class EpochProgressEvent : public Event
 {
     public:
         EpochProgressEvent(const std::shared_ptr<parameters::Parameters> parameters) :
-            Event("EpochProgressEvent"),
+            Event(type_tag()),
             model_parameters_(parameters)
         {}
 
+        static size_t type_tag() {
+            static const size_t type = event_type("EpochProgressEvent");
+            return type;
+        }
+
         const std::shared_ptr<parameters::Parameters> model_parameters() const {
             return model_parameters_;
         }
@@ -0,0 +1,62 @@
+#ifndef _LDAPLUSPLUS_PARALLEL_NUMATOPOLOGY_HPP_
+#define _LDAPLUSPLUS_PARALLEL_NUMATOPOLOGY_HPP_
+
+
+#include <string>
+#include <vector>
+
+namespace ldaplusplus {
+namespace parallel {
+
+
+/**
+ * The CPUs of every NUMA node of the machine.
+ *
+ * The topology is read from the nodeN directories of /sys/devices/system/node
+ * in ascending N (the numbers may have gaps) skipping the nodes without
+ * CPUs. When it is not available (not Linux, no NUMA support in the kernel)
+ * the machine is treated as a single node with all the CPUs.
+ *
+ * Memory is allocated on the node of the thread that first writes to it,
+ * so a thread pinned to a node with pin_to_node() can be used to place
+ * data close to the CPUs that will read it.
+ */
+class NumaTopology
+{
+    public:
+        /**
+         * @param root The sysfs directory that lists the nodes
+         */
+        NumaTopology(const std::string &root = "/sys/devices/system/node");
+
+        /**
+         * @return The number of NUMA nodes
+         */
+        size_t nodes() const { return cpus_.size(); }
+
+        /**
+         * @return The CPUs of a node
+         */
+        const std::vector<int> & cpus(size_t node) const { return cpus_[node]; }
+
+        /**
+         * Restrict the calling thread to the CPUs of a node.
+         *
+         * @return False if the thread could not be pinned
+         */
+        bool pin_to_node(size_t node) const;
+
+        /**
+         * Parse a cpulist as found in sysfs (for instance "0-3,8,10-11").
+         */
+        static std::vector<int> parse_cpulist(const std::string &cpulist);
+
+    private:
+        std::vector<std::vector<int> > cpus_;
+};
+
+
+}  // namespace parallel
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_PARALLEL_NUMATOPOLOGY_HPP_
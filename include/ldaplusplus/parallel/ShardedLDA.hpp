@@ -0,0 +1,152 @@
+#ifndef _LDAPLUSPLUS_PARALLEL_SHARDEDLDA_HPP_
+#define _LDAPLUSPLUS_PARALLEL_SHARDEDLDA_HPP_
+
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "ldaplusplus/events/Events.hpp"
+#include "ldaplusplus/Parameters.hpp"
+
+namespace ldaplusplus {
+namespace parallel {
+
+
+/**
+ * ShardedLDA trains an unsupervised LDA model in a model parallel fashion
+ * so that no worker needs the whole \f$K \times V\f$ \f$\beta\f$ or the
+ * equally large sufficient statistics of the maximization step.
+ *
+ * The vocabulary is partitioned into word blocks (balanced by their token
+ * counts in the corpus) and the documents into as many shards as there are
+ * workers. Every epoch is split in rounds and in each round every worker
+ * owns exactly one word block, so that it reads \f$\beta\f$ and writes the
+ * sufficient statistics only for the words of this block. Between rounds
+ * the blocks rotate across the workers (as in LightLDA and Petuum) and
+ * after all the rounds every document has seen every word block.
+ *
+ * Since the words of a document are visited one block at a time, the
+ * expectation step is performed as a single fixed point iteration per epoch
+ * using the \f$\gamma\f$ of the previous epoch,
+ *
+ * \f[
+ *     \phi_{dwk} \propto \beta_{kw} \exp(\Psi(\gamma_{dk})) \qquad
+ *     \gamma_{dk} = \alpha_k + \sum_w X_{dw} \phi_{dwk}
+ * \f]
+ *
+ * and the maximization step is the one of UnsupervisedMStep.
+ *
+ * The workers are separate local processes (created with fork()) that share
+ * \f$\beta\f$, the sufficient statistics and a barrier through shared
+ * memory. If a storage path is given the model blocks are backed by files
+ * instead of anonymous memory so that the operating system only needs to
+ * keep the blocks that are being worked on in memory. While training, the
+ * model exists only in the shared memory; it is moved there at the start of
+ * fit() and gathered back once at the end.
+ *
+ * If a worker fails or dies the rest are released from the barrier and
+ * fit() throws. Since the workers are forked, fit() must be called while
+ * the calling process has no other threads running (for instance no
+ * asynchronous event dispatcher or worker pool).
+ *
+ * Example:
+ *
+ *     LDA<double> lda = LDABuilder<double>().initialize_topics_seeded(X, 100);
+ *     ShardedLDA<double> sharded(
+ *         lda.model_parameters<parameters::ModelParameters<double> >(),
+ *         20,  // iterations
+ *         4    // worker processes
+ *     );
+ *     sharded.fit(X);
+ */
+template <typename Scalar = double>
+class ShardedLDA
+{
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    public:
+        /**
+         * @param model_parameters  The initial model (it is updated in place
+         *                          at the end of fit())
+         * @param iterations        The number of epochs to run in fit()
+         * @param workers           The number of worker processes
+         * @param blocks_per_worker The vocabulary is split in
+         *                          workers*blocks_per_worker blocks. More
+         *                          blocks mean a smaller slice of the model
+         *                          per round but more synchronization.
+         * @param storage_path      If not empty the prefix of two files that
+         *                          will back \f$\beta\f$ and the sufficient
+         *                          statistics during training
+         */
+        ShardedLDA(
+            std::shared_ptr<parameters::ModelParameters<Scalar> > model_parameters,
+            size_t iterations = 20,
+            size_t workers = 1,
+            size_t blocks_per_worker = 1,
+            std::string storage_path = ""
+        );
+
+        /**
+         * Compute an unsupervised topic model for word counts X.
+         *
+         * After every epoch an ExpectationProgressEvent with the per document
+         * lower bound of the log likelihood and an EpochProgressEvent are
+         * dispatched from the calling process. The EpochProgressEvent
+         * carries a copy of the model of that epoch, made only for the
+         * event, since the \f$\beta\f$ of model_parameters() is empty
+         * until fit() returns.
+         *
+         * @throws std::runtime_error if a worker process fails or if the
+         *                            calling process has other threads
+         *
+         * @param X The word counts in column-major order
+         */
+        void fit(const Eigen::MatrixXi &X);
+
+        /**
+         * Get the event dispatcher for this ShardedLDA instance.
+         */
+        std::shared_ptr<events::EventDispatcherInterface> get_event_dispatcher() {
+            return event_dispatcher_;
+        }
+
+        /**
+         * Get the model's parameters.
+         */
+        const std::shared_ptr<parameters::ModelParameters<Scalar> > model_parameters() {
+            return model_parameters_;
+        }
+
+    private:
+        // A range of the vocabulary [first, second)
+        typedef std::pair<int, int> WordBlock;
+
+        /**
+         * Split the vocabulary into blocks with approximately equal number of
+         * tokens.
+         */
+        std::vector<WordBlock> partition_vocabulary(
+            const Eigen::MatrixXi &X,
+            size_t blocks
+        ) const;
+
+        // The model parameters
+        std::shared_ptr<parameters::ModelParameters<Scalar> > model_parameters_;
+
+        size_t iterations_;
+        size_t workers_;
+        size_t blocks_per_worker_;
+        std::string storage_path_;
+
+        std::shared_ptr<events::EventDispatcherInterface> event_dispatcher_;
+};
+
+
+}  // namespace parallel
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_PARALLEL_SHARDEDLDA_HPP_
@@ -0,0 +1,85 @@
+#ifndef _LDAPLUSPLUS_PARALLEL_SHAREDARRAY_HPP_
+#define _LDAPLUSPLUS_PARALLEL_SHAREDARRAY_HPP_
+
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace ldaplusplus {
+namespace parallel {
+
+
+/**
+ * An array in memory that is shared with the processes forked after its
+ * creation. It is either anonymous or backed by a file, in which case the
+ * kernel can page it out to the file and the array can be larger than the
+ * memory. The file is removed when the array is destroyed.
+ *
+ * Anonymous memory and newly created files are zero filled.
+ */
+template <typename T>
+class SharedArray
+{
+    public:
+        SharedArray(size_t size, const std::string &path = "")
+            : size_(size),
+              path_(path)
+        {
+            size_t bytes = std::max<size_t>(1, size_ * sizeof(T));
+            void *data;
+
+            if (path_.empty()) {
+                data = mmap(
+                    nullptr, bytes, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0
+                );
+            } else {
+                int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+                if (fd < 0) {
+                    throw std::runtime_error("Could not create " + path_);
+                }
+                if (ftruncate(fd, bytes) != 0) {
+                    close(fd);
+                    throw std::runtime_error("Could not resize " + path_);
+                }
+                data = mmap(
+                    nullptr, bytes, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0
+                );
+                close(fd);
+            }
+
+            if (data == MAP_FAILED) {
+                throw std::runtime_error("Could not allocate shared memory");
+            }
+            data_ = static_cast<T *>(data);
+        }
+
+        SharedArray(const SharedArray &) = delete;
+        SharedArray & operator=(const SharedArray &) = delete;
+
+        ~SharedArray() {
+            munmap(data_, std::max<size_t>(1, size_ * sizeof(T)));
+            if (!path_.empty()) {
+                unlink(path_.c_str());
+            }
+        }
+
+        T * data() { return data_; }
+
+    private:
+        T *data_;
+        size_t size_;
+        std::string path_;
+};
+
+
+}  // namespace parallel
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_PARALLEL_SHAREDARRAY_HPP_
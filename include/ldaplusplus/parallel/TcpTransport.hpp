@@ -0,0 +1,95 @@
+#ifndef _LDAPLUSPLUS_PARALLEL_TCPTRANSPORT_HPP_
+#define _LDAPLUSPLUS_PARALLEL_TCPTRANSPORT_HPP_
+
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+
+#include "ldaplusplus/parallel/Transport.hpp"
+
+namespace ldaplusplus {
+namespace parallel {
+
+
+/**
+ * A Transport over TCP sockets with a star topology.
+ *
+ * The process with rank 0 listens on the given port and every other process
+ * connects to it. In all_gather() the root receives the buffers of all the
+ * processes and sends all of them back to everyone. In all_reduce() the
+ * root combines the buffers in rank order as they arrive and sends back
+ * only the result, so each process sends and receives a single buffer.
+ *
+ * It is meant for a few processes on a single machine (over loopback) or on
+ * a local network.
+ *
+ * Example (in each of the N processes):
+ *
+ *     auto transport = std::make_shared<TcpTransport>(rank, N, 5555);
+ *     LDA<double> lda = LDABuilder<double>().
+ *         ...
+ *         set_transport(transport);
+ *     lda.fit(X_shard, y_shard);
+ */
+class TcpTransport : public Transport
+{
+    public:
+        /**
+         * Connect all the processes. Blocks until every process has joined.
+         *
+         * @param rank    The index of this process in [0, size)
+         * @param size    The number of processes
+         * @param port    The port that rank 0 listens to
+         * @param host    The address of rank 0
+         * @param timeout The seconds to keep trying to connect to rank 0
+         */
+        TcpTransport(
+            int rank,
+            int size,
+            int port,
+            std::string host = "127.0.0.1",
+            int timeout = 30
+        );
+        TcpTransport(const TcpTransport &) = delete;
+        TcpTransport & operator=(const TcpTransport &) = delete;
+        ~TcpTransport();
+
+        int rank() const override { return rank_; }
+        int size() const override { return size_; }
+
+        std::vector<std::vector<char> > all_gather(
+            const std::vector<char> &buffer
+        ) override;
+
+        void all_reduce(
+            std::vector<char> &buffer,
+            const std::function<void(std::vector<char> &, const std::vector<char> &)> &combine
+        ) override;
+
+    private:
+        /**
+         * Accept the connections of all the other ranks (for rank 0).
+         */
+        void accept_ranks(const sockaddr_in &address);
+
+        /**
+         * Connect to rank 0 retrying for timeout seconds.
+         */
+        void connect_to_root(const sockaddr_in &address, int timeout);
+
+        int rank_;
+        int size_;
+
+        // The connections to the other processes for rank 0 (ordered by
+        // rank starting from 1) or the connection to rank 0 otherwise
+        std::vector<int> sockets_;
+};
+
+
+}  // namespace parallel
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_PARALLEL_TCPTRANSPORT_HPP_
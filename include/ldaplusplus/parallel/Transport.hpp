@@ -0,0 +1,179 @@
+#ifndef _LDAPLUSPLUS_PARALLEL_TRANSPORT_HPP_
+#define _LDAPLUSPLUS_PARALLEL_TRANSPORT_HPP_
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace ldaplusplus {
+namespace parallel {
+
+
+/**
+ * A Transport connects a group of processes that train the same model on
+ * different shards of a corpus (data parallel training).
+ *
+ * Implementations only need to provide the all_gather() collective; the
+ * rest are built on top of it. Implementations should also override
+ * all_reduce() since building it on all_gather() means that every process
+ * receives the contributions of all the others. Every collective must be
+ * called by all the processes in the same order.
+ *
+ * The reductions combine the contributions in rank order so that every
+ * process ends up with bitwise identical sufficient statistics and thus
+ * identical model parameters.
+ */
+class Transport
+{
+    public:
+        /**
+         * @return The index of this process in [0, size())
+         */
+        virtual int rank() const = 0;
+
+        /**
+         * @return The number of processes
+         */
+        virtual int size() const = 0;
+
+        /**
+         * Send a buffer to every process and receive theirs.
+         *
+         * @param  buffer The bytes contributed by this process
+         * @return        The buffers of all the processes ordered by rank
+         */
+        virtual std::vector<std::vector<char> > all_gather(
+            const std::vector<char> &buffer
+        ) = 0;
+
+        /**
+         * Combine the buffers of all the processes into one and replace the
+         * buffer of every process with it.
+         *
+         * The buffers are combined in rank order, namely the result is
+         * combine(...combine(combine(b_0, b_1), b_2)..., b_{size-1}) where
+         * the first argument of combine is updated in place.
+         *
+         * @param buffer  The bytes contributed by this process that are
+         *                replaced by the combined bytes
+         * @param combine Combines the second buffer into the first
+         */
+        virtual void all_reduce(
+            std::vector<char> &buffer,
+            const std::function<void(std::vector<char> &, const std::vector<char> &)> &combine
+        ) {
+            auto buffers = all_gather(buffer);
+            buffer = std::move(buffers[0]);
+            for (size_t i=1; i<buffers.size(); i++) {
+                combine(buffer, buffers[i]);
+            }
+        }
+
+        virtual ~Transport(){};
+
+        /**
+         * Replace the n values pointed to by data with their sum over all
+         * the processes.
+         */
+        template <typename Scalar>
+        void all_reduce_sum(Scalar *data, size_t n) {
+            std::vector<char> buffer(n * sizeof(Scalar));
+            std::memcpy(buffer.data(), data, buffer.size());
+            all_reduce(
+                buffer,
+                [n](std::vector<char> &sum, const std::vector<char> &other) {
+                    if (sum.size() != other.size() || sum.size() != n * sizeof(Scalar)) {
+                        throw std::runtime_error("All processes should reduce "
+                                                 "arrays of the same size");
+                    }
+                    Scalar *x = reinterpret_cast<Scalar *>(sum.data());
+                    const Scalar *y = reinterpret_cast<const Scalar *>(other.data());
+                    for (size_t i=0; i<n; i++) {
+                        x[i] += y[i];
+                    }
+                }
+            );
+            if (buffer.size() != n * sizeof(Scalar)) {
+                throw std::runtime_error("All processes should reduce "
+                                         "arrays of the same size");
+            }
+            std::memcpy(data, buffer.data(), buffer.size());
+        }
+
+        /**
+         * Replace the matrix x with its element-wise sum over all the
+         * processes.
+         */
+        template <typename Derived>
+        void all_reduce_sum(Eigen::PlainObjectBase<Derived> &x) {
+            all_reduce_sum(x.data(), x.size());
+        }
+
+        /**
+         * Replace the matrix x with the concatenation of the columns of the
+         * matrices x of all the processes ordered by rank.
+         *
+         * Processes that contribute no columns may pass an empty matrix.
+         */
+        template <typename Derived>
+        void all_gather_cols(Eigen::PlainObjectBase<Derived> &x) {
+            typedef typename Derived::Scalar Scalar;
+
+            std::vector<char> buffer(2*sizeof(int64_t) + x.size()*sizeof(Scalar));
+            int64_t shape[2] = {x.rows(), x.cols()};
+            std::memcpy(buffer.data(), shape, sizeof(shape));
+            std::memcpy(buffer.data() + sizeof(shape), x.data(), x.size()*sizeof(Scalar));
+            auto buffers = all_gather(buffer);
+
+            int64_t rows = 0, cols = 0;
+            for (auto & b : buffers) {
+                std::memcpy(shape, b.data(), sizeof(shape));
+                if (shape[1] > 0) {
+                    rows = shape[0];
+                    cols += shape[1];
+                }
+            }
+
+            x.resize(rows, cols);
+            int64_t col = 0;
+            for (auto & b : buffers) {
+                std::memcpy(shape, b.data(), sizeof(shape));
+                if (shape[1] == 0) {
+                    continue;
+                }
+                if (shape[0] != rows) {
+                    throw std::runtime_error("All processes should gather "
+                                             "matrices with the same rows");
+                }
+                std::memcpy(
+                    x.data() + col*rows,
+                    b.data() + sizeof(shape),
+                    shape[0]*shape[1]*sizeof(Scalar)
+                );
+                col += shape[1];
+            }
+        }
+
+        /**
+         * Replace the vector x with the concatenation of the vectors x of all
+         * the processes ordered by rank.
+         */
+        template <typename T>
+        void all_gather_vector(Eigen::Matrix<T, Eigen::Dynamic, 1> &x) {
+            Eigen::Matrix<T, 1, Eigen::Dynamic> row = x.transpose();
+            all_gather_cols(row);
+            x = row.transpose();
+        }
+};
+
+
+}  // namespace parallel
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_PARALLEL_TRANSPORT_HPP_
@@ -0,0 +1,50 @@
+#ifndef _LDAPLUSPLUS_QUANTIZATION_HPP_
+#define _LDAPLUSPLUS_QUANTIZATION_HPP_
+
+#include <memory>
+
+#include <Eigen/Core>
+
+#include "ldaplusplus/Parameters.hpp"
+
+namespace ldaplusplus {
+namespace quantization {
+
+    /**
+     * Create a compressed copy of a trained model to be used for inference
+     * with QuantizedEStep.
+     *
+     * With Float16 every topic is scaled so that its largest probability
+     * maps to 1 and then rounded to the nearest half precision float. With
+     * Int8 every probability is rounded (in the log domain) to the nearest
+     * of 255 levels spaced logarithmically over the range of its topic, so
+     * that small probabilities are not rounded to zero (see
+     * QuantizedModelParameters). This reduces the size of beta 4 or 8 times
+     * (for float and double respectively) using Float16 and 8 or 16 times
+     * using Int8.
+     *
+     * @param model    The full precision model
+     * @param encoding The storage type for beta
+     * @return         The quantized model (alpha and eta are copied as is)
+     */
+    template <typename Scalar>
+    std::shared_ptr<parameters::QuantizedModelParameters<Scalar> > quantize(
+        const parameters::SupervisedModelParameters<Scalar> &model,
+        typename parameters::QuantizedModelParameters<Scalar>::Encoding encoding
+    );
+
+    /**
+     * Reconstruct the full precision topics from a quantized model.
+     *
+     * @param model The quantized model
+     * @return      The K x V beta matrix
+     */
+    template <typename Scalar>
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> dequantize(
+        const parameters::QuantizedModelParameters<Scalar> &model
+    );
+
+}  // namespace quantization
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_QUANTIZATION_HPP_
@@ -0,0 +1,35 @@
+#ifndef _LDAPLUSPLUS_SPARSIFICATION_HPP_
+#define _LDAPLUSPLUS_SPARSIFICATION_HPP_
+
+#include <memory>
+
+#include "ldaplusplus/Parameters.hpp"
+
+namespace ldaplusplus {
+namespace sparsification {
+
+    /**
+     * Create a pruned copy of a trained model to be used for inference with
+     * SparseEStep.
+     *
+     * For every word w the topics are sorted by \f$\beta_{kw}\f$ and the
+     * most probable ones are kept until they account for at least mass of
+     * \f$\sum_k \beta_{kw}\f$. At least one topic is kept for every word
+     * that has a non zero probability under some topic. The kept
+     * probabilities are not renormalized.
+     *
+     * @param model The full model (for instance as loaded from a file)
+     * @param mass  The cumulative probability mass to keep per word in (0, 1]
+     *              (std::invalid_argument is thrown otherwise)
+     * @return      The sparse model (alpha and eta are copied as is)
+     */
+    template <typename Scalar>
+    std::shared_ptr<parameters::SparseModelParameters<Scalar> > sparsify(
+        const parameters::SupervisedModelParameters<Scalar> &model,
+        Scalar mass
+    );
+
+}  // namespace sparsification
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_SPARSIFICATION_HPP_
@@ -608,6 +608,24 @@ class ThreadSafePRNG
             return (*prng_)();
         }
 
+        /**
+         * @return A copy of the wrapped PRNG (for instance to checkpoint it)
+         */
+        PRNG state() const {
+            std::lock_guard<std::mutex> lock(*prng_mutex_);
+
+            return *prng_;
+        }
+
+        /**
+         * Replace the state of the wrapped PRNG.
+         */
+        void set_state(const PRNG &prng) {
+            std::lock_guard<std::mutex> lock(*prng_mutex_);
+
+            *prng_ = prng;
+        }
+
     private:
         std::shared_ptr<std::mutex> prng_mutex_;
         std::shared_ptr<PRNG> prng_;
@@ -1,17 +1,32 @@
 #include "ldaplusplus/events/ProgressEvents.hpp"
 
 #include "applications/EpochProgress.hpp"
+#include "applications/SnapshotEvery.hpp"
 
-EpochProgress::EpochProgress() {
+template <typename Scalar>
+EpochProgress<Scalar>::EpochProgress() {
     em_iterations_ = 0;
     likelihood_ = 0;
     cnt_likelihoods_ = 0;
     is_first_time_ = true;
+    e_step_iterations_ = 0;
+    documents_ = 0;
+    warm_started_ = 0;
 }
 
-void EpochProgress::on_event(std::shared_ptr<events::Event> event) {
-    if (event->id() == "ExpectationProgressEvent") {
-        auto progress = std::static_pointer_cast<events::ExpectationProgressEvent<double> >(event);
+template <typename Scalar>
+std::vector<size_t> EpochProgress<Scalar>::event_types() const {
+    return {
+        events::ExpectationProgressEvent<Scalar>::type_tag(),
+        events::EpochProgressEvent<Scalar>::type_tag(),
+        SnapshotEvent::type_tag()
+    };
+}
+
+template <typename Scalar>
+void EpochProgress<Scalar>::on_event(std::shared_ptr<events::Event> event) {
+    if (event->type() == events::ExpectationProgressEvent<Scalar>::type_tag()) {
+        auto progress = std::static_pointer_cast<events::ExpectationProgressEvent<Scalar> >(event);
 
         if (is_first_time_) {
             std::cout << "E-M Iteration " << em_iterations_+1 << std::endl;
@@ -23,18 +38,51 @@ void EpochProgress::on_event(std::shared_ptr<events::Event> event) {
             likelihood_ += progress->likelihood();
             cnt_likelihoods_++;
         }
+
+        // Keep track of the iterations to see the effect of warm starting
+        e_step_iterations_ += progress->iterations();
+        warm_started_ += progress->warm_started();
+        documents_++;
     }
-    else if (event->id() == "EpochProgressEvent") {
+    else if (event->type() == events::EpochProgressEvent<Scalar>::type_tag()) {
         if (likelihood_ < 0) {
             std::cout << "Per document likelihood: " <<
                 likelihood_ / cnt_likelihoods_ << std::endl;
         }
+        if (e_step_iterations_ > 0) {
+            std::cout << "E step iterations per document: " <<
+                static_cast<double>(e_step_iterations_) / documents_ <<
+                " (" << 100.0 * warm_started_ / documents_ <<
+                "% warm started)" << std::endl;
+        }
 
         // reset the member variables
         likelihood_ = 0;
         cnt_likelihoods_ = 0;
+        e_step_iterations_ = 0;
+        documents_ = 0;
+        warm_started_ = 0;
         em_iterations_ ++;
         is_first_time_ = true;
     }
+    else if (event->type() == SnapshotEvent::type_tag()) {
+        auto snapshot = std::static_pointer_cast<SnapshotEvent>(event);
+
+        if (!snapshot->error().empty()) {
+            std::cerr << "Snapshot failed: " << snapshot->error() << std::endl;
+            return;
+        }
+        std::cout << "Snapshot " << snapshot->path() << " written in " <<
+            snapshot->seconds() << "s";
+        if (snapshot->dropped() > 0) {
+            std::cout << " (" << snapshot->dropped() << " dropped)";
+        }
+        std::cout << std::endl;
+    }
 
 }
+
+
+// Template instantiation
+template class EpochProgress<float>;
+template class EpochProgress<double>;
@@ -7,15 +7,22 @@ ExpectationProgress::ExpectationProgress(int print_every) {
     print_every_ = print_every;
 }
 
+std::vector<size_t> ExpectationProgress::event_types() const {
+    return {
+        events::ExpectationProgressEvent<double>::type_tag(),
+        events::EpochProgressEvent<double>::type_tag()
+    };
+}
+
 void ExpectationProgress::on_event(std::shared_ptr<events::Event> event) {
-    if (event->id() == "ExpectationProgressEvent") {
+    if (event->type() == events::ExpectationProgressEvent<double>::type_tag()) {
 
         e_iterations_++;
         if (e_iterations_ % print_every_ == 0) {
             std::cout << e_iterations_ << std::endl;
         }
     }
-    else if (event->id() == "EpochProgressEvent") {
+    else if (event->type() == events::EpochProgressEvent<double>::type_tag()) {
         // If one Epoch is completed reset the member variables
         e_iterations_ = 0;
     }
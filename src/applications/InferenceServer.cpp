@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "applications/InferenceServer.hpp"
+
+namespace {
+
+bool send_all(int socket, const void *data, size_t n) {
+    const char *bytes = static_cast<const char *>(data);
+    while (n > 0) {
+        ssize_t sent = send(socket, bytes, n, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        bytes += sent;
+        n -= sent;
+    }
+
+    return true;
+}
+
+bool recv_all(int socket, void *data, size_t n) {
+    char *bytes = static_cast<char *>(data);
+    while (n > 0) {
+        ssize_t received = recv(socket, bytes, n, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        n -= received;
+    }
+
+    return true;
+}
+
+}  // namespace
+
+
+template <typename Scalar>
+InferenceServer<Scalar>::InferenceServer(
+    LDA<Scalar> &lda,
+    size_t words,
+    bool supervised,
+    size_t max_batch,
+    std::chrono::microseconds max_latency
+) : lda_(lda),
+    words_(words),
+    supervised_(supervised),
+    max_batch_(std::max<size_t>(1, max_batch)),
+    max_latency_(max_latency),
+    gammas_(
+        lda.template model_parameters<parameters::ModelParameters<Scalar> >()->alpha.rows(),
+        max_batch_
+    ),
+    predictions_(max_batch_),
+    running_(false),
+    listener_(-1)
+{}
+
+template <typename Scalar>
+InferenceServer<Scalar>::~InferenceServer() {
+    stop();
+}
+
+template <typename Scalar>
+void InferenceServer<Scalar>::serve(const std::string &socket_path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("InferenceServer: socket path too long");
+    }
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    listener_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener_ < 0) {
+        throw std::runtime_error("InferenceServer: could not create a socket");
+    }
+    unlink(socket_path.c_str());
+    if (
+        bind(listener_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(listener_, 64) != 0
+    ) {
+        close(listener_);
+        listener_ = -1;
+        throw std::runtime_error("InferenceServer: could not listen on " + socket_path);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    batcher_ = std::thread(&InferenceServer::batcher, this);
+
+    while (true) {
+        int connection = accept(listener_, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            close(connection);
+            break;
+        }
+        connections_.insert(connection);
+        std::thread(&InferenceServer::handle_connection, this, connection).detach();
+    }
+
+    unlink(socket_path.c_str());
+}
+
+template <typename Scalar>
+void InferenceServer<Scalar>::stop() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        running_ = false;
+        if (listener_ >= 0) {
+            shutdown(listener_, SHUT_RDWR);
+        }
+        for (auto connection : connections_) {
+            shutdown(connection, SHUT_RDWR);
+        }
+        pending_cv_.notify_all();
+
+        // wait for the connection threads to exit
+        connections_cv_.wait(lock, [this]() { return connections_.empty(); });
+    }
+
+    if (batcher_.joinable()) {
+        batcher_.join();
+    }
+    if (listener_ >= 0) {
+        close(listener_);
+        listener_ = -1;
+    }
+}
+
+template <typename Scalar>
+void InferenceServer<Scalar>::handle_connection(int connection) {
+    // a failing connection (for instance out of memory) is closed without
+    // taking the server down with it
+    try {
+        while (true) {
+            uint8_t type;
+            uint32_t N;
+            if (!recv_all(connection, &type, sizeof(type)) ||
+                !recv_all(connection, &N, sizeof(N))) {
+                break;
+            }
+
+            // A document has at most one pair per word so a larger N is
+            // garbage and the rest of the stream cannot be trusted either
+            if (N > words_) {
+                respond(connection, Response{-1, Eigen::VectorXd()});
+                break;
+            }
+
+            std::vector<uint32_t> pairs(2 * static_cast<size_t>(N));
+            if (!recv_all(connection, pairs.data(), pairs.size() * sizeof(uint32_t))) {
+                break;
+            }
+
+            // Validate the request before making it wait for a batch
+            Response response{-1, Eigen::VectorXd()};
+            bool valid = type <= 1 && (type == 0 || supervised_);
+            Eigen::VectorXi words;
+            if (valid) {
+                words = Eigen::VectorXi::Zero(words_);
+            }
+            for (size_t i=0; valid && i<N; i++) {
+                uint32_t word = pairs[2*i];
+                uint32_t count = pairs[2*i + 1];
+                valid = word < words_ && count <= static_cast<uint32_t>(
+                    std::numeric_limits<int>::max() - words[word]
+                );
+                if (valid) {
+                    words[word] += count;
+                }
+            }
+
+            if (valid) {
+                auto request = std::make_shared<Request>();
+                request->words = std::move(words);
+                request->predict = type == 1;
+                request->arrival = std::chrono::steady_clock::now();
+                auto future = request->response.get_future();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!running_) {
+                        break;
+                    }
+                    pending_.push_back(request);
+                }
+                pending_cv_.notify_one();
+                response = future.get();
+            }
+
+            if (!respond(connection, response)) {
+                break;
+            }
+        }
+    } catch (...) {
+        // the connection is closed below
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_.erase(connection);
+    close(connection);
+    connections_cv_.notify_all();
+}
+
+template <typename Scalar>
+bool InferenceServer<Scalar>::respond(int connection, const Response &response) {
+    uint32_t K = response.gamma.rows();
+
+    return send_all(connection, &response.status, sizeof(response.status)) &&
+        send_all(connection, &K, sizeof(K)) &&
+        send_all(connection, response.gamma.data(), K * sizeof(double));
+}
+
+template <typename Scalar>
+void InferenceServer<Scalar>::batcher() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        pending_cv_.wait(lock, [this]() { return !running_ || !pending_.empty(); });
+        if (!running_) {
+            break;
+        }
+
+        // Wait for the batch to fill up but not longer than the oldest
+        // request can wait
+        pending_cv_.wait_until(
+            lock,
+            pending_.front()->arrival + max_latency_,
+            [this]() { return !running_ || pending_.size() >= max_batch_; }
+        );
+
+        std::vector<std::shared_ptr<Request> > batch;
+        while (!pending_.empty() && batch.size() < max_batch_) {
+            batch.push_back(pending_.front());
+            pending_.pop_front();
+        }
+
+        lock.unlock();
+        process(batch);
+        lock.lock();
+    }
+
+    // Nobody will process the rest of the requests
+    for (auto & request : pending_) {
+        request->response.set_value(Response{-1, Eigen::VectorXd()});
+    }
+    pending_.clear();
+}
+
+template <typename Scalar>
+void InferenceServer<Scalar>::process(std::vector<std::shared_ptr<Request> > &batch) {
+    // the buffers are allocated once for the largest batch
+    auto gammas = gammas_.leftCols(batch.size());
+    auto predictions = predictions_.head(batch.size());
+    try {
+        Eigen::MatrixXi X(words_, batch.size());
+        bool predict = false;
+        for (size_t i=0; i<batch.size(); i++) {
+            X.col(i) = batch[i]->words;
+            predict = predict || batch[i]->predict;
+        }
+
+        if (predict) {
+            lda_.transform_predict(X, gammas, predictions);
+        } else {
+            lda_.transform(X, gammas);
+        }
+    } catch (std::exception &e) {
+        for (auto & request : batch) {
+            request->response.set_value(Response{-1, Eigen::VectorXd()});
+        }
+        return;
+    }
+
+    for (size_t i=0; i<batch.size(); i++) {
+        batch[i]->response.set_value(Response{
+            (batch[i]->predict) ? predictions[i] : 0,
+            gammas.col(i).template cast<double>()
+        });
+    }
+}
+
+
+// Template instantiation
+template class InferenceServer<float>;
+template class InferenceServer<double>;
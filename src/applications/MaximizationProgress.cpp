@@ -2,19 +2,34 @@
 
 #include "applications/MaximizationProgress.hpp"
 
-MaximizationProgress::MaximizationProgress() {
+template <typename Scalar>
+MaximizationProgress<Scalar>::MaximizationProgress() {
     m_iterations_ = 0;
 }
 
-void MaximizationProgress::on_event(std::shared_ptr<events::Event> event) {
-    if (event->id() == "MaximizationProgressEvent") {
+template <typename Scalar>
+std::vector<size_t> MaximizationProgress<Scalar>::event_types() const {
+    return {
+        events::MaximizationProgressEvent<Scalar>::type_tag(),
+        events::EpochProgressEvent<Scalar>::type_tag()
+    };
+}
+
+template <typename Scalar>
+void MaximizationProgress<Scalar>::on_event(std::shared_ptr<events::Event> event) {
+    if (event->type() == events::MaximizationProgressEvent<Scalar>::type_tag()) {
 
-        auto progress = std::static_pointer_cast<events::MaximizationProgressEvent<double> >(event);
+        auto progress = std::static_pointer_cast<events::MaximizationProgressEvent<Scalar> >(event);
         std::cout << "log p(y | \\bar{z}, eta): " << progress->likelihood() << std::endl;
         m_iterations_++;
     }
-    else if (event->id() == "EpochProgressEvent") {
+    else if (event->type() == events::EpochProgressEvent<Scalar>::type_tag()) {
         // If one Epoch is completed reset the member variables
         m_iterations_ = 0;
     }
 }
+
+
+// Template instantiation
+template class MaximizationProgress<float>;
+template class MaximizationProgress<double>;
@@ -1,33 +1,179 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
 #include "ldaplusplus/events/ProgressEvents.hpp"
 
 #include "applications/lda_io.hpp"
 #include "applications/SnapshotEvery.hpp"
 
-SnapshotEvery::SnapshotEvery(std::string path, int save_every) {
+template <typename Scalar>
+SnapshotEvery<Scalar>::SnapshotEvery(
+    std::string path,
+    int save_every,
+    std::shared_ptr<events::EventDispatcherInterface> dispatcher,
+    std::shared_ptr<const corpus::FeatureHasher> hasher
+) : dispatcher_(dispatcher),
+    hasher_(hasher)
+{
     seen_so_far_ = 0;
     save_every_ = save_every;
     path_ = std::move(path);
+    pending_epoch_ = 0;
+    dropped_ = 0;
+    writing_ = false;
+    stop_ = false;
 }
 
-void SnapshotEvery::snapshot(
-    std::shared_ptr<parameters::Parameters> parameters
+template <typename Scalar>
+SnapshotEvery<Scalar>::~SnapshotEvery() {
+    if (!writer_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    pending_cv_.notify_one();
+    writer_.join();
+}
+
+template <typename Scalar>
+std::string SnapshotEvery<Scalar>::snapshot(
+    std::shared_ptr<parameters::Parameters> parameters,
+    int epoch
 ) {
+    // keep the extension of the model files so that the snapshots are saved
+    // in the same format as the model
+    std::string prefix = path_, extension;
+    if (io::is_model_file_path(path_)) {
+        extension = path_.substr(path_.rfind('.'));
+        prefix = path_.substr(0, path_.size() - extension.size());
+    }
+
     std::stringstream actual_path;
-    actual_path << path_ << "_";
+    actual_path << prefix << "_";
     actual_path.fill('0');
     actual_path.width(3);
-    actual_path << seen_so_far_;
+    actual_path << epoch << extension;
+
+    // write to a temporary file and rename it so that a snapshot is never
+    // left half written
+    std::string temporary_path = actual_path.str() + ".tmp" + extension;
+    io::save_lda<Scalar>(temporary_path, parameters, hasher_);
+    if (std::rename(temporary_path.c_str(), actual_path.str().c_str()) != 0) {
+        std::string error = std::strerror(errno);
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error(
+            "Could not rename " + temporary_path + " to " +
+            actual_path.str() + ": " + error
+        );
+    }
+
+    return actual_path.str();
+}
+
+template <typename Scalar>
+void SnapshotEvery<Scalar>::writer() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        pending_cv_.wait(lock, [this]() { return stop_ || pending_; });
+        if (!pending_) {
+            break;
+        }
+
+        auto parameters = pending_;
+        int epoch = pending_epoch_;
+        pending_ = nullptr;
+        writing_ = true;
+        lock.unlock();
+
+        // a failed snapshot is reported and the training goes on
+        auto start = std::chrono::steady_clock::now();
+        std::string path, error;
+        try {
+            path = snapshot(parameters, epoch);
+        } catch (std::exception &e) {
+            error = e.what();
+        }
+        double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start
+        ).count();
 
-    io::save_lda(actual_path.str(), parameters);
+        lock.lock();
+        written_.push_back(WrittenSnapshot{path, seconds, dropped_, error});
+        writing_ = false;
+        pending_cv_.notify_all();
+    }
+}
+
+template <typename Scalar>
+void SnapshotEvery<Scalar>::flush() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        pending_cv_.wait(lock, [this]() { return !pending_ && !writing_; });
+    }
+
+    report();
+}
+
+template <typename Scalar>
+void SnapshotEvery<Scalar>::report() {
+    std::vector<WrittenSnapshot> written;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        written.swap(written_);
+    }
+
+    auto dispatcher = dispatcher_.lock();
+    if (!dispatcher) {
+        return;
+    }
+    for (auto & w : written) {
+        dispatcher->dispatch<SnapshotEvent>(w.path, w.seconds, w.dropped, w.error);
+    }
 }
 
-void SnapshotEvery::on_event(std::shared_ptr<events::Event> event) {
-    if (event->id() == "EpochProgressEvent") {
-        auto progress = std::static_pointer_cast<events::EpochProgressEvent<double> >(event);
+template <typename Scalar>
+std::vector<size_t> SnapshotEvery<Scalar>::event_types() const {
+    return {events::EpochProgressEvent<Scalar>::type_tag()};
+}
+
+template <typename Scalar>
+void SnapshotEvery<Scalar>::on_event(std::shared_ptr<events::Event> event) {
+    if (event->type() == events::EpochProgressEvent<Scalar>::type_tag()) {
+        auto progress = std::static_pointer_cast<events::EpochProgressEvent<Scalar> >(event);
+
+        report();
 
         seen_so_far_ ++;
         if (seen_so_far_ % save_every_ == 0) {
-            snapshot(progress->model_parameters());
+            // copy the parameters because the training goes on
+            auto parameters = progress->model_parameters()->clone();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_) {
+                dropped_++;
+            }
+            pending_ = parameters;
+            pending_epoch_ = seen_so_far_;
+            pending_cv_.notify_one();
+
+            // the writer is started only when needed so that a trainer can
+            // still fork before the first snapshot (see ShardedLDA)
+            if (!writer_.joinable()) {
+                writer_ = std::thread(&SnapshotEvery::writer, this);
+            }
         }
     }
 }
+
+
+// Template instantiation
+template class SnapshotEvery<float>;
+template class SnapshotEvery<double>;
@@ -1,3 +1,4 @@
+#include <chrono>
 #include <iostream>
 
 #include <Eigen/Core>
@@ -9,6 +10,7 @@
 
 #include "applications/EpochProgress.hpp"
 #include "applications/ExpectationProgress.hpp"
+#include "applications/InferenceServer.hpp"
 #include "applications/lda_io.hpp"
 #include "applications/MaximizationProgress.hpp"
 #include "applications/SnapshotEvery.hpp"
@@ -17,14 +19,18 @@
 using namespace ldaplusplus;
 
 
+template <typename Scalar>
 void add_e_step_options(
     std::map<std::string, docopt::value> &args,
-    LDABuilder<double> & builder
+    LDABuilder<Scalar> & builder
 ) {
     // Start building the LDA model by adding the number of iterations and
     // workers
     builder.set_iterations(args["--iterations"].asLong());
     builder.set_workers(args["--workers"].asLong());
+    if (args["--deterministic"].asBool()) {
+        builder.set_deterministic();
+    }
 
     // Add the parameters regarding the Expectation step
     builder.set_fast_supervised_e_step(
@@ -36,21 +42,22 @@ void add_e_step_options(
     );
 }
 
+template <typename Scalar>
 void add_initialization_options(
     std::map<std::string, docopt::value> &args,
     const Eigen::MatrixXi & X,
     const Eigen::VectorXi & y,
-    LDABuilder<double> & builder
+    LDABuilder<Scalar> & builder
 ) {
     // Initialize the model parameters
     if (args["--continue"]) {
-        auto model = io::load_lda(args["--continue"].asString());
+        auto model = io::load_lda<Scalar>(args["--continue"].asString());
         builder.
             initialize_topics_from_model(model).
             initialize_eta_from_model(model);
 
     } else if (args["--continue_from_unsupervised"]) {
-        auto model = io::load_lda(args["--continue"].asString());
+        auto model = io::load_lda<Scalar>(args["--continue"].asString());
         builder.
             initialize_topics_from_model(model).
             initialize_eta_zeros(y.maxCoeff() + 1);
@@ -75,9 +82,10 @@ void add_initialization_options(
     }
 }
 
+template <typename Scalar>
 void add_m_step_options(
     std::map<std::string, docopt::value> &args,
-    LDABuilder<double> & builder
+    LDABuilder<Scalar> & builder
 ) {
     // Add the parameters regarding the Maximization step
     builder.set_fast_supervised_m_step(
@@ -88,28 +96,31 @@ void add_m_step_options(
 }
 
 
+template <typename Scalar>
 void add_online_m_step_options(
     std::map<std::string, docopt::value> &args,
     const Eigen::VectorXi & y,
-    LDABuilder<double> & builder
+    LDABuilder<Scalar> & builder
 ) {
     // Add the parameters regarding the online Maximization step
     builder.set_fast_supervised_online_m_step(
-        utils::create_class_weights(y),
+        utils::create_class_weights(y).template cast<Scalar>(),
         std::stof(args["--regularization_penalty"].asString()),
         args["--batch_size"].asLong(),
         std::stof(args["--momentum"].asString()),
         std::stof(args["--learning_rate"].asString()),
-        std::stof(args["--beta_weight"].asString())
+        std::stof(args["--beta_weight"].asString()),
+        args["--hogwild"].asBool()
     );
 }
 
-LDA<double> create_lda_for_train(
+template <typename Scalar>
+LDA<Scalar> create_lda_for_train(
     std::map<std::string, docopt::value> &args,
     const Eigen::MatrixXi & X,
     const Eigen::VectorXi & y
 ) {
-    LDABuilder<double> builder;
+    LDABuilder<Scalar> builder;
     
     add_e_step_options(args, builder);
 
@@ -121,13 +132,14 @@ LDA<double> create_lda_for_train(
     return builder;
 }
 
-LDA<double> create_lda_for_online_train(
+template <typename Scalar>
+LDA<Scalar> create_lda_for_online_train(
     std::map<std::string, docopt::value> &args,  // should be const but const
                                                  // C++ map is annoying
     const Eigen::MatrixXi & X,
     const Eigen::VectorXi & y
 ) {
-    LDABuilder<double> builder;
+    LDABuilder<Scalar> builder;
 
     add_e_step_options(args, builder);
 
@@ -139,11 +151,12 @@ LDA<double> create_lda_for_online_train(
     return builder;
 }
 
-LDA<double> create_lda_for_transform(
+template <typename Scalar>
+LDA<Scalar> create_lda_for_transform(
     std::map<std::string, docopt::value> &args,
-    std::shared_ptr<parameters::SupervisedModelParameters<double>> model
+    std::shared_ptr<parameters::SupervisedModelParameters<Scalar>> model
 ) {
-    LDABuilder<double> builder;
+    LDABuilder<Scalar> builder;
 
     builder.set_workers(args["--workers"].asLong());
 
@@ -153,9 +166,17 @@ LDA<double> create_lda_for_transform(
         0.0
     );
 
-    builder.
-        initialize_topics_from_model(model).
-        initialize_eta_from_model(model);
+    // a mapped model is read in place instead of copied in the builder
+    auto mapped = std::dynamic_pointer_cast<parameters::MappedModelParameters<Scalar> >(
+        model
+    );
+    if (mapped) {
+        builder.initialize_from_mapped_model(mapped);
+    } else {
+        builder.
+            initialize_topics_from_model(model).
+            initialize_eta_from_model(model);
+    }
 
     // LDABuilder can be implicitly cashed in LDA
     return builder;
@@ -170,18 +191,23 @@ R"(Console application for fast supervised LDA (fsLDA).
                     [--compute_likelihood=CL] [--initialize_seeded | --initialize_random]
                     [--supervised_weight=C] [--m_step_iterations=MI]
                     [--m_step_tolerance=MT] [--regularization_penalty=L]
-                    [-q | --quiet] [--snapshot_every=N] [--workers=W]
-                    [--continue=M] [--continue_from_unsupervised=M] DATA MODEL
+                    [-q | --quiet] [--snapshot_every=N] [--workers=W] [--deterministic]
+                    [--continue=M] [--continue_from_unsupervised=M] [--checkpoint=PATH]
+                    [--precision=P] [--hash_buckets=H] DATA MODEL
         fslda online_train [--topics=K] [--iterations=I] [--e_step_iterations=EI]
                            [--e_step_tolerance=ET] [--random_state=RS]
                            [--compute_likelihood=CL] [--initialize_seeded | --initialize_random]
                            [--supervised_weight=C] [--regularization_penalty=L] [--batch_size=BS]
-                           [--momentum=MM] [--learning_rate=LR] [--beta_weight=BW]
-                           [-q | --quiet] [--snapshot_every=N] [--workers=W]
-                           [--continue=M] [--continue_from_unsupervised=M] DATA MODEL
+                           [--momentum=MM] [--learning_rate=LR] [--beta_weight=BW] [--hogwild]
+                           [-q | --quiet] [--snapshot_every=N] [--workers=W] [--deterministic]
+                           [--continue=M] [--continue_from_unsupervised=M] [--checkpoint=PATH]
+                           [--precision=P] [--hash_buckets=H] DATA MODEL
         fslda transform [-q | --quiet] [--e_step_iterations=EI]
                         [--e_step_tolerance=ET] [--workers=W]
-                        MODEL DATA OUTPUT
+                        [--precision=P] MODEL DATA OUTPUT
+        fslda serve [-q | --quiet] [--e_step_iterations=EI]
+                    [--e_step_tolerance=ET] [--workers=W] [--precision=P]
+                    [--max_batch=B] [--max_latency=MS] MODEL SOCKET
         fslda (-h | --help)
 
     General Options:
@@ -199,8 +225,18 @@ R"(Console application for fast supervised LDA (fsLDA).
                                           initialization option is initialize_seeded
         --snapshot_every=N                Snapshot the model every N iterations [default: -1]
         --workers=N                       The number of concurrent workers [default: 1]
+        --deterministic                   Train the same model regardless of the number
+                                          of workers
         --continue=M                      A model to continue training from
         --continue_from_unsupervised=M    An unsupervised model to continue training from
+        --checkpoint=PATH                 Save the state of the training in PATH after every
+                                          epoch and resume from it if it exists
+        --precision=P                     Train and infer with float or double numbers.
+                                          The models are saved with this precision and
+                                          converted when loaded [default: double]
+        --hash_buckets=H                  Hash the word ids of DATA into H buckets so that
+                                          the model has H words whatever the size of the
+                                          vocabulary (0 disables it) [default: 0]
 
     E Step Options:
         --e_step_iterations=EI            The maximum number of iterations to perform
@@ -228,102 +264,239 @@ R"(Console application for fast supervised LDA (fsLDA).
         --learning_rate=LR                Set the learning rate for changing eta [default: 0.01]
         --beta_weight=BW                  Set the weight of the previous beta parameters
                                           w.r.t to the new from the minibatch [default: 0.9]
+        --hogwild                         Let the workers update the model concurrently
+                                          without waiting for each other
+
+    Server Options:
+        --max_batch=B                     The maximum number of documents to transform
+                                          at once [default: 64]
+        --max_latency=MS                  The maximum time in milliseconds that a request
+                                          waits for more requests to batch with
+                                          [default: 5]
 )";
 
-int main(int argc, char **argv) {
-    
-    std::map<std::string, docopt::value> args = docopt::docopt(
-        USAGE,
-        {argv+1, argv + argc},
-        true,  // show help if requested
-        "Fast Supervised LDA 0.1"
-    );
+/**
+ * Train a model on DATA and save it in MODEL.
+ */
+template <typename Scalar>
+void train(std::map<std::string, docopt::value> &args) {
+    // Hash the word ids so that the size of the model does not depend on
+    // the size of the vocabulary (a model keeps its hasher)
+    std::shared_ptr<corpus::FeatureHasher> hasher;
+    if (args["--continue"]) {
+        hasher = io::load_feature_hasher(args["--continue"].asString());
+    } else if (args["--continue_from_unsupervised"]) {
+        hasher = io::load_feature_hasher(
+            args["--continue_from_unsupervised"].asString()
+        );
+    } else if (args["--hash_buckets"].asLong() > 0) {
+        hasher = std::make_shared<corpus::FeatureHasher>(
+            args["--hash_buckets"].asLong()
+        );
+    }
 
-    if (args["train"].asBool()) {
-        
-        Eigen::MatrixXi X, y;
-        // Parse data from input file
-        io::parse_input_data(args["DATA"].asString(), X, y);
-
-        auto lda = create_lda_for_train(args, X, y);
-
-        // Add the listeners to be used
-        if (!args["--quiet"].asBool()) {
-            lda.get_event_dispatcher()->add_listener<EpochProgress>();
-            lda.get_event_dispatcher()->add_listener<ExpectationProgress>();
-            lda.get_event_dispatcher()->add_listener<MaximizationProgress>();
-        }
-
-        if (args["--snapshot_every"].asLong() > 0) {
-            lda.get_event_dispatcher()->add_listener<SnapshotEvery>(
-                args["MODEL"].asString(),
-                args["--snapshot_every"].asLong()
-            );
-        }
-
-        // Fit LDA model according to the given training data and parameters
-        lda.fit(X, y);
+    // Parse data from input file hashing it while it is read
+    Eigen::MatrixXi X, y;
+    io::parse_input_data(args["DATA"].asString(), hasher, X, y);
+
+    auto lda = create_lda_for_train<Scalar>(args, X, y);
 
-        //Save the trained model
-        io::save_lda(
+    // Add the listeners to be used
+    if (!args["--quiet"].asBool()) {
+        lda.get_event_dispatcher()->template add_listener<EpochProgress<Scalar> >();
+        lda.get_event_dispatcher()->template add_listener<ExpectationProgress>();
+        lda.get_event_dispatcher()->template add_listener<MaximizationProgress<Scalar> >();
+    }
+
+    std::shared_ptr<SnapshotEvery<Scalar> > snapshots;
+    if (args["--snapshot_every"].asLong() > 0) {
+        snapshots = std::make_shared<SnapshotEvery<Scalar> >(
             args["MODEL"].asString(),
-            lda.model_parameters()
+            args["--snapshot_every"].asLong(),
+            lda.get_event_dispatcher(),
+            hasher
         );
-    } else if (args["online_train"].asBool()) {
-        
-        Eigen::MatrixXi X, y;
-        // Parse data from input file
-        io::parse_input_data(args["DATA"].asString(), X, y);
-
-        auto lda = create_lda_for_online_train(args, X, y);
-
-        // Add the listeners to be used
-        if (!args["--quiet"].asBool()) {
-            lda.get_event_dispatcher()->add_listener<EpochProgress>();
-            lda.get_event_dispatcher()->add_listener<ExpectationProgress>();
-            lda.get_event_dispatcher()->add_listener<MaximizationProgress>();
-        }
-
-        if (args["--snapshot_every"].asLong() > 0) {
-            lda.get_event_dispatcher()->add_listener<SnapshotEvery>(
-                args["MODEL"].asString(),
-                args["--snapshot_every"].asLong()
-            );
-        }
-
-        // Fit LDA model according to the given training data and parameters
+        lda.get_event_dispatcher()->add_listener(snapshots);
+    }
+
+    // Fit LDA model according to the given training data and parameters
+    if (args["--checkpoint"]) {
+        io::fit_with_checkpoints(
+            args["--checkpoint"].asString(),
+            lda,
+            std::make_shared<corpus::EigenClassificationCorpus>(X, y),
+            args["--iterations"].asLong()
+        );
+    } else {
         lda.fit(X, y);
+    }
 
-        //Save the trained model
-        io::save_lda(
-            args["MODEL"].asString(),
-            lda.model_parameters()
+    // report the last snapshot
+    if (snapshots) {
+        snapshots->flush();
+    }
+
+    //Save the trained model
+    io::save_lda<Scalar>(
+        args["MODEL"].asString(),
+        lda.model_parameters(),
+        hasher
+    );
+}
+
+/**
+ * Train a model on DATA with the online maximization step and save it in
+ * MODEL.
+ */
+template <typename Scalar>
+void online_train(std::map<std::string, docopt::value> &args) {
+    // Hash the word ids so that the size of the model does not depend on
+    // the size of the vocabulary (a model keeps its hasher)
+    std::shared_ptr<corpus::FeatureHasher> hasher;
+    if (args["--continue"]) {
+        hasher = io::load_feature_hasher(args["--continue"].asString());
+    } else if (args["--continue_from_unsupervised"]) {
+        hasher = io::load_feature_hasher(
+            args["--continue_from_unsupervised"].asString()
         );
-    
-    } else if (args["transform"].asBool()) {
-        
-        Eigen::MatrixXi X, y;
-        // Parse data from input file
-        io::parse_input_data(args["DATA"].asString(), X, y);
+    } else if (args["--hash_buckets"].asLong() > 0) {
+        hasher = std::make_shared<corpus::FeatureHasher>(
+            args["--hash_buckets"].asLong()
+        );
+    }
 
-        // Load LDA model from file
-        auto model = io::load_lda(args["MODEL"].asString());
+    // Parse data from input file hashing it while it is read
+    Eigen::MatrixXi X, y;
+    io::parse_input_data(args["DATA"].asString(), hasher, X, y);
 
-        auto lda = create_lda_for_transform(args, model);
+    auto lda = create_lda_for_online_train<Scalar>(args, X, y);
 
-        // Add the listeners to be used
-        if (!args["--quiet"].asBool()) {
-            lda.get_event_dispatcher()->add_listener<EpochProgress>();
-            lda.get_event_dispatcher()->add_listener<ExpectationProgress>();
-        }
+    // Add the listeners to be used
+    if (!args["--quiet"].asBool()) {
+        lda.get_event_dispatcher()->template add_listener<EpochProgress<Scalar> >();
+        lda.get_event_dispatcher()->template add_listener<ExpectationProgress>();
+        lda.get_event_dispatcher()->template add_listener<MaximizationProgress<Scalar> >();
+    }
 
-        Eigen::MatrixXd doc_topic_distribution;
-        doc_topic_distribution = lda.transform(X);
+    std::shared_ptr<SnapshotEvery<Scalar> > snapshots;
+    if (args["--snapshot_every"].asLong() > 0) {
+        snapshots = std::make_shared<SnapshotEvery<Scalar> >(
+            args["MODEL"].asString(),
+            args["--snapshot_every"].asLong(),
+            lda.get_event_dispatcher(),
+            hasher
+        );
+        lda.get_event_dispatcher()->add_listener(snapshots);
+    }
 
-        numpy_format::save(
-            args["OUTPUT"].asString(),
-            doc_topic_distribution
+    // Fit LDA model according to the given training data and parameters
+    if (args["--checkpoint"]) {
+        io::fit_with_checkpoints(
+            args["--checkpoint"].asString(),
+            lda,
+            std::make_shared<corpus::EigenClassificationCorpus>(X, y),
+            args["--iterations"].asLong()
         );
+    } else {
+        lda.fit(X, y);
+    }
+
+    // report the last snapshot
+    if (snapshots) {
+        snapshots->flush();
+    }
+
+    //Save the trained model
+    io::save_lda<Scalar>(
+        args["MODEL"].asString(),
+        lda.model_parameters(),
+        hasher
+    );
+}
+
+/**
+ * Compute the topic mixtures of the documents in DATA and save them in
+ * OUTPUT.
+ */
+template <typename Scalar>
+void transform(std::map<std::string, docopt::value> &args) {
+    // Load LDA model from file
+    auto model = io::load_lda_for_inference<Scalar>(args["MODEL"].asString());
+
+    auto lda = create_lda_for_transform<Scalar>(args, model);
+
+    // Add the listeners to be used
+    if (!args["--quiet"].asBool()) {
+        lda.get_event_dispatcher()->template add_listener<EpochProgress<Scalar> >();
+        lda.get_event_dispatcher()->template add_listener<ExpectationProgress>();
+    }
+
+    // Read the documents, hash their word ids like the training data and
+    // write their topic mixtures a block at a time instead of keeping them
+    // all in memory
+    io::transform_input_data<Scalar>(
+        args["DATA"].asString(),
+        io::load_feature_hasher(args["MODEL"].asString()),
+        lda,
+        args["OUTPUT"].asString()
+    );
+}
+
+/**
+ * Keep MODEL in memory and transform the documents sent to SOCKET.
+ */
+template <typename Scalar>
+void serve(std::map<std::string, docopt::value> &args) {
+    // Load LDA model from file once and keep it in memory
+    auto model = io::load_lda_for_inference<Scalar>(args["MODEL"].asString());
+
+    auto lda = create_lda_for_transform<Scalar>(args, model);
+
+    InferenceServer<Scalar> server(
+        lda,
+        io::model_words<Scalar>(model),
+        true,  // the model can predict
+        args["--max_batch"].asLong(),
+        std::chrono::microseconds(static_cast<long>(
+            1000 * std::stof(args["--max_latency"].asString())
+        ))
+    );
+    if (!args["--quiet"].asBool()) {
+        std::cout << "Serving on " << args["SOCKET"].asString() << std::endl;
+    }
+    server.serve(args["SOCKET"].asString());
+}
+
+int main(int argc, char **argv) {
+    
+    std::map<std::string, docopt::value> args = docopt::docopt(
+        USAGE,
+        {argv+1, argv + argc},
+        true,  // show help if requested
+        "Fast Supervised LDA 0.1"
+    );
+
+    // Everything is computed in the requested precision
+    bool single = args["--precision"].asString() == "float";
+    if (!single && args["--precision"].asString() != "double") {
+        std::cout << "Invalid precision" << std::endl;
+        return 1;
+    }
+
+    // The hogwild updates depend on thread timing
+    if (args["--hogwild"].asBool() && args["--deterministic"].asBool()) {
+        std::cout << "--deterministic cannot be used with --hogwild" << std::endl;
+        return 1;
+    }
+
+    if (args["train"].asBool()) {
+        (single) ? train<float>(args) : train<double>(args);
+    } else if (args["online_train"].asBool()) {
+        (single) ? online_train<float>(args) : online_train<double>(args);
+    } else if (args["transform"].asBool()) {
+        (single) ? transform<float>(args) : transform<double>(args);
+    } else if (args["serve"].asBool()) {
+        (single) ? serve<float>(args) : serve<double>(args);
     } else {
         std::cout << "Invalid command" << std::endl;
     }
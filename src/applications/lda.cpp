@@ -1,3 +1,4 @@
+#include <chrono>
 #include <iostream>
 
 #include <Eigen/Core>
@@ -6,9 +7,11 @@
 #include "ldaplusplus/LDABuilder.hpp"
 #include "ldaplusplus/LDA.hpp"
 #include "ldaplusplus/NumpyFormat.hpp"
+#include "ldaplusplus/parallel/ShardedLDA.hpp"
 
 #include "applications/EpochProgress.hpp"
 #include "applications/ExpectationProgress.hpp"
+#include "applications/InferenceServer.hpp"
 #include "applications/lda_io.hpp"
 #include "applications/MaximizationProgress.hpp"
 #include "applications/SnapshotEvery.hpp"
@@ -16,17 +19,22 @@
 using namespace ldaplusplus;
 
 
-LDA<double> create_lda_for_train(
+template <typename Scalar>
+LDA<Scalar> create_lda_for_train(
     std::map<std::string, docopt::value> &args,  // should be const but const
                                                  // C++ map is annoying
     const Eigen::MatrixXi & X
 ) {
-    LDABuilder<double> builder;
+    LDABuilder<Scalar> builder;
 
     // Start building the LDA model by adding the number of iterations and
     // workers
     builder.set_iterations(args["--iterations"].asLong());
     builder.set_workers(args["--workers"].asLong());
+    if (args["--deterministic"].asBool()) {
+        builder.set_deterministic();
+    }
+    builder.set_numa(args["--numa"].asBool());
 
     // Add the parameters regarding the Expectation step
     builder.set_classic_e_step(
@@ -35,10 +43,20 @@ LDA<double> create_lda_for_train(
         std::stof(args["--compute_likelihood"].asString()),
         args["--random_state"].asLong()
     );
+    if (args["--warm_start"].asBool()) {
+        builder.set_gamma_cache(
+            X.cols(),
+            (args["--warm_start_storage"]) ?
+                args["--warm_start_storage"].asString() : ""
+        );
+    }
+    if (args["--skip_converged"].asBool()) {
+        builder.set_selective_update();
+    }
     
     // Initialize the model parameters
     if (args["--continue"]) {
-        auto model = io::load_lda(args["--continue"].asString());
+        auto model = io::load_lda<Scalar>(args["--continue"].asString());
         builder.initialize_topics_from_model(model);
     } else if (args["--initialize_random"].asBool()) {
         builder.initialize_topics_random(
@@ -62,11 +80,12 @@ LDA<double> create_lda_for_train(
     return builder;
 }
 
-LDA<double> create_lda_for_transform(
+template <typename Scalar>
+LDA<Scalar> create_lda_for_transform(
     std::map<std::string, docopt::value> &args,
-    std::shared_ptr<parameters::ModelParameters<double>> model
+    std::shared_ptr<parameters::ModelParameters<Scalar>> model
 ) {
-    LDABuilder<double> builder;
+    LDABuilder<Scalar> builder;
 
     builder.set_workers(args["--workers"].asLong());
 
@@ -76,7 +95,15 @@ LDA<double> create_lda_for_transform(
         0.0
     );
 
-    builder.initialize_topics_from_model(model);
+    // a mapped model is read in place instead of copied in the builder
+    auto mapped = std::dynamic_pointer_cast<parameters::MappedModelParameters<Scalar> >(
+        model
+    );
+    if (mapped) {
+        builder.initialize_from_mapped_model(mapped);
+    } else {
+        builder.initialize_topics_from_model(model);
+    }
 
     // LDABuilder can be implicitly cashed in LDA
     return builder;
@@ -90,10 +117,17 @@ R"(Console application for unsupervised LDA.
                   [--e_step_tolerance=ET] [--random_state=RS]
                   [--compute_likelihood=CL] [--initialize_seeded | --initialize_random]
                   [-q | --quiet] [--snapshot_every=N] [--workers=W]
-                  [--continue=M] DATA MODEL
+                  [--deterministic] [--continue=M] [--checkpoint=PATH]
+                  [--shards=S] [--blocks_per_shard=B]
+                  [--shard_storage=PATH] [--warm_start]
+                  [--warm_start_storage=PATH] [--skip_converged] [--numa]
+                  [--precision=P] [--hash_buckets=H] DATA MODEL
         lda transform [-q | --quiet] [--e_step_iterations=EI]
                       [--e_step_tolerance=ET] [--workers=W]
-                      MODEL DATA OUTPUT
+                      [--precision=P] MODEL DATA OUTPUT
+        lda serve [-q | --quiet] [--e_step_iterations=EI]
+                  [--e_step_tolerance=ET] [--workers=W] [--precision=P]
+                  [--max_batch=B] [--max_latency=MS] MODEL SOCKET
         lda (-h | --help)
 
     General Options:
@@ -111,7 +145,30 @@ R"(Console application for unsupervised LDA.
                                 initialization option is initialize_seeded
         --snapshot_every=N      Snapshot the model every N iterations [default: -1]
         --workers=N             The number of concurrent workers [default: 1]
+        --deterministic         Train the same model regardless of the number
+                                of workers
+        --numa                  Pin the workers to the NUMA nodes and give
+                                every node its own copy of the model
         --continue=M            A model to continue training from
+        --checkpoint=PATH       Save the state of the training in PATH after
+                                every epoch and resume from it if it exists
+        --precision=P           Train and infer with float or double
+                                numbers. The models are saved with this
+                                precision and converted when loaded
+                                [default: double]
+        --hash_buckets=H        Hash the word ids of DATA into H buckets so that
+                                the model has H words whatever the size of
+                                the vocabulary (0 disables it) [default: 0]
+
+    Model Parallel Options:
+        --shards=S              Train with S worker processes that own a
+                                rotating slice of the vocabulary instead of
+                                sharing the whole model (0 disables it)
+                                [default: 0]
+        --blocks_per_shard=B    Split the vocabulary in S*B word blocks
+                                [default: 1]
+        --shard_storage=PATH    Back the sharded model with files starting
+                                with PATH instead of memory
 
     E Step Options:
         --e_step_iterations=EI  The maximum number of iterations to perform
@@ -121,8 +178,156 @@ R"(Console application for unsupervised LDA.
         --compute_likelihood=CL The percentage of documents to compute the
                                 likelihood for (1.0 means compute for every
                                 document) [default: 0.0]
+        --warm_start            Start the E step of every document from its
+                                gamma of the previous epoch
+        --warm_start_storage=PATH  Keep the gammas for --warm_start in the
+                                file PATH instead of memory
+        --skip_converged        Skip the E step of the documents whose gamma
+                                converged for a couple of epochs and reuse
+                                their previous variational parameters
+
+    Server Options:
+        --max_batch=B           The maximum number of documents to transform
+                                at once [default: 64]
+        --max_latency=MS        The maximum time in milliseconds that a request
+                                waits for more requests to batch with
+                                [default: 5]
 )";
 
+/**
+ * Train a model on DATA and save it in MODEL.
+ */
+template <typename Scalar>
+void train(std::map<std::string, docopt::value> &args) {
+    // Hash the word ids so that the size of the model does not depend on
+    // the size of the vocabulary (a model keeps its hasher)
+    std::shared_ptr<corpus::FeatureHasher> hasher;
+    if (args["--continue"]) {
+        hasher = io::load_feature_hasher(args["--continue"].asString());
+    } else if (args["--hash_buckets"].asLong() > 0) {
+        hasher = std::make_shared<corpus::FeatureHasher>(
+            args["--hash_buckets"].asLong()
+        );
+    }
+
+    // Parse data from input file hashing it while it is read
+    Eigen::MatrixXi X;
+    io::parse_input_data(args["DATA"].asString(), hasher, X);
+
+    auto lda = create_lda_for_train<Scalar>(args, X);
+
+    // Use the model parallel trainer with the initialized model
+    std::shared_ptr<parallel::ShardedLDA<Scalar> > sharded;
+    if (args["--shards"].asLong() > 0) {
+        sharded = std::make_shared<parallel::ShardedLDA<Scalar> >(
+            lda.template model_parameters<parameters::ModelParameters<Scalar> >(),
+            args["--iterations"].asLong(),
+            args["--shards"].asLong(),
+            args["--blocks_per_shard"].asLong(),
+            (args["--shard_storage"]) ? args["--shard_storage"].asString() : ""
+        );
+    }
+    auto event_dispatcher = (sharded) ?
+        sharded->get_event_dispatcher() :
+        lda.get_event_dispatcher();
+
+    // Add the listeners to be used
+    if (!args["--quiet"].asBool()) {
+        event_dispatcher->template add_listener<EpochProgress<Scalar> >();
+        event_dispatcher->template add_listener<ExpectationProgress>();
+    }
+
+    std::shared_ptr<SnapshotEvery<Scalar> > snapshots;
+    if (args["--snapshot_every"].asLong() > 0) {
+        snapshots = std::make_shared<SnapshotEvery<Scalar> >(
+            args["MODEL"].asString(),
+            args["--snapshot_every"].asLong(),
+            event_dispatcher,
+            hasher
+        );
+        event_dispatcher->add_listener(snapshots);
+    }
+
+    // Fit LDA model according to the given training data and parameters
+    if (sharded) {
+        sharded->fit(X);
+    } else if (args["--checkpoint"]) {
+        io::fit_with_checkpoints(
+            args["--checkpoint"].asString(),
+            lda,
+            std::make_shared<corpus::EigenCorpus>(X),
+            args["--iterations"].asLong()
+        );
+    } else {
+        lda.fit(X);
+    }
+
+    // report the last snapshot
+    if (snapshots) {
+        snapshots->flush();
+    }
+
+    //Save the trained model
+    io::save_lda<Scalar>(
+        args["MODEL"].asString(),
+        lda.model_parameters(),
+        hasher
+    );
+}
+
+/**
+ * Compute the topic mixtures of the documents in DATA and save them in
+ * OUTPUT.
+ */
+template <typename Scalar>
+void transform(std::map<std::string, docopt::value> &args) {
+    // Load LDA model from file
+    auto model = io::load_lda_for_inference<Scalar>(args["MODEL"].asString());
+
+    auto lda = create_lda_for_transform<Scalar>(args, model);
+
+    // Add the listeners to be used
+    if (!args["--quiet"].asBool()) {
+        lda.get_event_dispatcher()->template add_listener<EpochProgress<Scalar> >();
+        lda.get_event_dispatcher()->template add_listener<ExpectationProgress>();
+    }
+
+    // Read the documents, hash their word ids like the training data and
+    // write their topic mixtures a block at a time instead of keeping them
+    // all in memory
+    io::transform_input_data<Scalar>(
+        args["DATA"].asString(),
+        io::load_feature_hasher(args["MODEL"].asString()),
+        lda,
+        args["OUTPUT"].asString()
+    );
+}
+
+/**
+ * Keep MODEL in memory and transform the documents sent to SOCKET.
+ */
+template <typename Scalar>
+void serve(std::map<std::string, docopt::value> &args) {
+    // Load LDA model from file once and keep it in memory
+    auto model = io::load_lda_for_inference<Scalar>(args["MODEL"].asString());
+
+    auto lda = create_lda_for_transform<Scalar>(args, model);
+
+    InferenceServer<Scalar> server(
+        lda,
+        io::model_words<Scalar>(model),
+        false,  // no predictions from an unsupervised model
+        args["--max_batch"].asLong(),
+        std::chrono::microseconds(static_cast<long>(
+            1000 * std::stof(args["--max_latency"].asString())
+        ))
+    );
+    if (!args["--quiet"].asBool()) {
+        std::cout << "Serving on " << args["SOCKET"].asString() << std::endl;
+    }
+    server.serve(args["SOCKET"].asString());
+}
+
 int main(int argc, char **argv) {
     
     std::map<std::string, docopt::value> args = docopt::docopt(
@@ -132,58 +337,33 @@ int main(int argc, char **argv) {
         "Unsupervised LDA 0.1"
     );
 
-    if (args["train"].asBool()) {
-        Eigen::MatrixXi X;
-        // Parse data from input file
-        io::parse_input_data(args["DATA"].asString(), X);
-
-        auto lda = create_lda_for_train(args, X);
-
-        // Add the listeners to be used
-        if (!args["--quiet"].asBool()) {
-            lda.get_event_dispatcher()->add_listener<EpochProgress>();
-            lda.get_event_dispatcher()->add_listener<ExpectationProgress>();
-        }
-
-        if (args["--snapshot_every"].asLong() > 0) {
-            lda.get_event_dispatcher()->add_listener<SnapshotEvery>(
-                args["MODEL"].asString(),
-                args["--snapshot_every"].asLong()
-            );
-        }
-
-        // Fit LDA model according to the given training data and parameters
-        lda.fit(X);
-
-        //Save the trained model
-        io::save_lda(
-            args["MODEL"].asString(),
-            lda.model_parameters()
-        );
+    // Everything is computed in the requested precision
+    bool single = args["--precision"].asString() == "float";
+    if (!single && args["--precision"].asString() != "double") {
+        std::cout << "Invalid precision" << std::endl;
+        return 1;
     }
-    else if (args["transform"].asBool()) {
-        Eigen::MatrixXi X;
-        // Parse data from input file
-        io::parse_input_data(args["DATA"].asString(), X);
 
-        // Load LDA model from file
-        auto model = io::load_lda(args["MODEL"].asString());
-
-        auto lda = create_lda_for_transform(args, model);
-
-        // Add the listeners to be used
-        if (!args["--quiet"].asBool()) {
-            lda.get_event_dispatcher()->add_listener<EpochProgress>();
-            lda.get_event_dispatcher()->add_listener<ExpectationProgress>();
-        }
+    // The sharded trainer has its own schedule
+    if (args["--shards"].asLong() > 0 && args["--deterministic"].asBool()) {
+        std::cout << "--deterministic cannot be used with --shards" << std::endl;
+        return 1;
+    }
 
-        Eigen::MatrixXd doc_topic_distribution;
-        doc_topic_distribution = lda.transform(X);
+    // The sharded trainer keeps no state to resume from
+    if (args["--shards"].asLong() > 0 && args["--checkpoint"]) {
+        std::cout << "--checkpoint cannot be used with --shards" << std::endl;
+        return 1;
+    }
 
-        numpy_format::save(
-            args["OUTPUT"].asString(),
-            doc_topic_distribution
-        );
+    if (args["train"].asBool()) {
+        (single) ? train<float>(args) : train<double>(args);
+    }
+    else if (args["transform"].asBool()) {
+        (single) ? transform<float>(args) : transform<double>(args);
+    }
+    else if (args["serve"].asBool()) {
+        (single) ? serve<float>(args) : serve<double>(args);
     }
     else {
         std::cout << "Invalid command" << std::endl;
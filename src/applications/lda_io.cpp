@@ -1,6 +1,13 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
+#include <type_traits>
 
+#include "ldaplusplus/checkpoint.hpp"
+#include "ldaplusplus/ModelFile.hpp"
 #include "ldaplusplus/NumpyFormat.hpp"
 
 #include "applications/lda_io.hpp"
@@ -47,15 +54,90 @@ void parse_input_data(
     X = ni;
 }
 
+/**
+ * Read the word counts at the current position of the stream and hash them
+ * a block at a time.
+ */
+static void read_hashed_words(
+    std::istream &data,
+    std::shared_ptr<const corpus::FeatureHasher> hasher,
+    Eigen::MatrixXi &X,
+    size_t block_size
+) {
+    numpy_format::NumpyReader<int> reader(data);
+
+    if (!hasher) {
+        X = reader.read(reader.cols());
+        return;
+    }
+
+    X.resize(hasher->buckets(), reader.cols());
+    while (reader.remaining() > 0) {
+        size_t first = reader.cols() - reader.remaining();
+        Eigen::MatrixXi block = reader.read(block_size);
+        X.middleCols(first, block.cols()) = hasher->transform(block);
+    }
+}
+
+void parse_input_data(
+    std::string data_path,
+    std::shared_ptr<const corpus::FeatureHasher> hasher,
+    Eigen::MatrixXi &X,
+    Eigen::MatrixXi &y,
+    size_t block_size
+) {
+    std::fstream data(
+        data_path,
+        std::ios::in | std::ios::binary
+    );
+    read_hashed_words(data, hasher, X, block_size);
+
+    // and the labels that follow them
+    numpy_format::NumpyInput<int> ni;
+    data >> ni;
+    y = ni;
+}
+
+void parse_input_data(
+    std::string data_path,
+    std::shared_ptr<const corpus::FeatureHasher> hasher,
+    Eigen::MatrixXi &X,
+    size_t block_size
+) {
+    std::fstream data(
+        data_path,
+        std::ios::in | std::ios::binary
+    );
+    read_hashed_words(data, hasher, X, block_size);
+}
+
+bool is_model_file_path(const std::string &model_path) {
+    const std::string extension = ".ldam";
+
+    return model_path.size() >= extension.size() &&
+           model_path.compare(
+               model_path.size() - extension.size(),
+               extension.size(),
+               extension
+           ) == 0;
+}
+
+template <typename Scalar>
 void save_lda(
     std::string model_path,
-    std::shared_ptr<parameters::Parameters> parameters
+    std::shared_ptr<parameters::Parameters> parameters,
+    std::shared_ptr<const corpus::FeatureHasher> hasher
 ) {
+    if (is_model_file_path(model_path)) {
+        model_file::save<Scalar>(model_path, parameters, false, true, hasher);
+        return;
+    }
+
     // cast the model parameters SupervisedModelParameters regardless the type
     // of the trained LDA model. In this way, one can train initially a
     // unsupervised LDA and then continue the training in a supervised manner
     auto model_parameters =
-        std::static_pointer_cast<parameters::SupervisedModelParameters<double> >(
+        std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(
             parameters
         );
 
@@ -65,17 +147,81 @@ void save_lda(
         std::ios::out | std::ios::binary
     );
 
-    model << numpy_format::NumpyOutput<double>(model_parameters->alpha);
-    model << numpy_format::NumpyOutput<double>(model_parameters->beta);
-    model << numpy_format::NumpyOutput<double>(model_parameters->eta);
+    model << numpy_format::NumpyOutput<Scalar>(model_parameters->alpha);
+    model << numpy_format::NumpyOutput<Scalar>(model_parameters->beta);
+    model << numpy_format::NumpyOutput<Scalar>(model_parameters->eta);
+
+    // the hasher follows as a fourth array [buckets, seed]
+    if (hasher) {
+        uint64_t hashing[2] = {hasher->buckets(), hasher->seed()};
+        model << numpy_format::NumpyOutput<uint64_t>(hashing, {2}, false);
+    }
+
+    model.close();
+    if (!model) {
+        throw std::runtime_error("Could not write the model to " + model_path);
+    }
+}
+
+/**
+ * Read the next array from the stream in whichever precision it was saved
+ * and convert it to Scalar.
+ */
+template <typename Scalar, typename MatrixType>
+void read_array(std::istream &model, MatrixType &x) {
+    typedef typename std::conditional<
+        std::is_same<Scalar, float>::value, double, float
+    >::type OtherScalar;
+
+    auto start = model.tellg();
+    try {
+        numpy_format::NumpyInput<Scalar> ni;
+        model >> ni;
+        x = static_cast<Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> >(ni);
+    } catch (const std::runtime_error &) {
+        model.clear();
+        model.seekg(start);
+
+        numpy_format::NumpyInput<OtherScalar> ni;
+        model >> ni;
+        x = static_cast<Eigen::Matrix<OtherScalar, Eigen::Dynamic, Eigen::Dynamic> >(ni)
+            .template cast<Scalar>();
+    }
 }
 
-std::shared_ptr<parameters::SupervisedModelParameters<double> > load_lda(
+/**
+ * Map a model file saved with FileScalar and copy its parameters converting
+ * them to Scalar.
+ */
+template <typename Scalar, typename FileScalar>
+std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > load_model_file(
     std::string model_path
 ) {
+    model_file::MappedModel<FileScalar> model(model_path);
+
+    return std::make_shared<parameters::SupervisedModelParameters<Scalar> >(
+        model.alpha().template cast<Scalar>(),
+        model.beta().template cast<Scalar>(),
+        model.eta().template cast<Scalar>()
+    );
+}
+
+template <typename Scalar>
+std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > load_lda(
+    std::string model_path
+) {
+    // the model files are recognized by their contents so that they can be
+    // read whatever their name
+    if (model_file::is_model_file(model_path)) {
+        if (model_file::scalar_size(model_path) == sizeof(float)) {
+            return load_model_file<Scalar, float>(model_path);
+        } else {
+            return load_model_file<Scalar, double>(model_path);
+        }
+    }
+
     // we will be needing those
-    auto model_parameters = std::make_shared<parameters::SupervisedModelParameters<double> >();
-    numpy_format::NumpyInput<double> ni;
+    auto model_parameters = std::make_shared<parameters::SupervisedModelParameters<Scalar> >();
 
     // open the file
     std::fstream model(
@@ -83,13 +229,263 @@ std::shared_ptr<parameters::SupervisedModelParameters<double> > load_lda(
         std::ios::in | std::ios::binary
     );
 
-    model >> ni; model_parameters->alpha = ni;
-    model >> ni; model_parameters->beta = ni;
-    model >> ni; model_parameters->eta = ni;
+    read_array<Scalar>(model, model_parameters->alpha);
+    read_array<Scalar>(model, model_parameters->beta);
+    read_array<Scalar>(model, model_parameters->eta);
 
     return model_parameters;
 }
 
 
+template <typename Scalar>
+std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > load_lda_for_inference(
+    std::string model_path
+) {
+    if (
+        model_file::is_model_file(model_path) &&
+        model_file::scalar_size(model_path) == sizeof(Scalar)
+    ) {
+        try {
+            return model_file::map_parameters<Scalar>(model_path);
+        } catch (const std::invalid_argument &) {
+            // a row major beta is copied to column major below
+        }
+    }
+
+    return load_lda<Scalar>(model_path);
+}
+
+
+template <typename Scalar>
+size_t model_words(
+    std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > model
+) {
+    auto mapped = std::dynamic_pointer_cast<parameters::MappedModelParameters<Scalar> >(
+        model
+    );
+
+    return (mapped) ? mapped->beta_map.cols() : model->beta.cols();
+}
+
+
+std::shared_ptr<corpus::FeatureHasher> load_feature_hasher(
+    std::string model_path
+) {
+    if (model_file::is_model_file(model_path)) {
+        if (model_file::scalar_size(model_path) == sizeof(float)) {
+            return model_file::MappedModel<float>(model_path).feature_hasher();
+        } else {
+            return model_file::MappedModel<double>(model_path).feature_hasher();
+        }
+    }
+
+    // skip the parameters whatever their precision
+    std::fstream model(
+        model_path,
+        std::ios::in | std::ios::binary
+    );
+    Eigen::MatrixXd skipped;
+    read_array<double>(model, skipped);
+    read_array<double>(model, skipped);
+    read_array<double>(model, skipped);
+
+    if (model.peek() == std::char_traits<char>::eof()) {
+        return nullptr;
+    }
+    numpy_format::NumpyInput<uint64_t> hashing;
+    model >> hashing;
+
+    return std::make_shared<corpus::FeatureHasher>(
+        hashing.data()[0],
+        hashing.data()[1]
+    );
+}
+
+void hash_input_data(
+    std::shared_ptr<const corpus::FeatureHasher> hasher,
+    Eigen::MatrixXi &X
+) {
+    if (hasher) {
+        X = hasher->transform(X);
+    }
+}
+
+template <typename Scalar>
+void transform_input_data(
+    std::string data_path,
+    std::shared_ptr<const corpus::FeatureHasher> hasher,
+    LDA<Scalar> &lda,
+    std::string output_path,
+    size_t block_size
+) {
+    std::fstream data(
+        data_path,
+        std::ios::in | std::ios::binary
+    );
+    numpy_format::NumpyReader<int> reader(data);
+
+    auto model = lda.template model_parameters<parameters::ModelParameters<Scalar> >();
+    numpy_format::NumpyWriter<Scalar> doc_topic_distribution(
+        output_path,
+        model->alpha.rows()
+    );
+    while (reader.remaining() > 0) {
+        Eigen::MatrixXi X = reader.read(block_size);
+        hash_input_data(hasher, X);
+        lda.transform(
+            std::make_shared<corpus::EigenCorpus>(X),
+            [&doc_topic_distribution](
+                size_t first,
+                const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &gammas
+            ) {
+                doc_topic_distribution.write(gammas);
+            }
+        );
+    }
+    doc_topic_distribution.close();
+}
+
+template <typename Scalar>
+void save_checkpoint(
+    std::string checkpoint_path,
+    LDA<Scalar> &lda,
+    std::shared_ptr<const corpus::Corpus> corpus,
+    size_t epochs
+) {
+    // write to a temporary file and rename it so that the previous
+    // checkpoint survives an interrupted write
+    std::string temporary_path = checkpoint_path + ".tmp";
+    std::fstream checkpoint_file(
+        temporary_path,
+        std::ios::out | std::ios::binary | std::ios::trunc
+    );
+    checkpoint::write<uint64_t>(checkpoint_file, epochs);
+    lda.save_checkpoint(checkpoint_file, corpus);
+    checkpoint_file.close();
+    if (!checkpoint_file) {
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error("Could not write " + temporary_path);
+    }
+
+    if (std::rename(temporary_path.c_str(), checkpoint_path.c_str()) != 0) {
+        std::string error = std::strerror(errno);
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error(
+            "Could not rename " + temporary_path + " to " +
+            checkpoint_path + ": " + error
+        );
+    }
+}
+
+template <typename Scalar>
+size_t load_checkpoint(
+    std::string checkpoint_path,
+    LDA<Scalar> &lda,
+    std::shared_ptr<corpus::Corpus> corpus
+) {
+    std::fstream checkpoint_file(
+        checkpoint_path,
+        std::ios::in | std::ios::binary
+    );
+    if (!checkpoint_file) {
+        return 0;
+    }
+
+    size_t epochs = checkpoint::read<uint64_t>(checkpoint_file);
+    lda.load_checkpoint(checkpoint_file, corpus);
+
+    return epochs;
+}
+
+template <typename Scalar>
+void fit_with_checkpoints(
+    std::string checkpoint_path,
+    LDA<Scalar> &lda,
+    std::shared_ptr<corpus::Corpus> corpus,
+    size_t iterations
+) {
+    for (
+        size_t epoch = load_checkpoint(checkpoint_path, lda, corpus);
+        epoch < iterations;
+        epoch++
+    ) {
+        lda.partial_fit(corpus);
+        save_checkpoint<Scalar>(checkpoint_path, lda, corpus, epoch + 1);
+    }
+    lda.wait_for_m_steps();
+}
+
+
+// Template instantiation
+template void save_lda<float>(
+    std::string,
+    std::shared_ptr<parameters::Parameters>,
+    std::shared_ptr<const corpus::FeatureHasher>
+);
+template void save_lda<double>(
+    std::string,
+    std::shared_ptr<parameters::Parameters>,
+    std::shared_ptr<const corpus::FeatureHasher>
+);
+template std::shared_ptr<parameters::SupervisedModelParameters<float> > load_lda<float>(std::string);
+template std::shared_ptr<parameters::SupervisedModelParameters<double> > load_lda<double>(std::string);
+template std::shared_ptr<parameters::SupervisedModelParameters<float> > load_lda_for_inference<float>(std::string);
+template std::shared_ptr<parameters::SupervisedModelParameters<double> > load_lda_for_inference<double>(std::string);
+template size_t model_words<float>(
+    std::shared_ptr<parameters::SupervisedModelParameters<float> >
+);
+template size_t model_words<double>(
+    std::shared_ptr<parameters::SupervisedModelParameters<double> >
+);
+template void transform_input_data<float>(
+    std::string,
+    std::shared_ptr<const corpus::FeatureHasher>,
+    LDA<float> &,
+    std::string,
+    size_t
+);
+template void transform_input_data<double>(
+    std::string,
+    std::shared_ptr<const corpus::FeatureHasher>,
+    LDA<double> &,
+    std::string,
+    size_t
+);
+template void save_checkpoint<float>(
+    std::string,
+    LDA<float> &,
+    std::shared_ptr<const corpus::Corpus>,
+    size_t
+);
+template void save_checkpoint<double>(
+    std::string,
+    LDA<double> &,
+    std::shared_ptr<const corpus::Corpus>,
+    size_t
+);
+template size_t load_checkpoint<float>(
+    std::string,
+    LDA<float> &,
+    std::shared_ptr<corpus::Corpus>
+);
+template size_t load_checkpoint<double>(
+    std::string,
+    LDA<double> &,
+    std::shared_ptr<corpus::Corpus>
+);
+template void fit_with_checkpoints<float>(
+    std::string,
+    LDA<float> &,
+    std::shared_ptr<corpus::Corpus>,
+    size_t
+);
+template void fit_with_checkpoints<double>(
+    std::string,
+    LDA<double> &,
+    std::shared_ptr<corpus::Corpus>,
+    size_t
+);
+
+
 }  // namespace io
 
@@ -1,7 +1,9 @@
 
 #include <numeric>
+#include <stdexcept>
 #include <utility>
 
+#include "ldaplusplus/checkpoint.hpp"
 #include "ldaplusplus/Document.hpp"
 #include "ldaplusplus/utils.hpp"
 
@@ -9,12 +11,39 @@ namespace ldaplusplus {
 namespace corpus {
 
 
+// 
+// Document
+//
+uint64_t Document::fingerprint() const {
+    const Eigen::VectorXi &X = get_words();
+
+    // mix every nonzero (word, count) pair with the splitmix64 finalizer
+    uint64_t h = 0;
+    for (int i=0; i<X.rows(); i++) {
+        if (X[i] == 0) {
+            continue;
+        }
+        uint64_t z = h + 0x9e3779b97f4a7c15ULL +
+            ((static_cast<uint64_t>(i) << 32) ^ static_cast<uint32_t>(X[i]));
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        h = z ^ (z >> 31);
+    }
+
+    return h;
+}
+
+
 // 
 // EigenDocument
 //
-EigenDocument::EigenDocument(Eigen::VectorXi X, std::shared_ptr<const Corpus> corpus)
-    : X_(std::move(X)),
-      corpus_(corpus)
+EigenDocument::EigenDocument(
+    Eigen::VectorXi X,
+    std::shared_ptr<const Corpus> corpus,
+    int id
+) : X_(std::move(X)),
+    corpus_(corpus),
+    id_(id)
 {}
 
 const std::shared_ptr<const Corpus> EigenDocument::get_corpus() const {
@@ -25,6 +54,10 @@ const Eigen::VectorXi & EigenDocument::get_words() const {
     return X_;
 }
 
+int EigenDocument::get_id() const {
+    return id_;
+}
+
 
 // 
 // ClassificationDecorator
@@ -44,6 +77,10 @@ const Eigen::VectorXi & ClassificationDecorator::get_words() const {
     return document_->get_words();
 }
 
+int ClassificationDecorator::get_id() const {
+    return document_->get_id();
+}
+
 int ClassificationDecorator::get_class() const {
     return y_;
 }
@@ -63,6 +100,46 @@ void CorpusIndexes::shuffle() {
     std::shuffle(indices_.begin(), indices_.end(), prng_);
 }
 
+void CorpusIndexes::save_state(std::ostream &os) const {
+    checkpoint::write<uint64_t>(os, indices_.size());
+    os.write(
+        reinterpret_cast<const char *>(indices_.data()),
+        indices_.size()*sizeof(int)
+    );
+    checkpoint::write_prng(os, prng_);
+}
+
+void CorpusIndexes::load_state(std::istream &is) {
+    if (checkpoint::read<uint64_t>(is) != indices_.size()) {
+        throw std::runtime_error("The checkpoint was saved for a corpus of "
+                                 "a different size");
+    }
+    is.read(
+        reinterpret_cast<char *>(indices_.data()),
+        indices_.size()*sizeof(int)
+    );
+    checkpoint::read_prng(is, prng_);
+}
+
+
+// 
+// Corpus
+//
+void Corpus::count_words(
+    size_t index,
+    size_t &distinct_words,
+    size_t &total_words
+) const {
+    auto doc = at(index);
+    const Eigen::VectorXi &X = doc->get_words();
+    distinct_words = (X.array() > 0).count();
+    total_words = X.sum();
+}
+
+size_t Corpus::words() const {
+    return (size() > 0) ? at(0)->get_words().rows() : 0;
+}
+
 
 // 
 // EigenCorpus
@@ -79,13 +156,35 @@ size_t EigenCorpus::size() const {
 const std::shared_ptr<Document> EigenCorpus::at(size_t index) const {
     int i = indices_.get_index(index);
 
-    return std::make_shared<EigenDocument>(X_.col(i));
+    return std::make_shared<EigenDocument>(X_.col(i), nullptr, i);
 }
 
 void EigenCorpus::shuffle() {
     indices_.shuffle();
 }
 
+void EigenCorpus::count_words(
+    size_t index,
+    size_t &distinct_words,
+    size_t &total_words
+) const {
+    auto X = X_.col(indices_.get_index(index));
+    distinct_words = (X.array() > 0).count();
+    total_words = X.sum();
+}
+
+size_t EigenCorpus::words() const {
+    return X_.rows();
+}
+
+void EigenCorpus::save_state(std::ostream &os) const {
+    indices_.save_state(os);
+}
+
+void EigenCorpus::load_state(std::istream &is) {
+    indices_.load_state(is);
+}
+
 
 // 
 // EigenClassificationCorpus
@@ -116,7 +215,8 @@ const std::shared_ptr<Document> EigenClassificationCorpus::at(size_t index) cons
     return std::make_shared<ClassificationDecorator>(
         std::make_shared<EigenDocument>(
             X_.col(i),
-            std::shared_ptr<const Corpus>(this, [](const Corpus*){})
+            std::shared_ptr<const Corpus>(this, [](const Corpus*){}),
+            i
         ),
         y_[i]
     );
@@ -126,6 +226,28 @@ void EigenClassificationCorpus::shuffle() {
     indices_.shuffle();
 }
 
+void EigenClassificationCorpus::count_words(
+    size_t index,
+    size_t &distinct_words,
+    size_t &total_words
+) const {
+    auto X = X_.col(indices_.get_index(index));
+    distinct_words = (X.array() > 0).count();
+    total_words = X.sum();
+}
+
+size_t EigenClassificationCorpus::words() const {
+    return X_.rows();
+}
+
+void EigenClassificationCorpus::save_state(std::ostream &os) const {
+    indices_.save_state(os);
+}
+
+void EigenClassificationCorpus::load_state(std::istream &is) {
+    indices_.load_state(is);
+}
+
 float EigenClassificationCorpus::get_prior(int y) const {
     return priors_[y];
 }
@@ -0,0 +1,50 @@
+#include <stdexcept>
+#include <vector>
+
+#include "ldaplusplus/FeatureHasher.hpp"
+
+namespace ldaplusplus {
+namespace corpus {
+
+
+FeatureHasher::FeatureHasher(size_t buckets, uint64_t seed)
+    : buckets_(buckets),
+      seed_(seed)
+{
+    if (buckets_ == 0) {
+        throw std::invalid_argument("There should be at least one bucket");
+    }
+}
+
+
+size_t FeatureHasher::bucket(size_t word) const {
+    // the splitmix64 finalizer, so that consecutive ids are spread evenly
+    uint64_t h = static_cast<uint64_t>(word) + seed_ * 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h = h ^ (h >> 31);
+
+    return h % buckets_;
+}
+
+
+Eigen::MatrixXi FeatureHasher::transform(const Eigen::MatrixXi &X) const {
+    // hash every word once for all the documents
+    std::vector<size_t> buckets(X.rows());
+    for (int w=0; w<X.rows(); w++) {
+        buckets[w] = bucket(w);
+    }
+
+    Eigen::MatrixXi hashed = Eigen::MatrixXi::Zero(buckets_, X.cols());
+    for (int d=0; d<X.cols(); d++) {
+        for (int w=0; w<X.rows(); w++) {
+            hashed(buckets[w], d) += X(w, d);
+        }
+    }
+
+    return hashed;
+}
+
+
+}  // namespace corpus
+}  // namespace ldaplusplus
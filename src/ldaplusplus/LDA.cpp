@@ -1,41 +1,136 @@
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <map>
 #include <numeric>
 #include <random>
+#include <sstream>
+#include <stdexcept>
 #include <utility>
 
+#include "ldaplusplus/checkpoint.hpp"
 #include "ldaplusplus/LDA.hpp"
 #include "ldaplusplus/events/ProgressEvents.hpp"
 
 namespace ldaplusplus {
 
 
+// The time a worker should spend on the documents of a chunk
+static const long long CHUNK_NANOSECONDS = 200000;
+
+// The documents per worker that a streaming transform may complete past the
+// first one that is not done
+static const size_t TRANSFORM_WINDOW = 256;
+
+// The checkpoints start with this magic string followed by the version of
+// the format
+static const char CHECKPOINT_MAGIC[8] = {'L', 'D', 'A', '+', '+', 'C', 'K', 'P'};
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+
+/**
+ * Read a section of a checkpoint with a function and make sure that it was
+ * consumed entirely, namely that it was written by a compatible component.
+ */
+template <typename F>
+static void read_checkpoint_section(const std::string &data, const char *name, F read) {
+    std::istringstream section(data);
+    read(section);
+    if (section.peek() != std::char_traits<char>::eof()) {
+        throw std::runtime_error(
+            std::string("The checkpoint ") + name + " state was written by "
+            "a different implementation"
+        );
+    }
+}
+
+
 template <typename Scalar>
 LDA<Scalar>::LDA(
     std::shared_ptr<parameters::Parameters> model_parameters,
     std::shared_ptr<em::EStepInterface<Scalar> > e_step,
     std::shared_ptr<em::MStepInterface<Scalar> > m_step,
     size_t iterations,
-    size_t workers
+    size_t workers,
+    size_t staleness,
+    size_t deterministic_window,
+    std::shared_ptr<em::SelectiveUpdate<Scalar> > selective_update,
+    bool numa,
+    std::shared_ptr<em::GammaCache<Scalar> > gamma_cache
 ) : model_parameters_(model_parameters),
     e_step_(e_step),
     m_step_(m_step),
     iterations_(iterations),
+    staleness_(staleness),
+    deterministic_window_(deterministic_window),
+    selective_update_(selective_update),
+    gamma_cache_(gamma_cache),
+    numa_(numa),
+    use_replicas_(false),
+    model_version_(0),
     workers_(workers),
+    next_job_(0),
+    jobs_limit_(0),
+    document_nanoseconds_(0),
+    stop_transform_workers_(false),
+    transforms_paused_(false),
+    active_transforms_(0),
     event_dispatcher_(std::make_shared<events::SameThreadEventDispatcher>())
 {
     set_up_event_dispatcher();
+    set_up_model_publisher();
 }
 
 template <typename Scalar>
 LDA<Scalar>::LDA(LDA<Scalar> &&lda)
-    : model_parameters_(std::move(lda.model_parameters_)),
+    // the background maximization steps refer to lda so they should be done
+    : model_parameters_((lda.wait_for_m_steps(), std::move(lda.model_parameters_))),
       e_step_(std::move(lda.e_step_)),
       m_step_(std::move(lda.m_step_)),
       iterations_(lda.iterations_),
+      staleness_(lda.staleness_),
+      deterministic_window_(lda.deterministic_window_),
+      selective_update_(std::move(lda.selective_update_)),
+      gamma_cache_(std::move(lda.gamma_cache_)),
+      numa_(lda.numa_),
+      use_replicas_(false),
+      model_version_(lda.model_version_.load()),
       workers_(lda.workers_.size()),
+      next_job_(0),
+      jobs_limit_(0),
+      document_nanoseconds_(lda.document_nanoseconds_.load()),
+      stop_transform_workers_(false),
+      transforms_paused_(false),
+      active_transforms_(0),
       event_dispatcher_(std::move(lda.event_dispatcher_))
-{}
+{
+    set_up_model_publisher();
+}
+
+template <typename Scalar>
+LDA<Scalar>::~LDA() {
+    {
+        std::lock_guard<std::mutex> lock(transform_mutex_);
+        stop_transform_workers_ = true;
+    }
+    transform_cv_.notify_all();
+    for (auto & t : transform_workers_) {
+        t.join();
+    }
+}
+
+template <typename Scalar>
+void LDA<Scalar>::set_up_model_publisher() {
+    // the concurrent maximization steps replace the model that the
+    // expectation steps read instead of changing it in place
+    m_step_->set_model_publisher(
+        [this](std::shared_ptr<parameters::Parameters> parameters) {
+            std::atomic_store(&model_parameters_, parameters);
+        }
+    );
+}
 
 template <typename Scalar>
 void LDA<Scalar>::set_up_event_dispatcher() {
@@ -68,6 +163,7 @@ void LDA<Scalar>::fit(const Eigen::MatrixXi &X, const Eigen::VectorXi &y) {
     for (size_t i=0; i<iterations_; i++) {
         partial_fit(corpus);
     }
+    wait_for_m_steps();
 }
 
 
@@ -78,60 +174,389 @@ void LDA<Scalar>::fit(const Eigen::MatrixXi &X) {
     for (size_t i=0; i<iterations_; i++) {
         partial_fit(corpus);
     }
+    wait_for_m_steps();
 }
 
 
 template <typename Scalar>
 void LDA<Scalar>::partial_fit(const Eigen::MatrixXi &X, const Eigen::VectorXi &y) {
+    // the model may know words that this batch does not contain
+    size_t words = model_words();
+    if (static_cast<size_t>(X.rows()) < words) {
+        Eigen::MatrixXi padded = Eigen::MatrixXi::Zero(words, X.cols());
+        padded.topRows(X.rows()) = X;
+        partial_fit(get_corpus(padded, y));
+        return;
+    }
+
     partial_fit(get_corpus(X, y));
 }
 
 
 template <typename Scalar>
 void LDA<Scalar>::partial_fit(std::shared_ptr<corpus::Corpus> corpus) {
+    // the submitted transforms use the expectation step and the model that
+    // change below
+    TransformsPause pause(*this);
+
+    // Make room in the model for the words that appeared after the model
+    // was created (after the background maximization steps are done since
+    // they maximize copies of the smaller model)
+    size_t words = model_words();
+    size_t corpus_words = corpus->words();
+    if (words > 0 && corpus_words > words) {
+        wait_for_m_steps();
+        m_step_->grow_vocabulary(
+            corpus_words,
+            model_parameters_  // output
+        );
+        model_version_++;
+    }
+
+    // The documents cached by the selective update belong to the previous
+    // corpus (the ids repeat across corpora)
+    if (selective_update_ && selective_corpus_.lock() != corpus) {
+        selective_update_->clear();
+        selective_corpus_ = corpus;
+    }
+
     // Shuffle the documents for a randomized pass through
     corpus->shuffle();
 
-    // Queue all the documents
-    for (size_t i=0; i<corpus->size(); i++) {
-        queue_in_.emplace_back(corpus, i);
+    if (deterministic_window_ > 0) {
+        deterministic_doc_steps(corpus);
+    } else {
+        // Queue all the documents (the online maximization steps should see
+        // them in a random order so only the long ones are moved and they
+        // are spread over the minibatches)
+        bool concurrent_m_step = m_step_->concurrent_doc_m_step();
+        bool online_m_step = m_step_->online_doc_m_step();
+        queue_documents(
+            corpus,
+            0,
+            corpus->size(),
+            (online_m_step) ? QueueOrder::LongSpread : QueueOrder::LongFirst
+        );
+
+        // create the thread pool (the workers perform the online part of
+        // the m step themselves if it is thread safe)
+        create_worker_pool(concurrent_m_step, true);
+
+        // Extract variational parameters and calculate the doc_m_step
+        for (size_t i=0; i<corpus->size(); i++) {
+            std::shared_ptr<parameters::Parameters> variational_parameters;
+            size_t index;
+
+            std::tie(variational_parameters, index) = extract_vp_from_queue();
+
+            // tell the thread safe event dispatcher to process the events
+            // from the workers
+            process_worker_events();
+
+            if (concurrent_m_step) {
+                continue;
+            }
+
+            // perform the online part of m step
+            m_step_->doc_m_step(
+                corpus->at(index),
+                variational_parameters,
+                std::atomic_load(&model_parameters_)  // output
+            );
+            if (online_m_step) {
+                model_version_++;
+            }
+        }
+
+        // destroy the thread pool
+        destroy_worker_pool();
     }
 
-    // create the thread pool
-    create_worker_pool();
+    // Perform any corpuswise action related to e step
+    e_step_->e_step();
+    if (selective_update_) {
+        selective_update_->next_epoch();
+    }
+
+    // perform the batch part of m step
+    batch_m_step();
+
+    // inform the world that the epoch is over
+    get_event_dispatcher()->template dispatch<events::EpochProgressEvent<Scalar> >(
+        std::atomic_load(&model_parameters_)
+    );
+}
 
-    // Extract variational parameters and calculate the doc_m_step
-    for (size_t i=0; i<corpus->size(); i++) {
-        std::shared_ptr<parameters::Parameters> variational_parameters;
-        size_t index;
 
-        std::tie(variational_parameters, index) = extract_vp_from_queue();
+template <typename Scalar>
+void LDA<Scalar>::deterministic_doc_steps(std::shared_ptr<corpus::Corpus> corpus) {
+    std::vector<std::shared_ptr<parameters::Parameters> > window(deterministic_window_);
+
+    for (size_t start=0; start<corpus->size(); start+=deterministic_window_) {
+        size_t end = std::min(start + deterministic_window_, corpus->size());
+
+        // Queue the documents of the window. Nothing changes the model
+        // before the window is complete so all of them see the same one.
+        queue_documents(corpus, start, end, QueueOrder::Cost);
+        create_worker_pool(false, true);
+
+        // Put the variational parameters in document order
+        for (size_t i=start; i<end; i++) {
+            std::shared_ptr<parameters::Parameters> variational_parameters;
+            size_t index;
+
+            std::tie(variational_parameters, index) = extract_vp_from_queue();
+            window[index - start] = variational_parameters;
+
+            // tell the thread safe event dispatcher to process the events
+            // from the workers
+            process_worker_events();
+        }
+        destroy_worker_pool();
+
+        // perform the online part of m step in a fixed order
+        for (size_t i=start; i<end; i++) {
+            m_step_->doc_m_step(
+                corpus->at(i),
+                window[i - start],
+                model_parameters_  // output
+            );
+            window[i - start] = nullptr;
+        }
+        if (m_step_->online_doc_m_step()) {
+            model_version_++;
+        }
+    }
+}
 
-        // tell the thread safe event dispatcher to process the events from the
-        // workers
-        process_worker_events();
 
-        // perform the online part of m step
-        m_step_->doc_m_step(
-            corpus->at(index),
-            variational_parameters,
+template <typename Scalar>
+void LDA<Scalar>::batch_m_step() {
+    // forget about the maximization steps that have completed
+    pending_m_steps_.remove_if([](const std::shared_future<void> &f) {
+        return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+
+    // the deterministic mode needs to know which parameters each epoch uses
+    // so only split the maximization step outside of it
+    std::shared_ptr<em::MStepInterface<Scalar> > detached;
+    if (staleness_ > 0 && deterministic_window_ == 0) {
+        // maximize w.r.t. beta in place; no expectation step is running and
+        // the pending optimizations of eta only copy the model under the lock
+        std::lock_guard<std::mutex> lock(model_mutex_);
+        detached = m_step_->detach(
+            std::atomic_load(&model_parameters_)  // output
+        );
+    }
+    if (!detached) {
+        wait_for_m_steps();
+        m_step_->m_step(
             model_parameters_  // output
         );
+        model_version_++;
+        return;
     }
+    model_version_++;
 
-    // destroy the thread pool
-    destroy_worker_pool();
+    // respect the staleness bound
+    while (pending_m_steps_.size() >= staleness_) {
+        pending_m_steps_.front().get();
+        pending_m_steps_.pop_front();
+    }
 
-    // Perform any corpuswise action related to e step
-    e_step_->e_step();
+    // Optimize eta in the background starting from the latest one (after
+    // the previous optimizations have been applied) and publish it in a
+    // copy of the latest model when done
+    std::shared_future<void> previous;
+    if (!pending_m_steps_.empty()) {
+        previous = pending_m_steps_.back();
+    }
+    pending_m_steps_.push_back(std::async(
+        std::launch::async,
+        [this, detached, previous]() {
+            typedef parameters::SupervisedModelParameters<Scalar> SupervisedParameters;
+
+            if (previous.valid()) {
+                previous.wait();
+            }
+            auto eta = std::make_shared<SupervisedParameters>();
+            {
+                std::lock_guard<std::mutex> lock(model_mutex_);
+                eta->eta = std::static_pointer_cast<SupervisedParameters>(
+                    std::atomic_load(&model_parameters_)
+                )->eta;
+            }
+
+            detached->m_step(eta);
+
+            std::lock_guard<std::mutex> lock(model_mutex_);
+            auto parameters = std::static_pointer_cast<SupervisedParameters>(
+                std::atomic_load(&model_parameters_)->clone()
+            );
+            parameters->eta = std::move(eta->eta);
+            std::atomic_store(
+                &model_parameters_,
+                std::static_pointer_cast<parameters::Parameters>(parameters)
+            );
+        }
+    ).share());
+}
 
-    // perform the batch part of m step
-    m_step_->m_step(
-        model_parameters_  // output
+
+template <typename Scalar>
+size_t LDA<Scalar>::model_words() {
+    auto model = std::dynamic_pointer_cast<parameters::ModelParameters<Scalar> >(
+        std::atomic_load(&model_parameters_)
     );
 
-    // inform the world that the epoch is over
-    get_event_dispatcher()->template dispatch<events::EpochProgressEvent<Scalar> >(model_parameters_);
+    return (model) ? model->beta.cols() : 0;
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::wait_for_m_steps() {
+    while (!pending_m_steps_.empty()) {
+        auto f = pending_m_steps_.front();
+        pending_m_steps_.pop_front();
+        f.get();
+    }
+
+    // deliver the events of the background maximization steps
+    process_worker_events();
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::save_checkpoint(
+    std::ostream &os,
+    std::shared_ptr<const corpus::Corpus> corpus
+) {
+    wait_for_m_steps();
+
+    os.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    checkpoint::write<uint32_t>(os, CHECKPOINT_VERSION);
+
+    // every section is written with its length so that reading it with
+    // a differently configured component fails early
+    std::ostringstream model_section;
+    auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
+        model_parameters_
+    );
+    auto supervised_model = std::dynamic_pointer_cast<
+        parameters::SupervisedModelParameters<Scalar>
+    >(model_parameters_);
+    checkpoint::write_matrix(model_section, model->alpha);
+    checkpoint::write_matrix(model_section, model->beta);
+    checkpoint::write<uint8_t>(model_section, supervised_model != nullptr);
+    if (supervised_model) {
+        checkpoint::write_matrix(model_section, supervised_model->eta);
+    }
+    checkpoint::write_string(os, model_section.str());
+
+    std::ostringstream e_step_section;
+    e_step_->save_state(e_step_section);
+    checkpoint::write_string(os, e_step_section.str());
+
+    std::ostringstream m_step_section;
+    m_step_->save_state(m_step_section);
+    checkpoint::write_string(os, m_step_section.str());
+
+    std::ostringstream corpus_section;
+    if (corpus) {
+        corpus->save_state(corpus_section);
+    }
+    checkpoint::write_string(os, corpus_section.str());
+
+    if (!os) {
+        throw std::runtime_error("Failed to write the checkpoint");
+    }
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::load_checkpoint(
+    std::istream &is,
+    std::shared_ptr<corpus::Corpus> corpus
+) {
+    TransformsPause pause(*this);
+    wait_for_m_steps();
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    is.read(magic, sizeof(magic));
+    if (!is || !std::equal(magic, magic + sizeof(magic), CHECKPOINT_MAGIC)) {
+        throw std::runtime_error("This is not an LDA checkpoint");
+    }
+    if (checkpoint::read<uint32_t>(is) != CHECKPOINT_VERSION) {
+        throw std::runtime_error("Unsupported checkpoint version");
+    }
+
+    // read every section before changing anything so that a truncated
+    // checkpoint leaves the training untouched
+    std::string sections[4];
+    for (auto &section : sections) {
+        section = checkpoint::read_string(is);
+    }
+
+    // read the parameters into a copy so that the model stays intact if
+    // the checkpoint is invalid
+    auto parameters = model_parameters_->clone();
+    read_checkpoint_section(sections[0], "model", [&](std::istream &section) {
+        auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
+            parameters
+        );
+        checkpoint::read_matrix(section, model->alpha);
+        checkpoint::read_matrix(section, model->beta);
+        if (checkpoint::read<uint8_t>(section)) {
+            auto supervised_model = std::dynamic_pointer_cast<
+                parameters::SupervisedModelParameters<Scalar>
+            >(parameters);
+            if (!supervised_model) {
+                throw std::runtime_error("The checkpoint contains a "
+                                         "supervised model");
+            }
+            checkpoint::read_matrix(section, supervised_model->eta);
+        }
+    });
+
+    // the steps and the corpus cannot be copied so their current state is
+    // kept aside and restored into every one that started loading if a
+    // section turns out to be invalid
+    std::ostringstream e_step_backup, m_step_backup, corpus_backup;
+    e_step_->save_state(e_step_backup);
+    m_step_->save_state(m_step_backup);
+    if (corpus) {
+        corpus->save_state(corpus_backup);
+    }
+    int loaded = 0;
+    try {
+        read_checkpoint_section(sections[1], "expectation step", [&](std::istream &section) {
+            e_step_->load_state(section);
+        });
+        loaded++;
+        read_checkpoint_section(sections[2], "maximization step", [&](std::istream &section) {
+            m_step_->load_state(section);
+        });
+        loaded++;
+        if (corpus) {
+            read_checkpoint_section(sections[3], "corpus", [&](std::istream &section) {
+                corpus->load_state(section);
+            });
+        }
+    } catch (...) {
+        std::istringstream e_step_state(e_step_backup.str());
+        std::istringstream m_step_state(m_step_backup.str());
+        std::istringstream corpus_state(corpus_backup.str());
+        e_step_->load_state(e_step_state);
+        if (loaded >= 1) {
+            m_step_->load_state(m_step_state);
+        }
+        if (corpus && loaded >= 2) {
+            corpus->load_state(corpus_state);
+        }
+        throw;
+    }
+
+    std::atomic_store(&model_parameters_, parameters);
 }
 
 
@@ -139,40 +564,293 @@ template <typename Scalar>
 typename LDA<Scalar>::MatrixX LDA<Scalar>::transform(const Eigen::MatrixXi& X) {
     // cast the parameters to what is needed
     auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
-        model_parameters_
+        std::atomic_load(&model_parameters_)
+    );
+
+    // make some room for the transformed data (we use alpha for the number
+    // of topics because beta may be stored in another form, see
+    // QuantizedModelParameters)
+    MatrixX gammas(model->alpha.rows(), X.cols());
+    transform(X, gammas);
+
+    return gammas;
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::transform(const Eigen::MatrixXi &X, Eigen::Ref<MatrixX> gammas) {
+    auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
+        std::atomic_load(&model_parameters_)
     );
+    if (gammas.rows() != model->alpha.rows() || gammas.cols() != X.cols()) {
+        throw std::invalid_argument("The gammas should be a topics x documents "
+                                    "matrix");
+    }
+
+    transform_documents(X, [&gammas](size_t d, const VectorX &gamma) {
+        gammas.col(d) = gamma;
+    });
+}
 
-    // make some room for the transformed data
-    MatrixX gammas(model->beta.rows(), X.cols());
+
+template <typename Scalar>
+void LDA<Scalar>::transform_documents(
+    const Eigen::MatrixXi &X,
+    const std::function<void(size_t, const VectorX &)> &document_gamma
+) {
+    wait_for_m_steps();
 
     // make a corpus to use
     auto corpus = get_corpus(X);
 
     // Queue all the documents
-    for (size_t i=0; i<corpus->size(); i++) {
-        queue_in_.emplace_back(corpus, i);
-    }
+    queue_documents(corpus, 0, corpus->size(), QueueOrder::Cost);
 
     // create the thread pool
     create_worker_pool();
 
     // Extract variational parameters and calculate the doc_e_step
-    for (size_t i=0; i<corpus->size(); i++) {
-        std::shared_ptr<parameters::Parameters> vp;
-        size_t index;
+    try {
+        for (size_t i=0; i<corpus->size(); i++) {
+            std::shared_ptr<parameters::Parameters> vp;
+            size_t index;
+
+            std::tie(vp, index) = extract_vp_from_queue();
+            document_gamma(
+                index,
+                std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(vp)->gamma
+            );
+
+            // tell the thread safe event dispatcher to process the events from the
+            // workers
+            process_worker_events();
+        }
+    } catch (...) {
+        destroy_worker_pool();
+        results_.clear();
+        queue_out_.clear();
+        throw;
+    }
+
+    // destroy the thread pool
+    destroy_worker_pool();
+}
+
 
-        std::tie(vp, index) = extract_vp_from_queue();
-        gammas.col(index) = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(vp)->gamma;
+template <typename Scalar>
+void LDA<Scalar>::transform(
+    std::shared_ptr<corpus::Corpus> corpus,
+    const TransformSink &sink,
+    size_t block_size
+) {
+    wait_for_m_steps();
 
-        // tell the thread safe event dispatcher to process the events from the
-        // workers
-        process_worker_events();
+    if (block_size == 0) {
+        throw std::invalid_argument("The block size should be positive");
     }
 
-    // destroy the thread pool
+    auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
+        model_parameters_
+    );
+
+    size_t size = corpus->size();
+    if (size == 0) {
+        return;
+    }
+
+    // A single pool transforms the whole corpus in order. The completed
+    // documents that follow the first missing one wait aside (only their
+    // gamma) and the block is handed over as soon as its prefix is
+    // complete. The workers do not go further than a window past the
+    // first missing document.
+    MatrixX gammas(model->alpha.rows(), std::min(block_size, size));
+    std::map<size_t, VectorX> ahead;
+    size_t start = 0;
+    size_t next = 0;
+    queue_documents(corpus, 0, size, QueueOrder::InOrder);
+    size_t window = TRANSFORM_WINDOW * workers_.size();
+    jobs_limit_ = window;
+    create_worker_pool();
+    try {
+        for (size_t i=0; i<size; i++) {
+            std::shared_ptr<parameters::Parameters> vp;
+            size_t index;
+
+            std::tie(vp, index) = extract_vp_from_queue();
+            ahead.emplace(
+                index,
+                std::move(std::static_pointer_cast<
+                    parameters::VariationalParameters<Scalar>
+                >(vp)->gamma)
+            );
+            size_t previous = next;
+            while (!ahead.empty() && ahead.begin()->first == next) {
+                gammas.col(next - start) = ahead.begin()->second;
+                ahead.erase(ahead.begin());
+                next++;
+
+                if (next == size && next - start < static_cast<size_t>(gammas.cols())) {
+                    gammas.conservativeResize(Eigen::NoChange, next - start);
+                }
+                if (next - start == static_cast<size_t>(gammas.cols())) {
+                    sink(start, gammas);
+                    start = next;
+                }
+            }
+
+            // let the workers move on
+            if (next != previous) {
+                {
+                    std::lock_guard<std::mutex> lock(jobs_limit_mutex_);
+                    jobs_limit_ = next + window;
+                }
+                jobs_limit_cv_.notify_all();
+            }
+
+            // tell the thread safe event dispatcher to process the events from the
+            // workers
+            process_worker_events();
+        }
+    } catch (...) {
+        // let the workers finish their chunks (without the window) and
+        // drop their results before passing on the error of the sink
+        next_job_ = jobs_.size();
+        {
+            std::lock_guard<std::mutex> lock(jobs_limit_mutex_);
+            jobs_limit_ = std::numeric_limits<size_t>::max();
+        }
+        jobs_limit_cv_.notify_all();
+        destroy_worker_pool();
+        results_.clear();
+        queue_out_.clear();
+        throw;
+    }
     destroy_worker_pool();
+}
 
-    return gammas;
+
+template <typename Scalar>
+std::future<typename LDA<Scalar>::MatrixX> LDA<Scalar>::submit_transform(
+    const Eigen::MatrixXi &X
+) {
+    auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
+        std::atomic_load(&model_parameters_)
+    );
+
+    auto request = std::make_shared<TransformRequest>();
+    request->X = X;
+    request->corpus = std::make_shared<corpus::EigenCorpus>(request->X);
+    request->gammas.resize(model->alpha.rows(), X.cols());
+    request->next = 0;
+    request->remaining = X.cols();
+    request->failed = false;
+    auto result = request->result.get_future();
+
+    if (request->remaining == 0) {
+        request->result.set_value(std::move(request->gammas));
+        return result;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(transform_mutex_);
+
+        // start the pool the first time it is needed
+        if (transform_workers_.empty()) {
+            for (size_t w=0; w<std::max<size_t>(1, workers_.size()); w++) {
+                transform_workers_.emplace_back(&LDA<Scalar>::transform_worker, this);
+            }
+        }
+
+        transform_requests_.push_back(request);
+    }
+    transform_cv_.notify_all();
+
+    return result;
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::transform_worker() {
+    std::unique_lock<std::mutex> lock(transform_mutex_);
+
+    while (true) {
+        transform_cv_.wait(lock, [this]() {
+            return stop_transform_workers_ ||
+                (!transforms_paused_ && !transform_requests_.empty());
+        });
+        // finish the submitted transforms before stopping
+        if (transform_requests_.empty()) {
+            break;
+        }
+
+        // take a few documents from the first request (enough to not take
+        // the lock for every one of them) and move the request to the back
+        // so that the documents of the requests are interleaved
+        auto request = transform_requests_.front();
+        transform_requests_.pop_front();
+        size_t size = request->corpus->size();
+        long long nanoseconds = document_nanoseconds_.load(std::memory_order_relaxed);
+        size_t chunk = (nanoseconds > 0) ? CHUNK_NANOSECONDS / nanoseconds : 1;
+        chunk = std::min(chunk, (size - request->next) / (2 * transform_workers_.size()));
+        size_t begin = request->next;
+        size_t end = begin + std::max(chunk, size_t(1));
+        request->next = end;
+        if (end < size) {
+            transform_requests_.push_back(request);
+        }
+        active_transforms_++;
+        lock.unlock();
+
+        // the events stay queued since this is not the thread of the
+        // dispatcher (see SameThreadEventDispatcher)
+        size_t index = begin;
+        try {
+            for (; index<end; index++) {
+                auto vp = e_step_->doc_e_step(
+                    request->corpus->at(index),
+                    std::atomic_load(&model_parameters_)
+                );
+                request->gammas.col(index) = std::static_pointer_cast<
+                    parameters::VariationalParameters<Scalar>
+                >(vp)->gamma;
+            }
+        } catch (...) {
+            lock.lock();
+            if (!request->failed) {
+                request->failed = true;
+                transform_requests_.remove(request);
+                request->result.set_exception(std::current_exception());
+            }
+            lock.unlock();
+        }
+
+        lock.lock();
+        if (--active_transforms_ == 0 && transforms_paused_) {
+            transform_cv_.notify_all();
+        }
+        request->remaining -= index - begin;
+        if (index == end && request->remaining == 0 && !request->failed) {
+            request->result.set_value(std::move(request->gammas));
+        }
+    }
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::pause_transforms() {
+    std::unique_lock<std::mutex> lock(transform_mutex_);
+    transforms_paused_ = true;
+    transform_cv_.wait(lock, [this]() { return active_transforms_ == 0; });
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::resume_transforms() {
+    {
+        std::lock_guard<std::mutex> lock(transform_mutex_);
+        transforms_paused_ = false;
+    }
+    transform_cv_.notify_all();
 }
 
 
@@ -184,6 +862,24 @@ typename LDA<Scalar>::MatrixX LDA<Scalar>::decision_function(const Eigen::Matrix
 
 template <typename Scalar>
 typename LDA<Scalar>::MatrixX LDA<Scalar>::decision_function(const MatrixX &X) {
+    auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(
+        std::atomic_load(&model_parameters_)
+    );
+
+    MatrixX scores(model->eta.cols(), X.cols());
+    compute_decision_function(X, scores);
+
+    return scores;
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::compute_decision_function(
+    const Eigen::Ref<const MatrixX> &gammas,
+    Eigen::Ref<MatrixX> scores
+) {
+    wait_for_m_steps();
+
     // this function requires a supervised LDA so let's cast our models
     // parameters accordingly
     auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(
@@ -192,11 +888,15 @@ typename LDA<Scalar>::MatrixX LDA<Scalar>::decision_function(const MatrixX &X) {
 
     // the linear model is trained on
     // E_q[\bar z] = \fraction{\gamma - \alpha}{\sum_i \gamma_i}
-    MatrixX expected_z_bar = X.colwise() - model->alpha;
-    expected_z_bar.array().rowwise() /= expected_z_bar.array().colwise().sum();
-
-    // finally return the linear scores like a boss
-    return model->eta.transpose() * expected_z_bar;
+    // so instead of computing it we distribute the product with eta
+    // \eta^T E_q[\bar z] = \fraction{\eta^T \gamma - \eta^T \alpha}{\sum_i \gamma_i - \alpha_i}
+    VectorX eta_alpha = model->eta.transpose() * model->alpha;
+    Scalar alpha_sum = model->alpha.sum();
+    scores.noalias() = model->eta.transpose() * gammas;
+    for (int d=0; d<scores.cols(); d++) {
+        scores.col(d) -= eta_alpha;
+        scores.col(d) /= gammas.col(d).sum() - alpha_sum;
+    }
 }
 
 
@@ -209,12 +909,20 @@ Eigen::VectorXi LDA<Scalar>::predict(const Eigen::MatrixXi &X) {
 template <typename Scalar>
 Eigen::VectorXi LDA<Scalar>::predict(const MatrixX &scores) {
     Eigen::VectorXi predictions(scores.cols());
+    compute_predictions(scores, predictions);
+
+    return predictions;
+}
+
 
+template <typename Scalar>
+void LDA<Scalar>::compute_predictions(
+    const Eigen::Ref<const MatrixX> &scores,
+    Eigen::Ref<Eigen::VectorXi> predictions
+) {
     for (int d=0; d<scores.cols(); d++) {
         scores.col(d).maxCoeff( &predictions[d] );
     }
-
-    return predictions;
 }
 
 
@@ -229,49 +937,348 @@ std::tuple<typename LDA<Scalar>::MatrixX, Eigen::VectorXi> LDA<Scalar>::transfor
 }
 
 
+/**
+ * Compute the class scores of a document from its gamma like
+ * LDA::compute_decision_function() given eta^T alpha and the sum of alpha.
+ */
 template <typename Scalar>
-void LDA<Scalar>::create_worker_pool() {
-    for (auto & t : workers_) {
-        t = std::thread(
-            std::bind(&LDA<Scalar>::doc_e_step_worker, this)
+static void document_scores(
+    const parameters::SupervisedModelParameters<Scalar> &model,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &eta_alpha,
+    Scalar alpha_sum,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &gamma,
+    Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1> > scores
+) {
+    scores.noalias() = model.eta.transpose() * gamma;
+    scores -= eta_alpha;
+    scores /= gamma.sum() - alpha_sum;
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::decision_function(
+    const Eigen::MatrixXi &X,
+    Eigen::Ref<MatrixX> scores
+) {
+    auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(
+        std::atomic_load(&model_parameters_)
+    );
+    if (scores.rows() != model->eta.cols() || scores.cols() != X.cols()) {
+        throw std::invalid_argument("The scores should be a classes x "
+                                    "documents matrix");
+    }
+
+    VectorX eta_alpha = model->eta.transpose() * model->alpha;
+    Scalar alpha_sum = model->alpha.sum();
+    transform_documents(X, [&](size_t d, const VectorX &gamma) {
+        document_scores<Scalar>(*model, eta_alpha, alpha_sum, gamma, scores.col(d));
+    });
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::predict(
+    const Eigen::MatrixXi &X,
+    Eigen::Ref<Eigen::VectorXi> predictions
+) {
+    auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(
+        std::atomic_load(&model_parameters_)
+    );
+    if (predictions.rows() != X.cols()) {
+        throw std::invalid_argument("There should be a prediction per "
+                                    "document");
+    }
+
+    VectorX eta_alpha = model->eta.transpose() * model->alpha;
+    Scalar alpha_sum = model->alpha.sum();
+    VectorX scores(model->eta.cols());
+    transform_documents(X, [&](size_t d, const VectorX &gamma) {
+        document_scores<Scalar>(*model, eta_alpha, alpha_sum, gamma, scores);
+        scores.maxCoeff(&predictions[d]);
+    });
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::transform_predict(
+    const Eigen::MatrixXi &X,
+    Eigen::Ref<MatrixX> gammas,
+    Eigen::Ref<Eigen::VectorXi> predictions
+) {
+    auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(
+        std::atomic_load(&model_parameters_)
+    );
+    if (gammas.rows() != model->alpha.rows() || gammas.cols() != X.cols()) {
+        throw std::invalid_argument("The gammas should be a topics x documents "
+                                    "matrix");
+    }
+    if (predictions.rows() != X.cols()) {
+        throw std::invalid_argument("There should be a prediction per "
+                                    "document");
+    }
+
+    VectorX eta_alpha = model->eta.transpose() * model->alpha;
+    Scalar alpha_sum = model->alpha.sum();
+    VectorX scores(model->eta.cols());
+    transform_documents(X, [&](size_t d, const VectorX &gamma) {
+        gammas.col(d) = gamma;
+        document_scores<Scalar>(*model, eta_alpha, alpha_sum, gamma, scores);
+        scores.maxCoeff(&predictions[d]);
+    });
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::queue_documents(
+    std::shared_ptr<corpus::Corpus> corpus,
+    size_t start,
+    size_t end,
+    QueueOrder order
+) {
+    jobs_corpus_ = corpus;
+    jobs_.clear();
+    next_job_ = 0;
+    jobs_limit_ = std::numeric_limits<size_t>::max();
+
+    // With a single worker there is no tail to speak of
+    if (workers_.size() <= 1 || order == QueueOrder::InOrder) {
+        for (size_t i=start; i<end; i++) {
+            jobs_.push_back(i);
+        }
+        return;
+    }
+
+    // Estimate the cost of each expectation step. Every iteration is
+    // linear in the distinct words of the document and longer documents
+    // need more iterations to converge.
+    std::vector<std::pair<double, size_t> > costs;
+    costs.reserve(end - start);
+    double total_cost = 0;
+    for (size_t i=start; i<end; i++) {
+        size_t distinct_words, total_words;
+        corpus->count_words(i, distinct_words, total_words);
+        double cost = distinct_words * (1 + std::log1p(total_words));
+        costs.emplace_back(cost, i);
+        total_cost += cost;
+    }
+
+    // The documents that could keep a worker busy long after the others
+    // are done (more than 5% of the ideal epoch time or twice the average
+    // cost) are moved. The rest keep their order.
+    double threshold = (order != QueueOrder::Cost) ?
+        std::max(
+            total_cost / (20 * workers_.size()),
+            2 * total_cost / costs.size()
+        ) : 0;
+    auto long_end = std::stable_partition(
+        costs.begin(),
+        costs.end(),
+        [threshold](const std::pair<double, size_t> &c) {
+            return c.first > threshold;
+        }
+    );
+
+    // Either queue them evenly spaced among the rest, keeping their order
+    // too, so that the last one still has a share of the rest after it
+    if (order == QueueOrder::LongSpread) {
+        size_t longs = long_end - costs.begin();
+        size_t total = costs.size();
+        auto next_long = costs.begin();
+        auto next_short = long_end;
+        for (size_t p=0; p<total; p++) {
+            bool take_long = next_long != long_end &&
+                p >= static_cast<size_t>(next_long - costs.begin()) * total / longs;
+            if (take_long || next_short == costs.end()) {
+                jobs_.push_back((next_long++)->second);
+            } else {
+                jobs_.push_back((next_short++)->second);
+            }
+        }
+        return;
+    }
+
+    // or first, longest first
+    std::stable_sort(
+        costs.begin(),
+        long_end,
+        [](const std::pair<double, size_t> &a, const std::pair<double, size_t> &b) {
+            return a.first > b.first;
+        }
+    );
+
+    for (auto &c : costs) {
+        jobs_.push_back(c.second);
+    }
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::create_worker_pool(bool doc_m_step, bool training) {
+    // the copies of the model would be stale right after the first
+    // minibatch of an online maximization step that changes the model in
+    // place, namely outside the deterministic windows
+    use_replicas_ = numa_ && numa_topology_.nodes() > 1 && !(
+        training &&
+        !doc_m_step &&
+        deterministic_window_ == 0 &&
+        m_step_->online_doc_m_step()
+    );
+    if (use_replicas_ && replicas_.empty()) {
+        for (size_t node=0; node<numa_topology_.nodes(); node++) {
+            replicas_.emplace_back(new NumaReplica());
+        }
+    }
+
+    for (size_t w=0; w<workers_.size(); w++) {
+        workers_[w] = std::thread(
+            std::bind(&LDA<Scalar>::doc_e_step_worker, this, doc_m_step, training, w)
         );
     }
 }
 
 
+template <typename Scalar>
+std::shared_ptr<parameters::Parameters> LDA<Scalar>::node_model(size_t node) {
+    auto model = std::atomic_load(&model_parameters_);
+    size_t version = model_version_.load();
+
+    NumaReplica &replica = *replicas_[node];
+    std::lock_guard<std::mutex> lock(replica.mutex);
+    if (replica.source != model || replica.version != version) {
+        replica.model = model->clone();
+        replica.source = model;
+        replica.version = version;
+    }
+
+    return replica.model;
+}
+
+
 template <typename Scalar>
 void LDA<Scalar>::destroy_worker_pool() {
     for (auto & t : workers_) {
         t.join();
     }
+    jobs_corpus_ = nullptr;
+}
+
+
+template <typename Scalar>
+size_t LDA<Scalar>::chunk_size() {
+    size_t claimed = std::min(next_job_.load(), jobs_.size());
+    size_t remaining = jobs_.size() - claimed;
+    long long nanoseconds = document_nanoseconds_.load(std::memory_order_relaxed);
+
+    // Claim enough documents to keep a worker busy for a while but leave
+    // enough of them for the rest of the workers towards the end
+    size_t chunk = (nanoseconds > 0) ? CHUNK_NANOSECONDS / nanoseconds : 1;
+    chunk = std::min(chunk, remaining / (2 * workers_.size()));
+
+    return std::max(chunk, size_t(1));
 }
 
 
 template <typename Scalar>
-void LDA<Scalar>::doc_e_step_worker() {
-    std::shared_ptr<corpus::Corpus> corpus;
-    size_t index;
+void LDA<Scalar>::doc_e_step_worker(bool doc_m_step, bool training, size_t worker) {
+    // spread the workers over the NUMA nodes and read the model from the
+    // replica of their node
+    size_t node = 0;
+    if (numa_) {
+        node = worker % numa_topology_.nodes();
+        numa_topology_.pin_to_node(node);
+    }
+
+    // a single copy of the corpus pointer for all the jobs
+    std::shared_ptr<corpus::Corpus> corpus = jobs_corpus_;
+    bool selective = training && selective_update_;
+    // only the training documents may use the gamma cache, the documents
+    // of other corpora would collide with their ids
+    em::GammaCache<Scalar> *gamma_cache = (training) ? gamma_cache_.get() : nullptr;
+    std::list<std::tuple<std::shared_ptr<parameters::Parameters>, size_t> > results;
 
     while (true) {
-        // extract a job
-        {
-            std::lock_guard<std::mutex> lock(queue_in_mutex_);
-            if (queue_in_.empty())
-                break;
-            std::tie(corpus, index) = queue_in_.front();
-            queue_in_.pop_front();
+        // claim a chunk of jobs
+        size_t chunk = chunk_size();
+        size_t begin = next_job_.fetch_add(chunk);
+        if (begin >= jobs_.size())
+            break;
+        size_t end = std::min(begin + chunk, jobs_.size());
+        auto start_time = std::chrono::steady_clock::now();
+        std::shared_ptr<parameters::Parameters> replica = (use_replicas_) ?
+            node_model(node) : nullptr;
+
+        for (size_t j=begin; j<end; j++) {
+            size_t index = jobs_[j];
+
+            // hand over the finished documents and wait for the reader of
+            // a streaming transform to catch up (not counting the wait in
+            // the time per document)
+            if (j >= jobs_limit_.load()) {
+                {
+                    std::lock_guard<std::mutex> lock(queue_out_mutex_);
+                    queue_out_.splice(queue_out_.end(), results);
+                }
+                queue_out_cv_.notify_one();
+
+                auto wait_start = std::chrono::steady_clock::now();
+                std::unique_lock<std::mutex> lock(jobs_limit_mutex_);
+                jobs_limit_cv_.wait(lock, [this, j]() { return j < jobs_limit_.load(); });
+                start_time += std::chrono::steady_clock::now() - wait_start;
+            }
+
+            // do said job (unless the document has converged and its cached
+            // variational parameters can be used instead)
+            auto doc = corpus->at(index);
+            std::shared_ptr<parameters::Parameters> vp;
+            if (selective) {
+                vp = selective_update_->get(*doc);
+            }
+            if (!vp) {
+                auto parameters = (replica) ?
+                    replica : std::atomic_load(&model_parameters_);
+                vp = (gamma_cache) ?
+                    e_step_->cached_doc_e_step(doc, parameters, *gamma_cache) :
+                    e_step_->doc_e_step(doc, parameters);
+                if (selective) {
+                    selective_update_->put(*doc, vp);
+                }
+            }
+            if (doc_m_step) {
+                m_step_->doc_m_step(
+                    doc,
+                    vp,
+                    std::atomic_load(&model_parameters_)  // output
+                );
+            }
+
+            // the transforms only need gamma, do not keep phi around
+            if (!training) {
+                vp = std::make_shared<parameters::VariationalParameters<Scalar> >(
+                    std::move(std::static_pointer_cast<
+                        parameters::VariationalParameters<Scalar>
+                    >(vp)->gamma),
+                    MatrixX()
+                );
+            }
+
+            results.emplace_back(vp, index);
         }
 
-        // do said job
-        auto vp = e_step_->doc_e_step(
-            corpus->at(index),
-            model_parameters_
+        // keep a moving average of the time per document to size the
+        // next chunks (the updates may race, it is only an estimate)
+        long long nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_time
+        ).count() / (end - begin);
+        long long average = document_nanoseconds_.load(std::memory_order_relaxed);
+        document_nanoseconds_.store(
+            (average > 0) ? (3 * average + nanoseconds) / 4 : nanoseconds,
+            std::memory_order_relaxed
         );
 
         // show some results
         {
             std::lock_guard<std::mutex> lock(queue_out_mutex_);
-            queue_out_.emplace_back(vp, index);
+            queue_out_.splice(queue_out_.end(), results);
         }
         // talk about those results
         queue_out_cv_.notify_one();
@@ -281,11 +1288,15 @@ void LDA<Scalar>::doc_e_step_worker() {
 
 template <typename Scalar>
 std::tuple<std::shared_ptr<parameters::Parameters>, size_t> LDA<Scalar>::extract_vp_from_queue() {
-    std::unique_lock<std::mutex> lock(queue_out_mutex_);
-    queue_out_cv_.wait(lock, [this](){ return !queue_out_.empty(); });
+    // take all the available results at once
+    if (results_.empty()) {
+        std::unique_lock<std::mutex> lock(queue_out_mutex_);
+        queue_out_cv_.wait(lock, [this](){ return !queue_out_.empty(); });
+        results_.splice(results_.end(), queue_out_);
+    }
 
-    auto f = queue_out_.front();
-    queue_out_.pop_front();
+    auto f = results_.front();
+    results_.pop_front();
 
     return f;
 }
@@ -5,8 +5,10 @@
 #include "ldaplusplus/em/FastSupervisedMStep.hpp"
 #include "ldaplusplus/em/MultinomialSupervisedEStep.hpp"
 #include "ldaplusplus/em/MultinomialSupervisedMStep.hpp"
+#include "ldaplusplus/em/QuantizedEStep.hpp"
 #include "ldaplusplus/em/SemiSupervisedEStep.hpp"
 #include "ldaplusplus/em/SemiSupervisedMStep.hpp"
+#include "ldaplusplus/em/SparseEStep.hpp"
 #include "ldaplusplus/em/SupervisedEStep.hpp"
 #include "ldaplusplus/em/SupervisedMStep.hpp"
 #include "ldaplusplus/em/UnsupervisedEStep.hpp"
@@ -19,8 +21,16 @@ template <typename Scalar>
 LDABuilder<Scalar>::LDABuilder()
     : iterations_(20),
       workers_(std::thread::hardware_concurrency()),
+      staleness_(0),
+      deterministic_window_(0),
+      gamma_cache_documents_(0),
+      selective_tolerance_(0),
+      selective_skip_epochs_(0),
+      selective_full_pass_every_(0),
+      numa_(false),
       e_step_(std::make_shared<em::UnsupervisedEStep<Scalar> >()),
       m_step_(std::make_shared<em::UnsupervisedMStep<Scalar> >()),
+      e_step_for_topics_(classic_e_step_for_topics(10, 1e-2, 1.0, 0)),
       model_parameters_(
         std::make_shared<parameters::SupervisedModelParameters<Scalar> >()
       ),
@@ -56,6 +66,35 @@ std::shared_ptr<em::EStepInterface<Scalar> > LDABuilder<Scalar>::get_classic_e_s
     );
 }
 
+template <typename Scalar>
+typename LDABuilder<Scalar>::EStepForTopics LDABuilder<Scalar>::classic_e_step_for_topics(
+    size_t e_step_iterations,
+    Scalar e_step_tolerance,
+    Scalar compute_likelihood,
+    int random_state
+) {
+    return [=](size_t topics) -> std::shared_ptr<em::EStepInterface<Scalar> > {
+        switch (topics) {
+            case 16:
+                return std::make_shared<em::UnsupervisedEStep<Scalar, 16> >(
+                    e_step_iterations, e_step_tolerance, compute_likelihood, random_state
+                );
+            case 32:
+                return std::make_shared<em::UnsupervisedEStep<Scalar, 32> >(
+                    e_step_iterations, e_step_tolerance, compute_likelihood, random_state
+                );
+            case 64:
+                return std::make_shared<em::UnsupervisedEStep<Scalar, 64> >(
+                    e_step_iterations, e_step_tolerance, compute_likelihood, random_state
+                );
+            default:
+                return std::make_shared<em::UnsupervisedEStep<Scalar> >(
+                    e_step_iterations, e_step_tolerance, compute_likelihood, random_state
+                );
+        }
+    };
+}
+
 template <typename Scalar>
 std::shared_ptr<em::EStepInterface<Scalar> > LDABuilder<Scalar>::get_supervised_e_step(
     size_t e_step_iterations,
@@ -91,6 +130,44 @@ std::shared_ptr<em::EStepInterface<Scalar> > LDABuilder<Scalar>::get_fast_superv
     );
 }
 
+template <typename Scalar>
+typename LDABuilder<Scalar>::EStepForTopics LDABuilder<Scalar>::fast_supervised_e_step_for_topics(
+    size_t e_step_iterations,
+    Scalar e_step_tolerance,
+    Scalar C,
+    Scalar compute_likelihood,
+    int random_state
+) {
+    return [=](size_t topics) -> std::shared_ptr<em::EStepInterface<Scalar> > {
+        switch (topics) {
+            case 16:
+                return std::make_shared<em::FastSupervisedEStep<Scalar, 16> >(
+                    e_step_iterations, e_step_tolerance, C,
+                    em::FastSupervisedEStep<Scalar, 16>::CWeightType::Constant,
+                    compute_likelihood, random_state
+                );
+            case 32:
+                return std::make_shared<em::FastSupervisedEStep<Scalar, 32> >(
+                    e_step_iterations, e_step_tolerance, C,
+                    em::FastSupervisedEStep<Scalar, 32>::CWeightType::Constant,
+                    compute_likelihood, random_state
+                );
+            case 64:
+                return std::make_shared<em::FastSupervisedEStep<Scalar, 64> >(
+                    e_step_iterations, e_step_tolerance, C,
+                    em::FastSupervisedEStep<Scalar, 64>::CWeightType::Constant,
+                    compute_likelihood, random_state
+                );
+            default:
+                return std::make_shared<em::FastSupervisedEStep<Scalar> >(
+                    e_step_iterations, e_step_tolerance, C,
+                    em::FastSupervisedEStep<Scalar>::CWeightType::Constant,
+                    compute_likelihood, random_state
+                );
+        }
+    };
+}
+
 template <typename Scalar>
 std::shared_ptr<em::EStepInterface<Scalar> > LDABuilder<Scalar>::get_semi_supervised_e_step(
     std::shared_ptr<em::EStepInterface<Scalar> > supervised_step,
@@ -145,6 +222,28 @@ std::shared_ptr<em::EStepInterface<Scalar> > LDABuilder<Scalar>::get_corresponde
     );
 }
 
+template <typename Scalar>
+std::shared_ptr<em::EStepInterface<Scalar> > LDABuilder<Scalar>::get_quantized_e_step(
+    size_t e_step_iterations,
+    Scalar e_step_tolerance
+) {
+    return std::make_shared<em::QuantizedEStep<Scalar> >(
+        e_step_iterations,
+        e_step_tolerance
+    );
+}
+
+template <typename Scalar>
+std::shared_ptr<em::EStepInterface<Scalar> > LDABuilder<Scalar>::get_sparse_e_step(
+    size_t e_step_iterations,
+    Scalar e_step_tolerance
+) {
+    return std::make_shared<em::SparseEStep<Scalar> >(
+        e_step_iterations,
+        e_step_tolerance
+    );
+}
+
 template <typename Scalar>
 std::shared_ptr<em::MStepInterface<Scalar> > LDABuilder<Scalar>::get_classic_m_step() {
     return std::make_shared<em::UnsupervisedMStep<Scalar> >();
@@ -183,7 +282,8 @@ std::shared_ptr<em::MStepInterface<Scalar> > LDABuilder<Scalar>::get_fast_superv
     size_t minibatch_size,
     Scalar eta_momentum,
     Scalar eta_learning_rate,
-    Scalar beta_weight
+    Scalar beta_weight,
+    bool hogwild
 ) {
     return std::make_shared<em::FastOnlineSupervisedMStep<Scalar> >(
         num_classes,
@@ -191,7 +291,8 @@ std::shared_ptr<em::MStepInterface<Scalar> > LDABuilder<Scalar>::get_fast_superv
         minibatch_size,
         eta_momentum,
         eta_learning_rate,
-        beta_weight
+        beta_weight,
+        hogwild
     );
 }
 
@@ -202,7 +303,8 @@ std::shared_ptr<em::MStepInterface<Scalar> > LDABuilder<Scalar>::get_fast_superv
     size_t minibatch_size,
     Scalar eta_momentum,
     Scalar eta_learning_rate,
-    Scalar beta_weight
+    Scalar beta_weight,
+    bool hogwild
 ) {
     // Construct an Eigen Matrix and copy the weights
     Eigen::Matrix<Scalar, Eigen::Dynamic, 1> weights(class_weights.size());
@@ -216,7 +318,8 @@ std::shared_ptr<em::MStepInterface<Scalar> > LDABuilder<Scalar>::get_fast_superv
         minibatch_size,
         eta_momentum,
         eta_learning_rate,
-        beta_weight
+        beta_weight,
+        hogwild
     );
 }
 
@@ -227,7 +330,8 @@ std::shared_ptr<em::MStepInterface<Scalar> > LDABuilder<Scalar>::get_fast_superv
     size_t minibatch_size,
     Scalar eta_momentum,
     Scalar eta_learning_rate,
-    Scalar beta_weight
+    Scalar beta_weight,
+    bool hogwild
 ) {
     return std::make_shared<em::FastOnlineSupervisedMStep<Scalar> >(
         class_weights,
@@ -235,7 +339,8 @@ std::shared_ptr<em::MStepInterface<Scalar> > LDABuilder<Scalar>::get_fast_superv
         minibatch_size,
         eta_momentum,
         eta_learning_rate,
-        beta_weight
+        beta_weight,
+        hogwild
     );
 }
 
@@ -380,6 +485,48 @@ LDABuilder<Scalar> & LDABuilder<Scalar>::initialize_eta_uniform(
     return *this;
 }
 
+template <typename Scalar>
+void LDABuilder<Scalar>::check_inference_model() const {
+    bool quantized_model = static_cast<bool>(
+        std::dynamic_pointer_cast<parameters::QuantizedModelParameters<Scalar> >(
+            inference_model_parameters_
+        )
+    );
+    bool quantized_e_step = static_cast<bool>(
+        std::dynamic_pointer_cast<em::QuantizedEStep<Scalar> >(e_step_)
+    );
+    if (quantized_model != quantized_e_step) {
+        throw std::runtime_error("A quantized model can only be used with "
+                                 "set_quantized_e_step() and vice versa");
+    }
+
+    bool sparse_model = static_cast<bool>(
+        std::dynamic_pointer_cast<parameters::SparseModelParameters<Scalar> >(
+            inference_model_parameters_
+        )
+    );
+    bool sparse_e_step = static_cast<bool>(
+        std::dynamic_pointer_cast<em::SparseEStep<Scalar> >(e_step_)
+    );
+    if (sparse_model != sparse_e_step) {
+        throw std::runtime_error("A sparse model can only be used with "
+                                 "set_sparse_e_step() and vice versa");
+    }
+
+    bool mapped_model = static_cast<bool>(
+        std::dynamic_pointer_cast<parameters::MappedModelParameters<Scalar> >(
+            inference_model_parameters_
+        )
+    );
+    bool classic_e_step = static_cast<bool>(
+        std::dynamic_pointer_cast<em::UnsupervisedEStep<Scalar> >(e_step_)
+    );
+    if (mapped_model && !classic_e_step) {
+        throw std::runtime_error("A mapped model can only be used with "
+                                 "set_classic_e_step()");
+    }
+}
+
 // Just the template instantiations all the rest is defined in the headers.
 template class LDABuilder<float>;
 template class LDABuilder<double>;
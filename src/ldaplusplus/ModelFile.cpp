@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ldaplusplus/ModelFile.hpp"
+
+namespace ldaplusplus {
+namespace model_file {
+
+
+static size_t align(size_t offset) {
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+
+uint64_t checksum(const char *data, size_t bytes) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i=0; i<bytes; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+
+template <typename Scalar>
+void save(
+    const std::string &path,
+    std::shared_ptr<parameters::Parameters> parameters,
+    bool row_major_beta,
+    bool checksums,
+    std::shared_ptr<const corpus::FeatureHasher> hasher
+) {
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMajorMatrixX;
+
+    auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
+        parameters
+    );
+    auto supervised_model = std::dynamic_pointer_cast<
+        parameters::SupervisedModelParameters<Scalar>
+    >(parameters);
+    bool has_eta = supervised_model && supervised_model->eta.size() > 0;
+
+    // gather the arrays to be written
+    RowMajorMatrixX beta_rows;
+    if (row_major_beta) {
+        beta_rows = model->beta;
+    }
+    std::vector<std::pair<SectionId, const char *> > arrays{
+        {Alpha, reinterpret_cast<const char *>(model->alpha.data())},
+        {Beta, reinterpret_cast<const char *>(
+            (row_major_beta) ? beta_rows.data() : model->beta.data()
+        )}
+    };
+    std::vector<size_t> sizes{
+        model->alpha.size() * sizeof(Scalar),
+        model->beta.size() * sizeof(Scalar)
+    };
+    if (has_eta) {
+        arrays.emplace_back(
+            Eta,
+            reinterpret_cast<const char *>(supervised_model->eta.data())
+        );
+        sizes.push_back(supervised_model->eta.size() * sizeof(Scalar));
+    }
+    uint64_t hashing[2];
+    if (hasher) {
+        hashing[0] = hasher->buckets();
+        hashing[1] = hasher->seed();
+        arrays.emplace_back(FeatureHashing, reinterpret_cast<const char *>(hashing));
+        sizes.push_back(sizeof(hashing));
+    }
+
+    // fill in the header and the table of contents
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::copy(MAGIC, MAGIC + sizeof(MAGIC), header.magic);
+    header.version = VERSION;
+    header.scalar_size = sizeof(Scalar);
+    header.topics = model->beta.rows();
+    header.words = model->beta.cols();
+    header.classes = (has_eta) ? supervised_model->eta.cols() : 0;
+    header.sections = arrays.size();
+
+    std::vector<Section> sections(arrays.size());
+    size_t offset = align(sizeof(Header) + sections.size()*sizeof(Section));
+    for (size_t i=0; i<arrays.size(); i++) {
+        auto &s = sections[i];
+        s.id = arrays[i].first;
+        s.flags = 0;
+        if (s.id == Beta && row_major_beta) {
+            s.flags |= RowMajor;
+        }
+        s.offset = offset;
+        s.bytes = sizes[i];
+        s.checksum = 0;
+        if (checksums) {
+            s.flags |= HasChecksum;
+            s.checksum = checksum(arrays[i].second, s.bytes);
+        }
+        offset = align(offset + s.bytes);
+    }
+
+    // and write everything padding the sections with zeros
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Could not create " + path);
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(
+        reinterpret_cast<const char *>(sections.data()),
+        sections.size()*sizeof(Section)
+    );
+    const char zeros[ALIGNMENT] = {0};
+    size_t written = sizeof(header) + sections.size()*sizeof(Section);
+    for (size_t i=0; i<arrays.size(); i++) {
+        out.write(zeros, sections[i].offset - written);
+        out.write(arrays[i].second, sections[i].bytes);
+        written = sections[i].offset + sections[i].bytes;
+    }
+    out.write(zeros, align(written) - written);
+
+    if (!out) {
+        throw std::runtime_error("Could not write " + path);
+    }
+}
+
+
+template <typename Scalar>
+MappedModel<Scalar>::MappedModel(const std::string &path, bool verify_checksums) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not stat " + path);
+    }
+    size_ = st.st_size;
+    if (size_ < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error(path + " is not a model file");
+    }
+    void *mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map " + path);
+    }
+    mapping_ = static_cast<const char *>(mapping);
+    header_ = reinterpret_cast<const Header *>(mapping_);
+    sections_ = reinterpret_cast<const Section *>(mapping_ + sizeof(Header));
+
+    // validate everything before handing out any pointers
+    try {
+        if (!std::equal(MAGIC, MAGIC + sizeof(MAGIC), header_->magic)) {
+            throw std::runtime_error(path + " is not a model file");
+        }
+        if (header_->version != VERSION) {
+            throw std::runtime_error("Unsupported model file version");
+        }
+        if (header_->scalar_size != sizeof(Scalar)) {
+            throw std::runtime_error("The model file was written with a "
+                                     "different precision");
+        }
+        if (header_->sections > (size_ - sizeof(Header)) / sizeof(Section)) {
+            throw std::runtime_error("The model file is truncated");
+        }
+        for (uint32_t i=0; i<header_->sections; i++) {
+            // the offsets and sizes come from the file so they are compared
+            // without computing their sum that could overflow
+            const Section &s = sections_[i];
+            if (s.offset % ALIGNMENT != 0 || s.offset > size_ ||
+                s.bytes > size_ - s.offset) {
+                throw std::runtime_error("The model file is truncated");
+            }
+            if (verify_checksums && (s.flags & HasChecksum) &&
+                checksum(mapping_ + s.offset, s.bytes) != s.checksum) {
+                throw std::runtime_error("The model file is corrupted");
+            }
+        }
+
+        // every section fits in the file so a rows x cols array whose
+        // size overflows cannot match it
+        auto expect = [this](SectionId id, uint64_t rows, uint64_t cols, bool required) {
+            const Section *s = section(id);
+            if (s == nullptr) {
+                if (required || (rows > 0 && cols > 0)) {
+                    throw std::runtime_error("The model file sections do not "
+                                             "match its dimensions");
+                }
+                return;
+            }
+            uint64_t max_elements = size_ / sizeof(Scalar);
+            if ((rows > 0 && cols > max_elements / rows) ||
+                s->bytes != rows*cols*sizeof(Scalar)) {
+                throw std::runtime_error("The model file sections do not "
+                                         "match its dimensions");
+            }
+        };
+        expect(Alpha, header_->topics, 1, true);
+        expect(Beta, header_->topics, header_->words, true);
+        expect(Eta, header_->topics, header_->classes, false);
+        const Section *hashing = section(FeatureHashing);
+        if (hashing != nullptr && hashing->bytes != 2*sizeof(uint64_t)) {
+            throw std::runtime_error("The model file contains an invalid "
+                                     "feature hashing section");
+        }
+    } catch (...) {
+        munmap(const_cast<char *>(mapping_), size_);
+        throw;
+    }
+}
+
+
+template <typename Scalar>
+MappedModel<Scalar>::~MappedModel() {
+    munmap(const_cast<char *>(mapping_), size_);
+}
+
+
+template <typename Scalar>
+const Section * MappedModel<Scalar>::section(SectionId id) const {
+    for (uint32_t i=0; i<header_->sections; i++) {
+        if (sections_[i].id == static_cast<uint32_t>(id)) {
+            return &sections_[i];
+        }
+    }
+
+    return nullptr;
+}
+
+
+template <typename Scalar>
+const Scalar * MappedModel<Scalar>::data(SectionId id) const {
+    const Section *s = section(id);
+
+    return (s) ? reinterpret_cast<const Scalar *>(mapping_ + s->offset) : nullptr;
+}
+
+
+template <typename Scalar>
+bool MappedModel<Scalar>::row_major_beta() const {
+    const Section *s = section(Beta);
+
+    return s != nullptr && (s->flags & RowMajor);
+}
+
+
+template <typename Scalar>
+typename MappedModel<Scalar>::ConstVectorMap MappedModel<Scalar>::alpha() const {
+    return ConstVectorMap(data(Alpha), topics());
+}
+
+
+template <typename Scalar>
+typename MappedModel<Scalar>::ConstStridedMatrixMap MappedModel<Scalar>::beta() const {
+    // the element (k, w) is at k*inner + w*outer
+    size_t K = topics(), V = words();
+    return ConstStridedMatrixMap(
+        data(Beta),
+        K,
+        V,
+        (row_major_beta()) ?
+            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(1, V) :
+            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(K, 1)
+    );
+}
+
+
+template <typename Scalar>
+typename MappedModel<Scalar>::ConstMatrixMap MappedModel<Scalar>::eta() const {
+    return ConstMatrixMap(data(Eta), topics(), classes());
+}
+
+
+template <typename Scalar>
+std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > MappedModel<Scalar>::parameters() const {
+    return std::make_shared<parameters::SupervisedModelParameters<Scalar> >(
+        alpha(),
+        beta(),
+        eta()
+    );
+}
+
+
+template <typename Scalar>
+std::shared_ptr<parameters::MappedModelParameters<Scalar> > map_parameters(
+    const std::string &path
+) {
+    auto model = std::make_shared<const MappedModel<Scalar> >(path);
+    if (model->row_major_beta()) {
+        throw std::invalid_argument(path + " stores beta a topic after the "
+                                    "other and it cannot be viewed in place");
+    }
+
+    return std::make_shared<parameters::MappedModelParameters<Scalar> >(
+        model->alpha(),
+        model->beta().data(),
+        model->topics(),
+        model->words(),
+        model->eta(),
+        model
+    );
+}
+
+
+template <typename Scalar>
+std::shared_ptr<corpus::FeatureHasher> MappedModel<Scalar>::feature_hasher() const {
+    const Section *s = section(FeatureHashing);
+    if (s == nullptr) {
+        return nullptr;
+    }
+
+    const uint64_t *hashing = reinterpret_cast<const uint64_t *>(mapping_ + s->offset);
+    return std::make_shared<corpus::FeatureHasher>(hashing[0], hashing[1]);
+}
+
+
+bool is_model_file(const std::string &path) {
+    char magic[sizeof(MAGIC)];
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    in.read(magic, sizeof(magic));
+
+    return in && std::equal(MAGIC, MAGIC + sizeof(MAGIC), magic);
+}
+
+
+size_t scalar_size(const std::string &path) {
+    Header header;
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in || !std::equal(MAGIC, MAGIC + sizeof(MAGIC), header.magic)) {
+        throw std::runtime_error(path + " is not a model file");
+    }
+
+    return header.scalar_size;
+}
+
+
+// Template instantiation
+template void save<float>(
+    const std::string &,
+    std::shared_ptr<parameters::Parameters>,
+    bool,
+    bool,
+    std::shared_ptr<const corpus::FeatureHasher>
+);
+template void save<double>(
+    const std::string &,
+    std::shared_ptr<parameters::Parameters>,
+    bool,
+    bool,
+    std::shared_ptr<const corpus::FeatureHasher>
+);
+template class MappedModel<float>;
+template class MappedModel<double>;
+template std::shared_ptr<parameters::MappedModelParameters<float> > map_parameters<float>(
+    const std::string &
+);
+template std::shared_ptr<parameters::MappedModelParameters<double> > map_parameters<double>(
+    const std::string &
+);
+
+
+}  // namespace model_file
+}  // namespace ldaplusplus
@@ -1,3 +1,5 @@
+#include <cstdint>
+
 #include "ldaplusplus/e_step_utils.hpp"
 #include "ldaplusplus/utils.hpp"
 
@@ -6,11 +8,25 @@ namespace ldaplusplus {
 namespace e_step_utils {
 
 
+/**
+ * Views of the topic dimension of a K x N matrix (beta, eta, phi) with a
+ * compile time number of rows so that a specialization for small K can keep
+ * whole columns in registers. With Topics == Eigen::Dynamic they are plain
+ * views of the dynamic matrices.
+ */
+template <typename Scalar, int Topics>
+using ConstTopicsMap = Eigen::Map<const Eigen::Matrix<Scalar, Topics, Eigen::Dynamic> >;
+template <typename Scalar, int Topics>
+using TopicsMap = Eigen::Map<Eigen::Matrix<Scalar, Topics, Eigen::Dynamic>, 0, Eigen::OuterStride<> >;
+template <typename Scalar, int Topics>
+using ConstTopicsStridedMap = Eigen::Map<const Eigen::Matrix<Scalar, Topics, Eigen::Dynamic>, 0, Eigen::OuterStride<> >;
+
+
 template <typename Scalar>
 Scalar compute_unsupervised_likelihood(
     const VectorXi & X,
     const VectorX<Scalar> &alpha,
-    const MatrixX<Scalar> &beta,
+    const Ref<const MatrixX<Scalar> > &beta,
     const MatrixX<Scalar> &phi,
     const VectorX<Scalar> &gamma
 ) {
@@ -73,7 +89,7 @@ Scalar compute_supervised_likelihood(
     const VectorX<Scalar> &gamma,
     const VectorX<Scalar> &h
 ) {
-    Scalar likelihood = compute_unsupervised_likelihood(
+    Scalar likelihood = compute_unsupervised_likelihood<Scalar>(
         X,
         alpha,
         beta,
@@ -106,7 +122,7 @@ Scalar compute_supervised_multinomial_likelihood(
     Scalar mu,
     Scalar portion
 ) {
-    Scalar likelihood = compute_unsupervised_likelihood(
+    Scalar likelihood = compute_unsupervised_likelihood<Scalar>(
         X,
         alpha,
         beta,
@@ -140,7 +156,7 @@ Scalar compute_supervised_correspondence_likelihood(
     Scalar mu,
     Scalar portion
 ) {
-    Scalar likelihood = compute_unsupervised_likelihood(
+    Scalar likelihood = compute_unsupervised_likelihood<Scalar>(
         X,
         alpha,
         beta,
@@ -273,7 +289,7 @@ void compute_supervised_phi_gamma(
     }
 }
 
-template <typename Scalar>
+template <typename Scalar, int Topics>
 void compute_gamma(
     const VectorXi & X,
     const VectorX<Scalar> & alpha,
@@ -284,26 +300,34 @@ void compute_gamma(
     //
     // gamma = alpha.array() + (phi.array().rowwise() * X.cast<Scalar>().transpose().array()).rowwise().sum();
 
-    gamma = alpha;
-    math_utils::sum_cols_scaled(phi, X, gamma);
+    // With a fixed number of topics the accumulator lives in registers
+    Eigen::Matrix<Scalar, Topics, 1> g = alpha;
+    math_utils::sum_cols_scaled(ConstTopicsMap<Scalar, Topics>(phi.data(), phi.rows(), phi.cols()), X, g);
+    gamma = g;
 }
 
-template <typename Scalar>
+template <typename Scalar, int Topics>
 void compute_unsupervised_phi(
-    const MatrixX<Scalar> & beta,
+    const Ref<const MatrixX<Scalar> > & beta,
     const VectorX<Scalar> & gamma,
     Ref<MatrixX<Scalar> > phi
 ) {
     auto cwise_digamma = math_utils::CwiseDigamma<Scalar>();
     auto cwise_fast_exp = math_utils::CwiseFastExp<Scalar>();
 
-    auto exp_psi_gamma = gamma.unaryExpr(cwise_digamma).unaryExpr(cwise_fast_exp).array();
-    phi = beta.array().colwise() * exp_psi_gamma;
+    Eigen::Matrix<Scalar, Topics, 1> exp_psi_gamma = gamma.unaryExpr(cwise_digamma).unaryExpr(cwise_fast_exp);
+    TopicsMap<Scalar, Topics> phi_k(
+        phi.data(), phi.rows(), phi.cols(), Eigen::OuterStride<>(phi.outerStride())
+    );
+    ConstTopicsStridedMap<Scalar, Topics> beta_k(
+        beta.data(), beta.rows(), beta.cols(), Eigen::OuterStride<>(beta.outerStride())
+    );
+    phi_k = beta_k.array().colwise() * exp_psi_gamma.array();
     //phi = phi.array().rowwise() / phi.colwise().sum().array();
-    math_utils::normalize_cols(phi);
+    math_utils::normalize_cols(phi_k);
 }
 
-template <typename Scalar>
+template <typename Scalar, int Topics>
 void compute_supervised_approximate_phi(
     const VectorX<Scalar> & X_ratio,
     int num_words,
@@ -321,23 +345,27 @@ void compute_supervised_approximate_phi(
     auto cwise_digamma = math_utils::CwiseDigamma<Scalar>();
     auto cwise_fast_exp = math_utils::CwiseFastExp<Scalar>();
 
-    auto psi_gamma = gamma.unaryExpr(cwise_digamma).array();
-    VectorX<Scalar> z_bar = VectorX<Scalar>::Zero(phi.rows());
-    math_utils::sum_cols_scaled(phi, X_ratio, z_bar);
+    TopicsMap<Scalar, Topics> phi_k(
+        phi.data(), phi.rows(), phi.cols(), Eigen::OuterStride<>(phi.outerStride())
+    );
+    ConstTopicsMap<Scalar, Topics> eta_k(eta.data(), eta.rows(), eta.cols());
+
+    Eigen::Matrix<Scalar, Topics, 1> psi_gamma = gamma.unaryExpr(cwise_digamma);
+    Eigen::Matrix<Scalar, Topics, 1> z_bar = Eigen::Matrix<Scalar, Topics, 1>::Zero(phi.rows());
+    math_utils::sum_cols_scaled(phi_k, X_ratio, z_bar);
 
-    VectorX<Scalar> softmax_eta_z = (eta.transpose() * z_bar).unaryExpr(cwise_fast_exp);
+    VectorX<Scalar> softmax_eta_z = (eta_k.transpose() * z_bar).unaryExpr(cwise_fast_exp);
     softmax_eta_z = softmax_eta_z / softmax_eta_z.sum();
 
     Scalar max_eta = eta.maxCoeff();
-    MatrixX<Scalar> eta_scaled = eta;
-    if (max_eta > 0)
-        eta_scaled /= max_eta;
+    Scalar eta_scale = (max_eta > 0) ? max_eta : 1;
 
-    phi = beta.array().colwise() * (
-        psi_gamma + C*(eta_scaled.col(y) - eta_scaled * softmax_eta_z).array()
-    ).unaryExpr(cwise_fast_exp).array();
+    Eigen::Matrix<Scalar, Topics, 1> exp_weight = (
+        psi_gamma.array() + (C / eta_scale)*(eta_k.col(y) - eta_k * softmax_eta_z).array()
+    ).unaryExpr(cwise_fast_exp);
+    phi_k = ConstTopicsMap<Scalar, Topics>(beta.data(), beta.rows(), beta.cols()).array().colwise() * exp_weight.array();
     //phi = phi.array().rowwise() / phi.colwise().sum().array();
-    math_utils::normalize_cols(phi);
+    math_utils::normalize_cols(phi_k);
 }
 
 template <typename Scalar>
@@ -401,18 +429,107 @@ void compute_supervised_correspondence_tau(
     math_utils::normalize_cols(tau);
 }
 
+void nonzero_words(const VectorXi & X, VectorXi & words, VectorXi & counts) {
+    words.resize(X.rows());
+    int nnz = 0;
+    for (int w=0; w<X.rows(); w++) {
+        if (X[w] > 0) {
+            words[nnz++] = w;
+        }
+    }
+    words.conservativeResize(nnz);
+    counts.resize(nnz);
+    for (int n=0; n<nnz; n++) {
+        counts[n] = X[words[n]];
+    }
+}
+
+template <typename Scalar>
+void compute_quantized_phi(
+    const Eigen::Matrix<Eigen::half, Eigen::Dynamic, Eigen::Dynamic> & beta,
+    const VectorX<Scalar> & beta_scale,
+    const VectorXi & words,
+    const VectorX<Scalar> & gamma,
+    Ref<MatrixX<Scalar> > phi
+) {
+    auto cwise_digamma = math_utils::CwiseDigamma<Scalar>();
+    auto cwise_fast_exp = math_utils::CwiseFastExp<Scalar>();
+
+    // fold the per topic scale into the per topic weight so that a single
+    // multiplication per element is needed for dequantization
+    VectorX<Scalar> weight = gamma.unaryExpr(cwise_digamma).unaryExpr(cwise_fast_exp).cwiseProduct(beta_scale);
+    for (int n=0; n<words.rows(); n++) {
+        for (int k=0; k<beta.rows(); k++) {
+            phi(k, n) = static_cast<float>(beta(k, words[n])) * weight[k];
+        }
+    }
+    math_utils::normalize_cols(phi);
+}
+
+template <typename Scalar>
+void compute_quantized_phi(
+    const Eigen::Matrix<std::uint8_t, Eigen::Dynamic, Eigen::Dynamic> & beta,
+    const MatrixX<Scalar> & beta_levels,
+    const VectorXi & words,
+    const VectorX<Scalar> & gamma,
+    Ref<MatrixX<Scalar> > phi
+) {
+    auto cwise_digamma = math_utils::CwiseDigamma<Scalar>();
+    auto cwise_fast_exp = math_utils::CwiseFastExp<Scalar>();
+
+    VectorX<Scalar> weight = gamma.unaryExpr(cwise_digamma).unaryExpr(cwise_fast_exp);
+    for (int n=0; n<words.rows(); n++) {
+        for (int k=0; k<beta.rows(); k++) {
+            phi(k, n) = beta_levels(k, beta(k, words[n])) * weight[k];
+        }
+    }
+    math_utils::normalize_cols(phi);
+}
+
+template <typename Scalar>
+void compute_sparse_phi_gamma(
+    const Eigen::SparseMatrix<Scalar, Eigen::ColMajor> & beta,
+    const VectorXi & words,
+    const VectorXi & counts,
+    const VectorX<Scalar> & alpha,
+    Ref<VectorX<Scalar> > gamma
+) {
+    typedef typename Eigen::SparseMatrix<Scalar, Eigen::ColMajor>::InnerIterator TopicIterator;
+
+    auto cwise_digamma = math_utils::CwiseDigamma<Scalar>();
+    auto cwise_fast_exp = math_utils::CwiseFastExp<Scalar>();
+
+    VectorX<Scalar> exp_psi_gamma = gamma.unaryExpr(cwise_digamma).unaryExpr(cwise_fast_exp);
+    gamma = alpha;
+    for (int n=0; n<words.rows(); n++) {
+        // the normalization constant of phi_n
+        Scalar s = 0;
+        for (TopicIterator it(beta, words[n]); it; ++it) {
+            s += it.value() * exp_psi_gamma[it.row()];
+        }
+        if (s == 0) {
+            continue;
+        }
+
+        Scalar c = counts[n] / s;
+        for (TopicIterator it(beta, words[n]); it; ++it) {
+            gamma[it.row()] += c * it.value() * exp_psi_gamma[it.row()];
+        }
+    }
+}
+
 // Template instantiations
 template float compute_unsupervised_likelihood(
     const VectorXi & X,
     const VectorX<float> &alpha,
-    const MatrixX<float> &beta,
+    const Ref<const MatrixX<float> > &beta,
     const MatrixX<float> &phi,
     const VectorX<float> &gamma
 );
 template double compute_unsupervised_likelihood(
     const VectorXi & X,
     const VectorX<double> &alpha,
-    const MatrixX<double> &beta,
+    const Ref<const MatrixX<double> > &beta,
     const MatrixX<double> &phi,
     const VectorX<double> &gamma
 );
@@ -551,12 +668,12 @@ template void compute_gamma(
     Ref<VectorX<double> > gamma
 );
 template void compute_unsupervised_phi(
-    const MatrixX<float> & beta,
+    const Ref<const MatrixX<float> > & beta,
     const VectorX<float> & gamma,
     Ref<MatrixX<float> > phi
 );
 template void compute_unsupervised_phi(
-    const MatrixX<double> & beta,
+    const Ref<const MatrixX<double> > & beta,
     const VectorX<double> & gamma,
     Ref<MatrixX<double> > phi
 );
@@ -630,6 +747,80 @@ template void compute_supervised_correspondence_tau(
     const MatrixX<double> & phi,
     Ref<VectorX<double> > tau
 );
+template void compute_quantized_phi(
+    const Eigen::Matrix<Eigen::half, Eigen::Dynamic, Eigen::Dynamic> & beta,
+    const VectorX<float> & beta_scale,
+    const VectorXi & words,
+    const VectorX<float> & gamma,
+    Ref<MatrixX<float> > phi
+);
+template void compute_quantized_phi(
+    const Eigen::Matrix<Eigen::half, Eigen::Dynamic, Eigen::Dynamic> & beta,
+    const VectorX<double> & beta_scale,
+    const VectorXi & words,
+    const VectorX<double> & gamma,
+    Ref<MatrixX<double> > phi
+);
+template void compute_quantized_phi(
+    const Eigen::Matrix<std::uint8_t, Eigen::Dynamic, Eigen::Dynamic> & beta,
+    const MatrixX<float> & beta_levels,
+    const VectorXi & words,
+    const VectorX<float> & gamma,
+    Ref<MatrixX<float> > phi
+);
+template void compute_quantized_phi(
+    const Eigen::Matrix<std::uint8_t, Eigen::Dynamic, Eigen::Dynamic> & beta,
+    const MatrixX<double> & beta_levels,
+    const VectorXi & words,
+    const VectorX<double> & gamma,
+    Ref<MatrixX<double> > phi
+);
+template void compute_sparse_phi_gamma(
+    const Eigen::SparseMatrix<float, Eigen::ColMajor> & beta,
+    const VectorXi & words,
+    const VectorXi & counts,
+    const VectorX<float> & alpha,
+    Ref<VectorX<float> > gamma
+);
+template void compute_sparse_phi_gamma(
+    const Eigen::SparseMatrix<double, Eigen::ColMajor> & beta,
+    const VectorXi & words,
+    const VectorXi & counts,
+    const VectorX<double> & alpha,
+    Ref<VectorX<double> > gamma
+);
+
+// Instantiate the kernels that are specialized for a fixed number of topics
+// (see LDABuilder for the dispatching at runtime)
+#define INSTANTIATE_FIXED_TOPICS_KERNELS(Scalar, Topics)        \
+template void compute_gamma<Scalar, Topics>(                    \
+    const VectorXi & X,                                         \
+    const VectorX<Scalar> & alpha,                              \
+    const MatrixX<Scalar> & phi,                                \
+    Ref<VectorX<Scalar> > gamma                                 \
+);                                                              \
+template void compute_unsupervised_phi<Scalar, Topics>(         \
+    const Ref<const MatrixX<Scalar> > & beta,                   \
+    const VectorX<Scalar> & gamma,                              \
+    Ref<MatrixX<Scalar> > phi                                   \
+);                                                              \
+template void compute_supervised_approximate_phi<Scalar, Topics>( \
+    const VectorX<Scalar> & X_ratio,                            \
+    int num_words,                                              \
+    int y,                                                      \
+    const MatrixX<Scalar> & beta,                               \
+    const MatrixX<Scalar> & eta,                                \
+    const VectorX<Scalar> & gamma,                              \
+    Scalar C,                                                   \
+    Ref<MatrixX<Scalar> > phi                                   \
+);
+INSTANTIATE_FIXED_TOPICS_KERNELS(float, 16)
+INSTANTIATE_FIXED_TOPICS_KERNELS(float, 32)
+INSTANTIATE_FIXED_TOPICS_KERNELS(float, 64)
+INSTANTIATE_FIXED_TOPICS_KERNELS(double, 16)
+INSTANTIATE_FIXED_TOPICS_KERNELS(double, 32)
+INSTANTIATE_FIXED_TOPICS_KERNELS(double, 64)
+#undef INSTANTIATE_FIXED_TOPICS_KERNELS
 
 }  // namespace e_step_utils
 }  // namespace ldaplusplus
@@ -1,3 +1,4 @@
+#include "ldaplusplus/checkpoint.hpp"
 #include "ldaplusplus/em/AbstractEStep.hpp"
 
 namespace ldaplusplus {
@@ -20,6 +21,18 @@ bool AbstractEStep<Scalar>::converged(
     return mean_change < tolerance;
 }
 
+template <typename Scalar>
+void AbstractEStep<Scalar>::save_state(std::ostream &os) const {
+    checkpoint::write_prng(os, random_.state());
+}
+
+template <typename Scalar>
+void AbstractEStep<Scalar>::load_state(std::istream &is) {
+    auto prng = random_.state();
+    checkpoint::read_prng(is, prng);
+    random_.set_state(prng);
+}
+
 // Template instantiation
 template class AbstractEStep<float>;
 template class AbstractEStep<double>;
@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <stdexcept>
 #include <utility>
 
+#include "ldaplusplus/checkpoint.hpp"
 #include "ldaplusplus/em/FastOnlineSupervisedMStep.hpp"
 #include "ldaplusplus/optimization/MultinomialLogisticRegression.hpp"
 #include "ldaplusplus/events/ProgressEvents.hpp"
@@ -15,7 +18,8 @@ FastOnlineSupervisedMStep<Scalar>::FastOnlineSupervisedMStep(
     size_t minibatch_size,
     Scalar eta_momentum,
     Scalar eta_learning_rate,
-    Scalar beta_weight
+    Scalar beta_weight,
+    bool hogwild
 ) : class_weights_(std::move(class_weights)),
     num_classes_(class_weights_.rows()),
     minibatch_size_(minibatch_size),
@@ -23,7 +27,10 @@ FastOnlineSupervisedMStep<Scalar>::FastOnlineSupervisedMStep(
     beta_weight_(beta_weight),
     eta_momentum_(eta_momentum),
     eta_learning_rate_(eta_learning_rate),
-    docs_seen_so_far_(0)
+    docs_seen_so_far_(0),
+    hogwild_(hogwild),
+    hogwild_model_ready_(false),
+    hogwild_words_(0)
 {}
 
 template <typename Scalar>
@@ -33,14 +40,16 @@ FastOnlineSupervisedMStep<Scalar>::FastOnlineSupervisedMStep(
     size_t minibatch_size,
     Scalar eta_momentum,
     Scalar eta_learning_rate,
-    Scalar beta_weight
+    Scalar beta_weight,
+    bool hogwild
 ) : FastOnlineSupervisedMStep(
         VectorX::Constant(num_classes, 1),
         regularization_penalty,
         minibatch_size,
         eta_momentum,
         eta_learning_rate,
-        beta_weight
+        beta_weight,
+        hogwild
     )
 {}
 
@@ -59,6 +68,11 @@ void FastOnlineSupervisedMStep<Scalar>::doc_m_step(
     // Supervised model parameters
     const VectorX &alpha = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(m_parameters)->alpha;
 
+    if (hogwild_) {
+        hogwild_doc_m_step(X, y, phi, gamma, alpha, m_parameters);
+        return;
+    }
+
     // Initialize our variables
     if (b_.rows() == 0) {
         b_ = MatrixX::Zero(phi.rows(), phi.cols());
@@ -70,7 +84,7 @@ void FastOnlineSupervisedMStep<Scalar>::doc_m_step(
     }
 
     // Unsupervised sufficient statistics
-    b_.array() += phi.array().rowwise() * X.cast<Scalar>().transpose().array();
+    b_.leftCols(phi.cols()).array() += phi.array().rowwise() * X.cast<Scalar>().transpose().array();
 
     // Supervised suff stats
     expected_z_bar_.col(docs_seen_so_far_) = gamma - alpha;
@@ -85,16 +99,223 @@ void FastOnlineSupervisedMStep<Scalar>::doc_m_step(
         m_step(m_parameters);
 }
 
+template <typename Scalar>
+void FastOnlineSupervisedMStep<Scalar>::hogwild_doc_m_step(
+    const Eigen::VectorXi &X,
+    int y,
+    const MatrixX &phi,
+    const VectorX &gamma,
+    const VectorX &alpha,
+    std::shared_ptr<parameters::Parameters> m_parameters
+) {
+    // Take a minibatch that no other worker is filling
+    std::shared_ptr<Minibatch> minibatch;
+    {
+        std::lock_guard<std::mutex> lock(minibatches_mutex_);
+        if (this->get_transport()) {
+            throw std::runtime_error("The hogwild mode cannot be used with a "
+                                     "transport");
+        }
+
+        // the first document of the epoch copies the model
+        if (!hogwild_model_ready_) {
+            auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(m_parameters);
+            int topics = model->beta.rows();
+            hogwild_words_ = model->beta.cols();
+
+            // round the rows up to whole cache lines and add one more so
+            // that no two topics share a cache line
+            size_t line = 64 / sizeof(Scalar);
+            size_t stride = ((hogwild_words_ + line - 1) / line + 1) * line;
+            beta_rows_.resize(topics, stride);
+            beta_rows_.leftCols(hogwild_words_) = model->beta;
+            b_rows_ = RowMatrixX::Zero(topics, stride);
+            if (b_.rows() > 0) {
+                b_rows_.leftCols(hogwild_words_) = b_.leftCols(hogwild_words_);
+            }
+            hogwild_eta_ = model->eta;
+            if (eta_velocity_.rows() == 0) {
+                eta_velocity_ = MatrixX::Zero(topics, num_classes_);
+                eta_gradient_ = MatrixX::Zero(topics, num_classes_);
+            }
+            topic_locks_.reset(new PaddedMutex[topics]);
+            hogwild_model_ready_ = true;
+        }
+
+        if (minibatches_.empty()) {
+            minibatch = std::make_shared<Minibatch>();
+            minibatch->b = MatrixX::Zero(phi.rows(), phi.cols());
+            minibatch->expected_z_bar = MatrixX::Zero(phi.rows(), minibatch_size_);
+            minibatch->y = Eigen::VectorXi::Zero(minibatch_size_);
+            minibatch->docs = 0;
+        } else {
+            minibatch = minibatches_.back();
+            minibatches_.pop_back();
+        }
+    }
+
+    // Aggregate the sufficient statistics without any synchronization since
+    // no other worker has the minibatch
+    minibatch->b.array() += phi.array().rowwise() * X.cast<Scalar>().transpose().array();
+    minibatch->expected_z_bar.col(minibatch->docs) = gamma - alpha;
+    minibatch->expected_z_bar.col(minibatch->docs).array() /= minibatch->expected_z_bar.col(minibatch->docs).sum();
+    minibatch->y(minibatch->docs) = y;
+    minibatch->docs++;
+
+    if (minibatch->docs >= minibatch_size_) {
+        hogwild_update(
+            minibatch->b,
+            minibatch->expected_z_bar,
+            minibatch->y,
+            minibatch->docs
+        );
+        minibatch->b.setZero();
+        minibatch->docs = 0;
+
+        // the expectation steps switch to a snapshot of the updated model
+        if (this->can_publish_model()) {
+            std::lock_guard<std::mutex> lock(publish_lock_);
+            auto snapshot = m_parameters->clone();
+            copy_hogwild_model(snapshot);
+            this->publish_model(snapshot);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(minibatches_mutex_);
+    minibatches_.push_back(minibatch);
+}
+
+template <typename Scalar>
+void FastOnlineSupervisedMStep<Scalar>::hogwild_update(
+    const MatrixX &b,
+    const MatrixX &expected_z_bar,
+    const Eigen::VectorXi &y,
+    size_t docs
+) {
+    // update the topic distributions; b_rows_ accumulates the minibatches
+    // of all the workers
+    for (int k=0; k<beta_rows_.rows(); k++) {
+        std::lock_guard<std::mutex> lock(topic_locks_[k].mutex);
+        auto b_k = b_rows_.row(k).head(hogwild_words_);
+        auto beta_k = beta_rows_.row(k).head(hogwild_words_);
+        b_k += b.row(k);
+        beta_k = beta_weight_ * beta_k + (1-beta_weight_) * b_k / b_k.sum();
+    }
+
+    // update the eta (only the first docs documents are used because the
+    // leftover minibatches are partially filled)
+    MatrixX minibatch_z_bar = expected_z_bar.leftCols(docs);
+    Eigen::VectorXi minibatch_y = y.head(docs);
+    optimization::MultinomialLogisticRegression<Scalar> mlr(
+        minibatch_z_bar,
+        minibatch_y,
+        regularization_penalty_
+    );
+    std::lock_guard<std::mutex> lock(eta_lock_);
+    mlr.gradient(hogwild_eta_, eta_gradient_);
+    eta_velocity_ = eta_momentum_ * eta_velocity_ - eta_learning_rate_ * eta_gradient_;
+    hogwild_eta_ += eta_velocity_;
+    // minus the value to be minimized is the log likelihood
+    hogwild_log_py_.push_back(-mlr.value(hogwild_eta_));
+}
+
+template <typename Scalar>
+void FastOnlineSupervisedMStep<Scalar>::copy_hogwild_model(
+    std::shared_ptr<parameters::Parameters> parameters
+) {
+    auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(parameters);
+    for (int k=0; k<beta_rows_.rows(); k++) {
+        std::lock_guard<std::mutex> lock(topic_locks_[k].mutex);
+        model->beta.row(k) = beta_rows_.row(k).head(hogwild_words_);
+    }
+
+    std::lock_guard<std::mutex> lock(eta_lock_);
+    model->eta = hogwild_eta_;
+}
+
 template <typename Scalar>
 void FastOnlineSupervisedMStep<Scalar>::m_step(
     std::shared_ptr<parameters::Parameters> parameters
 ) {
+    if (hogwild_) {
+        // This is called at the end of an epoch when no worker is running
+        if (!hogwild_model_ready_) {
+            return;
+        }
+
+        // so apply what is left in the workers' minibatches
+        for (auto & m : minibatches_) {
+            if (m->docs > 0) {
+                hogwild_update(m->b, m->expected_z_bar, m->y, m->docs);
+            }
+        }
+        minibatches_.clear();
+
+        // write the private copy to the model and keep the statistics for
+        // the next epochs
+        copy_hogwild_model(parameters);
+        if (b_.rows() == 0) {
+            b_ = MatrixX::Zero(b_rows_.rows(), hogwild_words_);
+        }
+        b_.leftCols(hogwild_words_) = b_rows_.leftCols(hogwild_words_);
+        hogwild_model_ready_ = false;
+
+        // report the progress from this thread
+        for (auto log_py : hogwild_log_py_) {
+            this->get_event_dispatcher()->template dispatch<events::MaximizationProgressEvent<Scalar> >(
+                log_py
+            );
+        }
+        hogwild_log_py_.clear();
+
+        // and make sure that the updates left us with a consistent model
+        auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(parameters);
+        if (!model->beta.allFinite() || !model->eta.allFinite()) {
+            throw std::runtime_error("The hogwild updates resulted in a "
+                                     "non finite model");
+        }
+        model->beta.array().colwise() /= model->beta.array().rowwise().sum();
+
+        return;
+    }
+
     // Check whether we should actually perform the m_step
     if (docs_seen_so_far_ < minibatch_size_)
         return;
 
     docs_seen_so_far_ = 0;
 
+    // the minibatch consists of the documents of all the processes (b_
+    // keeps accumulating locally so we reduce a copy)
+    auto transport = this->get_transport();
+    size_t words = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(parameters)->beta.cols();
+    MatrixX global_b, global_expected_z_bar;
+    Eigen::VectorXi global_y;
+    if (transport) {
+        global_b = b_.leftCols(words);
+        global_expected_z_bar = expected_z_bar_;
+        global_y = y_;
+        transport->all_reduce_sum(global_b);
+        transport->all_gather_cols(global_expected_z_bar);
+        transport->all_gather_vector(global_y);
+    }
+    Eigen::Ref<const MatrixX> b = (transport) ?
+        Eigen::Ref<const MatrixX>(global_b) :
+        Eigen::Ref<const MatrixX>(b_.leftCols(words));
+    const MatrixX &expected_z_bar = (transport) ? global_expected_z_bar : expected_z_bar_;
+    const Eigen::VectorXi &y = (transport) ? global_y : y_;
+
+    update(b, expected_z_bar, y, expected_z_bar.cols(), parameters);
+}
+
+template <typename Scalar>
+void FastOnlineSupervisedMStep<Scalar>::update(
+    const Eigen::Ref<const MatrixX> &b,
+    const MatrixX &expected_z_bar,
+    const Eigen::VectorXi &y,
+    size_t docs,
+    std::shared_ptr<parameters::Parameters> parameters
+) {
     // Extract the parameters from the struct
     auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(parameters);
     MatrixX & beta = model->beta;
@@ -105,25 +326,130 @@ void FastOnlineSupervisedMStep<Scalar>::m_step(
     //       of Hoffman et al.
     beta.array() = (
         beta_weight_ * beta.array() +
-        (1-beta_weight_) * (b_.array().colwise() / b_.array().rowwise().sum())
+        (1-beta_weight_) * (b.array().colwise() / b.array().rowwise().sum())
     );
 
     // update the eta
+    MatrixX minibatch_z_bar = expected_z_bar.leftCols(docs);
+    Eigen::VectorXi minibatch_y = y.head(docs);
     optimization::MultinomialLogisticRegression<Scalar> mlr(
-        expected_z_bar_,
-        y_,
+        minibatch_z_bar,
+        minibatch_y,
         regularization_penalty_
     );
     mlr.gradient(eta, eta_gradient_);
     eta_velocity_ = eta_momentum_ * eta_velocity_ - eta_learning_rate_ * eta_gradient_;
     eta += eta_velocity_;
+    Scalar log_py = -mlr.value(eta);  // minus the value to be minimized is the log likelihood
 
     this->get_event_dispatcher()->template dispatch<events::MaximizationProgressEvent<Scalar> >(
-        -mlr.value(eta)  // minus the value to be minimized is the log likelihood
+        log_py
     );
 }
 
 
+template <typename Scalar>
+void FastOnlineSupervisedMStep<Scalar>::grow_vocabulary(
+    size_t words,
+    std::shared_ptr<parameters::Parameters> parameters
+) {
+    auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(parameters);
+    MatrixX & beta = model->beta;
+    size_t old_words = beta.cols();
+    if (words <= old_words) {
+        return;
+    }
+
+    // the new words get the uniform prior; appending columns to a column
+    // major matrix keeps the existing ones in place so the resize is a
+    // realloc of the buffer
+    beta.conservativeResize(Eigen::NoChange, words);
+
+    // the topics sum to one so with the prior of the new words they all sum
+    // to the same value and a single scale of the old words renormalizes
+    // them (without summing the rows first)
+    size_t new_words = words - old_words;
+    Scalar scale = Scalar(words) / (words + new_words);
+    beta.leftCols(old_words) *= scale;
+    beta.rightCols(new_words).setConstant(Scalar(1) / (words + new_words));
+
+    // the statistics are created by the first doc_m_step() with the right
+    // size, otherwise they grow geometrically
+    size_t capacity = b_.cols();
+    if (b_.rows() > 0 && capacity < words) {
+        b_.conservativeResize(Eigen::NoChange, std::max(words, 2*capacity));
+        b_.rightCols(b_.cols() - capacity).setZero();
+    }
+
+    // the minibatches of hogwild mode only live for an epoch
+    minibatches_.clear();
+}
+
+template <typename Scalar>
+void FastOnlineSupervisedMStep<Scalar>::save_state(std::ostream &os) const {
+    checkpoint::write_matrix(os, b_);
+    checkpoint::write_matrix(os, expected_z_bar_);
+    checkpoint::write_matrix(os, y_);
+    checkpoint::write_matrix(os, eta_velocity_);
+    checkpoint::write_matrix(os, eta_gradient_);
+    checkpoint::write<uint64_t>(os, docs_seen_so_far_);
+
+    // the partially filled minibatches of hogwild mode hold documents that
+    // have not been applied to the model yet
+    uint64_t partial = std::count_if(
+        minibatches_.begin(),
+        minibatches_.end(),
+        [](const std::shared_ptr<Minibatch> &m) { return m->docs > 0; }
+    );
+    checkpoint::write<uint64_t>(os, partial);
+    for (auto & m : minibatches_) {
+        if (m->docs > 0) {
+            checkpoint::write_matrix(os, m->b);
+            checkpoint::write_matrix(os, m->expected_z_bar);
+            checkpoint::write_matrix(os, m->y);
+            checkpoint::write<uint64_t>(os, m->docs);
+        }
+    }
+}
+
+template <typename Scalar>
+void FastOnlineSupervisedMStep<Scalar>::load_state(std::istream &is) {
+    checkpoint::read_matrix(is, b_);
+    checkpoint::read_matrix(is, expected_z_bar_);
+    checkpoint::read_matrix(is, y_);
+    checkpoint::read_matrix(is, eta_velocity_);
+    checkpoint::read_matrix(is, eta_gradient_);
+    docs_seen_so_far_ = checkpoint::read<uint64_t>(is);
+
+    if (expected_z_bar_.cols() > 0 &&
+        static_cast<size_t>(expected_z_bar_.cols()) != minibatch_size_) {
+        throw std::runtime_error("The checkpoint was saved with a different "
+                                 "minibatch size");
+    }
+
+    std::vector<std::shared_ptr<Minibatch> > minibatches(
+        checkpoint::read<uint64_t>(is)
+    );
+    for (auto & m : minibatches) {
+        m = std::make_shared<Minibatch>();
+        checkpoint::read_matrix(is, m->b);
+        checkpoint::read_matrix(is, m->expected_z_bar);
+        checkpoint::read_matrix(is, m->y);
+        m->docs = checkpoint::read<uint64_t>(is);
+        if (static_cast<size_t>(m->expected_z_bar.cols()) != minibatch_size_ ||
+            static_cast<size_t>(m->y.rows()) != minibatch_size_ ||
+            m->docs == 0 || m->docs >= minibatch_size_) {
+            throw std::runtime_error("The checkpoint was saved with a different "
+                                     "minibatch size");
+        }
+    }
+
+    // the private copy of hogwild mode is made again from the model and the
+    // restored minibatches are filled by the next documents
+    hogwild_model_ready_ = false;
+    minibatches_ = std::move(minibatches);
+}
+
 // Instantiations
 template class FastOnlineSupervisedMStep<float>;
 template class FastOnlineSupervisedMStep<double>;
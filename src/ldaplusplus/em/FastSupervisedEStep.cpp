@@ -1,5 +1,6 @@
 #include <cmath>
 
+#include "ldaplusplus/checkpoint.hpp"
 #include "ldaplusplus/events/ProgressEvents.hpp"
 #include "ldaplusplus/em/FastSupervisedEStep.hpp"
 #include "ldaplusplus/e_step_utils.hpp"
@@ -8,8 +9,8 @@ namespace ldaplusplus {
 namespace em {
 
 
-template <typename Scalar>
-FastSupervisedEStep<Scalar>::FastSupervisedEStep(
+template <typename Scalar, int Topics>
+FastSupervisedEStep<Scalar, Topics>::FastSupervisedEStep(
     size_t e_step_iterations,
     Scalar e_step_tolerance,
     Scalar C,
@@ -26,10 +27,28 @@ FastSupervisedEStep<Scalar>::FastSupervisedEStep(
     epochs_ = 0;
 }
 
-template <typename Scalar>
-std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar>::doc_e_step(
+template <typename Scalar, int Topics>
+std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar, Topics>::doc_e_step(
     const std::shared_ptr<corpus::Document> doc,
     const std::shared_ptr<parameters::Parameters> parameters
+) {
+    return doc_e_step(doc, parameters, nullptr);
+}
+
+template <typename Scalar, int Topics>
+std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar, Topics>::cached_doc_e_step(
+    const std::shared_ptr<corpus::Document> doc,
+    const std::shared_ptr<parameters::Parameters> parameters,
+    GammaCache<Scalar> &gamma_cache
+) {
+    return doc_e_step(doc, parameters, &gamma_cache);
+}
+
+template <typename Scalar, int Topics>
+std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar, Topics>::doc_e_step(
+    const std::shared_ptr<corpus::Document> doc,
+    const std::shared_ptr<parameters::Parameters> parameters,
+    GammaCache<Scalar> *gamma_cache
 ) {
     // Words form Document doc
     const Eigen::VectorXi &X = doc->get_words();
@@ -51,17 +70,21 @@ std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar>::doc_e_step(
     MatrixX phi = MatrixX::Constant(num_topics, voc_size, 1.0/num_topics);
     VectorX gamma = alpha.array() + static_cast<Scalar>(num_words)/num_topics;
 
+    // or start from the gamma of the previous epoch
+    bool warm_started = gamma_cache && gamma_cache->get(*doc, gamma);
+
     // to check for convergence
     VectorX gamma_old = VectorX::Zero(num_topics);
 
-    for (size_t iteration=0; iteration<e_step_iterations_; iteration++) {
+    size_t iteration = 0;
+    for (; iteration<e_step_iterations_; iteration++) {
         // check for early stopping
         if (this->converged(gamma_old, gamma, e_step_tolerance_)) {
             break;
         }
         gamma_old = gamma;
 
-        e_step_utils::compute_supervised_approximate_phi<Scalar>(
+        e_step_utils::compute_supervised_approximate_phi<Scalar, Topics>(
             X_ratio,
             num_words,
             y,
@@ -73,7 +96,11 @@ std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar>::doc_e_step(
         );
 
         // Equation (6) in Supervised topic models, Blei, McAulife 2008
-        e_step_utils::compute_gamma<Scalar>(X, alpha, phi, gamma);
+        e_step_utils::compute_gamma<Scalar, Topics>(X, alpha, phi, gamma);
+    }
+
+    if (gamma_cache) {
+        gamma_cache->put(*doc, gamma);
     }
 
     // notify that the e step has finished
@@ -88,24 +115,42 @@ std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar>::doc_e_step(
                 eta,
                 phi,
                 gamma
-            )
+            ),
+            iteration,
+            warm_started
         );
     } else {
-        this->get_event_dispatcher()->template dispatch<events::ExpectationProgressEvent<Scalar> >(NAN);
+        this->get_event_dispatcher()->template dispatch<events::ExpectationProgressEvent<Scalar> >(
+            NAN, iteration, warm_started
+        );
     }
 
     return std::make_shared<parameters::VariationalParameters<Scalar> >(gamma, phi);
 }
 
 
-template <typename Scalar>
-void FastSupervisedEStep<Scalar>::e_step() {
+template <typename Scalar, int Topics>
+void FastSupervisedEStep<Scalar, Topics>::e_step() {
     epochs_ ++;
 }
 
 
-template <typename Scalar>
-Scalar FastSupervisedEStep<Scalar>::get_weight() {
+template <typename Scalar, int Topics>
+void FastSupervisedEStep<Scalar, Topics>::save_state(std::ostream &os) const {
+    AbstractEStep<Scalar>::save_state(os);
+    checkpoint::write<int32_t>(os, epochs_);
+}
+
+
+template <typename Scalar, int Topics>
+void FastSupervisedEStep<Scalar, Topics>::load_state(std::istream &is) {
+    AbstractEStep<Scalar>::load_state(is);
+    epochs_ = checkpoint::read<int32_t>(is);
+}
+
+
+template <typename Scalar, int Topics>
+Scalar FastSupervisedEStep<Scalar, Topics>::get_weight() {
     switch (weight_type_) {
         case ExponentialDecay:
             return std::pow(C_, epochs_);
@@ -118,6 +163,12 @@ Scalar FastSupervisedEStep<Scalar>::get_weight() {
 // Template instantiation
 template class FastSupervisedEStep<float>;
 template class FastSupervisedEStep<double>;
+template class FastSupervisedEStep<float, 16>;
+template class FastSupervisedEStep<double, 16>;
+template class FastSupervisedEStep<float, 32>;
+template class FastSupervisedEStep<double, 32>;
+template class FastSupervisedEStep<float, 64>;
+template class FastSupervisedEStep<double, 64>;
 
 
 }  // namespace em
@@ -56,18 +56,38 @@ template <typename Scalar>
 void FastSupervisedMStep<Scalar>::m_step(
     std::shared_ptr<parameters::Parameters> parameters
 ) {
-    // Maximize w.r.t \beta during
-    UnsupervisedMStep<Scalar>::m_step(
-        parameters
-    );
-    MatrixX &eta = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(parameters)->eta;
+    if (!eta_only_) {
+        // Maximize w.r.t \beta during
+        UnsupervisedMStep<Scalar>::m_step(
+            parameters
+        );
+        gather_statistics();
+    }
 
+    maximize_eta(parameters);
+}
+
+template <typename Scalar>
+void FastSupervisedMStep<Scalar>::gather_statistics() {
     // resize the member variables to fit the documents we 've seen so far in
     // the doc_m_steps
     y_.conservativeResize(docs_);
     expected_z_bar_.conservativeResize(expected_z_bar_.rows(), docs_);
     docs_ = 0;
 
+    // every process fits eta to the documents of all the processes
+    if (auto transport = this->get_transport()) {
+        transport->all_gather_cols(expected_z_bar_);
+        transport->all_gather_vector(y_);
+    }
+}
+
+template <typename Scalar>
+void FastSupervisedMStep<Scalar>::maximize_eta(
+    std::shared_ptr<parameters::Parameters> parameters
+) {
+    MatrixX &eta = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(parameters)->eta;
+
     // we need to maximize w.r.t to \eta
     Scalar initial_value = INFINITY;
     MultinomialLogisticRegression<Scalar> mlr(expected_z_bar_, y_, regularization_penalty_);
@@ -94,6 +114,28 @@ void FastSupervisedMStep<Scalar>::m_step(
     minimizer.minimize(mlr, eta);
 }
 
+template <typename Scalar>
+std::shared_ptr<MStepInterface<Scalar> > FastSupervisedMStep<Scalar>::detach(
+    std::shared_ptr<parameters::Parameters> parameters
+) {
+    UnsupervisedMStep<Scalar>::m_step(parameters);
+    gather_statistics();
+
+    // Only the statistics of eta move to the new maximization step
+    auto detached = std::make_shared<FastSupervisedMStep<Scalar> >(
+        m_step_iterations_,
+        m_step_tolerance_,
+        regularization_penalty_
+    );
+    detached->set_event_dispatcher(this->get_event_dispatcher());
+    detached->eta_only_ = true;
+    detached->expected_z_bar_.swap(expected_z_bar_);
+    detached->y_.swap(y_);
+    expected_z_bar_.resize(detached->expected_z_bar_.rows(), 0);
+
+    return detached;
+}
+
 // Template instantiation
 template class FastSupervisedMStep<float>;
 template class FastSupervisedMStep<double>;
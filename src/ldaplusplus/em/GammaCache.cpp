@@ -0,0 +1,68 @@
+#include <cstring>
+
+#include "ldaplusplus/em/GammaCache.hpp"
+
+namespace ldaplusplus {
+namespace em {
+
+
+template <typename Scalar>
+GammaCache<Scalar>::GammaCache(
+    size_t topics,
+    size_t documents,
+    const std::string &path
+) : topics_(topics),
+    documents_(documents),
+    gammas_((topics + HEADER) * documents, path)
+{}
+
+template <typename Scalar>
+float * GammaCache<Scalar>::slot(const corpus::Document &doc) {
+    int id = doc.get_id();
+    if (id < 0 || static_cast<size_t>(id) >= documents_) {
+        return nullptr;
+    }
+
+    return gammas_.data() + id * (topics_ + HEADER);
+}
+
+template <typename Scalar>
+bool GammaCache<Scalar>::get(const corpus::Document &doc, VectorX &gamma) {
+    float *s = slot(doc);
+    if (s == nullptr || s[HEADER] == 0 || s[0] != doc.get_words().sum()) {
+        return false;
+    }
+
+    // the fingerprint is kept bit for bit in the two floats after the count
+    uint64_t fingerprint;
+    std::memcpy(&fingerprint, s + 1, sizeof(fingerprint));
+    if (fingerprint != doc.fingerprint()) {
+        return false;
+    }
+
+    gamma = Eigen::Map<Eigen::VectorXf>(s + HEADER, topics_).template cast<Scalar>();
+
+    return true;
+}
+
+template <typename Scalar>
+void GammaCache<Scalar>::put(const corpus::Document &doc, const VectorX &gamma) {
+    float *s = slot(doc);
+    if (s == nullptr || static_cast<size_t>(gamma.rows()) != topics_) {
+        return;
+    }
+
+    uint64_t fingerprint = doc.fingerprint();
+    s[0] = doc.get_words().sum();
+    std::memcpy(s + 1, &fingerprint, sizeof(fingerprint));
+    Eigen::Map<Eigen::VectorXf>(s + HEADER, topics_) = gamma.template cast<float>();
+}
+
+
+// Template instantiation
+template class GammaCache<float>;
+template class GammaCache<double>;
+
+
+}  // namespace em
+}  // namespace ldaplusplus
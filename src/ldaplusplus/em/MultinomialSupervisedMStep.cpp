@@ -11,6 +11,13 @@ template <typename Scalar>
 void MultinomialSupervisedMStep<Scalar>::m_step(
     std::shared_ptr<parameters::Parameters> parameters
 ) {
+    // combine the statistics of all the processes
+    if (auto transport = this->get_transport()) {
+        transport->all_reduce_sum(b_);
+        transport->all_reduce_sum(h_);
+        transport->all_reduce_sum(&log_py_, 1);
+    }
+
     // Normalize according to the statistics
     auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(parameters);
     model->beta = b_;
@@ -0,0 +1,92 @@
+#include <cmath>
+#include <stdexcept>
+
+#include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/em/QuantizedEStep.hpp"
+#include "ldaplusplus/e_step_utils.hpp"
+
+namespace ldaplusplus {
+namespace em {
+
+
+template <typename Scalar>
+QuantizedEStep<Scalar>::QuantizedEStep(
+    size_t e_step_iterations,
+    Scalar e_step_tolerance
+) : AbstractEStep<Scalar>(0)
+{
+    e_step_iterations_ = e_step_iterations;
+    e_step_tolerance_ = e_step_tolerance;
+}
+
+template <typename Scalar>
+std::shared_ptr<parameters::Parameters> QuantizedEStep<Scalar>::doc_e_step(
+    const std::shared_ptr<corpus::Document> doc,
+    const std::shared_ptr<parameters::Parameters> parameters
+) {
+    typedef parameters::QuantizedModelParameters<Scalar> QuantizedModel;
+
+    // Words form Document doc
+    const Eigen::VectorXi &X = doc->get_words();
+    int num_words = X.sum();
+
+    // Keep only the words that appear in the document
+    Eigen::VectorXi words, counts;
+    e_step_utils::nonzero_words(X, words, counts);
+    int nnz = words.rows();
+
+    auto model = std::dynamic_pointer_cast<QuantizedModel>(parameters);
+    if (!model) {
+        throw std::invalid_argument("QuantizedEStep can only be used with "
+                                    "QuantizedModelParameters");
+    }
+    const VectorX &alpha = model->alpha;
+    int num_topics = alpha.rows();
+
+    // These are the variational parameters to be computed
+    MatrixX phi = MatrixX::Constant(num_topics, nnz, 1.0/num_topics);
+    VectorX gamma = alpha.array() + static_cast<Scalar>(num_words)/num_topics;
+
+    // to check for convergence
+    VectorX gamma_old = VectorX::Zero(num_topics);
+
+    for (size_t iteration=0; iteration<e_step_iterations_; iteration++) {
+        // check for early stopping
+        if (this->converged(gamma_old, gamma, e_step_tolerance_)) {
+            break;
+        }
+        gamma_old = gamma;
+
+        switch (model->encoding) {
+            case QuantizedModel::Float16:
+                e_step_utils::compute_quantized_phi<Scalar>(
+                    model->beta_half, model->beta_scale, words, gamma, phi
+                );
+                break;
+            case QuantizedModel::Int8:
+                e_step_utils::compute_quantized_phi<Scalar>(
+                    model->beta_int8, model->beta_levels, words, gamma, phi
+                );
+                break;
+        }
+
+        e_step_utils::compute_gamma<Scalar>(counts, alpha, phi, gamma);
+    }
+
+    // we cannot compute the likelihood without the full beta
+    this->get_event_dispatcher()->
+        template dispatch<events::ExpectationProgressEvent<Scalar> >(NAN);
+
+    return std::make_shared<parameters::VariationalParameters<Scalar> >(
+        gamma,
+        MatrixX()
+    );
+}
+
+// Template instantiation
+template class QuantizedEStep<float>;
+template class QuantizedEStep<double>;
+
+
+}  // namespace em
+}  // namespace ldaplusplus
@@ -0,0 +1,134 @@
+#include <typeinfo>
+
+#include "ldaplusplus/em/SelectiveUpdate.hpp"
+
+namespace ldaplusplus {
+namespace em {
+
+
+template <typename Scalar>
+SelectiveUpdate<Scalar>::SelectiveUpdate(
+    Scalar tolerance,
+    size_t skip_epochs,
+    size_t full_pass_every
+) : tolerance_(tolerance),
+    skip_epochs_(skip_epochs),
+    full_pass_every_(full_pass_every),
+    epoch_(0)
+{}
+
+template <typename Scalar>
+bool SelectiveUpdate<Scalar>::full_pass() const {
+    return full_pass_every_ > 0 && epoch_ % full_pass_every_ == 0;
+}
+
+template <typename Scalar>
+void SelectiveUpdate<Scalar>::clear() {
+    std::lock_guard<std::mutex> lock(entries_mutex_);
+
+    entries_.clear();
+}
+
+template <typename Scalar>
+typename SelectiveUpdate<Scalar>::Entry & SelectiveUpdate<Scalar>::entry(int id) {
+    std::lock_guard<std::mutex> lock(entries_mutex_);
+
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+        Entry e;
+        e.num_words = -1;
+        e.fingerprint = 0;
+        e.skip_until = 0;
+        it = entries_.emplace(id, std::move(e)).first;
+    }
+
+    return it->second;
+}
+
+template <typename Scalar>
+std::shared_ptr<parameters::Parameters> SelectiveUpdate<Scalar>::get(
+    const corpus::Document &doc
+) {
+    if (doc.get_id() < 0 || full_pass()) {
+        return nullptr;
+    }
+
+    const Eigen::VectorXi &X = doc.get_words();
+    Entry &e = entry(doc.get_id());
+    if (
+        e.num_words != X.sum() ||
+        e.skip_until < epoch_ ||
+        e.fingerprint != doc.fingerprint()
+    ) {
+        return nullptr;
+    }
+
+    // Put the cached columns back in a full phi
+    auto vp = std::make_shared<parameters::VariationalParameters<Scalar> >(
+        e.gamma.template cast<Scalar>(),
+        MatrixX::Zero(e.gamma.rows(), X.rows())
+    );
+    for (int i=0, j=0; i<X.rows(); i++) {
+        if (X[i] > 0) {
+            vp->phi.col(i) = e.phi.col(j++).template cast<Scalar>();
+        }
+    }
+
+    return vp;
+}
+
+template <typename Scalar>
+void SelectiveUpdate<Scalar>::put(
+    const corpus::Document &doc,
+    const std::shared_ptr<parameters::Parameters> v_parameters
+) {
+    if (
+        doc.get_id() < 0 ||
+        typeid(*v_parameters) != typeid(parameters::VariationalParameters<Scalar>)
+    ) {
+        return;
+    }
+    auto vp = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(
+        v_parameters
+    );
+    const Eigen::VectorXi &X = doc.get_words();
+
+    // Some expectation steps do not compute phi at all
+    if (vp->phi.cols() != X.rows()) {
+        return;
+    }
+
+    Entry &e = entry(doc.get_id());
+
+    // Check whether the document converged since the previous epoch (a
+    // different document with the same id starts over)
+    int num_words = X.sum();
+    uint64_t fingerprint = doc.fingerprint();
+    if (e.num_words != num_words || e.fingerprint != fingerprint) {
+        e.skip_until = 0;
+    } else if (
+        (e.gamma.template cast<Scalar>() - vp->gamma).array().abs().sum() < tolerance_ * vp->gamma.sum()
+    ) {
+        e.skip_until = epoch_ + skip_epochs_;
+    }
+
+    // and cache the new parameters
+    e.num_words = num_words;
+    e.fingerprint = fingerprint;
+    e.gamma = vp->gamma.template cast<float>();
+    e.phi.resize(vp->phi.rows(), (X.array() > 0).count());
+    for (int i=0, j=0; i<X.rows(); i++) {
+        if (X[i] > 0) {
+            e.phi.col(j++) = vp->phi.col(i).template cast<float>();
+        }
+    }
+}
+
+
+// Template instantiation
+template class SelectiveUpdate<float>;
+template class SelectiveUpdate<double>;
+
+
+}  // namespace em
+}  // namespace ldaplusplus
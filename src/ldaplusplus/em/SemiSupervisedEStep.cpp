@@ -46,6 +46,18 @@ void SemiSupervisedEStep<Scalar>::e_step() {
     unsupervised_step_->e_step();
 }
 
+template <typename Scalar>
+void SemiSupervisedEStep<Scalar>::save_state(std::ostream &os) const {
+    supervised_step_->save_state(os);
+    unsupervised_step_->save_state(os);
+}
+
+template <typename Scalar>
+void SemiSupervisedEStep<Scalar>::load_state(std::istream &is) {
+    supervised_step_->load_state(is);
+    unsupervised_step_->load_state(is);
+}
+
 
 // template instantiation
 template class SemiSupervisedEStep<float>;
@@ -0,0 +1,81 @@
+#include <cmath>
+#include <stdexcept>
+
+#include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/em/SparseEStep.hpp"
+#include "ldaplusplus/e_step_utils.hpp"
+
+namespace ldaplusplus {
+namespace em {
+
+
+template <typename Scalar>
+SparseEStep<Scalar>::SparseEStep(
+    size_t e_step_iterations,
+    Scalar e_step_tolerance
+) : AbstractEStep<Scalar>(0)
+{
+    e_step_iterations_ = e_step_iterations;
+    e_step_tolerance_ = e_step_tolerance;
+}
+
+template <typename Scalar>
+std::shared_ptr<parameters::Parameters> SparseEStep<Scalar>::doc_e_step(
+    const std::shared_ptr<corpus::Document> doc,
+    const std::shared_ptr<parameters::Parameters> parameters
+) {
+    // Words form Document doc
+    const Eigen::VectorXi &X = doc->get_words();
+    int num_words = X.sum();
+
+    // Keep only the words that appear in the document
+    Eigen::VectorXi words, counts;
+    e_step_utils::nonzero_words(X, words, counts);
+
+    auto model = std::dynamic_pointer_cast<parameters::SparseModelParameters<Scalar> >(parameters);
+    if (!model) {
+        throw std::invalid_argument("SparseEStep can only be used with "
+                                    "SparseModelParameters");
+    }
+    const VectorX &alpha = model->alpha;
+    int num_topics = alpha.rows();
+
+    // This is the variational parameter to be computed
+    VectorX gamma = alpha.array() + static_cast<Scalar>(num_words)/num_topics;
+
+    // to check for convergence
+    VectorX gamma_old = VectorX::Zero(num_topics);
+
+    for (size_t iteration=0; iteration<e_step_iterations_; iteration++) {
+        // check for early stopping
+        if (this->converged(gamma_old, gamma, e_step_tolerance_)) {
+            break;
+        }
+        gamma_old = gamma;
+
+        e_step_utils::compute_sparse_phi_gamma<Scalar>(
+            model->beta_sparse,
+            words,
+            counts,
+            alpha,
+            gamma
+        );
+    }
+
+    // we cannot compute the likelihood without the full beta
+    this->get_event_dispatcher()->
+        template dispatch<events::ExpectationProgressEvent<Scalar> >(NAN);
+
+    return std::make_shared<parameters::VariationalParameters<Scalar> >(
+        gamma,
+        MatrixX()
+    );
+}
+
+// Template instantiation
+template class SparseEStep<float>;
+template class SparseEStep<double>;
+
+
+}  // namespace em
+}  // namespace ldaplusplus
@@ -67,12 +67,19 @@ template <typename Scalar>
 void SupervisedMStep<Scalar>::m_step(
     std::shared_ptr<parameters::Parameters> parameters
 ) {
-    // Maximize w.r.t \beta during
-    UnsupervisedMStep<Scalar>::m_step(
-        parameters
-    );
-    MatrixX &eta = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(parameters)->eta;
+    if (!eta_only_) {
+        // Maximize w.r.t \beta during
+        UnsupervisedMStep<Scalar>::m_step(
+            parameters
+        );
+        gather_statistics();
+    }
 
+    maximize_eta(parameters);
+}
+
+template <typename Scalar>
+void SupervisedMStep<Scalar>::gather_statistics() {
     // resize the member variables to fit the documents we 've seen so far in
     // the doc_m_steps
     y_.conservativeResize(docs_);
@@ -80,6 +87,29 @@ void SupervisedMStep<Scalar>::m_step(
     variance_z_bar_.resize(docs_);
     docs_ = 0;
 
+    // every process fits eta to the documents of all the processes
+    if (auto transport = this->get_transport()) {
+        int num_topics = expected_z_bar_.rows();
+        MatrixX variances(num_topics, num_topics * variance_z_bar_.size());
+        for (size_t d=0; d<variance_z_bar_.size(); d++) {
+            variances.middleCols(d*num_topics, num_topics) = variance_z_bar_[d];
+        }
+        transport->all_gather_cols(expected_z_bar_);
+        transport->all_gather_vector(y_);
+        transport->all_gather_cols(variances);
+        variance_z_bar_.resize(y_.rows());
+        for (size_t d=0; d<variance_z_bar_.size(); d++) {
+            variance_z_bar_[d] = variances.middleCols(d*num_topics, num_topics);
+        }
+    }
+}
+
+template <typename Scalar>
+void SupervisedMStep<Scalar>::maximize_eta(
+    std::shared_ptr<parameters::Parameters> parameters
+) {
+    MatrixX &eta = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(parameters)->eta;
+
     // we need to maximize w.r.t to \eta
     Scalar initial_value = INFINITY;
     SecondOrderLogisticRegressionApproximation<Scalar> mlr(
@@ -111,6 +141,29 @@ void SupervisedMStep<Scalar>::m_step(
     minimizer.minimize(mlr, eta);
 }
 
+template <typename Scalar>
+std::shared_ptr<MStepInterface<Scalar> > SupervisedMStep<Scalar>::detach(
+    std::shared_ptr<parameters::Parameters> parameters
+) {
+    UnsupervisedMStep<Scalar>::m_step(parameters);
+    gather_statistics();
+
+    // Only the statistics of eta move to the new maximization step
+    auto detached = std::make_shared<SupervisedMStep<Scalar> >(
+        m_step_iterations_,
+        m_step_tolerance_,
+        regularization_penalty_
+    );
+    detached->set_event_dispatcher(this->get_event_dispatcher());
+    detached->eta_only_ = true;
+    detached->expected_z_bar_.swap(expected_z_bar_);
+    detached->variance_z_bar_.swap(variance_z_bar_);
+    detached->y_.swap(y_);
+    expected_z_bar_.resize(detached->expected_z_bar_.rows(), 0);
+
+    return detached;
+}
+
 // Template instantiation
 template class SupervisedMStep<float>;
 template class SupervisedMStep<double>;
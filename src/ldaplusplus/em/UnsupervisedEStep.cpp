@@ -9,8 +9,8 @@ namespace ldaplusplus {
 namespace em {
 
 
-template <typename Scalar>
-UnsupervisedEStep<Scalar>::UnsupervisedEStep(
+template <typename Scalar, int Topics>
+UnsupervisedEStep<Scalar, Topics>::UnsupervisedEStep(
     size_t e_step_iterations,
     Scalar e_step_tolerance,
     Scalar compute_likelihood,
@@ -22,10 +22,28 @@ UnsupervisedEStep<Scalar>::UnsupervisedEStep(
     compute_likelihood_ = compute_likelihood;
 }
 
-template <typename Scalar>
-std::shared_ptr<parameters::Parameters> UnsupervisedEStep<Scalar>::doc_e_step(
+template <typename Scalar, int Topics>
+std::shared_ptr<parameters::Parameters> UnsupervisedEStep<Scalar, Topics>::doc_e_step(
     const std::shared_ptr<corpus::Document> doc,
     const std::shared_ptr<parameters::Parameters> parameters
+) {
+    return doc_e_step(doc, parameters, nullptr);
+}
+
+template <typename Scalar, int Topics>
+std::shared_ptr<parameters::Parameters> UnsupervisedEStep<Scalar, Topics>::cached_doc_e_step(
+    const std::shared_ptr<corpus::Document> doc,
+    const std::shared_ptr<parameters::Parameters> parameters,
+    GammaCache<Scalar> &gamma_cache
+) {
+    return doc_e_step(doc, parameters, &gamma_cache);
+}
+
+template <typename Scalar, int Topics>
+std::shared_ptr<parameters::Parameters> UnsupervisedEStep<Scalar, Topics>::doc_e_step(
+    const std::shared_ptr<corpus::Document> doc,
+    const std::shared_ptr<parameters::Parameters> parameters,
+    GammaCache<Scalar> *gamma_cache
 ) {
     // Words form Document doc
     const Eigen::VectorXi &X = doc->get_words();
@@ -33,18 +51,27 @@ std::shared_ptr<parameters::Parameters> UnsupervisedEStep<Scalar>::doc_e_step(
 
     // Cast parameters to model parameters in order to save all necessary
     // matrixes
-    const VectorX &alpha = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(parameters)->alpha;
-    const MatrixX &beta = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(parameters)->beta;
+    auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(parameters);
+    const VectorX &alpha = model->alpha;
+    // a mapped model reads beta in place from the model file
+    auto mapped = std::dynamic_pointer_cast<parameters::MappedModelParameters<Scalar> >(parameters);
+    const Eigen::Ref<const MatrixX> beta = (mapped) ?
+        Eigen::Ref<const MatrixX>(mapped->beta_map) :
+        Eigen::Ref<const MatrixX>(model->beta);
     int num_topics = beta.rows();
 
     // These are the variational parameters to be computed
     MatrixX phi = MatrixX::Constant(num_topics, X.rows(), 1.0/num_topics);
     VectorX gamma = alpha.array() + static_cast<Scalar>(num_words)/num_topics;
 
+    // or start from the gamma of the previous epoch
+    bool warm_started = gamma_cache && gamma_cache->get(*doc, gamma);
+
     // to check for convergence
     VectorX gamma_old = VectorX::Zero(num_topics);
 
-    for (size_t iteration=0; iteration<e_step_iterations_; iteration++) {
+    size_t iteration = 0;
+    for (; iteration<e_step_iterations_; iteration++) {
         // check for early stopping
         if (this->converged(gamma_old, gamma, e_step_tolerance_)) {
             break;
@@ -62,14 +89,18 @@ std::shared_ptr<parameters::Parameters> UnsupervisedEStep<Scalar>::doc_e_step(
         // end
         //
         // Equation (6) in Latent Dirichlet Allocation, Blei 2003
-        e_step_utils::compute_unsupervised_phi<Scalar>(beta, gamma, phi);
+        e_step_utils::compute_unsupervised_phi<Scalar, Topics>(beta, gamma, phi);
 
         // Update Dirichlet parameters according 
         //
         // gamma_i ^ {t+1} =  alpha_i + \sum_n \phi_{n,i}^{t+1}
         //
         // Equation (7) in Latent Dirichlet Allocation, Blei 2003 
-        e_step_utils::compute_gamma<Scalar>(X, alpha, phi, gamma);
+        e_step_utils::compute_gamma<Scalar, Topics>(X, alpha, phi, gamma);
+    }
+
+    if (gamma_cache) {
+        gamma_cache->put(*doc, gamma);
     }
 
     // notify that the e step has finished and compute the likelihood with
@@ -78,13 +109,17 @@ std::shared_ptr<parameters::Parameters> UnsupervisedEStep<Scalar>::doc_e_step(
     if (emit_likelihood(this->get_prng())) {
         this->get_event_dispatcher()->
             template dispatch<events::ExpectationProgressEvent<Scalar> >(
-                e_step_utils::compute_unsupervised_likelihood(
+                e_step_utils::compute_unsupervised_likelihood<Scalar>(
                     X, alpha, beta, phi, gamma
-                )
+                ),
+                iteration,
+                warm_started
             );
     } else {
         this->get_event_dispatcher()->
-            template dispatch<events::ExpectationProgressEvent<Scalar> >(NAN);
+            template dispatch<events::ExpectationProgressEvent<Scalar> >(
+                NAN, iteration, warm_started
+            );
     }
 
     return std::make_shared<parameters::VariationalParameters<Scalar> >(gamma, phi);
@@ -93,6 +128,12 @@ std::shared_ptr<parameters::Parameters> UnsupervisedEStep<Scalar>::doc_e_step(
 // Template instantiation
 template class UnsupervisedEStep<float>;
 template class UnsupervisedEStep<double>;
+template class UnsupervisedEStep<float, 16>;
+template class UnsupervisedEStep<double, 16>;
+template class UnsupervisedEStep<float, 32>;
+template class UnsupervisedEStep<double, 32>;
+template class UnsupervisedEStep<float, 64>;
+template class UnsupervisedEStep<double, 64>;
 
 
 }  // namespace em
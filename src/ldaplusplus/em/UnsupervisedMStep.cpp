@@ -9,9 +9,14 @@ template <typename Scalar>
 void UnsupervisedMStep<Scalar>::m_step(
     std::shared_ptr<parameters::Parameters> parameters
 ) {
+    // combine the statistics of all the processes
+    if (auto transport = this->get_transport()) {
+        transport->all_reduce_sum(b_);
+    }
+
     // we maximized w.r.t \beta during each doc_m_step
     std::static_pointer_cast<parameters::ModelParameters<Scalar> >(parameters)->beta = 
-        b_.array().colwise() / b_.array().rowwise().sum();
+        (b_.array().colwise() / b_.array().rowwise().sum()).matrix().template cast<Scalar>();
 
     b_.fill(0);
 }
@@ -32,9 +37,9 @@ void UnsupervisedMStep<Scalar>::doc_m_step(
     
     // Check if b_ is accessed and allocate suitable amound of memory
     if (b_.rows() == 0)
-        b_ = MatrixX::Zero(phi.rows(), phi.cols());
+        b_ = Eigen::MatrixXd::Zero(phi.rows(), phi.cols());
 
-    b_.array() += t2;
+    b_.array() += t2.template cast<double>();
 }
 
 // Template instantiation
@@ -1,21 +1,94 @@
 
+#include <atomic>
+#include <deque>
+#include <stdexcept>
+#include <unordered_map>
+
 #include "ldaplusplus/events/Events.hpp"
 
 namespace ldaplusplus {
 namespace events {
 
 
-Event::Event(std::string id) : id_(id) {}
+namespace {
+
+// The ids of the event types in the order they were seen. A deque does not
+// move its elements when it grows so event_id() can return references.
+//
+// The readers use an immutable array of pointers to the ids that is
+// replaced by a larger one when a type is added. The replaced arrays are
+// kept since a reader may still be using them (there are only a few
+// types).
+struct EventTypeRegistry
+{
+    std::mutex mutex;
+    std::unordered_map<std::string, size_t> types;
+    std::deque<std::string> ids;
+    std::vector<std::unique_ptr<const std::string *[]> > snapshots;
+    std::atomic<const std::string * const *> snapshot{nullptr};
+    std::atomic<size_t> size{0};
+};
+
+EventTypeRegistry & registry() {
+    static EventTypeRegistry r;
+    return r;
+}
+
+}  // namespace
+
+
+size_t event_type(const std::string &id) {
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    auto it = r.types.find(id);
+    if (it != r.types.end()) {
+        return it->second;
+    }
+
+    r.ids.push_back(id);
+    std::unique_ptr<const std::string *[]> snapshot(
+        new const std::string *[r.ids.size()]
+    );
+    for (size_t i=0; i<r.ids.size(); i++) {
+        snapshot[i] = &r.ids[i];
+    }
+    r.snapshot.store(snapshot.get(), std::memory_order_release);
+    r.size.store(r.ids.size(), std::memory_order_release);
+    r.snapshots.push_back(std::move(snapshot));
+
+    return r.types[id] = r.ids.size() - 1;
+}
+
+
+const std::string & event_id(size_t type) {
+    auto &r = registry();
+
+    // the snapshot is at least as recent as the size
+    if (type >= r.size.load(std::memory_order_acquire)) {
+        throw std::out_of_range("Unknown event type");
+    }
+
+    return *r.snapshot.load(std::memory_order_acquire)[type];
+}
+
+
+Event::Event(std::string id) : type_(event_type(id)) {}
+
+
+Event::Event(size_t type) : type_(type) {}
 
 
 const std::string & Event::id() const {
-    return id_;
+    return event_id(type_);
 }
 
 
 FunctionEventListener::FunctionEventListener(
-    std::function<void(std::shared_ptr<Event>)> listener
-) : listener_(listener)
+    std::function<void(std::shared_ptr<Event>)> listener,
+    std::vector<size_t> event_types
+) : listener_(listener),
+    event_types_(event_types)
 {}
 
 
@@ -24,34 +97,80 @@ void FunctionEventListener::on_event(std::shared_ptr<Event> event) {
 }
 
 
-void EventDispatcher::add_listener(std::shared_ptr<EventListenerInterface> listener) {
-    listeners_.push_back(listener);
+std::vector<size_t> FunctionEventListener::event_types() const {
+    return event_types_;
 }
 
 
-void EventDispatcher::remove_listener(std::shared_ptr<EventListenerInterface> listener) {
-    for (auto it = listeners_.begin(); it != listeners_.end(); it++) {
-        if (*it == listener) {
-            listeners_.erase(it);
-            break;
+void EventListeners::add(std::shared_ptr<EventListenerInterface> listener) {
+    auto types = listener->event_types();
+
+    // a listener of all the events goes to every list, including the lists
+    // of the types seen later (see below)
+    if (types.empty()) {
+        all_.push_back(listener);
+        for (auto & listeners : by_type_) {
+            listeners.push_back(listener);
+        }
+    }
+    for (auto type : types) {
+        if (by_type_.size() <= type) {
+            by_type_.resize(type + 1, all_);
         }
+        by_type_[type].push_back(listener);
     }
 }
 
 
-void EventDispatcher::dispatch(std::shared_ptr<Event> event) {
-    for (auto l : listeners_) {
+void EventListeners::remove(std::shared_ptr<EventListenerInterface> listener) {
+    all_.remove(listener);
+    for (auto & listeners : by_type_) {
+        listeners.remove(listener);
+    }
+}
+
+
+void EventListeners::notify(std::shared_ptr<Event> event) const {
+    const auto &listeners = (event->type() < by_type_.size()) ?
+        by_type_[event->type()] : all_;
+    for (auto & l : listeners) {
         l->on_event(event);
     }
 }
 
 
+bool EventListeners::handles(size_t type) const {
+    return !((type < by_type_.size()) ? by_type_[type] : all_).empty();
+}
+
+
+void EventDispatcher::add_listener(std::shared_ptr<EventListenerInterface> listener) {
+    listeners_.add(listener);
+}
+
+
+void EventDispatcher::remove_listener(std::shared_ptr<EventListenerInterface> listener) {
+    listeners_.remove(listener);
+}
+
+
+void EventDispatcher::dispatch(std::shared_ptr<Event> event) {
+    listeners_.notify(event);
+}
+
+
+ThreadSafeEventDispatcher::ThreadSafeEventDispatcher()
+    : listeners_(std::make_shared<EventListeners>())
+{}
+
 void ThreadSafeEventDispatcher::add_listener(
     std::shared_ptr<EventListenerInterface> listener
 ) {
     std::lock_guard<std::mutex> l(listeners_mutex_);
 
-    listeners_.push_back(listener);
+    auto listeners = std::make_shared<EventListeners>(*listeners_);
+    listeners->add(listener);
+    listeners_ = listeners;
 }
 
 void ThreadSafeEventDispatcher::remove_listener(
@@ -63,6 +182,15 @@ void ThreadSafeEventDispatcher::remove_listener(
 }
 
 void ThreadSafeEventDispatcher::dispatch(std::shared_ptr<Event> event) {
+    // nobody would see the event so do not keep it around until the next
+    // process_events() (which might never come)
+    {
+        std::lock_guard<std::mutex> l(listeners_mutex_);
+        if (!listeners_->handles(event->type())) {
+            return;
+        }
+    }
+
     std::lock_guard<std::mutex> l(events_mutex_);
 
     events_.push_back(event);
@@ -77,36 +205,34 @@ void ThreadSafeEventDispatcher::process_events() {
 
         std::lock(l1, l2);
 
-        for (auto l=listeners_.begin(); l!=listeners_.end(); l++) {
-            if (deleted_listeners_.find(*l) != deleted_listeners_.end()) {
-                l = listeners_.erase(l);
-                l--;
+        if (!deleted_listeners_.empty()) {
+            auto listeners = std::make_shared<EventListeners>(*listeners_);
+            for (auto & l : deleted_listeners_) {
+                listeners->remove(l);
             }
+            listeners_ = listeners;
         }
 
         deleted_listeners_.clear();
     }
 
-    // copy the event list
+    // take the event list
     std::list<std::shared_ptr<Event> > events;
     {
         std::lock_guard<std::mutex> l(events_mutex_);
-        events = events_;
-        events_.clear();
+        events.swap(events_);
     }
 
-    // copy the listeners list
-    std::list<std::shared_ptr<EventListenerInterface> > listeners;
+    // and the current listeners
+    std::shared_ptr<const EventListeners> listeners;
     {
         std::lock_guard<std::mutex> l(listeners_mutex_);
         listeners = listeners_;
     }
 
     // dispatch events without worry
-    for (auto ev : events) {
-        for (auto l : listeners) {
-            l->on_event(ev);
-        }
+    for (auto & ev : events) {
+        listeners->notify(ev);
     }
 }
 
@@ -123,5 +249,11 @@ void SameThreadEventDispatcher::dispatch(std::shared_ptr<Event> event) {
     }
 }
 
+void SameThreadEventDispatcher::process_events() {
+    if (std::this_thread::get_id() == thread_id_) {
+        ThreadSafeEventDispatcher::process_events();
+    }
+}
+
 }  // namespace events
 }  // namespace ldaplusplus
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "ldaplusplus/parallel/NumaTopology.hpp"
+
+namespace ldaplusplus {
+namespace parallel {
+
+
+NumaTopology::NumaTopology(const std::string &root) {
+    // The node numbers may have gaps (for instance offline nodes) so list
+    // the nodeN directories instead of counting
+    std::vector<int> nodes;
+    DIR *dir = opendir(root.c_str());
+    if (dir != nullptr) {
+        while (struct dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+                name.find_first_not_of("0123456789", 4) == std::string::npos) {
+                nodes.push_back(std::stoi(name.substr(4)));
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(nodes.begin(), nodes.end());
+
+    // and a node may have no CPUs
+    for (auto node : nodes) {
+        std::ifstream cpulist(
+            root + "/node" + std::to_string(node) + "/cpulist"
+        );
+        if (!cpulist) {
+            continue;
+        }
+
+        std::string line;
+        std::getline(cpulist, line);
+        auto cpus = parse_cpulist(line);
+        if (!cpus.empty()) {
+            cpus_.push_back(cpus);
+        }
+    }
+
+    if (cpus_.empty()) {
+        cpus_.emplace_back();
+        for (int cpu=0; cpu<static_cast<int>(std::thread::hardware_concurrency()); cpu++) {
+            cpus_.back().push_back(cpu);
+        }
+    }
+}
+
+bool NumaTopology::pin_to_node(size_t node) const {
+    #ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus_[node]) {
+        CPU_SET(cpu, &set);
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    #else
+    return false;
+    #endif
+}
+
+std::vector<int> NumaTopology::parse_cpulist(const std::string &cpulist) {
+    std::vector<int> cpus;
+    std::istringstream ranges(cpulist);
+    std::string range;
+
+    while (std::getline(ranges, range, ',')) {
+        if (range.find_first_of("0123456789") == std::string::npos) {
+            continue;
+        }
+
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = (dash == std::string::npos) ?
+            first : std::stoi(range.substr(dash + 1));
+        for (int cpu=first; cpu<=last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+
+}  // namespace parallel
+}  // namespace ldaplusplus
@@ -0,0 +1,534 @@
+#include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/parallel/ShardedLDA.hpp"
+#include "ldaplusplus/parallel/SharedArray.hpp"
+#include "ldaplusplus/utils.hpp"
+
+namespace ldaplusplus {
+namespace parallel {
+
+namespace {
+
+/**
+ * A barrier that can be waited on by many processes and aborted by any of
+ * them, so that a failed worker does not leave the others waiting forever.
+ */
+class SharedBarrier
+{
+    public:
+        SharedBarrier(unsigned int count) : state_(1) {
+            State *s = state_.data();
+
+            pthread_mutexattr_t mutex_attr;
+            pthread_mutexattr_init(&mutex_attr);
+            pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+            pthread_mutex_init(&s->mutex, &mutex_attr);
+            pthread_mutexattr_destroy(&mutex_attr);
+
+            pthread_condattr_t cond_attr;
+            pthread_condattr_init(&cond_attr);
+            pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+            pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+            pthread_cond_init(&s->cond, &cond_attr);
+            pthread_condattr_destroy(&cond_attr);
+
+            s->count = count;
+            s->waiting = 0;
+            s->generation = 0;
+            s->aborted = false;
+        }
+
+        ~SharedBarrier() {
+            pthread_cond_destroy(&state_.data()->cond);
+            pthread_mutex_destroy(&state_.data()->mutex);
+        }
+
+        /**
+         * Block until all the processes have called wait().
+         *
+         * @param poll If given it is called every POLL_MILLISECONDS while
+         *             waiting (without holding the lock) and may call
+         *             abort()
+         * @throws std::runtime_error if the barrier was aborted
+         */
+        void wait(const std::function<void()> &poll = nullptr) {
+            State *s = state_.data();
+
+            lock();
+            unsigned int generation = s->generation;
+            if (!s->aborted && ++s->waiting == s->count) {
+                s->waiting = 0;
+                s->generation++;
+                pthread_cond_broadcast(&s->cond);
+            }
+            while (!s->aborted && generation == s->generation) {
+                if (!poll) {
+                    check(pthread_cond_wait(&s->cond, &s->mutex));
+                    continue;
+                }
+
+                struct timespec deadline;
+                clock_gettime(CLOCK_MONOTONIC, &deadline);
+                deadline.tv_nsec += POLL_MILLISECONDS * 1000000L;
+                deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+                deadline.tv_nsec %= 1000000000L;
+                if (check(pthread_cond_timedwait(&s->cond, &s->mutex, &deadline)) == ETIMEDOUT) {
+                    pthread_mutex_unlock(&s->mutex);
+                    poll();
+                    lock();
+                }
+            }
+            bool aborted = generation == s->generation;
+            pthread_mutex_unlock(&s->mutex);
+
+            if (aborted) {
+                throw std::runtime_error("A worker process failed");
+            }
+        }
+
+        /**
+         * Release all the processes that are or will be waiting and make
+         * their wait() throw.
+         */
+        void abort() {
+            lock();
+            state_.data()->aborted = true;
+            pthread_cond_broadcast(&state_.data()->cond);
+            pthread_mutex_unlock(&state_.data()->mutex);
+        }
+
+    private:
+        static const long POLL_MILLISECONDS = 100;
+
+        struct State
+        {
+            pthread_mutex_t mutex;
+            pthread_cond_t cond;
+            unsigned int count;
+            unsigned int waiting;
+            unsigned int generation;
+            bool aborted;
+        };
+
+        void lock() {
+            check(pthread_mutex_lock(&state_.data()->mutex));
+        }
+
+        /**
+         * Recover the mutex if a process died while holding it (the state
+         * is only a few counters that are consistent at any time).
+         */
+        int check(int result) {
+            if (result == EOWNERDEAD) {
+                pthread_mutex_consistent(&state_.data()->mutex);
+            }
+
+            return result;
+        }
+
+        SharedArray<State> state_;
+};
+
+
+/**
+ * Count the threads of this process or return 0 if it cannot be known.
+ */
+int count_threads() {
+    DIR *tasks = opendir("/proc/self/task");
+    if (tasks == nullptr) {
+        return 0;
+    }
+
+    int threads = 0;
+    while (struct dirent *entry = readdir(tasks)) {
+        if (entry->d_name[0] != '.') {
+            threads++;
+        }
+    }
+    closedir(tasks);
+
+    return threads;
+}
+
+
+/**
+ * The state that all the worker processes share.
+ */
+template <typename Scalar>
+struct SharedState
+{
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+
+    SharedState(int topics, int words, int blocks, int workers, const std::string &path)
+        : beta_memory(static_cast<size_t>(topics) * words, path.empty() ? "" : path + ".beta"),
+          statistics_memory(static_cast<size_t>(topics) * words, path.empty() ? "" : path + ".statistics"),
+          row_sums_memory(static_cast<size_t>(topics) * blocks),
+          bounds_memory(workers),
+          barrier(workers),
+          beta(beta_memory.data(), topics, words),
+          statistics(statistics_memory.data(), topics, words),
+          row_sums(row_sums_memory.data(), topics, blocks),
+          bounds(bounds_memory.data(), workers)
+    {}
+
+    SharedArray<Scalar> beta_memory;
+    SharedArray<Scalar> statistics_memory;
+    SharedArray<Scalar> row_sums_memory;
+    SharedArray<Scalar> bounds_memory;
+    SharedBarrier barrier;
+
+    // K x V, the columns of a word block are contiguous in memory
+    Eigen::Map<MatrixX> beta;
+    Eigen::Map<MatrixX> statistics;
+    // K x B, the sum of the statistics of each block
+    Eigen::Map<MatrixX> row_sums;
+    // The lower bound of the log likelihood of each document shard
+    Eigen::Map<Eigen::Matrix<Scalar, Eigen::Dynamic, 1> > bounds;
+};
+
+
+/**
+ * Train on a single document shard visiting the word blocks in the order
+ * defined by the rotation schedule.
+ *
+ * @param worker      The index of this worker
+ * @param workers     The total number of workers
+ * @param X           The word counts of the whole corpus
+ * @param alpha       The Dirichlet prior of the topic mixtures
+ * @param blocks      The word blocks
+ * @param iterations  The number of epochs
+ * @param state       The shared model and statistics
+ * @param on_epoch    Called by the first worker after every epoch
+ * @param poll        Called periodically while waiting for the other
+ *                    workers (see SharedBarrier::wait())
+ */
+template <typename Scalar>
+void run_worker(
+    int worker,
+    int workers,
+    const Eigen::MatrixXi &X,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &alpha,
+    const std::vector<std::pair<int, int> > &blocks,
+    size_t iterations,
+    SharedState<Scalar> &state,
+    std::function<void()> on_epoch,
+    std::function<void()> poll
+) {
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    auto cwise_digamma = math_utils::CwiseDigamma<Scalar>();
+    auto cwise_lgamma = math_utils::CwiseLgamma<Scalar>();
+
+    int num_topics = alpha.rows();
+    int num_blocks = blocks.size();
+    int blocks_per_worker = num_blocks / workers;
+
+    // Our document shard in a compressed form with the words of every
+    // document in increasing order so that each block is a contiguous range
+    int first_doc = (static_cast<long>(X.cols()) * worker) / workers;
+    int last_doc = (static_cast<long>(X.cols()) * (worker + 1)) / workers;
+    int num_docs = last_doc - first_doc;
+    std::vector<int> offsets(num_docs + 1, 0);
+    std::vector<int> words;
+    std::vector<Scalar> counts;
+    for (int d=0; d<num_docs; d++) {
+        for (int w=0; w<X.rows(); w++) {
+            if (X(w, first_doc + d) > 0) {
+                words.push_back(w);
+                counts.push_back(X(w, first_doc + d));
+            }
+        }
+        offsets[d + 1] = words.size();
+    }
+
+    MatrixX gamma(num_topics, num_docs);
+    for (int d=0; d<num_docs; d++) {
+        Scalar length = 0;
+        for (int n=offsets[d]; n<offsets[d + 1]; n++) {
+            length += counts[n];
+        }
+        gamma.col(d) = alpha.array() + length / num_topics;
+    }
+    MatrixX exp_e_log_theta(num_topics, num_docs);
+    MatrixX next_gamma(num_topics, num_docs);
+    VectorX phi(num_topics);
+
+    Scalar lgamma_alpha = std::lgamma(alpha.sum()) - alpha.unaryExpr(cwise_lgamma).sum();
+
+    for (size_t epoch=0; epoch<iterations; epoch++) {
+        // E_q[log theta] with the gamma of the previous epoch and the terms
+        // of the bound that depend only on theta
+        Scalar bound = 0;
+        for (int d=0; d<num_docs; d++) {
+            VectorX e_log_theta = gamma.col(d).unaryExpr(cwise_digamma).array() -
+                                  math_utils::digamma(gamma.col(d).sum());
+            exp_e_log_theta.col(d) = e_log_theta.array().exp();
+
+            bound += lgamma_alpha;
+            bound += ((alpha.array() - gamma.col(d).array()) * e_log_theta.array()).sum();
+            bound -= std::lgamma(gamma.col(d).sum());
+            bound += gamma.col(d).unaryExpr(cwise_lgamma).sum();
+        }
+        next_gamma = alpha.rowwise().replicate(num_docs);
+
+        // Visit every block once. In each round every worker owns a
+        // different block.
+        for (int round=0; round<num_blocks; round++) {
+            const std::pair<int, int> &block = blocks[
+                (worker*blocks_per_worker + round) % num_blocks
+            ];
+
+            for (int d=0; d<num_docs; d++) {
+                auto begin = words.begin() + offsets[d];
+                auto end = words.begin() + offsets[d + 1];
+                int n = std::lower_bound(begin, end, block.first) - words.begin();
+                int last = std::lower_bound(begin, end, block.second) - words.begin();
+                for (; n<last; n++) {
+                    int w = words[n];
+                    phi = state.beta.col(w).cwiseProduct(exp_e_log_theta.col(d));
+                    Scalar normalizer = phi.sum();
+                    if (normalizer <= 0) {
+                        continue;
+                    }
+                    bound += counts[n] * std::log(normalizer);
+                    phi *= counts[n] / normalizer;
+
+                    state.statistics.col(w) += phi;
+                    next_gamma.col(d) += phi;
+                }
+            }
+
+            state.barrier.wait(poll);
+        }
+        gamma = next_gamma;
+        state.bounds[worker] = bound;
+
+        // Maximization step; each worker normalizes its own blocks
+        for (int b=worker*blocks_per_worker; b<(worker+1)*blocks_per_worker; b++) {
+            state.row_sums.col(b) = state.statistics.middleCols(
+                blocks[b].first,
+                blocks[b].second - blocks[b].first
+            ).rowwise().sum();
+        }
+        state.barrier.wait(poll);
+        VectorX topic_sums = state.row_sums.rowwise().sum();
+        for (int b=worker*blocks_per_worker; b<(worker+1)*blocks_per_worker; b++) {
+            auto beta_block = state.beta.middleCols(
+                blocks[b].first,
+                blocks[b].second - blocks[b].first
+            );
+            auto statistics_block = state.statistics.middleCols(
+                blocks[b].first,
+                blocks[b].second - blocks[b].first
+            );
+            beta_block = statistics_block.array().colwise() / topic_sums.array();
+            statistics_block.setZero();
+        }
+        state.barrier.wait(poll);
+
+        if (on_epoch) {
+            on_epoch();
+        }
+    }
+}
+
+}  // namespace
+
+
+template <typename Scalar>
+ShardedLDA<Scalar>::ShardedLDA(
+    std::shared_ptr<parameters::ModelParameters<Scalar> > model_parameters,
+    size_t iterations,
+    size_t workers,
+    size_t blocks_per_worker,
+    std::string storage_path
+) : model_parameters_(model_parameters),
+    iterations_(iterations),
+    workers_(std::max<size_t>(1, workers)),
+    blocks_per_worker_(std::max<size_t>(1, blocks_per_worker)),
+    storage_path_(storage_path),
+    event_dispatcher_(std::make_shared<events::SameThreadEventDispatcher>())
+{}
+
+
+template <typename Scalar>
+std::vector<typename ShardedLDA<Scalar>::WordBlock> ShardedLDA<Scalar>::partition_vocabulary(
+    const Eigen::MatrixXi &X,
+    size_t blocks
+) const {
+    Eigen::VectorXi tokens = X.rowwise().sum();
+    double total = tokens.cast<double>().sum();
+
+    std::vector<WordBlock> result;
+    int first = 0;
+    double seen = 0;
+    for (int w=0; w<X.rows(); w++) {
+        seen += tokens[w];
+        // close the block when it reaches its share of the tokens (leaving
+        // at least one word for each of the remaining blocks)
+        size_t remaining = blocks - result.size() - 1;
+        if (
+            remaining > 0 &&
+            (seen >= total * (result.size() + 1) / blocks ||
+             X.rows() - (w + 1) == static_cast<int>(remaining))
+        ) {
+            result.emplace_back(first, w + 1);
+            first = w + 1;
+        }
+    }
+    result.emplace_back(first, X.rows());
+
+    // Less words than blocks; pad with empty blocks
+    while (result.size() < blocks) {
+        result.emplace_back(X.rows(), X.rows());
+    }
+
+    return result;
+}
+
+
+template <typename Scalar>
+void ShardedLDA<Scalar>::fit(const Eigen::MatrixXi &X) {
+    int num_topics = model_parameters_->beta.rows();
+    int num_words = model_parameters_->beta.cols();
+    int workers = workers_;
+    int num_blocks = workers_ * blocks_per_worker_;
+
+    if (X.rows() != num_words) {
+        throw std::runtime_error("The corpus and the model have a different "
+                                 "number of words");
+    }
+
+    // Only the forking thread survives in the children so any lock held by
+    // another thread would stay locked forever
+    if (workers > 1 && count_threads() > 1) {
+        throw std::runtime_error("ShardedLDA cannot fork worker processes "
+                                 "while other threads are running");
+    }
+
+    std::vector<WordBlock> blocks = partition_vocabulary(X, num_blocks);
+    SharedState<Scalar> state(num_topics, num_words, num_blocks, workers, storage_path_);
+    state.statistics.setZero();
+
+    // The model lives only in the shared memory (or the files backing it)
+    // while training and it is gathered back once at the end
+    state.beta = model_parameters_->beta;
+    model_parameters_->beta.resize(0, 0);
+    auto gather = [&]() {
+        model_parameters_->beta = state.beta;
+    };
+
+    // Only the first worker (this process) talks to the outside world. The
+    // listeners get a copy of the model of this epoch (of the same type as
+    // model_parameters_) since its beta is empty until the end.
+    std::function<void()> on_epoch = [&]() {
+        event_dispatcher_->template dispatch<events::ExpectationProgressEvent<Scalar> >(
+            state.bounds.sum() / X.cols()
+        );
+        auto parameters = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
+            model_parameters_->clone()
+        );
+        parameters->beta = state.beta;
+        event_dispatcher_->template dispatch<events::EpochProgressEvent<Scalar> >(
+            parameters
+        );
+    };
+
+    std::vector<pid_t> children;
+    std::vector<int> statuses;
+    std::vector<bool> reaped;
+    for (int worker=1; worker<workers; worker++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            state.barrier.abort();
+            break;
+        }
+        if (pid == 0) {
+            int status = 0;
+            try {
+                run_worker<Scalar>(
+                    worker, workers, X, model_parameters_->alpha,
+                    blocks, iterations_, state, nullptr, nullptr
+                );
+            } catch (...) {
+                // release the rest of the workers
+                state.barrier.abort();
+                status = 1;
+            }
+            // Skip the destructors and atexit handlers of the parent
+            _exit(status);
+        }
+        children.push_back(pid);
+        statuses.push_back(0);
+        reaped.push_back(false);
+    }
+
+    // A worker that dies without reaching the barrier (for instance killed
+    // by a signal) is noticed by the parent that aborts the training
+    auto reap = [&](bool block) {
+        bool failed = false;
+        for (size_t i=0; i<children.size(); i++) {
+            if (!reaped[i] && waitpid(children[i], &statuses[i], (block) ? 0 : WNOHANG) == children[i]) {
+                reaped[i] = true;
+            }
+            failed |= reaped[i] && (
+                !WIFEXITED(statuses[i]) || WEXITSTATUS(statuses[i]) != 0
+            );
+        }
+
+        return failed;
+    };
+    std::function<void()> poll = [&]() {
+        if (reap(false)) {
+            state.barrier.abort();
+        }
+    };
+
+    bool failed = static_cast<int>(children.size()) + 1 < workers;
+    std::exception_ptr error;
+    try {
+        if (failed) {
+            throw std::runtime_error("Could not create a worker process");
+        }
+        run_worker<Scalar>(
+            0, workers, X, model_parameters_->alpha,
+            blocks, iterations_, state, on_epoch, poll
+        );
+    } catch (...) {
+        state.barrier.abort();
+        error = std::current_exception();
+    }
+
+    failed |= reap(true);
+    gather();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if (failed) {
+        throw std::runtime_error("A worker process failed");
+    }
+}
+
+
+// Template instantiation
+template class ShardedLDA<float>;
+template class ShardedLDA<double>;
+
+
+}  // namespace parallel
+}  // namespace ldaplusplus
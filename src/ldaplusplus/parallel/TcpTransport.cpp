@@ -0,0 +1,228 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ldaplusplus/parallel/TcpTransport.hpp"
+
+namespace ldaplusplus {
+namespace parallel {
+
+namespace {
+
+void send_all(int socket, const char *data, size_t n) {
+    while (n > 0) {
+        ssize_t sent = send(socket, data, n, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            throw std::runtime_error("TcpTransport: send failed");
+        }
+        data += sent;
+        n -= sent;
+    }
+}
+
+void recv_all(int socket, char *data, size_t n) {
+    while (n > 0) {
+        ssize_t received = recv(socket, data, n, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            throw std::runtime_error("TcpTransport: receive failed");
+        }
+        data += received;
+        n -= received;
+    }
+}
+
+void send_buffer(int socket, const std::vector<char> &buffer) {
+    uint64_t size = buffer.size();
+    send_all(socket, reinterpret_cast<const char *>(&size), sizeof(size));
+    send_all(socket, buffer.data(), buffer.size());
+}
+
+std::vector<char> recv_buffer(int socket) {
+    uint64_t size;
+    recv_all(socket, reinterpret_cast<char *>(&size), sizeof(size));
+    std::vector<char> buffer(size);
+    recv_all(socket, buffer.data(), size);
+
+    return buffer;
+}
+
+sockaddr_in make_address(const std::string &host, int port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        throw std::runtime_error("TcpTransport: invalid address " + host);
+    }
+
+    return address;
+}
+
+void set_no_delay(int socket) {
+    int one = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+}  // namespace
+
+
+TcpTransport::TcpTransport(
+    int rank,
+    int size,
+    int port,
+    std::string host,
+    int timeout
+) : rank_(rank),
+    size_(size)
+{
+    if (rank_ < 0 || rank_ >= size_) {
+        throw std::runtime_error("TcpTransport: rank should be in [0, size)");
+    }
+
+    sockaddr_in address = make_address(host, port);
+
+    // The destructor will not run if we throw so close what we have opened
+    try {
+        if (rank_ == 0) {
+            accept_ranks(address);
+        } else {
+            connect_to_root(address, timeout);
+        }
+    } catch (...) {
+        for (auto s : sockets_) {
+            if (s >= 0) {
+                close(s);
+            }
+        }
+        throw;
+    }
+}
+
+
+void TcpTransport::accept_ranks(const sockaddr_in &address) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (
+        listener < 0 ||
+        bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(listener, size_) != 0
+    ) {
+        close(listener);
+        throw std::runtime_error("TcpTransport: could not listen");
+    }
+
+    // Accept everyone and order the connections by rank
+    sockets_.resize(size_ - 1, -1);
+    for (int i=1; i<size_; i++) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            close(listener);
+            throw std::runtime_error("TcpTransport: accept failed");
+        }
+        set_no_delay(connection);
+        int32_t other = 0;
+        try {
+            recv_all(connection, reinterpret_cast<char *>(&other), sizeof(other));
+        } catch (...) {
+            other = 0;
+        }
+        if (other <= 0 || other >= size_ || sockets_[other - 1] >= 0) {
+            close(connection);
+            close(listener);
+            throw std::runtime_error("TcpTransport: invalid rank received");
+        }
+        sockets_[other - 1] = connection;
+    }
+    close(listener);
+}
+
+
+void TcpTransport::connect_to_root(const sockaddr_in &address, int timeout) {
+    // Rank 0 might not be listening yet so keep trying
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
+    while (true) {
+        int connection = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(connection, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0) {
+            sockets_.push_back(connection);
+            set_no_delay(connection);
+            int32_t me = rank_;
+            send_all(connection, reinterpret_cast<const char *>(&me), sizeof(me));
+            break;
+        }
+        close(connection);
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error("TcpTransport: could not connect to rank 0");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+
+TcpTransport::~TcpTransport() {
+    for (auto s : sockets_) {
+        close(s);
+    }
+}
+
+
+std::vector<std::vector<char> > TcpTransport::all_gather(
+    const std::vector<char> &buffer
+) {
+    std::vector<std::vector<char> > buffers;
+
+    if (rank_ == 0) {
+        buffers.push_back(buffer);
+        for (auto s : sockets_) {
+            buffers.push_back(recv_buffer(s));
+        }
+        for (auto s : sockets_) {
+            for (auto & b : buffers) {
+                send_buffer(s, b);
+            }
+        }
+    } else {
+        send_buffer(sockets_[0], buffer);
+        for (int i=0; i<size_; i++) {
+            buffers.push_back(recv_buffer(sockets_[0]));
+        }
+    }
+
+    return buffers;
+}
+
+
+void TcpTransport::all_reduce(
+    std::vector<char> &buffer,
+    const std::function<void(std::vector<char> &, const std::vector<char> &)> &combine
+) {
+    if (rank_ == 0) {
+        // receive one buffer at a time in rank order
+        for (auto s : sockets_) {
+            combine(buffer, recv_buffer(s));
+        }
+        for (auto s : sockets_) {
+            send_buffer(s, buffer);
+        }
+    } else {
+        send_buffer(sockets_[0], buffer);
+        buffer = recv_buffer(sockets_[0]);
+    }
+}
+
+
+}  // namespace parallel
+}  // namespace ldaplusplus
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ldaplusplus/quantization.hpp"
+
+namespace ldaplusplus {
+namespace quantization {
+
+
+/**
+ * Code every probability of beta as one of 255 levels spaced
+ * logarithmically between the smallest positive probability of its topic
+ * (but no less than MIN_LEVEL times the largest) and the largest one. The
+ * code 0 is reserved for the probabilities that are exactly 0.
+ */
+template <typename Scalar>
+static void quantize_int8(
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &beta,
+    parameters::QuantizedModelParameters<Scalar> &quantized
+) {
+    const Scalar MIN_LEVEL = 1e-10;
+    const int LEVELS = 255;
+
+    quantized.beta_int8.resize(beta.rows(), beta.cols());
+    quantized.beta_levels = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>::Zero(
+        beta.rows(),
+        LEVELS + 1
+    );
+    for (int k=0; k<beta.rows(); k++) {
+        Scalar largest = beta.row(k).maxCoeff();
+        Scalar smallest = largest;
+        for (int w=0; w<beta.cols(); w++) {
+            if (beta(k, w) > 0) {
+                smallest = std::min(smallest, beta(k, w));
+            }
+        }
+        smallest = std::max(smallest, MIN_LEVEL * largest);
+
+        // the logarithmic distance between two consecutive levels
+        Scalar step = (largest > smallest) ?
+            std::log(largest / smallest) / (LEVELS - 1) : 0;
+        for (int q=1; q<=LEVELS; q++) {
+            quantized.beta_levels(k, q) = largest * std::exp((q - LEVELS) * step);
+        }
+
+        for (int w=0; w<beta.cols(); w++) {
+            int q = 0;
+            if (beta(k, w) > 0) {
+                q = (step > 0) ?
+                    LEVELS + static_cast<int>(std::round(std::log(beta(k, w) / largest) / step)) :
+                    LEVELS;
+                q = std::max(1, std::min(LEVELS, q));
+            }
+            quantized.beta_int8(k, w) = static_cast<std::uint8_t>(q);
+        }
+    }
+}
+
+
+template <typename Scalar>
+std::shared_ptr<parameters::QuantizedModelParameters<Scalar> > quantize(
+    const parameters::SupervisedModelParameters<Scalar> &model,
+    typename parameters::QuantizedModelParameters<Scalar>::Encoding encoding
+) {
+    typedef parameters::QuantizedModelParameters<Scalar> QuantizedModel;
+
+    auto quantized = std::make_shared<QuantizedModel>();
+    quantized->alpha = model.alpha;
+    quantized->eta = model.eta;
+    quantized->encoding = encoding;
+
+    const auto &beta = model.beta;
+
+    // The per topic scale maps the maximum of every topic to the largest
+    // representable value
+    quantized->beta_scale = beta.rowwise().maxCoeff();
+    for (int k=0; k<beta.rows(); k++) {
+        if (quantized->beta_scale[k] <= 0) {
+            quantized->beta_scale[k] = 1;
+        }
+    }
+
+    switch (encoding) {
+        case QuantizedModel::Float16:
+            quantized->beta_half.resize(beta.rows(), beta.cols());
+            for (int w=0; w<beta.cols(); w++) {
+                for (int k=0; k<beta.rows(); k++) {
+                    quantized->beta_half(k, w) = Eigen::half(
+                        static_cast<float>(beta(k, w) / quantized->beta_scale[k])
+                    );
+                }
+            }
+            break;
+        case QuantizedModel::Int8:
+            quantize_int8(beta, *quantized);
+            break;
+    }
+
+    return quantized;
+}
+
+
+template <typename Scalar>
+Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> dequantize(
+    const parameters::QuantizedModelParameters<Scalar> &model
+) {
+    typedef parameters::QuantizedModelParameters<Scalar> QuantizedModel;
+
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> beta;
+    switch (model.encoding) {
+        case QuantizedModel::Float16:
+            beta.resize(model.beta_half.rows(), model.beta_half.cols());
+            for (int w=0; w<beta.cols(); w++) {
+                for (int k=0; k<beta.rows(); k++) {
+                    beta(k, w) = static_cast<float>(model.beta_half(k, w));
+                }
+            }
+            break;
+        case QuantizedModel::Int8:
+            beta.resize(model.beta_int8.rows(), model.beta_int8.cols());
+            for (int w=0; w<beta.cols(); w++) {
+                for (int k=0; k<beta.rows(); k++) {
+                    beta(k, w) = model.beta_levels(k, model.beta_int8(k, w));
+                }
+            }
+            return beta;
+    }
+
+    return model.beta_scale.asDiagonal() * beta;
+}
+
+
+// Template instantiations
+template std::shared_ptr<parameters::QuantizedModelParameters<float> > quantize(
+    const parameters::SupervisedModelParameters<float> &model,
+    parameters::QuantizedModelParameters<float>::Encoding encoding
+);
+template std::shared_ptr<parameters::QuantizedModelParameters<double> > quantize(
+    const parameters::SupervisedModelParameters<double> &model,
+    parameters::QuantizedModelParameters<double>::Encoding encoding
+);
+template Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic> dequantize(
+    const parameters::QuantizedModelParameters<float> &model
+);
+template Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> dequantize(
+    const parameters::QuantizedModelParameters<double> &model
+);
+
+
+}  // namespace quantization
+}  // namespace ldaplusplus
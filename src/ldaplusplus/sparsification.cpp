@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "ldaplusplus/sparsification.hpp"
+
+namespace ldaplusplus {
+namespace sparsification {
+
+
+template <typename Scalar>
+std::shared_ptr<parameters::SparseModelParameters<Scalar> > sparsify(
+    const parameters::SupervisedModelParameters<Scalar> &model,
+    Scalar mass
+) {
+    if (!(mass > 0 && mass <= 1)) {
+        throw std::invalid_argument("The probability mass to keep should be "
+                                    "in (0, 1]");
+    }
+
+    auto sparse = std::make_shared<parameters::SparseModelParameters<Scalar> >();
+    sparse->alpha = model.alpha;
+    sparse->eta = model.eta;
+
+    const auto &beta = model.beta;
+    std::vector<Eigen::Triplet<Scalar> > kept;
+    std::vector<int> order(beta.rows());
+    for (int w=0; w<beta.cols(); w++) {
+        // sort the topics by decreasing probability for this word
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&beta, w](int a, int b) {
+            return beta(a, w) > beta(b, w);
+        });
+
+        Scalar total = beta.col(w).sum();
+        Scalar cumulative = 0;
+        for (int k : order) {
+            if (beta(k, w) <= 0 || cumulative >= mass * total) {
+                break;
+            }
+            kept.emplace_back(k, w, beta(k, w));
+            cumulative += beta(k, w);
+        }
+    }
+
+    sparse->beta_sparse.resize(beta.rows(), beta.cols());
+    sparse->beta_sparse.setFromTriplets(kept.begin(), kept.end());
+    sparse->beta_sparse.makeCompressed();
+
+    return sparse;
+}
+
+
+// Template instantiations
+template std::shared_ptr<parameters::SparseModelParameters<float> > sparsify(
+    const parameters::SupervisedModelParameters<float> &model,
+    float mass
+);
+template std::shared_ptr<parameters::SparseModelParameters<double> > sparsify(
+    const parameters::SupervisedModelParameters<double> &model,
+    double mass
+);
+
+
+}  // namespace sparsification
+}  // namespace ldaplusplus
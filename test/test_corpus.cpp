@@ -1,5 +1,7 @@
+#include <cstdlib>
 
 #include <memory>
+#include <vector>
 
 #include <Eigen/Core>
 #include <gtest/gtest.h>
@@ -47,3 +49,58 @@ TEST(TestCorpus, TestEigenCorpus) {
         }
     }
 }
+
+TEST(TestCorpus, TestDocumentIds) {
+    MatrixXi X = MatrixXi::Random(10, 100).array().abs().matrix();
+    VectorXi y = VectorXi::Zero(100);
+
+    auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+    corpus->shuffle();
+
+    // The ids are the columns of X regardless of the shuffling
+    for (int i=0; i<100; i++) {
+        auto doc = corpus->at(i);
+        ASSERT_EQ(X.col(doc->get_id()), doc->get_words());
+    }
+    ASSERT_EQ(-1, corpus::EigenDocument(X.col(0)).get_id());
+}
+
+TEST(TestCorpus, TestCountWords) {
+    MatrixXi X = MatrixXi::Random(10, 100).unaryExpr([](int x) { return std::abs(x) % 3; });
+    VectorXi y = VectorXi::Zero(100);
+
+    auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+    corpus->shuffle();
+
+    // The counts are the ones of the shuffled documents
+    for (int i=0; i<100; i++) {
+        size_t distinct_words, total_words;
+        corpus->count_words(i, distinct_words, total_words);
+        auto doc = corpus->at(i);
+        ASSERT_EQ((doc->get_words().array() > 0).count(), distinct_words);
+        ASSERT_EQ(doc->get_words().sum(), total_words);
+    }
+}
+
+TEST(TestCorpus, TestWords) {
+    MatrixXi X = MatrixXi::Ones(10, 100);
+    VectorXi y = VectorXi::Zero(100);
+
+    ASSERT_EQ(10u, corpus::EigenCorpus(X).words());
+    ASSERT_EQ(10u, corpus::EigenClassificationCorpus(X, y).words());
+
+    // The default implementation asks the first document
+    struct DocumentsCorpus : public corpus::Corpus
+    {
+        size_t size() const override { return documents.size(); }
+        const std::shared_ptr<corpus::Document> at(size_t index) const override {
+            return documents[index];
+        }
+        void shuffle() override {}
+
+        std::vector<std::shared_ptr<corpus::Document> > documents;
+    } documents;
+    ASSERT_EQ(0u, documents.words());
+    documents.documents.push_back(std::make_shared<corpus::EigenDocument>(X.col(0)));
+    ASSERT_EQ(10u, documents.words());
+}
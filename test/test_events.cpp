@@ -0,0 +1,141 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ldaplusplus/events/Events.hpp"
+#include "ldaplusplus/events/ProgressEvents.hpp"
+
+using namespace ldaplusplus;
+
+
+TEST(TestEvents, TypeTags) {
+    size_t expectation = events::ExpectationProgressEvent<double>::type_tag();
+
+    // The tag depends only on the id
+    EXPECT_EQ(expectation, events::ExpectationProgressEvent<float>::type_tag());
+    EXPECT_EQ(expectation, events::event_type("ExpectationProgressEvent"));
+    EXPECT_NE(expectation, events::EpochProgressEvent<double>::type_tag());
+    EXPECT_EQ("ExpectationProgressEvent", events::event_id(expectation));
+
+    events::ExpectationProgressEvent<double> event(-1.0);
+    EXPECT_EQ(expectation, event.type());
+    EXPECT_EQ("ExpectationProgressEvent", event.id());
+
+    events::Event custom("TestEventsCustomEvent");
+    EXPECT_EQ(events::event_type("TestEventsCustomEvent"), custom.type());
+    EXPECT_EQ("TestEventsCustomEvent", custom.id());
+}
+
+
+TEST(TestEvents, RoutingByType) {
+    size_t expectation = events::ExpectationProgressEvent<double>::type_tag();
+    size_t epoch = events::EpochProgressEvent<double>::type_tag();
+
+    std::vector<std::shared_ptr<events::EventDispatcherInterface> > dispatchers = {
+        std::make_shared<events::EventDispatcher>(),
+        std::make_shared<events::SameThreadEventDispatcher>()
+    };
+    for (auto dispatcher : dispatchers) {
+        int all = 0, expectations = 0, epochs = 0;
+        dispatcher->add_listener(
+            [&all](std::shared_ptr<events::Event> event) { all++; }
+        );
+        dispatcher->add_listener(
+            [&expectations, expectation](std::shared_ptr<events::Event> event) {
+                EXPECT_EQ(expectation, event->type());
+                expectations++;
+            },
+            {expectation}
+        );
+        auto l = dispatcher->add_listener(
+            [&epochs](std::shared_ptr<events::Event> event) { epochs++; },
+            {expectation, epoch}
+        );
+
+        for (int i=0; i<3; i++) {
+            dispatcher->dispatch<events::ExpectationProgressEvent<double> >(-1.0);
+        }
+        dispatcher->dispatch<events::MaximizationProgressEvent<double> >(-1.0);
+        dispatcher->dispatch<events::EpochProgressEvent<double> >(nullptr);
+        EXPECT_EQ(5, all);
+        EXPECT_EQ(3, expectations);
+        EXPECT_EQ(4, epochs);
+
+        dispatcher->remove_listener(l);
+        dispatcher->dispatch<events::EpochProgressEvent<double> >(nullptr);
+        dispatcher->dispatch<events::EpochProgressEvent<double> >(nullptr);
+        EXPECT_EQ(7, all);
+        EXPECT_EQ(4, epochs);
+    }
+}
+
+
+TEST(TestEvents, ListenersInOrder) {
+    size_t expectation = events::ExpectationProgressEvent<double>::type_tag();
+    size_t custom = events::event_type("TestEventsOrderEvent");
+
+    std::vector<std::shared_ptr<events::EventDispatcherInterface> > dispatchers = {
+        std::make_shared<events::EventDispatcher>(),
+        std::make_shared<events::SameThreadEventDispatcher>()
+    };
+    for (auto dispatcher : dispatchers) {
+        // typed and all the events listeners interleaved
+        std::vector<int> order;
+        dispatcher->add_listener(
+            [&order](std::shared_ptr<events::Event> event) { order.push_back(0); },
+            {expectation, custom}
+        );
+        dispatcher->add_listener(
+            [&order](std::shared_ptr<events::Event> event) { order.push_back(1); }
+        );
+        dispatcher->add_listener(
+            [&order](std::shared_ptr<events::Event> event) { order.push_back(2); },
+            {expectation}
+        );
+        dispatcher->add_listener(
+            [&order](std::shared_ptr<events::Event> event) { order.push_back(3); }
+        );
+        dispatcher->add_listener(
+            [&order](std::shared_ptr<events::Event> event) { order.push_back(4); },
+            {custom}
+        );
+
+        dispatcher->dispatch<events::ExpectationProgressEvent<double> >(-1.0);
+        EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), order);
+
+        order.clear();
+        dispatcher->dispatch<events::Event>(custom);
+        EXPECT_EQ(std::vector<int>({0, 1, 3, 4}), order);
+
+        order.clear();
+        dispatcher->dispatch<events::EpochProgressEvent<double> >(nullptr);
+        EXPECT_EQ(std::vector<int>({1, 3}), order);
+    }
+}
+
+
+TEST(TestEvents, IdsWhileRegistering) {
+    // new types are registered while other threads read the ids
+    std::vector<std::thread> readers;
+    for (int t=0; t<4; t++) {
+        readers.emplace_back([]() {
+            events::ExpectationProgressEvent<double> event(-1.0);
+            for (int i=0; i<10000; i++) {
+                ASSERT_EQ("ExpectationProgressEvent", event.id());
+            }
+        });
+    }
+    for (int i=0; i<100; i++) {
+        std::string id = "TestEventsRegistered" + std::to_string(i);
+        EXPECT_EQ(id, events::event_id(events::event_type(id)));
+    }
+    for (auto & t : readers) {
+        t.join();
+    }
+
+    EXPECT_THROW(events::event_id(1000000), std::out_of_range);
+}
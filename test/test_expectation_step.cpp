@@ -12,6 +12,7 @@
 #include "ldaplusplus/em/FastSupervisedEStep.hpp"
 #include "ldaplusplus/Parameters.hpp"
 #include "ldaplusplus/em/SupervisedEStep.hpp"
+#include "ldaplusplus/em/UnsupervisedEStep.hpp"
 #include "ldaplusplus/e_step_utils.hpp"
 
 using namespace Eigen;
@@ -206,3 +207,54 @@ TYPED_TEST(TestExpectationStep, FastDocEStep) {
         EXPECT_GT(likelihoods[i], likelihoods[i-1]);
     }
 }
+
+
+TYPED_TEST(TestExpectationStep, FixedTopicsDocEStep) {
+    VectorX<TypeParam> Xtmp = VectorX<TypeParam>::Random(100).array().abs() * 5;
+    VectorXi X = Xtmp.template cast<int>();
+    int y = 1;
+
+    auto doc = std::make_shared<corpus::ClassificationDecorator>(
+        std::make_shared<corpus::EigenDocument>(X),
+        y
+    );
+
+    VectorX<TypeParam> alpha = VectorX<TypeParam>::Constant(16, 0.1);
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Random(16, 100);
+    MatrixX<TypeParam> eta = MatrixX<TypeParam>::Random(16, 3);
+
+    // normalize beta
+    beta.array() -= beta.minCoeff() - 0.001;
+    beta.array().rowwise() /= beta.colwise().sum().array();
+
+    auto model = std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+        alpha,
+        beta,
+        eta
+    );
+
+    // The specialized steps should compute the same variational parameters
+    // as the dynamic ones
+    std::vector<std::shared_ptr<em::EStepInterface<TypeParam> > > dynamic_steps{
+        std::make_shared<em::UnsupervisedEStep<TypeParam> >(10, 1e-2, 0),
+        std::make_shared<em::FastSupervisedEStep<TypeParam> >(10, 1e-2, 1)
+    };
+    std::vector<std::shared_ptr<em::EStepInterface<TypeParam> > > fixed_steps{
+        std::make_shared<em::UnsupervisedEStep<TypeParam, 16> >(10, 1e-2, 0),
+        std::make_shared<em::FastSupervisedEStep<TypeParam, 16> >(10, 1e-2, 1)
+    };
+    for (size_t i=0; i<dynamic_steps.size(); i++) {
+        auto vp1 = std::static_pointer_cast<parameters::VariationalParameters<TypeParam> >(
+            dynamic_steps[i]->doc_e_step(doc, model)
+        );
+        auto vp2 = std::static_pointer_cast<parameters::VariationalParameters<TypeParam> >(
+            fixed_steps[i]->doc_e_step(doc, model)
+        );
+
+        ASSERT_EQ(vp1->gamma.rows(), vp2->gamma.rows());
+        for (int k=0; k<16; k++) {
+            EXPECT_NEAR(vp1->gamma[k], vp2->gamma[k], vp1->gamma[k]*1e-3);
+        }
+        EXPECT_TRUE(vp1->phi.isApprox(vp2->phi, 1e-3));
+    }
+}
@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+
+#include <unistd.h>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "applications/lda_io.hpp"
+#include "ldaplusplus/FeatureHasher.hpp"
+#include "ldaplusplus/NumpyFormat.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+TEST(FeatureHasher, Buckets) {
+    corpus::FeatureHasher hasher(100);
+    corpus::FeatureHasher same(100);
+    corpus::FeatureHasher other(100, 1);
+
+    std::set<size_t> used;
+    size_t different = 0;
+    for (size_t w=0; w<1000; w++) {
+        size_t b = hasher.bucket(w);
+        EXPECT_LT(b, 100u);
+        EXPECT_EQ(b, same.bucket(w));
+        different += b != other.bucket(w);
+        used.insert(b);
+    }
+
+    // consecutive ids are spread over (almost) all the buckets and the seed
+    // changes the mapping
+    EXPECT_GT(used.size(), 95u);
+    EXPECT_GT(different, 900u);
+
+    EXPECT_THROW(corpus::FeatureHasher(0), std::invalid_argument);
+}
+
+
+TEST(FeatureHasher, Transform) {
+    corpus::FeatureHasher hasher(8);
+    MatrixXi X = MatrixXi::Random(300, 20).unaryExpr([](int x) {
+        return std::abs(x) % 5;
+    });
+
+    MatrixXi H = hasher.transform(X);
+    ASSERT_EQ(8, H.rows());
+    ASSERT_EQ(20, H.cols());
+
+    // every count ends up in the bucket of its word
+    EXPECT_EQ(X.colwise().sum(), H.colwise().sum());
+    MatrixXi expected = MatrixXi::Zero(8, 20);
+    for (int w=0; w<300; w++) {
+        expected.row(hasher.bucket(w)) += X.row(w);
+    }
+    EXPECT_EQ(expected, H);
+}
+
+
+TEST(FeatureHasher, HashWhileReading) {
+    auto hasher = std::make_shared<corpus::FeatureHasher>(8);
+    MatrixXi X = MatrixXi::Random(300, 37).unaryExpr([](int x) {
+        return std::abs(x) % 5;
+    });
+    MatrixXi y = MatrixXi::Random(1, 37).unaryExpr([](int x) {
+        return std::abs(x) % 3;
+    });
+
+    char data_path[] = "/tmp/test_feature_hasher_XXXXXX";
+    close(mkstemp(data_path));
+    {
+        std::fstream data(data_path, std::ios::out | std::ios::binary);
+        data << numpy_format::NumpyOutput<int>(X);
+        data << numpy_format::NumpyOutput<int>(y);
+    }
+
+    // the blocks do not divide the documents evenly
+    MatrixXi H, labels;
+    io::parse_input_data(data_path, hasher, H, labels, 8);
+    EXPECT_EQ(hasher->transform(X), H);
+    EXPECT_EQ(y, labels);
+
+    io::parse_input_data(data_path, hasher, H, 100);
+    EXPECT_EQ(hasher->transform(X), H);
+
+    io::parse_input_data(data_path, nullptr, H, labels, 8);
+    EXPECT_EQ(X, H);
+    EXPECT_EQ(y, labels);
+
+    std::remove(data_path);
+}
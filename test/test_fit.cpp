@@ -1,13 +1,28 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
 #include <random>
+#include <sstream>
+#include <thread>
 #include <vector>
 
+#include <unistd.h>
+
 #include <Eigen/Core>
 #include <gtest/gtest.h>
 
 #include "test/utils.hpp"
 
+#include "applications/lda_io.hpp"
+#include "ldaplusplus/em/FastOnlineSupervisedMStep.hpp"
+#include "ldaplusplus/em/FastSupervisedEStep.hpp"
+#include "ldaplusplus/em/SelectiveUpdate.hpp"
+#include "ldaplusplus/em/UnsupervisedMStep.hpp"
 #include "ldaplusplus/LDABuilder.hpp"
 #include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/NumpyFormat.hpp"
 #include "ldaplusplus/events/ProgressEvents.hpp"
 
 using namespace Eigen;
@@ -66,3 +81,1077 @@ TYPED_TEST(TestFit, partial_fit) {
     //EXPECT_GT(likelihood, likelihood0);
     EXPECT_GT(py, py0);
 }
+
+
+TYPED_TEST(TestFit, partial_fit_growing_vocabulary) {
+    // The stream starts with 80 words and 20 more appear later
+    std::mt19937 rng;
+    rng.seed(0);
+    MatrixXi X(100, 40);
+    VectorXi y(40);
+    std::uniform_int_distribution<> class_generator(0, 3);
+    std::exponential_distribution<> words_generator(0.1);
+    for (int d=0; d<40; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+        y(d) = class_generator(rng);
+    }
+    MatrixXi X_old = X.topRows(80);
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_fast_supervised_e_step(10, 1e-2, 5).
+            set_fast_supervised_online_m_step(size_t(4), 1e-2, 10).
+            initialize_topics_seeded(X_old, 5).
+            initialize_eta_zeros(4);
+
+    lda.partial_fit(X_old, y);
+    EXPECT_EQ(80, lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >()->beta.cols());
+
+    lda.partial_fit(X, y);
+    auto model = lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    EXPECT_EQ(100, model->beta.cols());
+    EXPECT_TRUE(model->beta.allFinite());
+    EXPECT_TRUE(
+        model->beta.rowwise().sum().isApprox(VectorX<TypeParam>::Ones(5), 1e-4)
+    );
+
+    // batches without the new words are padded to the model's vocabulary
+    lda.partial_fit(X_old, y);
+    model = lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    EXPECT_EQ(100, model->beta.cols());
+    EXPECT_TRUE(model->beta.allFinite());
+}
+
+
+TYPED_TEST(TestFit, stale_synchronous_fit) {
+    // Build a corpus where the classes use distinct parts of the vocabulary
+    std::mt19937 rng(0);
+    MatrixXi X(120, 90);
+    VectorXi y(90);
+    std::uniform_int_distribution<> class_generator(0, 2);
+    std::exponential_distribution<> words_generator(0.5);
+    for (int d=0; d<90; d++) {
+        y(d) = class_generator(rng);
+        for (int w=0; w<120; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+            if (w % 3 == y(d)) {
+                X(w, d) += 2;
+            }
+        }
+    }
+
+    auto accuracy = [&X, &y](size_t staleness) {
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_iterations(10).
+            set_workers(2).
+            set_staleness(staleness).
+            set_fast_supervised_e_step().
+            set_fast_supervised_m_step().
+            initialize_topics_seeded(X, 6).
+            initialize_eta_zeros(3);
+        lda.fit(X, y);
+
+        auto model = lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+        LDA<TypeParam> inference = LDABuilder<TypeParam>().
+            set_workers(1).
+            set_classic_e_step(10, 1e-2, 0).
+            initialize_topics_from_model(model).
+            initialize_eta_from_model(model);
+
+        return (inference.predict(X).array() == y.array()).template cast<float>().mean();
+    };
+
+    float synchronous = accuracy(0);
+    EXPECT_GT(synchronous, 0.8);
+    EXPECT_GE(accuracy(1), synchronous - 0.05);
+    EXPECT_GE(accuracy(2), synchronous - 0.05);
+}
+
+
+TYPED_TEST(TestFit, stale_synchronous_converges) {
+    std::mt19937 rng(0);
+    MatrixXi X(90, 60);
+    VectorXi y(60);
+    std::exponential_distribution<> words_generator(0.5);
+    for (int d=0; d<60; d++) {
+        y(d) = d % 3;
+        for (int w=0; w<90; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+            if (w % 3 == y(d)) {
+                X(w, d) += 2;
+            }
+        }
+    }
+
+    // The per document lower bound of every epoch
+    auto fit = [&X, &y](size_t staleness) {
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_iterations(15).
+            set_workers(1).
+            set_staleness(staleness).
+            set_fast_supervised_e_step().
+            set_fast_supervised_m_step().
+            initialize_topics_seeded(X, 6).
+            initialize_eta_zeros(3);
+        std::vector<TypeParam> bounds;
+        lda.get_event_dispatcher()->add_listener(
+            [&bounds](std::shared_ptr<events::Event> event) {
+                if (event->id() == "ExpectationProgressEvent") {
+                    bounds.push_back(
+                        std::static_pointer_cast<events::ExpectationProgressEvent<TypeParam> >(event)->likelihood()
+                    );
+                }
+            }
+        );
+        lda.fit(X, y);
+
+        return bounds;
+    };
+
+    // A stale eta delays the convergence but reaches the same bound
+    auto synchronous = fit(0);
+    auto stale = fit(2);
+    ASSERT_EQ(synchronous.size(), stale.size());
+    EXPECT_GT(stale.back(), stale.front());
+    EXPECT_NEAR(synchronous.back(), stale.back(), std::abs(synchronous.back()) * 1e-2);
+}
+
+
+TYPED_TEST(TestFit, stale_synchronous_unsupervised) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 40);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<40; d++) {
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    // There is no eta to optimize in the background so the staleness bound
+    // changes nothing
+    auto fit = [&X](size_t staleness) {
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_iterations(3).
+            set_workers(1).
+            set_staleness(staleness).
+            initialize_topics_seeded(X, 4);
+        lda.fit(X);
+
+        return lda.template model_parameters<parameters::ModelParameters<TypeParam> >();
+    };
+
+    EXPECT_TRUE(fit(0)->beta.isApprox(fit(2)->beta));
+}
+
+
+TYPED_TEST(TestFit, stale_synchronous_fallback) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 40);
+    VectorXi y(40);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<40; d++) {
+        y(d) = d % 2;
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    // The online maximization step cannot be detached so the epochs remain
+    // synchronous and the fit completes normally
+    auto fit = [&X, &y](size_t staleness) {
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_iterations(3).
+            set_workers(1).
+            set_staleness(staleness).
+            set_fast_supervised_e_step().
+            set_fast_supervised_online_m_step(size_t(2), 1e-2, 8).
+            initialize_topics_seeded(X, 4).
+            initialize_eta_zeros(2);
+        lda.fit(X, y);
+
+        return lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    };
+
+    auto stale = fit(1);
+    EXPECT_TRUE(stale->beta.allFinite());
+    EXPECT_TRUE(stale->eta.allFinite());
+    EXPECT_TRUE(
+        stale->beta.rowwise().sum().isApprox(
+            Matrix<TypeParam, Dynamic, 1>::Ones(4), 1e-3
+        )
+    );
+}
+
+
+TYPED_TEST(TestFit, hogwild_fit) {
+    // Build a corpus where the classes use distinct parts of the vocabulary
+    std::mt19937 rng(0);
+    MatrixXi X(120, 200);
+    VectorXi y(200);
+    std::uniform_int_distribution<> class_generator(0, 2);
+    std::exponential_distribution<> words_generator(0.5);
+    for (int d=0; d<200; d++) {
+        y(d) = class_generator(rng);
+        for (int w=0; w<120; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+            if (w % 3 == y(d)) {
+                X(w, d) += 2;
+            }
+        }
+    }
+
+    // The workers update the model themselves
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_iterations(5).
+        set_workers(4).
+        set_fast_supervised_e_step().
+        set_fast_supervised_online_m_step(size_t(3), 1e-2, 10, 0.9, 0.1, 0.9, true).
+        initialize_topics_seeded(X, 6).
+        initialize_eta_zeros(3);
+    lda.fit(X, y);
+
+    auto model = lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    EXPECT_TRUE(model->beta.allFinite());
+    EXPECT_TRUE(model->eta.allFinite());
+
+    LDA<TypeParam> inference = LDABuilder<TypeParam>().
+        set_workers(1).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_from_model(model).
+        initialize_eta_from_model(model);
+    float accuracy = (inference.predict(X).array() == y.array()).template cast<float>().mean();
+    EXPECT_GT(accuracy, 0.8);
+}
+
+
+TYPED_TEST(TestFit, deterministic_fit) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 70);
+    VectorXi y(70);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<70; d++) {
+        y(d) = d % 3;
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    // The model does not depend on the number of workers, not even with
+    // an online maximization step
+    auto fit = [&X, &y](size_t workers, bool online) {
+        LDABuilder<TypeParam> builder;
+        builder.
+            set_iterations(3).
+            set_workers(workers).
+            set_deterministic(16).
+            set_fast_supervised_e_step().
+            initialize_topics_seeded(X, 4).
+            initialize_eta_zeros(3);
+        if (online) {
+            builder.set_fast_supervised_online_m_step(size_t(3), 1e-2, 10);
+        } else {
+            builder.set_fast_supervised_m_step();
+        }
+        LDA<TypeParam> lda = builder;
+        lda.fit(X, y);
+
+        return lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    };
+
+    for (bool online : {true, false}) {
+        auto single = fit(1, online);
+        for (size_t workers : {2, 4}) {
+            auto parallel = fit(workers, online);
+            EXPECT_EQ(single->beta, parallel->beta);
+            EXPECT_EQ(single->eta, parallel->eta);
+        }
+    }
+}
+
+
+TYPED_TEST(TestFit, deterministic_rejects_timing_dependent_modes) {
+    MatrixXi X = MatrixXi::Constant(20, 10, 1);
+
+    auto builder = [&X]() {
+        LDABuilder<TypeParam> builder;
+        builder.
+            set_deterministic(4).
+            set_fast_supervised_e_step().
+            initialize_topics_seeded(X, 2).
+            initialize_eta_zeros(2);
+        return builder;
+    };
+
+    LDABuilder<TypeParam> stale = builder();
+    stale.set_staleness(1);
+    EXPECT_THROW(LDA<TypeParam> lda = stale, std::runtime_error);
+
+    LDABuilder<TypeParam> hogwild = builder();
+    hogwild.set_fast_supervised_online_m_step(size_t(2), 1e-2, 4, 0.9, 0.1, 0.9, true);
+    EXPECT_THROW(LDA<TypeParam> lda = hogwild, std::runtime_error);
+}
+
+
+TYPED_TEST(TestFit, selective_update_fit) {
+    // Build a corpus where the classes use distinct parts of the vocabulary
+    std::mt19937 rng(0);
+    MatrixXi X(120, 90);
+    VectorXi y(90);
+    std::uniform_int_distribution<> class_generator(0, 2);
+    std::exponential_distribution<> words_generator(0.5);
+    for (int d=0; d<90; d++) {
+        y(d) = class_generator(rng);
+        for (int w=0; w<120; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+            if (w % 3 == y(d)) {
+                X(w, d) += 2;
+            }
+        }
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_iterations(10).
+        set_workers(2).
+        set_selective_update(1e-2, 2, 5).
+        set_fast_supervised_e_step().
+        set_fast_supervised_m_step().
+        initialize_topics_seeded(X, 6).
+        initialize_eta_zeros(3);
+
+    // Count the expectation steps of every epoch
+    std::vector<int> e_steps(1, 0);
+    lda.get_event_dispatcher()->add_listener(
+        [&e_steps](std::shared_ptr<events::Event> event) {
+            if (event->id() == "ExpectationProgressEvent") {
+                e_steps.back()++;
+            } else if (event->id() == "EpochProgressEvent") {
+                e_steps.push_back(0);
+            }
+        }
+    );
+    lda.fit(X, y);
+    e_steps.pop_back();
+
+    // Every document is processed in the full passes and some are skipped
+    // in between
+    ASSERT_EQ(10, e_steps.size());
+    EXPECT_EQ(90, e_steps[0]);
+    EXPECT_EQ(90, e_steps[5]);
+    EXPECT_LT(*std::min_element(e_steps.begin(), e_steps.end()), 90);
+
+    auto model = lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    EXPECT_TRUE(model->beta.allFinite());
+    EXPECT_TRUE(model->eta.allFinite());
+    LDA<TypeParam> inference = LDABuilder<TypeParam>().
+        set_workers(1).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_from_model(model).
+        initialize_eta_from_model(model);
+    EXPECT_GT((inference.predict(X).array() == y.array()).template cast<float>().mean(), 0.8);
+}
+
+
+TYPED_TEST(TestFit, selective_update_minibatches) {
+    // A document that converged is skipped with its cached parameters
+    em::SelectiveUpdate<TypeParam> selective(1e-2, 2, 0);
+    VectorXi words(6), other(6);
+    words << 4, 0, 0, 0, 0, 0;
+    other << 1, 1, 1, 1, 0, 0;
+    corpus::EigenDocument doc(words, nullptr, 0);
+    auto vp = std::make_shared<parameters::VariationalParameters<TypeParam> >(
+        VectorX<TypeParam>::Constant(3, 2.0),
+        MatrixX<TypeParam>::Constant(3, 6, 1.0/3)
+    );
+    selective.put(doc, vp);
+    selective.next_epoch();
+    selective.put(doc, vp);
+    selective.next_epoch();
+    ASSERT_NE(nullptr, selective.get(doc));
+
+    // but not in place of another document with the same id and length
+    corpus::EigenDocument same_id(other, nullptr, 0);
+    EXPECT_EQ(nullptr, selective.get(same_id));
+    selective.put(same_id, vp);
+    selective.next_epoch();
+    EXPECT_EQ(nullptr, selective.get(same_id));
+
+    // Train on two minibatches whose documents have the same ids and
+    // lengths but different words
+    std::mt19937 rng(0);
+    MatrixXi X1(60, 40), X2(60, 40);
+    VectorXi y(40);
+    std::exponential_distribution<> words_generator(0.5);
+    for (int d=0; d<40; d++) {
+        y(d) = d % 2;
+        for (int w=0; w<30; w++) {
+            X1(w + 30*y(d), d) = static_cast<int>(words_generator(rng)) + 1;
+            X1(w + 30*(1-y(d)), d) = 0;
+        }
+        // the same number of words over twice as many word ids
+        X2.col(d).setZero();
+        int total = X1.col(d).sum();
+        for (int i=0; i<total; i++) {
+            X2(i % 60, d)++;
+        }
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        set_selective_update(1e-1, 2, 0).
+        set_fast_supervised_e_step().
+        set_fast_supervised_m_step().
+        initialize_topics_seeded(X1, 4).
+        initialize_eta_zeros(2);
+    int e_steps = 0;
+    lda.get_event_dispatcher()->add_listener(
+        [&e_steps](std::shared_ptr<events::Event> event) { e_steps++; },
+        {events::ExpectationProgressEvent<TypeParam>::type_tag()}
+    );
+
+    auto first = std::make_shared<corpus::EigenClassificationCorpus>(X1, y);
+    for (int i=0; i<6; i++) {
+        lda.partial_fit(first);
+    }
+    e_steps = 0;
+    lda.partial_fit(std::make_shared<corpus::EigenClassificationCorpus>(X2, y));
+    EXPECT_EQ(40, e_steps);
+    lda.partial_fit(X2, y);
+    EXPECT_EQ(80, e_steps);
+
+    auto model = lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    EXPECT_TRUE(model->beta.allFinite());
+    EXPECT_TRUE(model->eta.allFinite());
+}
+
+
+TYPED_TEST(TestFit, numa_fit) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 70);
+    VectorXi y(70);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<70; d++) {
+        y(d) = d % 3;
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    // In deterministic mode the expectation steps of a window use the
+    // model of its start whether they read it from a replica or not
+    auto fit = [&X, &y](bool numa) {
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_iterations(3).
+            set_workers(4).
+            set_deterministic(16).
+            set_numa(numa).
+            set_fast_supervised_e_step().
+            set_fast_supervised_online_m_step(size_t(3), 1e-2, 10).
+            initialize_topics_seeded(X, 4).
+            initialize_eta_zeros(3);
+        lda.fit(X, y);
+
+        return lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    };
+
+    auto single_copy = fit(false);
+    auto replicated = fit(true);
+    EXPECT_EQ(single_copy->beta, replicated->beta);
+    EXPECT_EQ(single_copy->eta, replicated->eta);
+}
+
+/**
+ * A corpus that records the order in which its documents are read.
+ */
+class RecordingCorpus : public corpus::EigenCorpus
+{
+    public:
+        RecordingCorpus(const MatrixXi &X) : corpus::EigenCorpus(X) {}
+
+        const std::shared_ptr<corpus::Document> at(size_t index) const override {
+            auto doc = corpus::EigenCorpus::at(index);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                order_.push_back(doc->get_id());
+            }
+            return doc;
+        }
+
+        std::vector<size_t> order() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return order_;
+        }
+
+    private:
+        mutable std::mutex mutex_;
+        mutable std::vector<size_t> order_;
+};
+
+TYPED_TEST(TestFit, long_documents_first) {
+    std::mt19937 rng(0);
+    MatrixXi X(100, 40);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<40; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+    // the last two documents are a lot longer than the rest
+    for (int w=20; w<100; w++) {
+        X(w, 38) = 0;
+        X(w, 39) = 0;
+    }
+    X.col(38).head(20) *= 20;
+    X.col(39).head(20) *= 30;
+    for (int d=0; d<38; d++) {
+        X.col(d).tail(90).setZero();
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 4);
+    auto corpus = std::make_shared<RecordingCorpus>(X);
+    lda.partial_fit(corpus);
+
+    // the workers read the longest documents first (the maximization step
+    // reads every document once more)
+    auto order = corpus->order();
+    ASSERT_EQ(80u, order.size());
+    std::vector<size_t> first;
+    for (auto id : order) {
+        if (first.size() < 2 && std::find(first.begin(), first.end(), id) == first.end()) {
+            first.push_back(id);
+        }
+    }
+    std::sort(first.begin(), first.end());
+    EXPECT_EQ(38u, first[0]);
+    EXPECT_EQ(39u, first[1]);
+}
+
+
+template <typename Scalar>
+class RecordingMStep : public em::FastOnlineSupervisedMStep<Scalar>
+{
+    public:
+        RecordingMStep() : em::FastOnlineSupervisedMStep<Scalar>(size_t(2), 1e-2, 8) {}
+
+        void doc_m_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> v_parameters,
+            std::shared_ptr<parameters::Parameters> m_parameters
+        ) override {
+            order.push_back(doc->get_id());
+            em::FastOnlineSupervisedMStep<Scalar>::doc_m_step(doc, v_parameters, m_parameters);
+        }
+
+        std::vector<int> order;
+};
+
+TYPED_TEST(TestFit, long_documents_spread_for_online_m_step) {
+    std::mt19937 rng(0);
+    MatrixXi X(100, 80);
+    VectorXi y(80);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<80; d++) {
+        y(d) = d % 2;
+        for (int w=0; w<100; w++) {
+            X(w, d) = (w < 10) ? static_cast<int>(words_generator(rng)) : 0;
+        }
+    }
+    // four documents are a lot longer than the rest
+    for (int d=0; d<4; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = 1 + static_cast<int>(words_generator(rng));
+        }
+    }
+
+    auto m_step = std::make_shared<RecordingMStep<TypeParam> >();
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Ones(4, 100) / 100;
+    LDA<TypeParam> lda(
+        std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+            VectorX<TypeParam>::Constant(4, 0.1),
+            beta,
+            MatrixX<TypeParam>::Zero(4, 2)
+        ),
+        std::make_shared<em::FastSupervisedEStep<TypeParam> >(10, 1e-2),
+        m_step,
+        1,
+        2
+    );
+    lda.partial_fit(X, y);
+
+    // the minibatches at the start of the epoch are not made of the long
+    // documents alone
+    ASSERT_EQ(80u, m_step->order.size());
+    size_t last = 0;
+    for (size_t i=0; i<m_step->order.size(); i++) {
+        if (m_step->order[i] < 4) {
+            last = i;
+        }
+    }
+    EXPECT_GT(last, 40u);
+}
+
+
+TYPED_TEST(TestFit, checkpoint_resume) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 60);
+    VectorXi y(60);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<60; d++) {
+        y(d) = d % 3;
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    // The minibatches do not divide the corpus so a partially filled one
+    // is carried over to the next epoch, and the weight of the supervision
+    // decays with the epochs. The deterministic mode makes the training
+    // reproducible.
+    auto create = []() {
+        MatrixX<TypeParam> beta = MatrixX<TypeParam>::Ones(4, 50) / 50;
+        for (int k=0; k<4; k++) {
+            beta(k, k) += 0.1;
+        }
+        beta.array().colwise() /= beta.array().rowwise().sum();
+        return LDA<TypeParam>(
+            std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+                VectorX<TypeParam>::Constant(4, 0.1),
+                beta,
+                MatrixX<TypeParam>::Zero(4, 3)
+            ),
+            std::make_shared<em::FastSupervisedEStep<TypeParam> >(
+                10, 1e-2, 0.5,
+                em::FastSupervisedEStep<TypeParam>::ExponentialDecay,
+                0.5
+            ),
+            std::make_shared<em::FastOnlineSupervisedMStep<TypeParam> >(
+                size_t(3), 1e-2, 7
+            ),
+            20,
+            2,
+            0,
+            16
+        );
+    };
+
+    auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+    LDA<TypeParam> uninterrupted = create();
+    for (int i=0; i<4; i++) {
+        uninterrupted.partial_fit(corpus);
+    }
+
+    std::stringstream checkpoint;
+    {
+        auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+        LDA<TypeParam> interrupted = create();
+        for (int i=0; i<2; i++) {
+            interrupted.partial_fit(corpus);
+        }
+        interrupted.save_checkpoint(checkpoint, corpus);
+    }
+
+    auto resumed_corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+    LDA<TypeParam> resumed = create();
+    resumed.load_checkpoint(checkpoint, resumed_corpus);
+    for (int i=0; i<2; i++) {
+        resumed.partial_fit(resumed_corpus);
+    }
+
+    auto expected = uninterrupted.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    auto actual = resumed.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    EXPECT_EQ(expected->beta, actual->beta);
+    EXPECT_EQ(expected->eta, actual->eta);
+
+    // A checkpoint cannot be loaded by a differently configured LDA
+    std::stringstream other;
+    uninterrupted.save_checkpoint(other);
+    LDA<TypeParam> unsupervised(
+        std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(),
+        std::make_shared<em::FastSupervisedEStep<TypeParam> >(),
+        std::make_shared<em::UnsupervisedMStep<TypeParam> >()
+    );
+    EXPECT_THROW(unsupervised.load_checkpoint(other), std::runtime_error);
+}
+
+
+TYPED_TEST(TestFit, checkpoint_invalid) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 40);
+    VectorXi y(40);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<40; d++) {
+        y(d) = d % 3;
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+    auto create = [](size_t minibatch_size) {
+        return LDA<TypeParam>(
+            std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+                VectorX<TypeParam>::Constant(4, 0.1),
+                MatrixX<TypeParam>::Ones(4, 50) / 50,
+                MatrixX<TypeParam>::Zero(4, 3)
+            ),
+            std::make_shared<em::FastSupervisedEStep<TypeParam> >(
+                10, 1e-2, 0.5,
+                em::FastSupervisedEStep<TypeParam>::ExponentialDecay,
+                0.5
+            ),
+            std::make_shared<em::FastOnlineSupervisedMStep<TypeParam> >(
+                size_t(3), 1e-2, minibatch_size
+            )
+        );
+    };
+    auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+
+    LDA<TypeParam> lda = create(7);
+    lda.partial_fit(corpus);
+    std::stringstream before;
+    lda.save_checkpoint(before, corpus);
+
+    // The expectation step state of the checkpoint is valid but the
+    // maximization step was trained with a different minibatch size, so
+    // nothing is restored
+    auto other_corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+    LDA<TypeParam> other = create(5);
+    for (int i=0; i<3; i++) {
+        other.partial_fit(other_corpus);
+    }
+    std::stringstream checkpoint;
+    other.save_checkpoint(checkpoint, other_corpus);
+    EXPECT_THROW(lda.load_checkpoint(checkpoint, corpus), std::runtime_error);
+
+    std::stringstream after;
+    lda.save_checkpoint(after, corpus);
+    EXPECT_EQ(before.str(), after.str());
+
+    // and neither does a truncated checkpoint
+    std::string truncated = before.str();
+    truncated.resize(truncated.size() - 1);
+    std::stringstream truncated_checkpoint(truncated);
+    EXPECT_THROW(lda.load_checkpoint(truncated_checkpoint), std::runtime_error);
+    std::stringstream after_truncated;
+    lda.save_checkpoint(after_truncated, corpus);
+    EXPECT_EQ(before.str(), after_truncated.str());
+}
+
+
+TYPED_TEST(TestFit, fit_with_checkpoints) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 40);
+    VectorXi y(40);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<40; d++) {
+        y(d) = d % 3;
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+    auto create = []() {
+        return LDA<TypeParam>(
+            std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+                VectorX<TypeParam>::Constant(4, 0.1),
+                MatrixX<TypeParam>::Ones(4, 50) / 50 +
+                    MatrixX<TypeParam>::Identity(4, 50) / 10,
+                MatrixX<TypeParam>::Zero(4, 3)
+            ),
+            std::make_shared<em::FastSupervisedEStep<TypeParam> >(10, 1e-2, 0.5),
+            std::make_shared<em::FastOnlineSupervisedMStep<TypeParam> >(
+                size_t(3), 1e-2, 7
+            ),
+            20,
+            2,
+            0,
+            8
+        );
+    };
+
+    LDA<TypeParam> uninterrupted = create();
+    auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+    for (int i=0; i<4; i++) {
+        uninterrupted.partial_fit(corpus);
+    }
+
+    // A training preempted after 2 epochs continues from its checkpoint
+    char path[] = "/tmp/test_fit_checkpoint_XXXXXX";
+    close(mkstemp(path));
+    std::remove(path);
+    {
+        LDA<TypeParam> preempted = create();
+        io::fit_with_checkpoints<TypeParam>(
+            path,
+            preempted,
+            std::make_shared<corpus::EigenClassificationCorpus>(X, y),
+            2
+        );
+    }
+    LDA<TypeParam> resumed = create();
+    io::fit_with_checkpoints<TypeParam>(
+        path,
+        resumed,
+        std::make_shared<corpus::EigenClassificationCorpus>(X, y),
+        4
+    );
+    std::remove(path);
+
+    auto expected = uninterrupted.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    auto actual = resumed.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    EXPECT_EQ(expected->beta, actual->beta);
+    EXPECT_EQ(expected->eta, actual->eta);
+}
+
+
+TYPED_TEST(TestFit, streaming_transform) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 70);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<70; d++) {
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 4);
+    MatrixX<TypeParam> gammas = lda.transform(X);
+
+    // The blocks arrive in order and together they are the whole transform
+    MatrixX<TypeParam> streamed(4, 0);
+    std::vector<size_t> firsts;
+    lda.transform(
+        std::make_shared<corpus::EigenCorpus>(X),
+        [&](size_t first, const MatrixX<TypeParam> &block) {
+            EXPECT_EQ(static_cast<size_t>(streamed.cols()), first);
+            EXPECT_LE(block.cols(), 16);
+            streamed.conservativeResize(Eigen::NoChange, first + block.cols());
+            streamed.middleCols(first, block.cols()) = block;
+            firsts.push_back(first);
+        },
+        16
+    );
+    EXPECT_EQ(5u, firsts.size());
+    EXPECT_EQ(gammas, streamed);
+
+    // A sink that fails stops the transform and leaves the LDA usable
+    EXPECT_THROW(
+        lda.transform(
+            std::make_shared<corpus::EigenCorpus>(X),
+            [](size_t first, const MatrixX<TypeParam> &block) {
+                if (first > 0) {
+                    throw std::runtime_error("Full disk");
+                }
+            },
+            16
+        ),
+        std::runtime_error
+    );
+    EXPECT_EQ(gammas, lda.transform(X));
+
+    // and the same goes for transforming a file a block at a time
+    char data_path[] = "/tmp/test_fit_data_XXXXXX";
+    char output_path[] = "/tmp/test_fit_output_XXXXXX";
+    close(mkstemp(data_path));
+    close(mkstemp(output_path));
+    numpy_format::save(data_path, X);
+    io::transform_input_data<TypeParam>(data_path, nullptr, lda, output_path, 16);
+    EXPECT_EQ(gammas, numpy_format::load<TypeParam>(output_path));
+    std::remove(data_path);
+    std::remove(output_path);
+}
+
+
+TYPED_TEST(TestFit, streaming_transform_bounded) {
+    // A heavy tailed corpus: the first document takes a lot longer than all
+    // the rest together
+    class SlowFirstCorpus : public RecordingCorpus
+    {
+        public:
+            SlowFirstCorpus(const MatrixXi &X) : RecordingCorpus(X) {}
+
+            const std::shared_ptr<corpus::Document> at(size_t index) const override {
+                if (index == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                }
+                return RecordingCorpus::at(index);
+            }
+    };
+
+    std::mt19937 rng(0);
+    MatrixXi X(20, 3000);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<3000; d++) {
+        for (int w=0; w<20; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 4);
+    MatrixX<TypeParam> gammas = lda.transform(X);
+
+    // The other worker does not run ahead of the stream by more than a
+    // window of documents while the first one is transformed
+    auto corpus = std::make_shared<SlowFirstCorpus>(X);
+    MatrixX<TypeParam> streamed(4, 3000);
+    size_t most_ahead = 0;
+    lda.transform(
+        corpus,
+        [&](size_t first, const MatrixX<TypeParam> &block) {
+            size_t read = corpus->order().size();
+            most_ahead = std::max(most_ahead, read - first - block.cols());
+            streamed.middleCols(first, block.cols()) = block;
+        },
+        16
+    );
+    EXPECT_LE(most_ahead, 2*256u);
+    EXPECT_EQ(gammas, streamed);
+}
+
+
+TYPED_TEST(TestFit, transform_predict_into_outputs) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 30);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<30; d++) {
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 4).
+        initialize_eta_uniform(3);
+    MatrixX<TypeParam> gammas;
+    VectorXi predictions;
+    std::tie(gammas, predictions) = lda.transform_predict(X);
+    MatrixX<TypeParam> scores = lda.decision_function(X);
+
+    // The outputs can be blocks of larger buffers and reused
+    MatrixX<TypeParam> gammas_buffer = MatrixX<TypeParam>::Zero(4, 40);
+    MatrixX<TypeParam> scores_buffer = MatrixX<TypeParam>::Zero(3, 40);
+    VectorXi predictions_buffer = VectorXi::Zero(40);
+    for (int i=0; i<2; i++) {
+        lda.transform_predict(
+            X,
+            gammas_buffer.leftCols(30),
+            predictions_buffer.head(30)
+        );
+        EXPECT_EQ(gammas, gammas_buffer.leftCols(30));
+        EXPECT_EQ(predictions, predictions_buffer.head(30));
+
+        lda.decision_function(X, scores_buffer.leftCols(30));
+        EXPECT_TRUE(scores.isApprox(scores_buffer.leftCols(30), 1e-4));
+
+        predictions_buffer.setZero();
+        lda.predict(X, predictions_buffer.head(30));
+        EXPECT_EQ(predictions, predictions_buffer.head(30));
+    }
+    EXPECT_EQ(0, predictions_buffer.tail(10).sum());
+
+    // Outputs of the wrong size are rejected
+    EXPECT_THROW(
+        lda.transform(X, gammas_buffer.leftCols(29)),
+        std::invalid_argument
+    );
+    EXPECT_THROW(
+        lda.decision_function(X, gammas_buffer.leftCols(30)),
+        std::invalid_argument
+    );
+    EXPECT_THROW(
+        lda.predict(X, predictions_buffer),
+        std::invalid_argument
+    );
+    EXPECT_THROW(
+        lda.transform_predict(X, scores_buffer.leftCols(30), predictions_buffer.head(30)),
+        std::invalid_argument
+    );
+}
+
+
+TYPED_TEST(TestFit, submit_transform) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 60);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<60; d++) {
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(3).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 4);
+    MatrixX<TypeParam> gammas = lda.transform(X);
+
+    // Submit overlapping batches of different sizes from several threads
+    std::vector<std::thread> threads;
+    std::vector<MatrixX<TypeParam> > results(4);
+    for (int t=0; t<4; t++) {
+        threads.emplace_back([&, t]() {
+            auto large = lda.submit_transform(X);
+            auto small = lda.submit_transform(X.middleCols(t, 2));
+            results[t] = small.get();
+            EXPECT_EQ(gammas, large.get());
+        });
+    }
+    for (auto & t : threads) {
+        t.join();
+    }
+    for (int t=0; t<4; t++) {
+        EXPECT_EQ(gammas.middleCols(t, 2), results[t]);
+    }
+
+    EXPECT_EQ(0, lda.submit_transform(MatrixXi(50, 0)).get().cols());
+}
+
+
+TYPED_TEST(TestFit, submit_transform_while_training) {
+    std::mt19937 rng(0);
+    MatrixXi X(50, 60);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<60; d++) {
+        for (int w=0; w<50; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 4);
+
+    // the listeners are only called from this thread
+    std::thread::id owner = std::this_thread::get_id();
+    size_t expectations = 0;
+    lda.get_event_dispatcher()->add_listener(
+        [&](std::shared_ptr<events::Event> event) {
+            EXPECT_EQ(owner, std::this_thread::get_id());
+            expectations++;
+        },
+        {events::ExpectationProgressEvent<TypeParam>::type_tag()}
+    );
+
+    std::thread transforms([&]() {
+        for (int i=0; i<5; i++) {
+            EXPECT_EQ(60, lda.submit_transform(X).get().cols());
+        }
+    });
+    for (int i=0; i<3; i++) {
+        lda.partial_fit(std::make_shared<corpus::EigenCorpus>(X));
+    }
+    transforms.join();
+
+    // the events of the submitted transforms were left for this thread
+    lda.transform(X.leftCols(1));
+    EXPECT_EQ(3*60 + 5*60 + 1, expectations);
+}
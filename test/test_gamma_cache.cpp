@@ -0,0 +1,216 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "ldaplusplus/Document.hpp"
+#include "ldaplusplus/em/GammaCache.hpp"
+#include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+// T will be available as TypeParam in TYPED_TEST functions
+template <typename T>
+class TestGammaCache : public ParameterizedTest<T> {};
+
+TYPED_TEST_CASE(TestGammaCache, ForFloatAndDouble);
+
+
+TYPED_TEST(TestGammaCache, GetPut) {
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<> words_generator(0, 10);
+    MatrixXi X(20, 3);
+    for (int i=0; i<X.size(); i++) {
+        X(i) = words_generator(rng);
+    }
+    corpus::EigenCorpus corpus(X);
+    VectorX<TypeParam> gamma = VectorX<TypeParam>::Constant(4, 1.5);
+    VectorX<TypeParam> cached;
+    char cache_path[] = "/tmp/test_gamma_cache_XXXXXX";
+    close(mkstemp(cache_path));
+
+    for (std::string path : std::vector<std::string>{"", cache_path}) {
+        em::GammaCache<TypeParam> cache(4, 2, path);
+
+        // empty
+        EXPECT_FALSE(cache.get(*corpus.at(0), cached));
+
+        // round trip
+        cache.put(*corpus.at(0), gamma);
+        ASSERT_TRUE(cache.get(*corpus.at(0), cached));
+        EXPECT_EQ(gamma, cached);
+        EXPECT_FALSE(cache.get(*corpus.at(1), cached));
+
+        // different document with the same id
+        VectorXi other = X.col(0);
+        other(0) += 1;
+        EXPECT_FALSE(cache.get(corpus::EigenDocument(other, nullptr, 0), cached));
+
+        // even with the same number of words
+        VectorXi reversed = X.col(0).reverse();
+        ASSERT_NE(X.col(0), reversed);
+        EXPECT_FALSE(cache.get(corpus::EigenDocument(reversed, nullptr, 0), cached));
+
+        // documents without an id or beyond the cache are never cached
+        cache.put(*corpus.at(2), gamma);
+        EXPECT_FALSE(cache.get(*corpus.at(2), cached));
+        cache.put(corpus::EigenDocument(X.col(1)), gamma);
+        EXPECT_FALSE(cache.get(corpus::EigenDocument(X.col(1)), cached));
+    }
+    std::remove(cache_path);
+}
+
+
+TYPED_TEST(TestGammaCache, WarmStart) {
+    std::mt19937 rng(0);
+    MatrixXi X(100, 80);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<80; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    // Count the E step iterations in every epoch
+    auto fit = [&X](bool warm_start) {
+        LDABuilder<TypeParam> builder;
+        builder.
+            set_iterations(5).
+            set_workers(2).
+            set_classic_e_step(100, 1e-3).
+            initialize_topics_seeded(X, 10);
+        if (warm_start) {
+            builder.set_gamma_cache(X.cols());
+        }
+        LDA<TypeParam> lda = builder;
+
+        std::vector<size_t> iterations(1, 0), warm_started(1, 0);
+        lda.get_event_dispatcher()->add_listener(
+            [&](std::shared_ptr<events::Event> event) {
+                if (event->id() == "ExpectationProgressEvent") {
+                    auto progress = std::static_pointer_cast<events::ExpectationProgressEvent<TypeParam> >(event);
+                    iterations.back() += progress->iterations();
+                    warm_started.back() += progress->warm_started();
+                } else if (event->id() == "EpochProgressEvent") {
+                    iterations.push_back(0);
+                    warm_started.push_back(0);
+                }
+            }
+        );
+        lda.fit(X);
+        iterations.pop_back();
+        warm_started.pop_back();
+
+        return std::make_pair(iterations, warm_started);
+    };
+
+    auto cold = fit(false);
+    auto warm = fit(true);
+
+    // Only the first epoch starts cold
+    EXPECT_EQ(0, warm.second[0]);
+    for (size_t i=1; i<warm.second.size(); i++) {
+        EXPECT_EQ(80, warm.second[i]);
+    }
+    EXPECT_EQ(0, cold.second.back());
+
+    // and the later epochs need a lot fewer iterations
+    EXPECT_EQ(cold.first[0], warm.first[0]);
+    EXPECT_LT(2 * warm.first.back(), cold.first.back());
+}
+
+
+TYPED_TEST(TestGammaCache, OnlyTrainingUsesTheCache) {
+    std::mt19937 rng(0);
+    MatrixXi X(100, 40);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<40; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+    // other documents with the same ids
+    MatrixXi other = X;
+    other.row(0).array() += 1;
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_iterations(1).
+        set_workers(2).
+        set_classic_e_step(100, 1e-3).
+        set_gamma_cache(X.cols()).
+        initialize_topics_seeded(X, 10);
+
+    size_t expectations = 0, warm_started = 0;
+    lda.get_event_dispatcher()->add_listener(
+        [&](std::shared_ptr<events::Event> event) {
+            if (event->id() == "ExpectationProgressEvent") {
+                auto progress = std::static_pointer_cast<events::ExpectationProgressEvent<TypeParam> >(event);
+                expectations++;
+                warm_started += progress->warm_started();
+            }
+        }
+    );
+    lda.fit(X);
+
+    // transforming neither reads the cache
+    expectations = warm_started = 0;
+    lda.transform(X);
+    EXPECT_EQ(40, expectations);
+    EXPECT_EQ(0, warm_started);
+
+    // nor overwrites it
+    lda.transform(other);
+    lda.partial_fit(std::make_shared<corpus::EigenCorpus>(X));
+    EXPECT_EQ(40, warm_started);
+}
+
+
+TYPED_TEST(TestGammaCache, Minibatches) {
+    // Two minibatches whose documents have the same ids and number of
+    // words but different words
+    std::mt19937 rng(0);
+    MatrixXi X1(100, 40), X2(100, 40);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<40; d++) {
+        for (int w=0; w<100; w++) {
+            X1(w, d) = static_cast<int>(words_generator(rng));
+        }
+        X2.col(d) = X1.col(d).reverse();
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        set_classic_e_step(100, 1e-3).
+        set_gamma_cache(40).
+        initialize_topics_seeded(X1, 10);
+
+    size_t warm_started = 0;
+    lda.get_event_dispatcher()->add_listener(
+        [&](std::shared_ptr<events::Event> event) {
+            auto progress = std::static_pointer_cast<events::ExpectationProgressEvent<TypeParam> >(event);
+            warm_started += progress->warm_started();
+        },
+        {events::ExpectationProgressEvent<TypeParam>::type_tag()}
+    );
+
+    lda.partial_fit(X1, VectorXi::Zero(40));
+    lda.partial_fit(X2, VectorXi::Zero(40));
+    EXPECT_EQ(0, warm_started);
+
+    // the documents of the same minibatch start from their own gamma
+    lda.partial_fit(X2, VectorXi::Zero(40));
+    EXPECT_EQ(40, warm_started);
+}
@@ -0,0 +1,191 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "applications/InferenceServer.hpp"
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+// T will be available as TypeParam in TYPED_TEST functions
+template <typename T>
+class TestInferenceServer : public ParameterizedTest<T>
+{
+    protected:
+        void SetUp() override {
+            std::mt19937 rng(0);
+            std::exponential_distribution<> words_generator(0.3);
+            X_.resize(30, 20);
+            for (int i=0; i<X_.size(); i++) {
+                X_(i) = static_cast<int>(words_generator(rng));
+            }
+
+            lda_ = std::make_shared<LDA<T> >(LDABuilder<T>().
+                set_iterations(2).
+                set_classic_e_step(20, 1e-3, 0).
+                initialize_topics_seeded(X_, 4)
+            );
+            lda_->fit(X_);
+
+            // listen on a fresh path
+            char directory[] = "/tmp/test_inference_server_XXXXXX";
+            ASSERT_NE(nullptr, mkdtemp(directory));
+            directory_ = directory;
+            socket_path_ = directory_ + "/socket";
+
+            server_ = std::make_shared<InferenceServer<T> >(
+                *lda_, X_.rows(), false, 4, std::chrono::microseconds(1000)
+            );
+            serving_ = std::thread([this]() { server_->serve(socket_path_); });
+        }
+
+        void TearDown() override {
+            server_->stop();
+            serving_.join();
+            rmdir(directory_.c_str());
+        }
+
+        int connect_to_server() {
+            sockaddr_un address;
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            std::strcpy(address.sun_path, socket_path_.c_str());
+
+            // the server may not be listening yet
+            for (int attempt=0; attempt<1000; attempt++) {
+                int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+                if (connect(connection, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0) {
+                    return connection;
+                }
+                close(connection);
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+
+            return -1;
+        }
+
+        void send_request(int connection, uint8_t type, uint32_t N, const std::vector<uint32_t> &pairs) {
+            ASSERT_EQ(1, send(connection, &type, 1, 0));
+            ASSERT_EQ(4, send(connection, &N, 4, 0));
+            if (!pairs.empty()) {
+                ssize_t bytes = pairs.size() * sizeof(uint32_t);
+                ASSERT_EQ(bytes, send(connection, pairs.data(), bytes, 0));
+            }
+        }
+
+        /**
+         * @return False if the connection was closed
+         */
+        bool receive_response(int connection, int32_t &status, VectorXd &gamma) {
+            uint32_t K;
+            if (recv(connection, &status, 4, MSG_WAITALL) != 4 ||
+                recv(connection, &K, 4, MSG_WAITALL) != 4) {
+                return false;
+            }
+            gamma.resize(K);
+            ssize_t bytes = K * sizeof(double);
+
+            return K == 0 || recv(connection, gamma.data(), bytes, MSG_WAITALL) == bytes;
+        }
+
+        MatrixXi X_;
+        std::shared_ptr<LDA<T> > lda_;
+        std::string directory_;
+        std::string socket_path_;
+        std::shared_ptr<InferenceServer<T> > server_;
+        std::thread serving_;
+};
+
+TYPED_TEST_CASE(TestInferenceServer, ForFloatAndDouble);
+
+
+TYPED_TEST(TestInferenceServer, Transform) {
+    MatrixX<TypeParam> expected = this->lda_->transform(this->X_.leftCols(1));
+
+    int connection = this->connect_to_server();
+    ASSERT_LE(0, connection);
+
+    // the document in pairs with the first word split over two pairs
+    std::vector<uint32_t> pairs;
+    for (int w=0; w<this->X_.rows(); w++) {
+        if (this->X_(w, 0) > 1 && pairs.empty()) {
+            pairs.insert(pairs.end(), {uint32_t(w), 1, uint32_t(w), uint32_t(this->X_(w, 0) - 1)});
+        } else if (this->X_(w, 0) > 0) {
+            pairs.insert(pairs.end(), {uint32_t(w), uint32_t(this->X_(w, 0))});
+        }
+    }
+
+    int32_t status;
+    VectorXd gamma;
+    for (int i=0; i<3; i++) {
+        this->send_request(connection, 0, pairs.size() / 2, pairs);
+        ASSERT_TRUE(this->receive_response(connection, status, gamma));
+        EXPECT_EQ(0, status);
+        ASSERT_EQ(4, gamma.rows());
+        EXPECT_TRUE(expected.col(0).template cast<double>().isApprox(gamma, 1e-4));
+    }
+
+    close(connection);
+}
+
+
+TYPED_TEST(TestInferenceServer, MalformedRequests) {
+    int connection = this->connect_to_server();
+    ASSERT_LE(0, connection);
+    int32_t status;
+    VectorXd gamma;
+    uint32_t max_count = std::numeric_limits<int>::max();
+
+    // invalid requests get an invalid response and the connection goes on
+    std::vector<std::pair<uint8_t, std::vector<uint32_t> > > invalid = {
+        {2, {0, 1}},                    // unknown type
+        {1, {0, 1}},                    // no predictions without supervision
+        {0, {30, 1}},                   // word out of the vocabulary
+        {0, {0, max_count, 0, 1}}       // the count overflows
+    };
+    for (auto &request : invalid) {
+        this->send_request(connection, request.first, request.second.size() / 2, request.second);
+        ASSERT_TRUE(this->receive_response(connection, status, gamma));
+        EXPECT_EQ(-1, status);
+        EXPECT_EQ(0, gamma.rows());
+    }
+    this->send_request(connection, 0, 1, {0, max_count});
+    ASSERT_TRUE(this->receive_response(connection, status, gamma));
+    EXPECT_EQ(0, status);
+
+    // a request larger than the vocabulary closes the connection before
+    // anything is allocated for it
+    this->send_request(connection, 0, std::numeric_limits<uint32_t>::max(), {});
+    ASSERT_TRUE(this->receive_response(connection, status, gamma));
+    EXPECT_EQ(-1, status);
+    EXPECT_FALSE(this->receive_response(connection, status, gamma));
+    close(connection);
+
+    // and the server keeps serving
+    connection = this->connect_to_server();
+    ASSERT_LE(0, connection);
+    this->send_request(connection, 0, 1, {3, 2});
+    ASSERT_TRUE(this->receive_response(connection, status, gamma));
+    EXPECT_EQ(0, status);
+    EXPECT_EQ(4, gamma.rows());
+    close(connection);
+}
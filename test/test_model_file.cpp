@@ -0,0 +1,288 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "applications/lda_io.hpp"
+#include "ldaplusplus/FeatureHasher.hpp"
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/ModelFile.hpp"
+#include "ldaplusplus/Parameters.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+// T will be available as TypeParam in TYPED_TEST functions
+template <typename T>
+class TestModelFile : public ParameterizedTest<T> {};
+
+TYPED_TEST_CASE(TestModelFile, ForFloatAndDouble);
+
+
+TYPED_TEST(TestModelFile, SaveMap) {
+    auto model = std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+        VectorX<TypeParam>::Random(7),
+        MatrixX<TypeParam>::Random(7, 33),
+        MatrixX<TypeParam>::Random(7, 3)
+    );
+    char temporary_path[] = "/tmp/test_model_file_XXXXXX";
+    close(mkstemp(temporary_path));
+    std::string path = temporary_path;
+
+    for (bool row_major : {false, true}) {
+        model_file::save<TypeParam>(path, model, row_major);
+        ASSERT_TRUE(model_file::is_model_file(path));
+
+        model_file::MappedModel<TypeParam> mapped(path, true);
+        EXPECT_EQ(7u, mapped.topics());
+        EXPECT_EQ(33u, mapped.words());
+        EXPECT_EQ(3u, mapped.classes());
+        EXPECT_EQ(row_major, mapped.row_major_beta());
+        EXPECT_EQ(model->alpha, mapped.alpha());
+        EXPECT_EQ(model->beta, mapped.beta());
+        EXPECT_EQ(model->eta, mapped.eta());
+
+        // the sections are aligned for vectorized access
+        EXPECT_EQ(0u, reinterpret_cast<size_t>(mapped.alpha().data()) % 64);
+        EXPECT_EQ(0u, reinterpret_cast<size_t>(mapped.beta().data()) % 64);
+        EXPECT_EQ(0u, reinterpret_cast<size_t>(mapped.eta().data()) % 64);
+
+        auto loaded = mapped.parameters();
+        EXPECT_EQ(model->alpha, loaded->alpha);
+        EXPECT_EQ(model->beta, loaded->beta);
+        EXPECT_EQ(model->eta, loaded->eta);
+    }
+
+    // unsupervised models have no eta
+    auto unsupervised = std::make_shared<parameters::ModelParameters<TypeParam> >(
+        model->alpha,
+        model->beta
+    );
+    model_file::save<TypeParam>(path, unsupervised);
+    model_file::MappedModel<TypeParam> mapped(path);
+    EXPECT_EQ(0u, mapped.classes());
+    EXPECT_EQ(0, mapped.eta().size());
+    EXPECT_EQ(model->beta, mapped.beta());
+    EXPECT_EQ(nullptr, mapped.feature_hasher());
+
+    std::remove(path.c_str());
+}
+
+
+TYPED_TEST(TestModelFile, FeatureHasher) {
+    auto model = std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+        VectorX<TypeParam>::Random(5),
+        MatrixX<TypeParam>::Random(5, 16),
+        MatrixX<TypeParam>::Random(5, 2)
+    );
+    auto hasher = std::make_shared<corpus::FeatureHasher>(16, 42);
+    char temporary_path[] = "/tmp/test_model_file_XXXXXX";
+    close(mkstemp(temporary_path));
+    std::string path = temporary_path;
+
+    model_file::save<TypeParam>(path, model, false, true, hasher);
+    model_file::MappedModel<TypeParam> mapped(path, true);
+    auto loaded = mapped.feature_hasher();
+    ASSERT_NE(nullptr, loaded);
+    EXPECT_EQ(16u, loaded->buckets());
+    EXPECT_EQ(42u, loaded->seed());
+    EXPECT_EQ(model->beta, mapped.beta());
+    EXPECT_EQ(model->eta, mapped.eta());
+
+    std::remove(path.c_str());
+}
+
+
+TYPED_TEST(TestModelFile, Invalid) {
+    auto model = std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+        VectorX<TypeParam>::Random(5),
+        MatrixX<TypeParam>::Random(5, 20),
+        MatrixX<TypeParam>::Random(5, 2)
+    );
+    char temporary_path[] = "/tmp/test_model_file_XXXXXX";
+    close(mkstemp(temporary_path));
+    std::string path = temporary_path;
+    model_file::save<TypeParam>(path, model);
+
+    // the other precision
+    if (sizeof(TypeParam) == sizeof(float)) {
+        EXPECT_THROW(model_file::MappedModel<double>(path, false), std::runtime_error);
+    } else {
+        EXPECT_THROW(model_file::MappedModel<float>(path, false), std::runtime_error);
+    }
+
+    // a corrupted section is only detected when verifying the checksums (the
+    // header, the table of contents and alpha take 256 bytes)
+    {
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekg(300);
+        char c = f.get();
+        f.seekp(300);
+        f.put(~c);
+    }
+    EXPECT_NO_THROW(model_file::MappedModel<TypeParam>(path, false));
+    EXPECT_THROW(model_file::MappedModel<TypeParam>(path, true), std::runtime_error);
+
+    // a file that is not a model file
+    {
+        std::ofstream f(path);
+        f << "not a model";
+    }
+    EXPECT_FALSE(model_file::is_model_file(path));
+    EXPECT_THROW(model_file::MappedModel<TypeParam>(path, false), std::runtime_error);
+
+    std::remove(path.c_str());
+}
+
+
+TYPED_TEST(TestModelFile, Overflow) {
+    auto model = std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+        VectorX<TypeParam>::Random(5),
+        MatrixX<TypeParam>::Random(5, 20),
+        MatrixX<TypeParam>::Random(5, 2)
+    );
+    char temporary_path[] = "/tmp/test_model_file_XXXXXX";
+    close(mkstemp(temporary_path));
+    std::string path = temporary_path;
+    auto overwrite = [&path, &model](std::streamoff position, uint64_t value) {
+        model_file::save<TypeParam>(path, model);
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(position);
+        f.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+    model_file::save<TypeParam>(path, model);
+    ASSERT_NO_THROW(model_file::MappedModel<TypeParam>(path, false));
+
+    // a number of words for which K*V*sizeof(Scalar) wraps around to the
+    // size of beta
+    uint64_t wrap = std::numeric_limits<uint64_t>::max() / sizeof(TypeParam) + 1;
+    overwrite(offsetof(model_file::Header, words), 20 + wrap);
+    EXPECT_THROW(model_file::MappedModel<TypeParam>(path, false), std::runtime_error);
+
+    // an offset for which offset + bytes wraps around
+    overwrite(
+        sizeof(model_file::Header) + sizeof(model_file::Section) +
+            offsetof(model_file::Section, offset),
+        std::numeric_limits<uint64_t>::max() - model_file::ALIGNMENT + 1
+    );
+    EXPECT_THROW(model_file::MappedModel<TypeParam>(path, false), std::runtime_error);
+
+    // a model file without beta
+    overwrite(
+        sizeof(model_file::Header) + sizeof(model_file::Section) +
+            offsetof(model_file::Section, id),
+        0
+    );
+    EXPECT_THROW(model_file::MappedModel<TypeParam>(path, false), std::runtime_error);
+
+    std::remove(path.c_str());
+}
+
+
+TYPED_TEST(TestModelFile, TransformMapped) {
+    std::mt19937 rng(0);
+    std::poisson_distribution<> words_generator(1.0);
+    std::uniform_real_distribution<TypeParam> topics_generator(0.1, 1.0);
+    MatrixXi X(50, 20);
+    for (int d=0; d<X.cols(); d++) {
+        for (int w=0; w<X.rows(); w++) {
+            X(w, d) = words_generator(rng);
+        }
+    }
+    char temporary_path[] = "/tmp/test_model_file_XXXXXX";
+    close(mkstemp(temporary_path));
+    std::string path = temporary_path;
+
+    // 16 topics use the specialized expectation step
+    for (int topics : {5, 16}) {
+        auto model = std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+            VectorX<TypeParam>::Constant(topics, 0.1),
+            MatrixX<TypeParam>(topics, X.rows()),
+            MatrixX<TypeParam>::Zero(topics, 2)
+        );
+        for (int w=0; w<X.rows(); w++) {
+            for (int k=0; k<topics; k++) {
+                model->beta(k, w) = topics_generator(rng);
+            }
+        }
+        model->beta.array().colwise() /= model->beta.rowwise().sum().array();
+        model_file::save<TypeParam>(path, model);
+
+        // beta is read from the mapping and nothing is copied
+        auto mapped = model_file::map_parameters<TypeParam>(path);
+        EXPECT_EQ(0, mapped->beta.size());
+        EXPECT_EQ(model->beta, mapped->beta_map);
+        EXPECT_EQ(model->alpha, mapped->alpha);
+        EXPECT_EQ(model->eta, mapped->eta);
+
+        LDA<TypeParam> copied = LDABuilder<TypeParam>().
+            set_classic_e_step().
+            set_workers(1).
+            initialize_topics_from_model(model);
+        LDA<TypeParam> in_place = LDABuilder<TypeParam>().
+            set_classic_e_step().
+            set_workers(1).
+            initialize_from_mapped_model(mapped);
+        EXPECT_TRUE(copied.transform(X).isApprox(in_place.transform(X)));
+    }
+
+    // only the classic expectation step reads a mapped model
+    auto mapped = model_file::map_parameters<TypeParam>(path);
+    EXPECT_THROW(
+        LDA<TypeParam>(
+            LDABuilder<TypeParam>().
+                set_supervised_e_step().
+                initialize_from_mapped_model(mapped)
+        ),
+        std::runtime_error
+    );
+
+    // the apps map the model files of their precision with a column major
+    // beta and copy the rest
+    auto loaded = io::load_lda_for_inference<TypeParam>(path);
+    EXPECT_NE(
+        nullptr,
+        std::dynamic_pointer_cast<parameters::MappedModelParameters<TypeParam> >(loaded)
+    );
+    EXPECT_EQ(50u, io::model_words<TypeParam>(loaded));
+
+    char row_major_path[] = "/tmp/test_model_file_XXXXXX";
+    close(mkstemp(row_major_path));
+    model_file::save<TypeParam>(
+        row_major_path,
+        std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+            mapped->alpha,
+            mapped->beta_map,
+            mapped->eta
+        ),
+        true
+    );
+    EXPECT_THROW(
+        model_file::map_parameters<TypeParam>(row_major_path),
+        std::invalid_argument
+    );
+    loaded = io::load_lda_for_inference<TypeParam>(row_major_path);
+    EXPECT_EQ(
+        nullptr,
+        std::dynamic_pointer_cast<parameters::MappedModelParameters<TypeParam> >(loaded)
+    );
+    EXPECT_EQ(mapped->beta_map, loaded->beta);
+    EXPECT_EQ(50u, io::model_words<TypeParam>(loaded));
+
+    std::remove(row_major_path);
+    std::remove(path.c_str());
+}
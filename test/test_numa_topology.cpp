@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "ldaplusplus/parallel/NumaTopology.hpp"
+
+using namespace ldaplusplus;
+
+
+TEST(TestNumaTopology, ParseCpulist) {
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), parallel::NumaTopology::parse_cpulist("0-3"));
+    EXPECT_EQ(
+        std::vector<int>({0, 1, 8, 10, 11}),
+        parallel::NumaTopology::parse_cpulist("0-1,8,10-11\n")
+    );
+    EXPECT_TRUE(parallel::NumaTopology::parse_cpulist("").empty());
+    EXPECT_TRUE(parallel::NumaTopology::parse_cpulist("\n").empty());
+}
+
+
+TEST(TestNumaTopology, ReadNodes) {
+    // Fake a sysfs tree with two nodes with CPUs and a memory only node
+    char root[] = "/tmp/test_numa_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(root));
+    std::vector<std::string> cpulists = {"0-1,4", "", "2-3"};
+    for (size_t n=0; n<cpulists.size(); n++) {
+        std::string node = std::string(root) + "/node" + std::to_string(n);
+        mkdir(node.c_str(), 0700);
+        std::ofstream(node + "/cpulist") << cpulists[n] << std::endl;
+    }
+
+    parallel::NumaTopology topology(root);
+    ASSERT_EQ(2, topology.nodes());
+    EXPECT_EQ(std::vector<int>({0, 1, 4}), topology.cpus(0));
+    EXPECT_EQ(std::vector<int>({2, 3}), topology.cpus(1));
+
+    for (size_t n=0; n<cpulists.size(); n++) {
+        std::string node = std::string(root) + "/node" + std::to_string(n);
+        std::remove((node + "/cpulist").c_str());
+        rmdir(node.c_str());
+    }
+    rmdir(root);
+
+    // Without a sysfs tree there is a single node with all the CPUs
+    parallel::NumaTopology missing("/nonexistent");
+    ASSERT_EQ(1, missing.nodes());
+    EXPECT_FALSE(missing.cpus(0).empty());
+    EXPECT_TRUE(missing.pin_to_node(0));
+}
+
+
+TEST(TestNumaTopology, ReadNodesWithGaps) {
+    // Fake a sysfs tree whose nodes are not numbered consecutively along
+    // with other entries that are not nodes
+    char root[] = "/tmp/test_numa_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(root));
+    std::vector<int> numbers = {10, 2, 0};
+    std::vector<std::string> cpulists = {"6-7", "4-5", "0-3"};
+    for (size_t n=0; n<numbers.size(); n++) {
+        std::string node = std::string(root) + "/node" + std::to_string(numbers[n]);
+        mkdir(node.c_str(), 0700);
+        std::ofstream(node + "/cpulist") << cpulists[n] << std::endl;
+    }
+    std::ofstream(std::string(root) + "/has_cpu") << "0-7" << std::endl;
+
+    parallel::NumaTopology topology(root);
+    ASSERT_EQ(3, topology.nodes());
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), topology.cpus(0));
+    EXPECT_EQ(std::vector<int>({4, 5}), topology.cpus(1));
+    EXPECT_EQ(std::vector<int>({6, 7}), topology.cpus(2));
+
+    for (size_t n=0; n<numbers.size(); n++) {
+        std::string node = std::string(root) + "/node" + std::to_string(numbers[n]);
+        std::remove((node + "/cpulist").c_str());
+        rmdir(node.c_str());
+    }
+    std::remove((std::string(root) + "/has_cpu").c_str());
+    rmdir(root);
+}
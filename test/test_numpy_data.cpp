@@ -1,7 +1,11 @@
 
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 
+#include <unistd.h>
+
 #include <Eigen/Core>
 #include <gtest/gtest.h>
 
@@ -98,6 +102,61 @@ TYPED_TEST(TestNumpyData, SaveLoad) {
 
     numpy_format::save(filename, A);
     MatrixX<TypeParam> B = numpy_format::load<TypeParam>(filename);
+    std::remove(filename.c_str());
+
+    ASSERT_TRUE(A==B);
+}
+
+TYPED_TEST(TestNumpyData, IncrementalWrite) {
+    char temporary_path[] = "/tmp/test_numpy_data_XXXXXX";
+    close(mkstemp(temporary_path));
+    std::string filename = temporary_path;
+
+    MatrixX<TypeParam> A = MatrixX<TypeParam>::Random(10, 20);
+    {
+        numpy_format::NumpyWriter<TypeParam> writer(filename, 10);
+        writer.write(A.leftCols(7));
+        writer.write(A.middleCols(7, 5));
+        writer.write(A.rightCols(8));
+        EXPECT_EQ(20u, writer.cols());
+        EXPECT_THROW(
+            writer.write(MatrixX<TypeParam>::Random(9, 2)),
+            std::invalid_argument
+        );
+    }
+    MatrixX<TypeParam> B = numpy_format::load<TypeParam>(filename);
+    std::remove(filename.c_str());
 
     ASSERT_TRUE(A==B);
 }
+
+TYPED_TEST(TestNumpyData, IncrementalRead) {
+    typedef Eigen::Matrix<TypeParam, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMajorMatrixX;
+    MatrixX<TypeParam> A = MatrixX<TypeParam>::Random(10, 20);
+    RowMajorMatrixX A_rows = A;
+    VectorX<TypeParam> b = VectorX<TypeParam>::Random(20);
+
+    // the blocks of a column major and a row major array followed by
+    // another array are the same
+    std::stringstream ss;
+    ss << numpy_format::NumpyOutput<TypeParam>(A);
+    ss << numpy_format::NumpyOutput<TypeParam>(A_rows);
+    ss << numpy_format::NumpyOutput<TypeParam>(b);
+    ss.seekg(0);
+    for (int i=0; i<2; i++) {
+        numpy_format::NumpyReader<TypeParam> reader(ss);
+        EXPECT_EQ(10u, reader.rows());
+        EXPECT_EQ(20u, reader.cols());
+
+        MatrixX<TypeParam> B(10, 0);
+        while (reader.remaining() > 0) {
+            MatrixX<TypeParam> block = reader.read(7);
+            EXPECT_EQ(std::min<long>(7, 20 - B.cols()), block.cols());
+            B.conservativeResize(Eigen::NoChange, B.cols() + block.cols());
+            B.rightCols(block.cols()) = block;
+        }
+        EXPECT_EQ(A, B);
+    }
+    MatrixX<TypeParam> c = numpy_format::load<TypeParam>(ss);
+    EXPECT_EQ(b, c);
+}
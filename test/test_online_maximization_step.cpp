@@ -1,6 +1,9 @@
 
 #include <memory>
+#include <numeric>
 #include <random>
+#include <sstream>
+#include <thread>
 #include <vector>
 
 #include <Eigen/Core>
@@ -95,3 +98,231 @@ TYPED_TEST(TestOnlineMaximizationStep, Maximization) {
         );
     }
 }
+
+
+TYPED_TEST(TestOnlineMaximizationStep, HogwildMaximization) {
+    // Build the corpus
+    std::mt19937 rng;
+    rng.seed(0);
+    MatrixXi X(100, 50);
+    VectorXi y(50);
+    std::uniform_int_distribution<> class_generator(0, 5);
+    std::exponential_distribution<> words_generator(0.1);
+    for (int d=0; d<50; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+        y(d) = class_generator(rng);
+    }
+
+    // Create the corpus and the model
+    auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Random(10, 100);
+    beta.array() -= beta.minCoeff();
+    beta.array().colwise() /= beta.array().rowwise().sum();
+    auto model = std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+        VectorX<TypeParam>::Constant(10, 0.1),
+        beta,
+        MatrixX<TypeParam>::Zero(10, 6)
+    );
+
+    em::FastSupervisedEStep<TypeParam> e_step(10, 1e-2, 10);
+    em::FastOnlineSupervisedMStep<TypeParam> m_step(
+        6,
+        1e-2,
+        5,
+        0.9,
+        0.01,
+        0.9,
+        true
+    );
+    ASSERT_TRUE(m_step.concurrent_doc_m_step());
+
+    // the events are dispatched from many threads
+    auto dispatcher = std::make_shared<events::ThreadSafeEventDispatcher>();
+    e_step.set_event_dispatcher(dispatcher);
+    m_step.set_event_dispatcher(dispatcher);
+    std::vector<TypeParam> progress;
+    m_step.get_event_dispatcher()->add_listener(
+        [&progress](std::shared_ptr<events::Event> event) {
+            if (event->id() == "MaximizationProgressEvent") {
+                auto prog_ev = std::static_pointer_cast<events::MaximizationProgressEvent<TypeParam> >(event);
+                progress.push_back(prog_ev->likelihood());
+            }
+        }
+    );
+
+    size_t N = 4, T = 4;
+    std::vector<TypeParam> epoch_likelihood;
+    for (size_t n=0; n<N; n++) {
+        // every thread gets every T-th document and fills whichever
+        // minibatch no other thread is filling
+        std::vector<std::thread> threads;
+        for (size_t t=0; t<T; t++) {
+            threads.emplace_back([&, t]() {
+                for (size_t i=t; i<corpus->size(); i+=T) {
+                    m_step.doc_m_step(
+                        corpus->at(i),
+                        e_step.doc_e_step(corpus->at(i), model),
+                        model
+                    );
+                }
+            });
+        }
+        for (auto & t : threads) {
+            t.join();
+        }
+
+        // and the leftovers are applied here
+        m_step.m_step(model);
+
+        progress.clear();
+        dispatcher->process_events();
+        // 10 full minibatches and at most one partial per thread
+        ASSERT_LE(10, progress.size());
+        ASSERT_GE(10 + T, progress.size());
+        epoch_likelihood.push_back(
+            std::accumulate(progress.begin(), progress.end(), TypeParam(0))
+        );
+
+        // The model is consistent after every epoch
+        EXPECT_TRUE(model->beta.allFinite());
+        EXPECT_TRUE(model->eta.allFinite());
+        EXPECT_TRUE(
+            model->beta.rowwise().sum().isApprox(VectorX<TypeParam>::Ones(10), 1e-4)
+        );
+    }
+
+    EXPECT_LT(epoch_likelihood.front(), epoch_likelihood.back());
+}
+
+
+TYPED_TEST(TestOnlineMaximizationStep, VocabularyGrowth) {
+    // Build a corpus whose last 50 words only appear later in the stream
+    std::mt19937 rng;
+    rng.seed(0);
+    MatrixXi X(150, 50);
+    VectorXi y(50);
+    std::uniform_int_distribution<> class_generator(0, 5);
+    std::exponential_distribution<> words_generator(0.1);
+    for (int d=0; d<50; d++) {
+        for (int w=0; w<150; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+        y(d) = class_generator(rng);
+    }
+    MatrixXi X_old = X.topRows(100);
+    auto old_corpus = std::make_shared<corpus::EigenClassificationCorpus>(X_old, y);
+    auto new_corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Random(10, 100);
+    beta.array() -= beta.minCoeff();
+    beta.array().colwise() /= beta.array().rowwise().sum();
+    auto model = std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+        VectorX<TypeParam>::Constant(10, 0.1),
+        beta,
+        MatrixX<TypeParam>::Zero(10, 6)
+    );
+
+    em::FastSupervisedEStep<TypeParam> e_step(10, 1e-2, 10);
+    em::FastOnlineSupervisedMStep<TypeParam> m_step(6, 1e-2, 25);
+
+    auto epoch = [&](std::shared_ptr<corpus::Corpus> corpus) {
+        for (size_t i=0; i<corpus->size(); i++) {
+            m_step.doc_m_step(
+                corpus->at(i),
+                e_step.doc_e_step(corpus->at(i), model),
+                model
+            );
+        }
+        m_step.m_step(model);
+    };
+
+    epoch(old_corpus);
+    MatrixX<TypeParam> trained_beta = model->beta;
+
+    // The new words get the prior and the old ones keep their proportions
+    m_step.grow_vocabulary(150, model);
+    ASSERT_EQ(150, model->beta.cols());
+    for (int k=0; k<10; k++) {
+        TypeParam scale = model->beta(k, 0) / trained_beta(k, 0);
+        EXPECT_TRUE(
+            model->beta.row(k).head(100).isApprox(scale * trained_beta.row(k))
+        );
+        for (int w=101; w<150; w++) {
+            EXPECT_FLOAT_EQ(model->beta(k, 100), model->beta(k, w));
+        }
+    }
+    EXPECT_TRUE(
+        model->beta.rowwise().sum().isApprox(VectorX<TypeParam>::Ones(10), 1e-4)
+    );
+
+    // Growing to fewer words changes nothing
+    m_step.grow_vocabulary(120, model);
+    ASSERT_EQ(150, model->beta.cols());
+
+    // and the new words are learned from the documents that contain them
+    MatrixX<TypeParam> grown_beta = model->beta;
+    epoch(new_corpus);
+    EXPECT_TRUE(model->beta.allFinite());
+    EXPECT_TRUE(
+        model->beta.rowwise().sum().isApprox(VectorX<TypeParam>::Ones(10), 1e-4)
+    );
+    EXPECT_FALSE(
+        model->beta.rightCols(50).isApprox(grown_beta.rightCols(50), 1e-3)
+    );
+}
+
+
+TYPED_TEST(TestOnlineMaximizationStep, HogwildStateRoundTrip) {
+    std::mt19937 rng;
+    rng.seed(0);
+    MatrixXi X(100, 3);
+    VectorXi y(3);
+    std::exponential_distribution<> words_generator(0.1);
+    for (int d=0; d<3; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+        y(d) = d;
+    }
+    auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Random(10, 100);
+    beta.array() -= beta.minCoeff();
+    beta.array().colwise() /= beta.array().rowwise().sum();
+    auto model = std::make_shared<parameters::SupervisedModelParameters<TypeParam> >(
+        VectorX<TypeParam>::Constant(10, 0.1),
+        beta,
+        MatrixX<TypeParam>::Zero(10, 6)
+    );
+    auto restored_model = std::static_pointer_cast<
+        parameters::SupervisedModelParameters<TypeParam>
+    >(model->clone());
+
+    em::FastSupervisedEStep<TypeParam> e_step(10, 1e-2, 10);
+    em::FastOnlineSupervisedMStep<TypeParam> m_step(6, 1e-2, 5, 0.9, 0.01, 0.9, true);
+    em::FastOnlineSupervisedMStep<TypeParam> restored(6, 1e-2, 5, 0.9, 0.01, 0.9, true);
+    std::vector<std::shared_ptr<parameters::Parameters> > e_step_results;
+    for (size_t i=0; i<corpus->size(); i++) {
+        e_step_results.push_back(e_step.doc_e_step(corpus->at(i), model));
+    }
+
+    // Two documents are left in a partially filled minibatch
+    for (size_t i=0; i<2; i++) {
+        m_step.doc_m_step(corpus->at(i), e_step_results[i], model);
+    }
+    std::stringstream state;
+    m_step.save_state(state);
+    restored.load_state(state);
+
+    // and they are applied along with the next one after the restore
+    m_step.doc_m_step(corpus->at(2), e_step_results[2], model);
+    m_step.m_step(model);
+    restored.doc_m_step(corpus->at(2), e_step_results[2], restored_model);
+    restored.m_step(restored_model);
+
+    EXPECT_EQ(model->beta, restored_model->beta);
+    EXPECT_EQ(model->eta, restored_model->eta);
+    EXPECT_NE(beta, model->beta);
+}
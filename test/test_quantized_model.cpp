@@ -0,0 +1,147 @@
+#include <random>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/quantization.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+// T will be available as TypeParam in TYPED_TEST functions
+template <typename T>
+class TestQuantizedModel : public ParameterizedTest<T>
+{
+    protected:
+        typedef parameters::QuantizedModelParameters<T> QuantizedModel;
+
+        void SetUp() override {
+            // Build a corpus where the classes use distinct parts of the
+            // vocabulary
+            std::mt19937 rng(0);
+            X = MatrixXi::Zero(200, 100);
+            y = VectorXi(100);
+            std::uniform_int_distribution<> class_generator(0, 3);
+            std::exponential_distribution<> words_generator(0.5);
+            for (int d=0; d<100; d++) {
+                y(d) = class_generator(rng);
+                for (int w=0; w<200; w++) {
+                    X(w, d) = static_cast<int>(words_generator(rng));
+                    if (w % 4 == y(d)) {
+                        X(w, d) += 2;
+                    }
+                }
+            }
+
+            LDA<T> lda = LDABuilder<T>().
+                set_iterations(5).
+                set_workers(1).
+                set_fast_supervised_e_step().
+                set_fast_supervised_m_step().
+                initialize_topics_seeded(X, 10).
+                initialize_eta_zeros(4);
+            lda.fit(X, y);
+            model = lda.template model_parameters<parameters::SupervisedModelParameters<T> >();
+
+            LDA<T> full = LDABuilder<T>().
+                set_workers(1).
+                set_classic_e_step(10, 1e-2, 0).
+                initialize_topics_from_model(model).
+                initialize_eta_from_model(model);
+            std::tie(gammas, predictions) = full.transform_predict(X);
+        }
+
+        void compare(typename QuantizedModel::Encoding encoding, T tolerance) {
+            auto quantized = quantization::quantize(*model, encoding);
+
+            // the reconstructed topics should be close to the originals
+            MatrixX<T> beta = quantization::dequantize(*quantized);
+            T beta_error = (beta - model->beta).array().abs().maxCoeff();
+            EXPECT_LT(beta_error, tolerance * model->beta.maxCoeff());
+
+            LDA<T> lda = LDABuilder<T>().
+                set_workers(1).
+                set_quantized_e_step(10, 1e-2).
+                initialize_from_quantized_model(quantized);
+
+            MatrixX<T> qgammas;
+            VectorXi qpredictions;
+            std::tie(qgammas, qpredictions) = lda.transform_predict(X);
+
+            ASSERT_EQ(gammas.rows(), qgammas.rows());
+            ASSERT_EQ(gammas.cols(), qgammas.cols());
+
+            // compare the topic mixtures
+            MatrixX<T> theta = gammas.array().rowwise() / gammas.colwise().sum().array();
+            MatrixX<T> qtheta = qgammas.array().rowwise() / qgammas.colwise().sum().array();
+            EXPECT_LT((theta - qtheta).array().abs().colwise().sum().maxCoeff(), 10*tolerance);
+
+            // and the predictions
+            int agree = (predictions.array() == qpredictions.array()).count();
+            EXPECT_GE(agree, 0.95 * predictions.rows());
+        }
+
+        MatrixXi X;
+        VectorXi y;
+        std::shared_ptr<parameters::SupervisedModelParameters<T> > model;
+        MatrixX<T> gammas;
+        VectorXi predictions;
+};
+
+TYPED_TEST_CASE(TestQuantizedModel, ForFloatAndDouble);
+
+
+TYPED_TEST(TestQuantizedModel, Float16) {
+    this->compare(TestFixture::QuantizedModel::Float16, 1e-3);
+}
+
+
+TYPED_TEST(TestQuantizedModel, Int8) {
+    this->compare(TestFixture::QuantizedModel::Int8, 1e-2);
+}
+
+
+TYPED_TEST(TestQuantizedModel, Int8KeepsSmallProbabilities) {
+    auto quantized = quantization::quantize(
+        *this->model,
+        TestFixture::QuantizedModel::Int8
+    );
+    MatrixX<TypeParam> beta = quantization::dequantize(*quantized);
+
+    // every probability is kept within a few percent of its value no matter
+    // how small it is
+    for (int w=0; w<beta.cols(); w++) {
+        for (int k=0; k<beta.rows(); k++) {
+            TypeParam b = this->model->beta(k, w);
+            if (b > 1e-9 * this->model->beta.row(k).maxCoeff()) {
+                EXPECT_NEAR(1, beta(k, w) / b, 0.1);
+            }
+        }
+    }
+}
+
+
+TYPED_TEST(TestQuantizedModel, RejectsMismatchedEStep) {
+    auto quantized = quantization::quantize(
+        *this->model,
+        TestFixture::QuantizedModel::Float16
+    );
+
+    EXPECT_THROW(
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_classic_e_step().
+            initialize_from_quantized_model(quantized),
+        std::runtime_error
+    );
+    EXPECT_THROW(
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_quantized_e_step().
+            initialize_topics_from_model(this->model),
+        std::runtime_error
+    );
+}
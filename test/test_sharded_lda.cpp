@@ -0,0 +1,147 @@
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/parallel/ShardedLDA.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+// T will be available as TypeParam in TYPED_TEST functions
+template <typename T>
+class TestShardedLDA : public ParameterizedTest<T>
+{
+    protected:
+        void SetUp() override {
+            std::mt19937 rng(0);
+            X = MatrixXi(150, 60);
+            std::exponential_distribution<> words_generator(0.3);
+            for (int d=0; d<60; d++) {
+                for (int w=0; w<150; w++) {
+                    X(w, d) = static_cast<int>(words_generator(rng));
+                    // make some topical structure
+                    if ((w / 50) == (d % 3)) {
+                        X(w, d) += 2;
+                    }
+                }
+            }
+        }
+
+        std::shared_ptr<parameters::ModelParameters<T> > initial_model() {
+            LDA<T> lda = LDABuilder<T>().initialize_topics_seeded(X, 6);
+            auto model = lda.template model_parameters<parameters::ModelParameters<T> >();
+            return std::make_shared<parameters::ModelParameters<T> >(
+                model->alpha,
+                model->beta
+            );
+        }
+
+        std::vector<T> fit(
+            std::shared_ptr<parameters::ModelParameters<T> > model,
+            size_t workers,
+            size_t blocks_per_worker,
+            std::string storage_path = ""
+        ) {
+            parallel::ShardedLDA<T> lda(model, 5, workers, blocks_per_worker, storage_path);
+            std::vector<T> bounds;
+            lda.get_event_dispatcher()->add_listener(
+                [&bounds](std::shared_ptr<events::Event> event) {
+                    if (event->id() == "ExpectationProgressEvent") {
+                        auto progress = std::static_pointer_cast<events::ExpectationProgressEvent<T> >(event);
+                        bounds.push_back(progress->likelihood());
+                    }
+                }
+            );
+            lda.fit(X);
+
+            return bounds;
+        }
+
+        MatrixXi X;
+};
+
+TYPED_TEST_CASE(TestShardedLDA, ForFloatAndDouble);
+
+
+TYPED_TEST(TestShardedLDA, Fit) {
+    auto model = this->initial_model();
+    auto bounds = this->fit(model, 1, 1);
+
+    ASSERT_EQ(5, bounds.size());
+    EXPECT_GT(bounds.back(), bounds.front());
+    EXPECT_TRUE(
+        model->beta.rowwise().sum().isApprox(
+            VectorX<TypeParam>::Ones(model->beta.rows()),
+            1e-4
+        )
+    );
+}
+
+
+TYPED_TEST(TestShardedLDA, ProcessesMatchSingleWorker) {
+    auto model1 = this->initial_model();
+    auto bounds1 = this->fit(model1, 1, 1);
+
+    // Three processes with six word blocks and file backed storage
+    auto model3 = this->initial_model();
+    char storage_path[] = "/tmp/test_sharded_lda_XXXXXX";
+    close(mkstemp(storage_path));
+    auto bounds3 = this->fit(model3, 3, 2, storage_path);
+    std::remove(storage_path);
+
+    // Only the order of the floating point summations differs
+    ASSERT_EQ(bounds1.size(), bounds3.size());
+    for (size_t i=0; i<bounds1.size(); i++) {
+        EXPECT_NEAR(bounds1[i], bounds3[i], std::abs(bounds1[i]) * 1e-4);
+    }
+    EXPECT_TRUE(model1->beta.isApprox(model3->beta, 1e-3));
+}
+
+
+TYPED_TEST(TestShardedLDA, FailureReleasesWorkers) {
+    auto model = this->initial_model();
+    MatrixX<TypeParam> beta = model->beta;
+
+    // The first worker fails after the first epoch while the rest of the
+    // workers are still running
+    parallel::ShardedLDA<TypeParam> lda(model, 5, 3, 1);
+    lda.get_event_dispatcher()->add_listener(
+        [](std::shared_ptr<events::Event> event) {
+            if (event->id() == "EpochProgressEvent") {
+                throw std::runtime_error("listener failure");
+            }
+        }
+    );
+    EXPECT_THROW(lda.fit(this->X), std::runtime_error);
+
+    // the model is gathered back even on failure
+    ASSERT_EQ(beta.rows(), model->beta.rows());
+    ASSERT_EQ(beta.cols(), model->beta.cols());
+}
+
+
+TYPED_TEST(TestShardedLDA, RejectsRunningThreads) {
+    auto model = this->initial_model();
+    parallel::ShardedLDA<TypeParam> lda(model, 1, 2, 1);
+
+    std::mutex mutex;
+    mutex.lock();
+    std::thread thread([&mutex]() { mutex.lock(); mutex.unlock(); });
+    EXPECT_THROW(lda.fit(this->X), std::runtime_error);
+    mutex.unlock();
+    thread.join();
+}
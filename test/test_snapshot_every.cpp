@@ -0,0 +1,167 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "applications/lda_io.hpp"
+#include "applications/SnapshotEvery.hpp"
+#include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/Parameters.hpp"
+#include "ldaplusplus/parallel/ShardedLDA.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+// T will be available as TypeParam in TYPED_TEST functions
+template <typename T>
+class TestSnapshotEvery : public ParameterizedTest<T>
+{
+    protected:
+        void SetUp() override {
+            char directory[] = "/tmp/test_snapshot_every_XXXXXX";
+            ASSERT_NE(nullptr, mkdtemp(directory));
+            directory_ = directory;
+
+            model_ = std::make_shared<parameters::SupervisedModelParameters<T> >();
+            model_->alpha = VectorX<T>::Constant(3, 0.1);
+            model_->beta = MatrixX<T>::Constant(3, 5, 0.2);
+            model_->eta = MatrixX<T>::Zero(3, 2);
+
+            dispatcher_ = std::make_shared<events::SameThreadEventDispatcher>();
+            dispatcher_->add_listener(
+                [this](std::shared_ptr<events::Event> event) {
+                    snapshot_events_.push_back(
+                        std::static_pointer_cast<SnapshotEvent>(event)
+                    );
+                },
+                {SnapshotEvent::type_tag()}
+            );
+        }
+
+        void TearDown() override {
+            for (auto & event : snapshot_events_) {
+                std::remove(event->path().c_str());
+            }
+            rmdir(directory_.c_str());
+        }
+
+        void epoch() {
+            dispatcher_->template dispatch<events::EpochProgressEvent<T> >(model_);
+        }
+
+        std::string directory_;
+        std::shared_ptr<parameters::SupervisedModelParameters<T> > model_;
+        std::shared_ptr<events::EventDispatcherInterface> dispatcher_;
+        std::vector<std::shared_ptr<SnapshotEvent> > snapshot_events_;
+};
+
+TYPED_TEST_CASE(TestSnapshotEvery, ForFloatAndDouble);
+
+
+TYPED_TEST(TestSnapshotEvery, FlushReportsTheLastSnapshot) {
+    auto snapshots = std::make_shared<SnapshotEvery<TypeParam> >(
+        this->directory_ + "/model",
+        2,
+        this->dispatcher_
+    );
+    this->dispatcher_->add_listener(snapshots);
+
+    for (int i=0; i<4; i++) {
+        this->epoch();
+    }
+    snapshots->flush();
+
+    // the snapshot of the 4th epoch is reported although no epoch follows
+    ASSERT_FALSE(this->snapshot_events_.empty());
+    auto last = this->snapshot_events_.back();
+    EXPECT_EQ(this->directory_ + "/model_004", last->path());
+    EXPECT_TRUE(last->error().empty());
+    EXPECT_EQ(2u, this->snapshot_events_.size() + last->dropped());
+    EXPECT_EQ(0, access(last->path().c_str(), R_OK));
+
+    // nothing is reported twice
+    snapshots->flush();
+    EXPECT_EQ(2u, this->snapshot_events_.size() + last->dropped());
+}
+
+
+TYPED_TEST(TestSnapshotEvery, ReportsFailures) {
+    auto snapshots = std::make_shared<SnapshotEvery<TypeParam> >(
+        this->directory_ + "/missing/model",
+        1,
+        this->dispatcher_
+    );
+    this->dispatcher_->add_listener(snapshots);
+
+    this->epoch();
+    snapshots->flush();
+
+    // the writer survives the failure
+    this->epoch();
+    snapshots->flush();
+
+    ASSERT_EQ(2u, this->snapshot_events_.size());
+    for (auto & event : this->snapshot_events_) {
+        EXPECT_FALSE(event->error().empty());
+    }
+}
+
+
+TYPED_TEST(TestSnapshotEvery, ShardedTraining) {
+    // the same as lda train --shards=2 --snapshot_every=2
+    std::mt19937 rng(0);
+    std::poisson_distribution<> words_generator(1.0);
+    MatrixXi X(40, 30);
+    for (int d=0; d<X.cols(); d++) {
+        for (int w=0; w<X.rows(); w++) {
+            X(w, d) = words_generator(rng);
+        }
+    }
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().initialize_topics_seeded(X, 3);
+    auto model = lda.template model_parameters<parameters::ModelParameters<TypeParam> >();
+
+    parallel::ShardedLDA<TypeParam> sharded(model, 4, 2);
+    auto dispatcher = sharded.get_event_dispatcher();
+    dispatcher->add_listener(
+        [this](std::shared_ptr<events::Event> event) {
+            this->snapshot_events_.push_back(
+                std::static_pointer_cast<SnapshotEvent>(event)
+            );
+        },
+        {SnapshotEvent::type_tag()}
+    );
+    auto snapshots = std::make_shared<SnapshotEvery<TypeParam> >(
+        this->directory_ + "/model",
+        2,
+        dispatcher
+    );
+    dispatcher->add_listener(snapshots);
+
+    // the workers are forked before the first snapshot
+    sharded.fit(X);
+    snapshots->flush();
+
+    ASSERT_FALSE(this->snapshot_events_.empty());
+    for (auto & event : this->snapshot_events_) {
+        EXPECT_TRUE(event->error().empty()) << event->error();
+        auto snapshot = io::load_lda<TypeParam>(event->path());
+        EXPECT_EQ(model->beta.rows(), snapshot->beta.rows());
+        EXPECT_EQ(model->beta.cols(), snapshot->beta.cols());
+    }
+
+    // the last snapshot is the trained model
+    auto last = this->snapshot_events_.back();
+    EXPECT_EQ(this->directory_ + "/model_004", last->path());
+    EXPECT_TRUE(io::load_lda<TypeParam>(last->path())->beta.isApprox(model->beta));
+}
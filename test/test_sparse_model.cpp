@@ -0,0 +1,136 @@
+#include <random>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/sparsification.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+// T will be available as TypeParam in TYPED_TEST functions
+template <typename T>
+class TestSparseModel : public ParameterizedTest<T>
+{
+    protected:
+        void SetUp() override {
+            // Build a corpus where the classes use distinct parts of the
+            // vocabulary
+            std::mt19937 rng(0);
+            X = MatrixXi::Zero(200, 100);
+            VectorXi y(100);
+            std::uniform_int_distribution<> class_generator(0, 3);
+            std::exponential_distribution<> words_generator(0.5);
+            for (int d=0; d<100; d++) {
+                y(d) = class_generator(rng);
+                for (int w=0; w<200; w++) {
+                    X(w, d) = static_cast<int>(words_generator(rng));
+                    if (w % 4 == y(d)) {
+                        X(w, d) += 2;
+                    }
+                }
+            }
+
+            LDA<T> lda = LDABuilder<T>().
+                set_iterations(5).
+                set_workers(1).
+                set_fast_supervised_e_step().
+                set_fast_supervised_m_step().
+                initialize_topics_seeded(X, 10).
+                initialize_eta_zeros(4);
+            lda.fit(X, y);
+            model = lda.template model_parameters<parameters::SupervisedModelParameters<T> >();
+
+            LDA<T> full = LDABuilder<T>().
+                set_workers(1).
+                set_classic_e_step(10, 1e-2, 0).
+                initialize_topics_from_model(model).
+                initialize_eta_from_model(model);
+            std::tie(gammas, predictions) = full.transform_predict(X);
+        }
+
+        std::tuple<MatrixX<T>, VectorXi> transform_predict(
+            std::shared_ptr<parameters::SparseModelParameters<T> > sparse
+        ) {
+            LDA<T> lda = LDABuilder<T>().
+                set_workers(1).
+                set_sparse_e_step(10, 1e-2).
+                initialize_from_sparse_model(sparse);
+
+            return lda.transform_predict(X);
+        }
+
+        MatrixXi X;
+        std::shared_ptr<parameters::SupervisedModelParameters<T> > model;
+        MatrixX<T> gammas;
+        VectorXi predictions;
+};
+
+TYPED_TEST_CASE(TestSparseModel, ForFloatAndDouble);
+
+
+TYPED_TEST(TestSparseModel, FullMassIsExact) {
+    auto sparse = sparsification::sparsify<TypeParam>(*this->model, 1.0);
+    EXPECT_EQ(
+        (this->model->beta.array() > 0).count(),
+        sparse->beta_sparse.nonZeros()
+    );
+
+    MatrixX<TypeParam> sgammas;
+    VectorXi spredictions;
+    std::tie(sgammas, spredictions) = this->transform_predict(sparse);
+
+    EXPECT_TRUE(sgammas.isApprox(this->gammas, 1e-3));
+    EXPECT_EQ(this->predictions, spredictions);
+}
+
+
+TYPED_TEST(TestSparseModel, TruncatedMass) {
+    auto sparse = sparsification::sparsify<TypeParam>(*this->model, 0.9);
+
+    // every word keeps at least one topic and at least 90% of its mass
+    for (int w=0; w<this->model->beta.cols(); w++) {
+        MatrixX<TypeParam> kept = sparse->beta_sparse.col(w);
+        EXPECT_GT(kept.size(), 0);
+        EXPECT_GE(kept.sum(), 0.9 * this->model->beta.col(w).sum() - 1e-5);
+    }
+    EXPECT_LT(sparse->beta_sparse.nonZeros(), this->model->beta.size());
+
+    MatrixX<TypeParam> sgammas;
+    VectorXi spredictions;
+    std::tie(sgammas, spredictions) = this->transform_predict(sparse);
+
+    int agree = (this->predictions.array() == spredictions.array()).count();
+    EXPECT_GE(agree, 0.9 * this->predictions.rows());
+}
+
+
+TYPED_TEST(TestSparseModel, RejectsInvalidUse) {
+    EXPECT_THROW(
+        sparsification::sparsify<TypeParam>(*this->model, 0),
+        std::invalid_argument
+    );
+    EXPECT_THROW(
+        sparsification::sparsify<TypeParam>(*this->model, 1.5),
+        std::invalid_argument
+    );
+
+    auto sparse = sparsification::sparsify<TypeParam>(*this->model, 0.9);
+    EXPECT_THROW(
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_classic_e_step().
+            initialize_from_sparse_model(sparse),
+        std::runtime_error
+    );
+    EXPECT_THROW(
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_sparse_e_step().
+            initialize_topics_from_model(this->model),
+        std::runtime_error
+    );
+}
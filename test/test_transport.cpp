@@ -0,0 +1,206 @@
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/parallel/TcpTransport.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+/**
+ * Run f(transport) for every rank in a separate thread, each with its own
+ * TcpTransport over loopback.
+ */
+void run_ranks(int size, std::function<void(parallel::Transport &)> f) {
+    static int port = 20000 + (getpid() % 20000);
+    port++;
+
+    std::vector<std::thread> threads;
+    for (int rank=0; rank<size; rank++) {
+        threads.emplace_back([=]() {
+            parallel::TcpTransport transport(rank, size, port);
+            f(transport);
+        });
+    }
+    for (auto & t : threads) {
+        t.join();
+    }
+}
+
+
+TEST(TestTransport, Collectives) {
+    std::vector<MatrixXd> sums(3), gathered(3);
+    std::vector<VectorXi> vectors(3);
+
+    run_ranks(3, [&](parallel::Transport &transport) {
+        int r = transport.rank();
+
+        MatrixXd x = MatrixXd::Constant(2, 3, r + 1);
+        transport.all_reduce_sum(x);
+        sums[r] = x;
+
+        // rank 1 contributes nothing
+        MatrixXd cols = MatrixXd::Constant(2, (r == 1) ? 0 : r + 1, r);
+        transport.all_gather_cols(cols);
+        gathered[r] = cols;
+
+        VectorXi v = VectorXi::Constant(r + 1, r);
+        transport.all_gather_vector(v);
+        vectors[r] = v;
+    });
+
+    MatrixXd expected_cols(2, 4);
+    expected_cols << 0, 2, 2, 2,
+                     0, 2, 2, 2;
+    VectorXi expected_vector(6);
+    expected_vector << 0, 1, 1, 2, 2, 2;
+    for (int r=0; r<3; r++) {
+        EXPECT_EQ(MatrixXd::Constant(2, 3, 6), sums[r]);
+        EXPECT_EQ(expected_cols, gathered[r]);
+        EXPECT_EQ(expected_vector, vectors[r]);
+    }
+}
+
+
+TEST(TestTransport, ReducesInRankOrder) {
+    // The sum depends on the order of the additions
+    double values[3] = {1e16, 1, -1e16};
+    std::vector<double> sums(3);
+
+    run_ranks(3, [&](parallel::Transport &transport) {
+        int r = transport.rank();
+        double x = values[r];
+        transport.all_reduce_sum(&x, 1);
+        sums[r] = x;
+    });
+
+    double expected = (values[0] + values[1]) + values[2];
+    for (int r=0; r<3; r++) {
+        EXPECT_EQ(expected, sums[r]);
+    }
+}
+
+
+/**
+ * Count the file descriptors of this process.
+ */
+int count_open_files() {
+    int count = 0;
+    DIR *fds = opendir("/proc/self/fd");
+    while (struct dirent *entry = readdir(fds)) {
+        count += entry->d_name[0] != '.';
+    }
+    closedir(fds);
+
+    return count;
+}
+
+
+TEST(TestTransport, ClosesSocketsOnFailure) {
+    int before = count_open_files();
+
+    // Nobody listens to this port so the constructor gives up
+    EXPECT_THROW(parallel::TcpTransport(1, 2, 1, "127.0.0.1", 0), std::runtime_error);
+    EXPECT_EQ(before, count_open_files());
+
+    // Rank 0 receives an invalid rank
+    int port = 40000 + (getpid() % 20000);
+    std::thread intruder([port]() {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        int connection = socket(AF_INET, SOCK_STREAM, 0);
+        while (connect(connection, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            close(connection);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            connection = socket(AF_INET, SOCK_STREAM, 0);
+        }
+        int32_t rank = 5;
+        send(connection, &rank, sizeof(rank), 0);
+        close(connection);
+    });
+    EXPECT_THROW(parallel::TcpTransport(0, 3, port), std::runtime_error);
+    intruder.join();
+    EXPECT_EQ(before, count_open_files());
+}
+
+
+// T will be available as TypeParam in TYPED_TEST functions
+template <typename T>
+class TestDataParallelFit : public ParameterizedTest<T> {};
+
+TYPED_TEST_CASE(TestDataParallelFit, ForFloatAndDouble);
+
+
+TYPED_TEST(TestDataParallelFit, MatchesSingleProcess) {
+    std::mt19937 rng(0);
+    MatrixXi X(100, 60);
+    VectorXi y(60);
+    std::uniform_int_distribution<> class_generator(0, 2);
+    std::exponential_distribution<> words_generator(0.3);
+    for (int d=0; d<60; d++) {
+        y(d) = class_generator(rng);
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+            if (w % 3 == y(d)) {
+                X(w, d) += 2;
+            }
+        }
+    }
+
+    auto builder = [&X](std::shared_ptr<parallel::Transport> transport) {
+        return LDABuilder<TypeParam>().
+            set_iterations(3).
+            set_workers(1).
+            set_fast_supervised_e_step().
+            set_fast_supervised_m_step().
+            initialize_topics_seeded(X, 5).
+            initialize_eta_zeros(3).
+            set_transport(transport);
+    };
+
+    LDA<TypeParam> single = builder(nullptr);
+    single.fit(X, y);
+    auto model = single.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+
+    // Two processes with a shard of 20 and 40 documents
+    std::vector<std::shared_ptr<parameters::SupervisedModelParameters<TypeParam> > > models(2);
+    run_ranks(2, [&](parallel::Transport &transport) {
+        int r = transport.rank();
+        // the transport outlives the LDA
+        std::shared_ptr<parallel::Transport> t(&transport, [](parallel::Transport *){});
+        MatrixXi X_shard = (r == 0) ? MatrixXi(X.leftCols(20)) : MatrixXi(X.rightCols(40));
+        VectorXi y_shard = (r == 0) ? VectorXi(y.head(20)) : VectorXi(y.tail(40));
+
+        LDA<TypeParam> lda = builder(t);
+        lda.fit(X_shard, y_shard);
+        models[r] = lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >();
+    });
+
+    // All processes have exactly the same model
+    EXPECT_EQ(models[0]->beta, models[1]->beta);
+    EXPECT_EQ(models[0]->eta, models[1]->eta);
+
+    // which is the single process model
+    EXPECT_TRUE(models[0]->beta.isApprox(model->beta, 1e-3));
+    EXPECT_TRUE(models[0]->eta.isApprox(model->eta, 1e-2));
+}